@@ -0,0 +1,305 @@
+// CG2025_bench: CPU micro-benchmarks of the startup / per-frame hot paths (no GL context).
+// Usage: CG2025_bench [filter]   (runs the cases whose name contains filter)
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <assimp/mesh.h>
+#include "FrustumUtils.h"
+#include "InstanceData.h"
+#include "MeshImport.h"
+#include "MyPoissonSample.h"
+#include "PoissonDiskSampler.h"
+#include "SoftwareOcclusion.h"
+#include "terrain/MyTerrainData.h"
+#include "terrain/TerrainOccluderProxy.h"
+
+// ==============================================
+// allocation accounting for bytes/op
+
+static std::atomic<long long> g_allocBytes(0);
+static std::atomic<long long> g_allocCount(0);
+
+void* operator new(std::size_t size) {
+	g_allocBytes += (long long)size;
+	g_allocCount++;
+	if (void* p = std::malloc(size ? size : 1)) { return p; }
+	throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) { return ::operator new(size); }
+// kept out of line: GCC 12 otherwise inlines free() into call sites of new and
+// reports -Wmismatched-new-delete
+#if defined(__GNUC__)
+__attribute__((noinline))
+#endif
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { ::operator delete(p); }
+void operator delete(void* p, std::size_t) noexcept { ::operator delete(p); }
+void operator delete[](void* p, std::size_t) noexcept { ::operator delete(p); }
+
+// keeps results alive so the optimizer cannot drop the measured work
+static volatile float g_sink = 0.0f;
+static void consume(const float v) { g_sink = g_sink + v; }
+
+// ==============================================
+
+struct BenchCase {
+	std::string name;
+	// processes `items` elements per call (ns/item is reported alongside ns/op)
+	long long items;
+	std::function<void()> run;
+};
+
+static void runCase(const BenchCase& c) {
+	using Clock = std::chrono::steady_clock;
+	const double MIN_SECONDS = 0.2;
+
+	c.run(); // warm caches and lazy allocations
+
+	long long iterations = 1;
+	for (;;) {
+		const long long bytesBefore = g_allocBytes.load();
+		const long long countBefore = g_allocCount.load();
+		const Clock::time_point start = Clock::now();
+		for (long long i = 0; i < iterations; ++i) { c.run(); }
+		const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+		if (seconds >= MIN_SECONDS || iterations >= (1ll << 30)) {
+			const double nsPerOp = seconds * 1.0e9 / (double)iterations;
+			const double bytesPerOp = (double)(g_allocBytes.load() - bytesBefore) / (double)iterations;
+			const double allocsPerOp = (double)(g_allocCount.load() - countBefore) / (double)iterations;
+			std::printf("%-44s %14.1f ns/op %10.2f ns/item %14.0f B/op %8.1f allocs/op\n",
+				c.name.c_str(), nsPerOp, nsPerOp / (double)c.items, bytesPerOp, allocsPerOp);
+			return;
+		}
+		// aim a bit past the minimum so the next round is usually the last
+		const double scale = (seconds > 0.0) ? (MIN_SECONDS * 1.2 / seconds) : 10.0;
+		iterations = (long long)((double)iterations * std::min(std::max(scale, 2.0), 100.0));
+	}
+}
+
+// ==============================================
+// synthetic data
+
+static MyTerrainData* makeTerrain(const int size) {
+	MyTerrainData* terrain = new MyTerrainData();
+	terrain->m_elevationMapWidth = size;
+	terrain->m_elevationMapHeight = size;
+	terrain->m_elevationMap = new float[size * size * 4];
+	for (int i = 0; i < size * size; ++i) {
+		const int x = i % size, z = i / size;
+		terrain->m_elevationMap[i * 4] = 20.0f * std::sin(x * 0.05f) * std::cos(z * 0.07f);
+	}
+	// 1024 x 1024 world units over the map, like MyTerrain
+	terrain->m_worldVtoElevationUVMat = glm::scale(glm::mat4(1.0f), glm::vec3(1.0f / 1024.0f, 1.0f, 1.0f / 1024.0f));
+	return terrain;
+}
+
+static std::string writePoissonFile(const int numSample) {
+	MyPoissonSample sample;
+	sample.m_numSample = numSample;
+	sample.m_positions = new float[numSample * 3];
+	sample.m_radians = new float[numSample * 3];
+	std::mt19937 rng(numSample);
+	std::uniform_real_distribution<float> pos(0.0f, 1024.0f), rad(0.0f, 6.2831853f);
+	for (int i = 0; i < numSample; ++i) {
+		sample.setPosition(i, pos(rng), 0.0f, pos(rng));
+		sample.setRadians(i, 0.0f, rad(rng), 0.0f);
+	}
+	const std::string path = "bench_poisson_" + std::to_string(numSample) + ".ppd2";
+	std::ofstream output(path, std::ios::binary);
+	sample.exportBinaryFile(output);
+	return path;
+}
+
+static aiMesh* makeGridMesh(const int numVertexSide) {
+	aiMesh* mesh = new aiMesh();
+	const unsigned int n = (unsigned int)(numVertexSide * numVertexSide);
+	mesh->mNumVertices = n;
+	mesh->mVertices = new aiVector3D[n];
+	mesh->mNormals = new aiVector3D[n];
+	mesh->mTangents = new aiVector3D[n];
+	mesh->mBitangents = new aiVector3D[n];
+	mesh->mTextureCoords[0] = new aiVector3D[n];
+	mesh->mNumUVComponents[0] = 2;
+	for (unsigned int i = 0; i < n; ++i) {
+		const float u = (float)(i % numVertexSide) / (numVertexSide - 1);
+		const float v = (float)(i / numVertexSide) / (numVertexSide - 1);
+		mesh->mVertices[i] = aiVector3D(u, 0.0f, v);
+		mesh->mNormals[i] = aiVector3D(0.0f, 1.0f, 0.0f);
+		mesh->mTangents[i] = aiVector3D(1.0f, 0.0f, 0.0f);
+		mesh->mBitangents[i] = aiVector3D(0.0f, 0.0f, 1.0f);
+		mesh->mTextureCoords[0][i] = aiVector3D(u, v, 0.0f);
+	}
+	const unsigned int numQuadSide = (unsigned int)numVertexSide - 1;
+	mesh->mNumFaces = numQuadSide * numQuadSide * 2;
+	mesh->mFaces = new aiFace[mesh->mNumFaces];
+	for (unsigned int q = 0; q < numQuadSide * numQuadSide; ++q) {
+		const unsigned int x = q % numQuadSide, z = q / numQuadSide;
+		const unsigned int i0 = z * numVertexSide + x, i1 = i0 + 1, i2 = i0 + numVertexSide, i3 = i2 + 1;
+		const unsigned int tris[2][3] = { { i0, i2, i1 }, { i1, i2, i3 } };
+		for (int t = 0; t < 2; ++t) {
+			aiFace& face = mesh->mFaces[q * 2 + t];
+			face.mNumIndices = 3;
+			face.mIndices = new unsigned int[3];
+			std::memcpy(face.mIndices, tris[t], sizeof(tris[t]));
+		}
+	}
+	return mesh;
+}
+
+// ==============================================
+
+int main(int argc, char** argv) {
+	const std::string filter = (argc > 1) ? argv[1] : "";
+	std::vector<BenchCase> cases;
+	std::vector<std::function<void()>> cleanup;
+
+	const glm::mat4 view = glm::lookAt(glm::vec3(50.0f, 50.0f, 120.0f), glm::vec3(50.0f, 47.0f, 110.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	const glm::mat4 proj = glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 400.0f);
+
+	// terrain height: one query per player/airplane per step, queries spread over the map
+	for (const int size : { 256, 1024, 2048 }) {
+		MyTerrainData* terrain = makeTerrain(size);
+		cleanup.push_back([terrain]() { delete[] terrain->m_elevationMap; delete terrain; });
+		const int NUM_QUERY = 4096;
+		cases.push_back({ "MyTerrainData::height/" + std::to_string(size), NUM_QUERY, [terrain]() {
+			float sum = 0.0f;
+			for (int i = 0; i < NUM_QUERY; ++i) {
+				sum += terrain->height((float)((i * 37) % 1021) + 0.5f, (float)((i * 91) % 1019) + 0.25f);
+			}
+			consume(sum);
+		} });
+	}
+
+	// frustum planes
+	cases.push_back({ "extractFrustumPlanes", 1, [&]() {
+		glm::vec4 planes[6];
+		extractFrustumPlanes(proj * view, planes);
+		consume(planes[5].w);
+	} });
+	cases.push_back({ "extractFrustumPlanesFromCorners", 1, [&]() {
+		glm::vec3 corners[8];
+		computeFrustumCornersWS(view, proj, 0.1f, 400.0f, corners);
+		const glm::vec3 nearCorners[4] = { corners[3], corners[0], corners[1], corners[2] };
+		const glm::vec3 farCorners[4] = { corners[7], corners[4], corners[5], corners[6] };
+		glm::vec4 planes[6];
+		extractFrustumPlanesFromCorners(nearCorners, farCorners, planes);
+		consume(planes[5].w);
+	} });
+	for (const int numDepth : { 2, 4, 8 }) {
+		std::vector<float> depths(numDepth);
+		for (int i = 0; i < numDepth; ++i) { depths[i] = 0.1f + 400.0f * i / (numDepth - 1); }
+		cases.push_back({ "viewFrustumMultiClipCorner/" + std::to_string(numDepth), numDepth, [&view, &proj, depths]() {
+			float corners[8 * 12];
+			viewFrustumMultiClipCorner(depths, view, proj, corners);
+			consume(corners[0]);
+		} });
+	}
+	cases.push_back({ "computeFrustumCornersWS", 1, [&]() {
+		glm::vec3 corners[8];
+		computeFrustumCornersWS(view, proj, 10.0f, 60.0f, corners);
+		consume(corners[7].x);
+	} });
+	// SceneRenderer::updateShadowMatrices: 3 cascades
+	cases.push_back({ "updateShadowMatrices (3 cascades)", 3, [&]() {
+		const float cascadeNear[3] = { 0.1f, 30.0f, 100.0f };
+		const float cascadeFar[3] = { 30.0f, 100.0f, 400.0f };
+		const glm::vec3 lightDir = glm::normalize(glm::vec3(0.4f, 0.5f, 0.8f));
+		float sum = 0.0f;
+		for (int c = 0; c < 3; ++c) {
+			sum += computeCascadeLightVP(view, proj, cascadeNear[c], cascadeFar[c], lightDir, 2048)[3][0];
+		}
+		consume(sum);
+	} });
+
+	// poisson sample loading and the instance build loop of SceneRenderer::setUpInstanceBatches
+	for (const int numSample : { 1000, 10000, 100000, 621043 }) {
+		const std::string path = writePoissonFile(numSample);
+		cleanup.push_back([path]() { std::remove(path.c_str()); });
+		cases.push_back({ "MyPoissonSample::fromFile/" + std::to_string(numSample), numSample, [path]() {
+			MyPoissonSample* sample = MyPoissonSample::fromFile(path);
+			consume(sample->m_positions[0]);
+			delete sample;
+		} });
+
+		MyPoissonSample* sample = MyPoissonSample::fromFile(path);
+		cleanup.push_back([sample]() { delete sample; });
+		cases.push_back({ "buildInstanceData/" + std::to_string(numSample), numSample, [sample]() {
+			std::vector<InstanceDataGPU> instances(sample->m_numSample);
+			buildInstanceData(*sample, glm::vec3(0.0f, 0.66f, 0.0f), 1.4f, instances.data());
+			consume(instances.back().sphere.x);
+		} });
+	}
+
+	// Poisson-disk placement (CG2025_poisson): 128 m x 128 m at grass spacing, ~8k points
+	for (const int numThread : { 0, 1 }) {
+		const std::string name = (numThread == 1) ? "PoissonDiskSampler::sampleSerial" : "PoissonDiskSampler::sampleTiled";
+		cases.push_back({ name, 1, [numThread]() {
+			PoissonDiskSampler sampler(1.2f, glm::vec2(-64.0f), glm::vec2(64.0f), 7u);
+			const std::vector<glm::vec2> points = (numThread == 1) ? sampler.sampleSerial() : sampler.sampleTiled(0);
+			consume(points.back().x);
+		} });
+	}
+
+	// SceneRenderer::renderSoftwareOcclusion: terrain proxy + 48 boxes at 320 x 184, serial and threaded
+	{
+		MyTerrainData* terrain = makeTerrain(1024);
+		cleanup.push_back([terrain]() { delete[] terrain->m_elevationMap; delete terrain; });
+		TerrainOccluderProxy* proxy = new TerrainOccluderProxy();
+		cleanup.push_back([proxy]() { delete proxy; });
+		proxy->init(terrain, 8.0f);
+		static const float BOX_VERTICES[] = { -4, 0, -4, 4, 0, -4, 4, 0, 4, -4, 0, 4, -4, 12, -4, 4, 12, -4, 4, 12, 4, -4, 12, 4 };
+		static const uint32_t BOX_INDICES[] = { 0, 1, 2, 0, 2, 3, 4, 6, 5, 4, 7, 6, 0, 4, 5, 0, 5, 1, 1, 5, 6, 1, 6, 2, 2, 6, 7, 2, 7, 3, 3, 7, 4, 3, 4, 0 };
+		std::vector<glm::mat4> boxes;
+		for (int i = 0; i < 48; ++i) {
+			boxes.push_back(glm::translate(glm::mat4(1.0f), glm::vec3(20.0f + 12.0f * (i % 8), 25.0f, 60.0f - 10.0f * (i / 8))));
+		}
+		for (const int numWorker : { 0, -1 }) {
+			SoftwareOcclusionBuffer* buffer = new SoftwareOcclusionBuffer();
+			cleanup.push_back([buffer]() { delete buffer; });
+			buffer->resize(320, 184);
+			buffer->setNumWorkers(numWorker);
+			const std::string name = (numWorker == 0) ? "SoftwareOcclusion::rasterize/serial" : "SoftwareOcclusion::rasterize/threads";
+			cases.push_back({ name, 1, [&view, &proj, proxy, buffer, boxes]() {
+				proxy->update(glm::vec3(50.0f, 50.0f, 120.0f));
+				buffer->begin(proj * view, false);
+				buffer->addTriangles(proxy->vertices(), proxy->numVertex(), 3, proxy->indices(), proxy->numIndex(), glm::mat4(1.0f));
+				for (const glm::mat4& model : boxes) {
+					buffer->addTriangles(BOX_VERTICES, 8, 3, BOX_INDICES, 36, model);
+				}
+				buffer->rasterize();
+				consume((float)buffer->numRasterizedTriangles());
+			} });
+		}
+	}
+
+	// Assimp mesh -> interleaved vertex/index arrays
+	for (const int side : { 32, 128, 512 }) {
+		aiMesh* mesh = makeGridMesh(side);
+		cleanup.push_back([mesh]() { delete mesh; });
+		cases.push_back({ "interleaveAiMesh/" + std::to_string(side * side), (long long)side * side, [mesh]() {
+			std::vector<float> vertices(mesh->mNumVertices * INTERLEAVED_VERTEX_FLOATS);
+			std::vector<unsigned int> indices(mesh->mNumFaces * 3);
+			interleaveAiMesh(mesh, vertices.data(), indices.data());
+			consume(vertices.back());
+		} });
+	}
+
+	for (const BenchCase& c : cases) {
+		if (filter.empty() || c.name.find(filter) != std::string::npos) {
+			runCase(c);
+		}
+	}
+	for (auto& f : cleanup) { f(); }
+	return 0;
+}
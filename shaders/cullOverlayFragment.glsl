@@ -0,0 +1,15 @@
+#version 430 core
+
+in vec4 f_color;
+out vec4 fragColor;
+
+#include "uniformBlocks.glsl"
+
+// G-buffer depth of the same view: lines behind the scene are drawn faded instead of hidden
+layout(binding = 5) uniform sampler2D sceneDepth;
+
+void main() {
+    float depth = texelFetch(sceneDepth, ivec2(gl_FragCoord.xy), 0).r;
+    bool behind = (frame.depthFlags.x != 0) ? (gl_FragCoord.z < depth) : (gl_FragCoord.z > depth);
+    fragColor = vec4(f_color.rgb, behind ? 0.3 : 1.0);
+}
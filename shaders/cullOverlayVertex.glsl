@@ -0,0 +1,59 @@
+#version 430 core
+
+// God-view culling overlay: bounds of every instance of one batch as GL_LINES, colored by the
+// reason cullInstances.comp wrote for it. No vertex attributes; gl_VertexID walks the line list.
+out vec4 f_color;
+
+#include "uniformBlocks.glsl"
+
+struct InstanceData {
+    mat4 model;
+    vec4 sphere; // xyz center in world, w radius
+};
+
+layout(std430, binding = 0) readonly buffer InstanceBuffer {
+    InstanceData instances[];
+};
+
+// CullReason per instance (see cullInstances.comp)
+layout(std430, binding = 7) readonly buffer CullReasons {
+    uint cullReasons[];
+};
+
+layout(location = 0) uniform uint reasonMask; // bit per CullReason to draw
+layout(location = 1) uniform int boundsShape; // 0: sphere (3 great circles), 1: box around the sphere
+
+#define CIRCLE_SEGMENTS 16
+
+// visible, distance, frustum, off-screen, occluded, not in PVS
+const vec3 REASON_COLORS[6] = vec3[6](vec3(0.1, 1.0, 0.1), vec3(0.45, 0.45, 1.0), vec3(1.0, 0.9, 0.1),
+                                      vec3(1.0, 0.2, 1.0), vec3(1.0, 0.15, 0.1), vec3(0.1, 0.9, 1.0));
+
+// 12 edges as corner pairs, corner bits: x, y, z
+const int BOX_EDGES[24] = int[24](0, 1, 2, 3, 4, 5, 6, 7, 0, 2, 1, 3, 4, 6, 5, 7, 0, 4, 1, 5, 2, 6, 3, 7);
+
+void main() {
+    uint reason = min(cullReasons[gl_InstanceID], 5u);
+    if ((reasonMask & (1u << reason)) == 0u) {
+        // both ends outside the clip volume: the line is dropped by clipping
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        f_color = vec4(0.0);
+        return;
+    }
+
+    vec3 p;
+    if (boundsShape == 0) {
+        int line = gl_VertexID >> 1;
+        int circle = line / CIRCLE_SEGMENTS;
+        float angle = float(line % CIRCLE_SEGMENTS + (gl_VertexID & 1)) * (6.28318531 / float(CIRCLE_SEGMENTS));
+        vec2 c = vec2(cos(angle), sin(angle));
+        p = (circle == 0) ? vec3(c, 0.0) : ((circle == 1) ? vec3(0.0, c) : vec3(c.y, 0.0, c.x));
+    } else {
+        int corner = BOX_EDGES[gl_VertexID];
+        p = vec3(((corner & 1) != 0) ? 1.0 : -1.0, ((corner & 2) != 0) ? 1.0 : -1.0, ((corner & 4) != 0) ? 1.0 : -1.0);
+    }
+
+    vec4 sphere = instances[gl_InstanceID].sphere;
+    f_color = vec4(REASON_COLORS[reason], 1.0);
+    gl_Position = view.projMat * (view.viewMat * vec4(sphere.xyz + sphere.w * p, 1.0));
+}
@@ -0,0 +1,21 @@
+// Front-to-back visible lists (mirrored by DEPTH_BIN_* in src/InstanceData.h).
+// cullInstances.comp appends (instance, bin) pairs and counts each bin, depthBinScan.comp turns the
+// counts into bin offsets and the scatter dispatch size, depthBinScatter.comp writes indices[] bin by bin.
+
+#define NUM_DEPTH_BIN 64
+
+// bins are finer close to the camera: bin = sqrt(viewDepth / maxViewDepth) * NUM_DEPTH_BIN
+uint depthBin(float viewDepth, float maxViewDepth) {
+    float t = sqrt(clamp(viewDepth / maxViewDepth, 0.0, 1.0));
+    return min(uint(t * float(NUM_DEPTH_BIN)), uint(NUM_DEPTH_BIN - 1));
+}
+
+layout(std430, binding = 3) buffer DepthBinEntries {
+    uvec2 binEntries[]; // x: instance index, y: bin
+};
+
+layout(std430, binding = 4) buffer DepthBins {
+    uint binCount[NUM_DEPTH_BIN];
+    uint binOffset[NUM_DEPTH_BIN]; // exclusive prefix sum of binCount, advanced by the scatter
+    uvec4 scatterDispatch;         // xyz: glDispatchComputeIndirect arguments of depthBinScatter.comp
+};
@@ -0,0 +1,12 @@
+#version 430 core
+
+// Foliage depth prepass: alpha test only (same cutout as texturePass() in oglFragmentShader.glsl)
+in vec2 f_uv;
+
+layout(binding = 0) uniform sampler2D albedoTexture;
+
+void main() {
+    if (texture(albedoTexture, f_uv).a < 0.5) {
+        discard;
+    }
+}
@@ -0,0 +1,32 @@
+#version 430 core
+
+// Foliage depth prepass: same position math as instanceProcess() in oglVertexShader.glsl
+layout(location=0) in vec3 v_vertex;
+layout(location=3) in vec2 v_uv;
+
+out vec2 f_uv;
+invariant gl_Position;
+
+#include "uniformBlocks.glsl"
+
+struct InstanceData {
+    mat4 model;
+    vec4 sphere;
+};
+
+layout(std430, binding = 0) readonly buffer InstanceBuffer {
+    InstanceData instances[];
+};
+
+layout(std430, binding = 1) readonly buffer VisibleBuffer {
+    uint count;
+    uint indices[];
+};
+
+void main() {
+    uint visibleIdx = indices[gl_InstanceID];
+    mat4 m = instances[visibleIdx].model;
+    vec4 worldVertex = m * vec4(v_vertex, 1.0);
+    f_uv = v_uv;
+    gl_Position = view.projMat * (view.viewMat * worldVertex);
+}
@@ -0,0 +1,15 @@
+#version 430 core
+
+// Foliage G-buffer pass after the depth prepass: depth test GL_EQUAL without depth writes, so
+// the alpha test is already in the depth buffer and every pixel is shaded once
+layout(early_fragment_tests) in;
+
+#include "uniformBlocks.glsl"
+#include "gbufferOutput.glsl"
+#include "overdraw.glsl"
+
+void main(){
+    countOverdraw();
+    vec3 texel = texture(albedoTexture, f_uv).rgb;
+    writeGBuffer(texel, computeWorldNormal());
+}
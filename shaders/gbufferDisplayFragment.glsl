@@ -3,34 +3,40 @@
 in vec2 v_uv;
 out vec4 fragColor;
 
-layout(location = 0) uniform sampler2D gPositionTex;
-layout(location = 1) uniform sampler2D gNormalTex;
-layout(location = 2) uniform sampler2D gAmbientTex;
-layout(location = 3) uniform sampler2D gDiffuseTex;
-layout(location = 4) uniform sampler2D gSpecularTex;
-layout(location = 5) uniform int displayMode; // 0:pos,1:normal,2:ambient,3:diffuse,4:specular
+#include "uniformBlocks.glsl"
+#include "shadowMoments.glsl"
+
+layout(binding = 0) uniform sampler2D gPositionTex;
+layout(binding = 1) uniform sampler2D gNormalTex;
+layout(binding = 2) uniform sampler2D gAmbientTex;
+layout(binding = 3) uniform sampler2D gDiffuseTex;
+layout(binding = 4) uniform sampler2D gSpecularTex;
+layout(binding = 5) uniform sampler2D depthPyramid;
+layout(binding = 6) uniform sampler2DArrayShadow shadowMap;
+layout(binding = 7) uniform usampler2D overdrawTex;
+layout(binding = 8) uniform sampler2DArray shadowMoments; // prefiltered (EVSM), frame.shadowFlags.w
+layout(location = 5) uniform int displayMode; // 0:pos,1:normal,2:ambient,3:diffuse,4:specular,5:default,6:depth mip,7:overdraw
 layout(location = 6) uniform vec2 uvScale;
 layout(location = 7) uniform vec2 uvBias;
-layout(location = 8) uniform vec3 lightDirWorld;
-layout(location = 9) uniform vec3 cameraPosWorld;
-layout(location = 10) uniform mat4 viewMat;
-layout(location = 11) uniform sampler2D depthPyramid;
 layout(location = 12) uniform int depthMipLevel;
-layout(location = 13) uniform mat4 invProj;
 layout(location = 14) uniform float depthVisFar;
 layout(location = 16) uniform float depthVisGamma; // 1.0 = no curve
-// Cascaded shadow mapping
-layout(location = 17) uniform int shadowEnabled;
-layout(location = 18) uniform int cascadeVizEnabled;
-layout(location = 19) uniform vec3 cascadeFar; // (50, 200, 500)
-layout(location = 20) uniform mat4 lightVP[3];
-layout(location = 32) uniform sampler2DArrayShadow shadowMap;
-layout(location = 34) uniform mat4 cullViewMat;
+// light, camera and cascaded shadow state come from FrameBlock / ViewBlock / ShadowBlock
 
 vec3 viewVec(vec3 v){
     return normalize(v) * 0.5 + 0.5;
 }
 
+// depth buffer value -> NDC z ([0,1] clip depth with reversed-Z)
+float depthToNDC(float depth){
+    return (frame.depthFlags.x != 0) ? depth : depth * 2.0 - 1.0;
+}
+
+// cleared depth: nothing was drawn
+bool isBackground(float depth){
+    return (frame.depthFlags.x != 0) ? (depth <= 0.000001) : (depth >= 0.999999);
+}
+
 vec4 applyFog(vec4 color, vec3 viewPos){
     const vec4  FOG_COLOR = vec4(0.0, 0.0, 0.0, 1.0);
     const float MAX_DIST = 400.0;
@@ -49,19 +55,45 @@ vec4 applyGamma(vec4 color){
     return color;
 }
 
+// black 0, blue 1, cyan 2, green 4, yellow 8, red 16, white 32+ fragment shader invocations
+vec3 overdrawHeat(uint n){
+    if (n == 0u) return vec3(0.0);
+    const vec3 RAMP[6] = vec3[6](vec3(0.0, 0.0, 1.0), vec3(0.0, 1.0, 1.0), vec3(0.0, 1.0, 0.0),
+                                 vec3(1.0, 1.0, 0.0), vec3(1.0, 0.0, 0.0), vec3(1.0, 1.0, 1.0));
+    float t = clamp(log2(float(n)), 0.0, 5.0);
+    int i = min(int(t), 4);
+    return mix(RAMP[i], RAMP[i + 1], t - float(i));
+}
+
 bool chooseCascadeMapBased(vec3 worldPos, out int chosen, out vec3 uvz);
 
-float sampleShadow(vec3 worldPos, vec3 normalWS) {
-    if (shadowEnabled == 0) return 1.0;
+// dPdx, dPdy: screen-space derivatives of worldPos, taken in uniform control flow
+float sampleShadow(vec3 worldPos, vec3 normalWS, vec3 dPdx, vec3 dPdy) {
+    if (frame.shadowFlags.x == 0) return 1.0;
 	int chosen = -1;
 	vec3 uvz = vec3(0.0);
 	if (!chooseCascadeMapBased(worldPos, chosen, uvz)) return 1.0;
 
 	// Bias: reduce acne (world-space normal vs world-space light direction).
-	vec3 Lw = normalize(lightDirWorld);
+	vec3 Lw = normalize(frame.lightDirWorld.xyz);
 	float ndl = max(dot(normalize(normalWS), Lw), 0.0);
 	float bias = max(0.0008 * (1.0 - ndl), 0.0003);
 
+	if (frame.shadowFlags.w != 0) {
+		// one filtered fetch; the light projection is affine, so it maps the derivatives directly.
+		// Silhouette pixels (huge derivatives) are limited to a 16-texel footprint.
+		mat4 lightVP = shadow.lightVP[chosen];
+		float maxGrad = 16.0 / float(textureSize(shadowMoments, 0).x);
+		vec2 gx = (lightVP * vec4(dPdx, 0.0)).xy * 0.5;
+		vec2 gy = (lightVP * vec4(dPdy, 0.0)).xy * 0.5;
+		gx *= min(1.0, maxGrad / max(length(gx), 1e-8));
+		gy *= min(1.0, maxGrad / max(length(gy), 1e-8));
+		vec4 moments = textureGrad(shadowMoments, vec3(uvz.xy, float(chosen)), gx, gy);
+		// distance from the light: reversed-Z has the light's near plane at 1
+		float depth = (frame.depthFlags.x != 0) ? 1.0 - uvz.z : uvz.z;
+		return evsmVisibility(moments, depth - bias);
+	}
+
 	ivec3 ts = textureSize(shadowMap, 0);
 	vec2 texel = 1.0 / vec2(max(ts.x, 1), max(ts.y, 1));
 
@@ -69,7 +101,8 @@ float sampleShadow(vec3 worldPos, vec3 normalWS) {
 	for (int y = -1; y <= 1; ++y) {
 		for (int x = -1; x <= 1; ++x) {
 			vec2 o = vec2(x, y) * texel;
-			sum += texture(shadowMap, vec4(uvz.xy + o, float(chosen), uvz.z - bias));
+			// reversed-Z: towards the light is towards 1
+			sum += texture(shadowMap, vec4(uvz.xy + o, float(chosen), (frame.depthFlags.x != 0) ? uvz.z + bias : uvz.z - bias));
 		}
 	}
 	return sum / 9.0;
@@ -78,11 +111,12 @@ float sampleShadow(vec3 worldPos, vec3 normalWS) {
 bool chooseCascadeMapBased(vec3 worldPos, out int chosen, out vec3 uvz) {
 	chosen = -1;
 	uvz = vec3(0.0);
-	for (int c = 0; c < 3; ++c) {
-		vec4 clip = lightVP[c] * vec4(worldPos, 1.0);
+	for (int c = 0; c < frame.shadowFlags.z; ++c) {
+		vec4 clip = shadow.lightVP[c] * vec4(worldPos, 1.0);
 		if (abs(clip.w) < 1e-6) continue;
 		vec3 ndc = clip.xyz / clip.w;
 		vec3 t = ndc * 0.5 + 0.5;
+		if (frame.depthFlags.x != 0) t.z = ndc.z;
 		if (t.x >= 0.0 && t.x <= 1.0 && t.y >= 0.0 && t.y <= 1.0 && t.z >= 0.0 && t.z <= 1.0) {
 			chosen = c;
 			uvz = t;
@@ -116,9 +150,9 @@ void main(){
         vec3 specColor = specPacked.rgb;
         float shininess = max(specPacked.a, 1.0);
 
-        vec3 viewPos = (viewMat * vec4(P, 1.0)).xyz;
-        vec3 N = normalize(mat3(viewMat) * Nworld);
-        vec3 L = normalize((viewMat * vec4(lightDirWorld, 0.0)).xyz);
+        vec3 viewPos = (view.viewMat * vec4(P, 1.0)).xyz;
+        vec3 N = normalize(mat3(view.viewMat) * Nworld);
+        vec3 L = normalize((view.viewMat * vec4(frame.lightDirWorld.xyz, 0.0)).xyz);
         vec3 V = normalize(-viewPos);
         vec3 H = normalize(L + V);
 
@@ -130,38 +164,44 @@ void main(){
         float ndh = max(dot(N, H), 0.0);
         float spec = (ndl > 0.0) ? pow(ndh, shininess) : 0.0;
 
-        // Background pixels have depth==1 and cleared G-buffer; keep them untouched (sky stays black).
-        float shadow = (rawDepth >= 0.999999) ? 1.0 : sampleShadow(P, Nworld);
+        // Background pixels have the cleared depth and G-buffer; keep them untouched (sky stays black).
+        vec3 dPdx = dFdx(P);
+        vec3 dPdy = dFdy(P);
+        float lit = isBackground(rawDepth) ? 1.0 : sampleShadow(P, Nworld, dPdx, dPdy);
         vec3 direct = Id * diffuse * ndl + Is * specColor * spec;
-        vec4 shaded = vec4(Ia * ambient + shadow * direct, 1.0);
+        vec4 shaded = vec4(Ia * ambient + lit * direct, 1.0);
         vec3 outColor = applyGamma(applyFog(shaded, viewPos)).rgb;
 
-        // Visualize cascades (RGB mixing) using map-based cascade selection:
+        // Visualize cascades (RGB, then yellow) using map-based cascade selection:
         // pick the tightest cascade that covers this pixel in shadow texture space.
-        if (cascadeVizEnabled != 0 && rawDepth < 0.999999) {
+        if (frame.shadowFlags.y != 0 && !isBackground(rawDepth)) {
 			int cas = -1;
 			vec3 uvz = vec3(0.0);
 			if (chooseCascadeMapBased(P, cas, uvz)) {
 				vec3 tint = (cas == 0) ? vec3(1.0, 0.0, 0.0)
 					: (cas == 1) ? vec3(0.0, 1.0, 0.0)
-					: vec3(0.0, 0.0, 1.0);
+					: (cas == 2) ? vec3(0.0, 0.0, 1.0)
+					: vec3(1.0, 1.0, 0.0);
 				outColor = clamp(outColor * 0.6 + tint * 0.4, 0.0, 1.0);
 			}
         }
 
         color = outColor;
     } else if(displayMode == 6){
-        // depth mip visualization
-        float depthVal = textureLod(depthPyramid, uv, float(depthMipLevel)).r;
+        // depth mip visualization: g = farthest depth of the min/max pyramid
+        float depthVal = textureLod(depthPyramid, uv, float(depthMipLevel)).g;
         // Linearized view-space z normalized by far
-        vec4 ndcV = vec4(uv * 2.0 - 1.0, depthVal * 2.0 - 1.0, 1.0);
-        vec4 viewV = invProj * ndcV;
+        vec4 ndcV = vec4(uv * 2.0 - 1.0, depthToNDC(depthVal), 1.0);
+        vec4 viewV = view.invProjMat * ndcV;
         viewV /= viewV.w;
         float denom = max(depthVisFar, 0.001);
         float d = clamp(-viewV.z / denom, 0.0, 1.0);
         float g = max(depthVisGamma, 0.001);
         d = pow(d, g);
         color = vec3(d);
+    } else if(displayMode == 7){
+        uint n = texelFetch(overdrawTex, ivec2(uv * vec2(textureSize(overdrawTex, 0))), 0).x;
+        color = overdrawHeat(n);
     } else {
         color = texture(gDiffuseTex, uv).rgb;
     }
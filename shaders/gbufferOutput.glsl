@@ -0,0 +1,39 @@
+// G-buffer inputs/outputs shared by oglFragmentShader.glsl and foliageGBufferFragment.glsl
+// (include after uniformBlocks.glsl)
+
+in vec3 f_worldPos;      // from VS
+in vec2 f_uv;
+in vec3 f_lightDirTS;
+in vec3 f_eyeDirTS;
+in vec3 f_normalWS;
+in vec3 f_tangentWS;
+in vec3 f_bitangentWS;
+
+layout(location = 0) out vec4 gPosition;
+layout(location = 1) out vec4 gNormal;
+layout(location = 2) out vec4 gAmbient;
+layout(location = 3) out vec4 gDiffuse;
+layout(location = 4) out vec4 gSpecular;
+
+layout(location = 10) uniform int materialIndex;
+layout(binding = 0) uniform sampler2D albedoTexture;
+layout(binding = 2) uniform sampler2D normalTexture;
+
+vec3 computeWorldNormal(){
+    vec3 N = normalize(f_normalWS);
+    if (materials[materialIndex].flags.z == 1) {
+        vec3 nTex = texture(normalTexture, f_uv).xyz * 2.0 - 1.0;
+        mat3 TBN = mat3(normalize(f_tangentWS), normalize(f_bitangentWS), normalize(f_normalWS));
+        N = normalize(TBN * nTex);
+    }
+    return N;
+}
+
+void writeGBuffer(vec3 baseColor, vec3 normalWS){
+    gPosition = vec4(f_worldPos, 1.0);
+    gNormal   = vec4(normalize(normalWS), 1.0);
+    MaterialData mtl = materials[materialIndex];
+    gAmbient  = vec4(baseColor * mtl.ambient.rgb, 1.0);
+    gDiffuse  = vec4(baseColor, 1.0);
+    gSpecular = mtl.specularShininess;
+}
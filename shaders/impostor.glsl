@@ -0,0 +1,20 @@
+// Octahedral impostor frames (mirrored by src/ImpostorAtlas.h): frames x frames views of the mesh's
+// bounding sphere from directions on a hemi-octahedral grid of the upper hemisphere
+
+vec2 hemiOctEncode(vec3 dir) {
+    vec3 d = dir / (abs(dir.x) + abs(dir.y) + abs(dir.z));
+    return vec2(d.x + d.z, d.x - d.z) * 0.5 + 0.5;
+}
+
+vec3 hemiOctDecode(vec2 uv) {
+    vec2 t = uv * 2.0 - 1.0;
+    vec2 p = vec2(t.x + t.y, t.x - t.y) * 0.5;
+    return normalize(vec3(p.x, 1.0 - abs(p.x) - abs(p.y), p.y));
+}
+
+// right x up = dir; straight down views use -z as up
+void impostorFrameBasis(vec3 dir, out vec3 right, out vec3 up) {
+    vec3 upRef = (dir.y > 0.999) ? vec3(0.0, 0.0, -1.0) : vec3(0.0, 1.0, 0.0);
+    right = normalize(cross(upRef, dir));
+    up = cross(dir, right);
+}
@@ -0,0 +1,22 @@
+#version 430 core
+
+in vec3 f_normalOS;
+in vec2 f_uv;
+in float f_depth;
+
+layout(location = 0) out vec4 outAlbedo;
+layout(location = 1) out vec4 outNormalDepth;
+
+layout(binding = 0) uniform sampler2D albedoTexture;
+
+void main() {
+    vec4 texel = texture(albedoTexture, f_uv);
+    // same cutout as the G-buffer texture pass
+    if (texel.a < 0.5) {
+        discard;
+    }
+    vec3 n = normalize(f_normalOS);
+    if (!gl_FrontFacing) n = -n;
+    outAlbedo = vec4(texel.rgb, 1.0);
+    outNormalDepth = vec4(n * 0.5 + 0.5, clamp(f_depth * 0.5 + 0.5, 0.0, 1.0));
+}
@@ -0,0 +1,25 @@
+#version 430 core
+
+// ImpostorBaker: one orthographic frame of the octahedral atlas (src/ImpostorAtlas.h)
+
+layout(location=0) in vec3 v_vertex;
+layout(location=1) in vec3 v_normal;
+layout(location=3) in vec2 v_uv;
+
+out vec3 f_normalOS;
+out vec2 f_uv;
+out float f_depth; // along the frame direction, [-1, 1] of the radius
+
+layout(location = 0) uniform vec4 bounds; // xyz center, w radius (object space)
+layout(location = 1) uniform vec3 frameDir;
+layout(location = 2) uniform vec3 frameRight;
+layout(location = 3) uniform vec3 frameUp;
+
+void main() {
+    vec3 p = (v_vertex - bounds.xyz) / bounds.w;
+    f_normalOS = v_normal;
+    f_uv = v_uv;
+    f_depth = dot(p, frameDir);
+    // clip depth in [0, 1] (valid for both clip conventions), nearer the viewer is smaller
+    gl_Position = vec4(dot(p, frameRight), dot(p, frameUp), (1.0 - f_depth) * 0.5, 1.0);
+}
@@ -0,0 +1,68 @@
+#version 430 core
+
+// Impostor G-buffer / shadow fragments: the atlas texel's surface point is rebuilt from the baked
+// depth and written as gl_FragDepth, so impostors depth-test (and cast shadows) like the mesh
+
+in vec3 f_posOS;
+in vec2 f_atlasUV;
+in flat vec3 f_frameDirOS;
+in flat uint f_instance;
+
+#include "uniformBlocks.glsl"
+#include "overdraw.glsl"
+
+layout(location = 0) out vec4 gPosition;
+layout(location = 1) out vec4 gNormal;
+layout(location = 2) out vec4 gAmbient;
+layout(location = 3) out vec4 gDiffuse;
+layout(location = 4) out vec4 gSpecular;
+
+layout(location = 10) uniform int materialIndex;
+layout(location = 12) uniform vec4 impostorBounds;
+layout(location = 14) uniform int shadowCascade;
+
+layout(binding = 0) uniform sampler2D impostorAlbedo;
+layout(binding = 1) uniform sampler2D impostorNormalDepth;
+
+struct InstanceData {
+    mat4 model;
+    vec4 sphere;
+};
+
+layout(std430, binding = 0) readonly buffer InstanceBuffer {
+    InstanceData instances[];
+};
+
+// casters are pushed away from the light by this fraction of the radius (no polygon offset with
+// gl_FragDepth)
+const float SHADOW_BIAS = 0.05;
+
+void main() {
+    vec4 albedo = texture(impostorAlbedo, f_atlasUV);
+    // same cutout as the G-buffer texture pass
+    if (albedo.a < 0.5) {
+        discard;
+    }
+    vec4 normalDepth = texture(impostorNormalDepth, f_atlasUV);
+    float offset = normalDepth.a * 2.0 - 1.0;
+    if (shadowCascade >= 0) offset -= SHADOW_BIAS;
+    vec3 surfaceOS = f_posOS + f_frameDirOS * offset * impostorBounds.w;
+
+    mat4 m = instances[f_instance].model;
+    vec4 worldPos = m * vec4(surfaceOS, 1.0);
+    vec4 clip = (shadowCascade < 0) ? view.projMat * (view.viewMat * worldPos) : shadow.lightVP[shadowCascade] * worldPos;
+    float ndcZ = clip.z / clip.w;
+    gl_FragDepth = (frame.depthFlags.x != 0) ? ndcZ : ndcZ * 0.5 + 0.5;
+    if (shadowCascade >= 0) return;
+
+    countOverdraw();
+    // coverage-weighted mips: undo the premultiplication by the empty texels around the silhouette
+    vec3 baseColor = albedo.rgb / max(albedo.a, 1e-3);
+    vec3 normalWS = mat3(m) * (normalDepth.xyz * 2.0 - 1.0);
+    MaterialData mtl = materials[materialIndex];
+    gPosition = vec4(worldPos.xyz, 1.0);
+    gNormal   = vec4(normalize(normalWS), 1.0);
+    gAmbient  = vec4(baseColor * mtl.ambient.rgb, 1.0);
+    gDiffuse  = vec4(baseColor, 1.0);
+    gSpecular = mtl.specularShininess;
+}
@@ -0,0 +1,66 @@
+#version 430 core
+
+// Distant instances of a batch as camera-facing quads of its octahedral impostor (src/ImpostorAtlas.h):
+// the frame nearest the view direction, in object space, is drawn on its own image plane. 6 vertices
+// per instance from gl_VertexID; the instances are the impostor list cullInstances.comp writes.
+
+out vec3 f_posOS;              // on the frame's image plane
+out vec2 f_atlasUV;
+out flat vec3 f_frameDirOS;
+out flat uint f_instance;
+
+#include "uniformBlocks.glsl"
+#include "impostor.glsl"
+
+layout(location = 12) uniform vec4 impostorBounds; // xyz center, w radius (object space)
+layout(location = 13) uniform int impostorFrames;
+layout(location = 14) uniform int shadowCascade;   // -1: camera view, else the cascade seen from the light
+
+struct InstanceData {
+    mat4 model;
+    vec4 sphere;
+};
+
+layout(std430, binding = 0) readonly buffer InstanceBuffer {
+    InstanceData instances[];
+};
+
+// DrawArraysIndirectCommand followed by the instance indices
+layout(std430, binding = 9) readonly buffer ImpostorList {
+    uint vertexCount;
+    uint instanceCount;
+    uint first;
+    uint baseInstance;
+    uint impostorIndices[];
+};
+
+const vec2 CORNERS[6] = vec2[6](vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0),
+                                vec2(-1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0));
+
+void main() {
+    uint idx = impostorIndices[gl_InstanceID];
+    mat4 m = instances[idx].model;
+    vec3 centerWS = (m * vec4(impostorBounds.xyz, 1.0)).xyz;
+
+    // instances are rotated and translated only: the inverse rotation takes the view into object space
+    vec3 toEye = (shadowCascade < 0) ? view.cameraPosWorld.xyz - centerWS : frame.lightDirWorld.xyz;
+    vec3 dirOS = transpose(mat3(m)) * toEye;
+    // frames cover the upper hemisphere: views from below use the horizon
+    dirOS.y = max(dirOS.y, 0.0);
+    dirOS = (dot(dirOS, dirOS) > 1e-12) ? normalize(dirOS) : vec3(0.0, 1.0, 0.0);
+
+    float last = float(impostorFrames - 1);
+    vec2 frameCell = clamp(floor(hemiOctEncode(dirOS) * last + 0.5), vec2(0.0), vec2(last));
+    vec3 frameDir = hemiOctDecode(frameCell / last);
+    vec3 right, up;
+    impostorFrameBasis(frameDir, right, up);
+
+    vec2 corner = CORNERS[gl_VertexID % 6];
+    f_posOS = impostorBounds.xyz + (corner.x * right + corner.y * up) * impostorBounds.w;
+    f_atlasUV = (frameCell + corner * 0.5 + 0.5) / float(impostorFrames);
+    f_frameDirOS = frameDir;
+    f_instance = idx;
+
+    vec4 worldPos = m * vec4(f_posOS, 1.0);
+    gl_Position = (shadowCascade < 0) ? view.projMat * (view.viewMat * worldPos) : shadow.lightVP[shadowCascade] * worldPos;
+}
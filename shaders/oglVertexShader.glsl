@@ -13,16 +13,17 @@ out vec3 f_normalWS;      // world-space normal (vertex)
 out vec3 f_tangentWS;     // world-space tangent
 out vec3 f_bitangentWS;   // world-space bitangent
 out flat uint f_instanceVisibleIdx;
+// must match foliageDepthVertex.glsl bit for bit: the foliage G-buffer pass tests GL_EQUAL against it
+invariant gl_Position;
 
+#include "uniformBlocks.glsl"
+
+// per-draw state; everything else comes from the uniform blocks
 layout(location = 0) uniform mat4 modelMat;
-layout(location = 5) uniform sampler2D elevationMap;
-layout(location = 6) uniform sampler2D normalMap;
-layout(location = 7) uniform mat4 viewMat;
-layout(location = 8) uniform mat4 projMat;
 layout(location = 9) uniform mat4 terrainVToUVMat;
-layout(location = 1) uniform int vertexProcessIdx;
-layout(location = 17) uniform vec3 lightDirWorld;
-layout(location = 18) uniform vec3 cameraPosWorld;
+layout(location = 10) uniform int materialIndex;
+layout(binding = 3) uniform sampler2D elevationMap;
+layout(binding = 2) uniform sampler2D normalMap;
 
 // GPU-driven instancing buffers
 struct InstanceData {
@@ -39,6 +40,15 @@ layout(std430, binding = 1) readonly buffer VisibleBuffer {
     uint indices[];
 };
 
+// cluster-culled batches (clusterCull.comp) draw without vertex attributes: the index is
+// (instance << clusterVertexBits) | vertex, the vertex is read from the batch's interleaved
+// vertex buffer (MeshImport.h)
+layout(location = 12) uniform int clusterVertexBits;
+
+layout(std430, binding = 13) readonly buffer ClusterVertexBuffer {
+    float clusterVertices[];
+};
+
 // ========== 動態物件（飛機、石頭等） ==========
 void commonProcess(){
     // TBN
@@ -55,12 +65,12 @@ void commonProcess(){
     f_bitangentWS = B;
 
     // light/view direction in tangent space
-    vec3 L = normalize(lightDirWorld);
-    vec3 V = normalize(cameraPosWorld - f_worldPos);
+    vec3 L = normalize(frame.lightDirWorld.xyz);
+    vec3 V = normalize(view.cameraPosWorld.xyz - f_worldPos);
     f_lightDirTS = vec3(dot(L, T), dot(L, B), dot(L, N));
     f_eyeDirTS   = vec3(dot(V, T), dot(V, B), dot(V, N));
 
-    gl_Position = projMat * (viewMat * worldVertex);
+    gl_Position = view.projMat * (view.viewMat * worldVertex);
 }
 
 // ========== 地形（height map + normal map） ==========
@@ -100,44 +110,59 @@ void terrainProcess(){
     f_tangentWS   = T;
     f_bitangentWS = B;
 
-    vec3 L = normalize(lightDirWorld);
-    vec3 V = normalize(cameraPosWorld - f_worldPos);
+    vec3 L = normalize(frame.lightDirWorld.xyz);
+    vec3 V = normalize(view.cameraPosWorld.xyz - f_worldPos);
     f_lightDirTS = vec3(dot(L, T), dot(L, B), dot(L, N));
     f_eyeDirTS   = vec3(dot(V, T), dot(V, B), dot(V, N));
 
     // 投影
-    vec4 viewVertex = viewMat * worldV;
-    gl_Position = projMat * viewVertex;
+    vec4 viewVertex = view.viewMat * worldV;
+    gl_Position = view.projMat * viewVertex;
 }
 
-void instanceProcess(){
-    // fetch visible index (visible buffer has count at slot 0)
-    uint visibleIdx = indices[gl_InstanceID + 1u];
-    InstanceData inst = instances[visibleIdx];
+void instanceVertex(uint instanceIdx, vec3 position, vec3 normal, vec3 tangent, vec2 uv){
+    InstanceData inst = instances[instanceIdx];
     mat4 m = inst.model;
 
     mat3 normalMat = transpose(inverse(mat3(m)));
-    vec3 T = normalize(normalMat * v_tangent);
-    vec3 N = normalize(normalMat * v_normal);
+    vec3 T = normalize(normalMat * tangent);
+    vec3 N = normalize(normalMat * normal);
     vec3 B = normalize(cross(N, T));
 
-    vec4 worldVertex = m * vec4(v_vertex, 1.0);
+    vec4 worldVertex = m * vec4(position, 1.0);
     f_worldPos = worldVertex.xyz;
-    f_uv       = v_uv;
+    f_uv       = uv;
     f_normalWS   = N;
     f_tangentWS  = T;
     f_bitangentWS = B;
-    f_instanceVisibleIdx = visibleIdx;
+    f_instanceVisibleIdx = instanceIdx;
 
-    vec3 L = normalize(lightDirWorld);
-    vec3 V = normalize(cameraPosWorld - f_worldPos);
+    vec3 L = normalize(frame.lightDirWorld.xyz);
+    vec3 V = normalize(view.cameraPosWorld.xyz - f_worldPos);
     f_lightDirTS = vec3(dot(L, T), dot(L, B), dot(L, N));
     f_eyeDirTS   = vec3(dot(V, T), dot(V, B), dot(V, N));
 
-    gl_Position = projMat * (viewMat * worldVertex);
+    gl_Position = view.projMat * (view.viewMat * worldVertex);
+}
+
+void instanceProcess(){
+    // fetch visible index (visible buffer has count at slot 0, indices[] follows it)
+    instanceVertex(indices[gl_InstanceID], v_vertex, v_normal, v_tangent, v_uv);
+}
+
+void clusterProcess(){
+    uint id = uint(gl_VertexID);
+    uint bits = uint(clusterVertexBits);
+    uint v = (id & ((1u << bits) - 1u)) * 11u;
+    vec3 position = vec3(clusterVertices[v], clusterVertices[v + 1u], clusterVertices[v + 2u]);
+    vec3 normal = vec3(clusterVertices[v + 3u], clusterVertices[v + 4u], clusterVertices[v + 5u]);
+    vec3 tangent = vec3(clusterVertices[v + 6u], clusterVertices[v + 7u], clusterVertices[v + 8u]);
+    vec2 uv = vec2(clusterVertices[v + 9u], clusterVertices[v + 10u]);
+    instanceVertex(id >> bits, position, normal, tangent, uv);
 }
 
 void main(){
+    const int vertexProcessIdx = materials[materialIndex].flags.y;
     if(vertexProcessIdx == 0){
         commonProcess();
     }
@@ -147,6 +172,9 @@ void main(){
     else if(vertexProcessIdx == 4){
         instanceProcess();
     }
+    else if(vertexProcessIdx == 8){
+        clusterProcess();
+    }
     else{
         commonProcess();
     }
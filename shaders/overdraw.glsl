@@ -0,0 +1,48 @@
+// Overdraw heatmap (G-buffer display mode 7, see SceneRenderer::setOverdrawEnabled): every G-buffer
+// fragment shader invocation counts itself per pixel and per draw slot. The depth prepass is not
+// counted. Only the OVERDRAW_COUNT variants count: the image writes are side effects, so the
+// programs without early_fragment_tests also run (and count) fragments that fail the depth test.
+// Without OVERDRAW_COUNT countOverdraw() is empty and the normal programs keep early depth tests.
+
+#ifdef OVERDRAW_COUNT
+layout(binding = 2, r32ui) uniform coherent uimage2D overdrawCount; // invocations per pixel
+layout(binding = 3, r32ui) uniform coherent uimage2D overdrawOwner; // (slot + 1) << 20 | invocations of that slot
+
+layout(std430, binding = 5) buffer OverdrawStats {
+    uvec4 overdrawStats[]; // [0]: all slots, [1 + slot]: x invocations, y pixels, z max per pixel
+};
+
+// -1: off, -2: heat image only (god view), 0: terrain + objects, 1 + i: instance batch i,
+// 1 + n + i: impostors of batch i (n batches); no fixed location, looked up by name
+uniform int overdrawSlot = -1;
+
+void countOverdraw() {
+    if (overdrawSlot == -1) return;
+    ivec2 p = ivec2(gl_FragCoord.xy);
+    uint total = imageAtomicAdd(overdrawCount, p, 1u) + 1u;
+    if (overdrawSlot < 0) return;
+
+    atomicAdd(overdrawStats[0].x, 1u);
+    if (total == 1u) atomicAdd(overdrawStats[0].y, 1u);
+    atomicMax(overdrawStats[0].z, total);
+
+    // per-slot count: the owner texel restarts when another slot draws over the pixel
+    // (batches are drawn one after another)
+    uint tag = uint(overdrawSlot + 1) << 20;
+    uint prev = imageLoad(overdrawOwner, p).x;
+    uint next = tag | 1u;
+    for (int attempt = 0; attempt < 64; ++attempt) {
+        next = ((prev & 0xFFF00000u) == tag) ? prev + 1u : (tag | 1u);
+        uint seen = imageAtomicCompSwap(overdrawOwner, p, prev, next);
+        if (seen == prev) break;
+        prev = seen;
+    }
+    uint n = next & 0xFFFFFu;
+    uint s = uint(overdrawSlot) + 1u;
+    atomicAdd(overdrawStats[s].x, 1u);
+    if (n == 1u) atomicAdd(overdrawStats[s].y, 1u);
+    atomicMax(overdrawStats[s].z, n);
+}
+#else
+void countOverdraw() {}
+#endif
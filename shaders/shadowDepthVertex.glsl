@@ -2,12 +2,14 @@
 
 layout(location=0) in vec3 v_vertex;
 
+#include "uniformBlocks.glsl"
+
 // For non-instanced objects
 layout(location = 0) uniform mat4 modelMat;
 
-// Common
-layout(location = 20) uniform mat4 lightVP;
-layout(location = 21) uniform int useInstancing; // 0: modelMat, 1: instances[gl_InstanceID]
+// Common (light view-projections come from the ShadowBlock)
+layout(location = 21) uniform int useInstancing; // 0: modelMat, 1: visible instances, 2: all instances
+layout(location = 22) uniform int cascadeIndex;
 
 struct InstanceData {
     mat4 model;
@@ -24,10 +26,22 @@ layout(std430, binding = 1) readonly buffer VisibleBuffer {
 };
 
 void main() {
+    mat4 lightVP = shadow.lightVP[cascadeIndex];
     mat4 m = modelMat;
     if (useInstancing == 1) {
-        uint visibleIdx = indices[gl_InstanceID + 1u];
+        uint visibleIdx = indices[gl_InstanceID];
         m = instances[visibleIdx].model;
+    } else if (useInstancing == 2) {
+        // cached static casters: every instance, those outside the cascade's box are dropped here
+        vec4 sphere = instances[gl_InstanceID].sphere;
+        vec3 c = (lightVP * vec4(sphere.xyz, 1.0)).xyz;
+        vec2 r = sphere.w * vec2(length(vec3(lightVP[0][0], lightVP[1][0], lightVP[2][0])),
+                                 length(vec3(lightVP[0][1], lightVP[1][1], lightVP[2][1])));
+        if (any(greaterThan(abs(c.xy), vec2(1.0) + r))) {
+            gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+            return;
+        }
+        m = instances[gl_InstanceID].model;
     }
     gl_Position = lightVP * (m * vec4(v_vertex, 1.0));
 }
@@ -0,0 +1,35 @@
+// Exponentially warped variance shadow maps (EVSM, positive and negative warp).
+// shadowMomentBlur.comp stores the filtered moments, gbufferDisplayFragment.glsl compares a receiver
+// against one filtered fetch. depth: distance from the light in [0,1] (0 at the light's near plane).
+
+#define EVSM_POSITIVE_EXPONENT 40.0
+#define EVSM_NEGATIVE_EXPONENT 5.0
+#define EVSM_LIGHT_BLEEDING_CUT 0.2
+
+vec2 evsmWarp(float depth) {
+    float x = depth * 2.0 - 1.0;
+    return vec2(exp(EVSM_POSITIVE_EXPONENT * x), -exp(-EVSM_NEGATIVE_EXPONENT * x));
+}
+
+vec4 evsmMoments(float depth) {
+    vec2 w = evsmWarp(depth);
+    return vec4(w.x, w.x * w.x, w.y, w.y * w.y);
+}
+
+// Chebyshev upper bound of the lit fraction, with the light bleeding below the cut removed
+float chebyshevUpperBound(vec2 moments, float mean, float minVariance) {
+    if (mean <= moments.x) return 1.0;
+    float variance = max(moments.y - moments.x * moments.x, minVariance);
+    float d = mean - moments.x;
+    float pMax = variance / (variance + d * d);
+    return clamp((pMax - EVSM_LIGHT_BLEEDING_CUT) / (1.0 - EVSM_LIGHT_BLEEDING_CUT), 0.0, 1.0);
+}
+
+float evsmVisibility(vec4 moments, float depth) {
+    vec2 w = evsmWarp(depth);
+    // variance floor relative to the warped depth (float precision of the second moments)
+    vec2 minVariance = 0.0001 * vec2(EVSM_POSITIVE_EXPONENT, EVSM_NEGATIVE_EXPONENT) * abs(w);
+    minVariance *= minVariance;
+    return min(chebyshevUpperBound(moments.xy, w.x, minVariance.x),
+               chebyshevUpperBound(moments.zw, w.y, minVariance.y));
+}
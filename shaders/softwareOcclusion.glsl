@@ -0,0 +1,49 @@
+// CPU occlusion buffer (SoftwareOcclusion.h) test of cullInstances.comp and clusterCull.comp; needs
+// uniformBlocks.glsl (FrameBlock: cullVP, depth convention)
+
+// farthest occluder depth, mips of the farthest of 2x2
+layout(binding = 9) uniform sampler2D softwareOcclusion;
+
+// conservative: the nearest corner of the sphere's box against the farthest occluder of every
+// buffer texel its projection overlaps (the 2x2 texels of the level where it spans at most two)
+bool occludedBySoftwareBuffer(vec3 center, float radius) {
+    bool reversed = frame.depthFlags.x != 0;
+    vec2 ndcMin = vec2(1e30);
+    vec2 ndcMax = vec2(-1e30);
+    float nearest = reversed ? 0.0 : 1.0;
+    for (int i = 0; i < 8; ++i) {
+        vec3 corner = center + radius * vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+        vec4 clip = frame.cullVP * vec4(corner, 1.0);
+        // reaches the near plane
+        if (clip.w <= 0.0 || (reversed ? clip.z > clip.w : clip.z < -clip.w)) return false;
+        vec3 ndc = clip.xyz / clip.w;
+        ndcMin = min(ndcMin, ndc.xy);
+        ndcMax = max(ndcMax, ndc.xy);
+        nearest = reversed ? max(nearest, ndc.z) : min(nearest, ndc.z * 0.5 + 0.5);
+    }
+    vec2 size0 = vec2(textureSize(softwareOcclusion, 0));
+    vec2 pMin = (ndcMin * 0.5 + 0.5) * size0;
+    vec2 pMax = (ndcMax * 0.5 + 0.5) * size0;
+    if (any(lessThan(pMax, vec2(0.0))) || any(greaterThan(pMin, size0))) return false;
+    ivec2 lo = ivec2(floor(max(pMin, vec2(0.0))));
+    ivec2 hi = max(ivec2(ceil(min(pMax, size0))) - 1, lo);
+
+    int numLevels = textureQueryLevels(softwareOcclusion);
+    int level = 0;
+    while (level < numLevels - 1 && any(greaterThan((hi >> level) - (lo >> level), ivec2(1)))) {
+        ++level;
+    }
+    // the last texel of an odd-sized level also covers the extra row / column (sizes computed here:
+    // textureSize() with a lod that differs between invocations is unreliable on llvmpipe)
+    ivec2 last = max(ivec2(size0) >> level, ivec2(1)) - 1;
+    ivec2 a = min(lo >> level, last);
+    ivec2 b = min(hi >> level, last);
+    vec4 d = vec4(texelFetch(softwareOcclusion, a, level).r,
+                  texelFetch(softwareOcclusion, ivec2(b.x, a.y), level).r,
+                  texelFetch(softwareOcclusion, ivec2(a.x, b.y), level).r,
+                  texelFetch(softwareOcclusion, b, level).r);
+    if (reversed) {
+        return nearest < min(min(d.x, d.y), min(d.z, d.w));
+    }
+    return nearest > max(max(d.x, d.y), max(d.z, d.w));
+}
@@ -0,0 +1,50 @@
+// Shared std140 uniform blocks (mirrored by src/UniformBlocks.h).
+// Included by the graphics and compute programs through Shader's #include expansion.
+
+// binding 0: written once per frame
+layout(std140, binding = 0) uniform FrameBlock {
+    mat4 cullVP;        // player view-projection (culling / cascades)
+    mat4 cullViewMat;   // player view
+    vec4 lightDirWorld; // xyz: direction towards the light
+    ivec4 shadowFlags;  // x: shadows enabled, y: cascade visualization, z: number of cascades
+    ivec4 depthFlags;   // x: reversed-Z ([0,1] clip depth, near = 1, far = 0, GL_GREATER)
+    vec4 shadowFit;     // cascade fit: x: min distance, y: max distance, z: split lambda, w: caster distance
+    ivec4 shadowMapInfo; // x: shadow map size
+} frame;
+
+// binding 1: written once per rendered view (player, god, shadow cascades)
+layout(std140, binding = 1) uniform ViewBlock {
+    mat4 viewMat;
+    mat4 projMat;
+    mat4 invProjMat;
+    vec4 cameraPosWorld;
+} view;
+
+// binding 2: material table, indexed by materialIndex
+#define MAX_NUM_MATERIAL 32
+struct MaterialData {
+    vec4 ambient;            // rgb
+    vec4 specularShininess;  // rgb: specular, a: shininess
+    ivec4 flags;             // x: pixel process id, y: vertex process id, z: use normal map
+};
+layout(std140, binding = 2) uniform MaterialBlock {
+    MaterialData materials[MAX_NUM_MATERIAL];
+};
+
+// binding 4: cascade light view-projections, from the CPU (fixed splits) or written on the GPU by
+// shadowCascadeFit.comp (fitted to the depth pyramid) into a buffer with the same layout
+#define MAX_SHADOW_CASCADES 4
+layout(std140, binding = 4) uniform ShadowBlock {
+    mat4 lightVP[MAX_SHADOW_CASCADES];
+    vec4 cascadeFar;  // view depth where each cascade ends
+    vec4 depthRange;  // xy: view depth range covered by the cascades
+} shadow;
+
+// binding 3: written once per culled batch
+layout(std140, binding = 3) uniform CullBlock {
+    vec4 frustumPlanes[6];
+    vec4 cullParams;  // x: max view depth, y: occlusion bias, zw: screen size
+    uvec4 cullFlags;  // x: instances to cull, y: use occlusion, z: fixed mip level, w: depth bins (front-to-back)
+    uvec4 cullInfo;   // x: batch index (CullStats record), y: write per-instance reasons (overlay), z: software occlusion buffer, w: PVS ranges (0: all)
+    vec4 impostorParams; // x: distance past which visible instances go to the impostor list (0: none)
+} cull;
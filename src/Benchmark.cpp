@@ -0,0 +1,239 @@
+#define GLM_ENABLE_EXPERIMENTAL
+#include "Benchmark.h"
+#include "JsonEscape.h"
+#include "MyCameraManager.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <glm/common.hpp>
+
+CameraPath* CameraPath::fromFile(const std::string& fileFullpath, std::string& error) {
+	std::ifstream input(fileFullpath);
+	if (!input.is_open()) {
+		error = "cannot open camera path: " + fileFullpath;
+		return nullptr;
+	}
+
+	CameraPath* path = new CameraPath();
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(input, line)) {
+		lineNumber++;
+		std::istringstream ss(line);
+		std::string type;
+		if (!(ss >> type) || type[0] == '#') { continue; }
+
+		CameraPathKey key;
+		const CameraPathKey* prev = path->m_keys.empty() ? nullptr : &path->m_keys.back();
+		bool ok = false;
+		if (type == "key") {
+			ok = static_cast<bool>(ss >> key.time
+				>> key.playerViewOrg.x >> key.playerViewOrg.y >> key.playerViewOrg.z
+				>> key.playerLookCenter.x >> key.playerLookCenter.y >> key.playerLookCenter.z);
+			glm::vec3 godViewOrg, godLookCenter;
+			if (ok && (ss >> godViewOrg.x >> godViewOrg.y >> godViewOrg.z >> godLookCenter.x >> godLookCenter.y >> godLookCenter.z)) {
+				key.godViewOrg = godViewOrg;
+				key.godLookCenter = godLookCenter;
+			}
+			else if (ok && prev != nullptr) {
+				const glm::vec3 move = key.playerLookCenter - prev->playerLookCenter;
+				key.godViewOrg = prev->godViewOrg + move;
+				key.godLookCenter = prev->godLookCenter + move;
+			}
+			else {
+				ok = false; // the first key needs god camera values
+			}
+		}
+		else if (type == "teleport") {
+			int idx = -1;
+			ok = static_cast<bool>(ss >> key.time >> idx) && prev != nullptr &&
+				INANOA::MyCameraManager::teleportPoint(idx, key.playerViewOrg, key.playerLookCenter);
+			if (ok) {
+				// same as MyCameraManager::teleport: the god camera keeps its offset to the player
+				const glm::vec3 move = key.playerLookCenter - prev->playerLookCenter;
+				key.godViewOrg = prev->godViewOrg + move;
+				key.godLookCenter = prev->godLookCenter + move;
+				key.cut = true;
+			}
+		}
+
+		if (!ok || (prev != nullptr && key.time < prev->time)) {
+			error = fileFullpath + ":" + std::to_string(lineNumber) + ": invalid line: " + line;
+			delete path;
+			return nullptr;
+		}
+		path->m_keys.push_back(key);
+	}
+
+	if (path->m_keys.empty()) {
+		error = "camera path has no keys: " + fileFullpath;
+		delete path;
+		return nullptr;
+	}
+	return path;
+}
+
+CameraPathKey CameraPath::sample(const float t) const {
+	if (t <= this->m_keys.front().time) { return this->m_keys.front(); }
+
+	// last key with time <= t
+	size_t i = 0;
+	while (i + 1 < this->m_keys.size() && this->m_keys[i + 1].time <= t) { i++; }
+	if (i + 1 >= this->m_keys.size()) { return this->m_keys.back(); }
+
+	const CameraPathKey& a = this->m_keys[i];
+	const CameraPathKey& b = this->m_keys[i + 1];
+	if (b.cut || b.time <= a.time) { return a; }
+
+	const float s = (t - a.time) / (b.time - a.time);
+	CameraPathKey k;
+	k.time = t;
+	k.playerViewOrg = glm::mix(a.playerViewOrg, b.playerViewOrg, s);
+	k.playerLookCenter = glm::mix(a.playerLookCenter, b.playerLookCenter, s);
+	k.godViewOrg = glm::mix(a.godViewOrg, b.godViewOrg, s);
+	k.godLookCenter = glm::mix(a.godLookCenter, b.godLookCenter, s);
+	return k;
+}
+
+// =======================================
+
+void BenchmarkRecorder::collectGpuFrames(const unsigned long long firstFrame) {
+	if (!this->m_gpuStarted) {
+		this->m_nextGpuFrame = firstFrame;
+		this->m_gpuStarted = true;
+	}
+	for (const GpuFrameResult& frame : GpuProfiler::Instance()->history()) {
+		if (frame.frameIndex < this->m_nextGpuFrame) { continue; }
+		this->m_nextGpuFrame = frame.frameIndex + 1;
+
+		// one sample per scope path and frame ("Player view/Geometry/Cull foliage")
+		std::vector<std::string> stack;
+		std::vector<std::pair<std::string, double>> frameSamples;
+		for (const GpuScopeResult& r : frame.scopes) {
+			stack.resize(std::min((size_t)r.depth, stack.size()));
+			stack.push_back(r.name);
+			std::string path = stack[0];
+			for (size_t s = 1; s < stack.size(); ++s) { path += "/" + stack[s]; }
+
+			bool merged = false;
+			for (auto& fs : frameSamples) {
+				if (fs.first == path) { fs.second += r.durationMs(); merged = true; break; }
+			}
+			if (!merged) { frameSamples.push_back({ path, r.durationMs() }); }
+		}
+
+		for (const auto& fs : frameSamples) {
+			PassSamples* pass = nullptr;
+			for (PassSamples& p : this->m_passes) {
+				if (p.name == fs.first) { pass = &p; break; }
+			}
+			if (pass == nullptr) {
+				this->m_passes.push_back({ fs.first, (int)std::count(fs.first.begin(), fs.first.end(), '/'), {} });
+				pass = &this->m_passes.back();
+			}
+			pass->ms.push_back(fs.second);
+		}
+	}
+}
+
+void BenchmarkRecorder::addVisibleCounts(const std::vector<std::string>& names, const std::vector<unsigned int>& numInstances, const std::vector<unsigned int>& numVisible) {
+	if (this->m_batches.empty()) {
+		for (size_t i = 0; i < names.size(); ++i) {
+			BenchmarkBatchStats b;
+			b.name = names[i];
+			b.numInstances = numInstances[i];
+			b.visibleMin = numVisible[i];
+			b.visibleMax = numVisible[i];
+			this->m_batches.push_back(b);
+		}
+		this->m_visibleSums.assign(names.size(), 0ull);
+	}
+	for (size_t i = 0; i < numVisible.size() && i < this->m_batches.size(); ++i) {
+		this->m_batches[i].visibleMin = std::min(this->m_batches[i].visibleMin, numVisible[i]);
+		this->m_batches[i].visibleMax = std::max(this->m_batches[i].visibleMax, numVisible[i]);
+		this->m_visibleSums[i] += numVisible[i];
+	}
+	this->m_numVisibleSample++;
+}
+
+void BenchmarkRecorder::addTriangleCounts(const std::vector<unsigned long long>& numTriangles) {
+	if (this->m_triangleSums.empty()) {
+		this->m_triangleSums.assign(numTriangles.size(), 0ull);
+	}
+	for (size_t i = 0; i < numTriangles.size() && i < this->m_triangleSums.size(); ++i) {
+		this->m_triangleSums[i] += numTriangles[i];
+	}
+	this->m_numTriangleSample++;
+}
+
+void BenchmarkRecorder::addFragmentStats(const GLuint64 samplesPassed[2], const GLuint64 fragmentInvocations[2]) {
+	for (int pass = 0; pass < 2; ++pass) {
+		this->m_samplesPassed[pass].push_back((double)samplesPassed[pass]);
+		this->m_fragmentInvocations[pass].push_back((double)fragmentInvocations[pass]);
+	}
+}
+
+static double percentile(const std::vector<double>& sorted, const double p) {
+	if (sorted.empty()) { return 0.0; }
+	const double pos = p * (double)(sorted.size() - 1);
+	const size_t lo = (size_t)pos;
+	const size_t hi = std::min(lo + 1, sorted.size() - 1);
+	return sorted[lo] + (sorted[hi] - sorted[lo]) * (pos - (double)lo);
+}
+
+static void writeStats(std::ostream& output, std::vector<double> values) {
+	std::sort(values.begin(), values.end());
+	double sum = 0.0;
+	for (const double v : values) { sum += v; }
+	const double mean = values.empty() ? 0.0 : sum / (double)values.size();
+	output << "{\"mean\":" << mean
+		<< ",\"min\":" << (values.empty() ? 0.0 : values.front())
+		<< ",\"p50\":" << percentile(values, 0.50)
+		<< ",\"p90\":" << percentile(values, 0.90)
+		<< ",\"p95\":" << percentile(values, 0.95)
+		<< ",\"p99\":" << percentile(values, 0.99)
+		<< ",\"max\":" << (values.empty() ? 0.0 : values.back())
+		<< ",\"samples\":" << values.size() << "}";
+}
+
+bool BenchmarkRecorder::writeJSON(const std::string& path, const std::string& settingsJSON) const {
+	std::ofstream output(path);
+	if (!output.is_open()) { return false; }
+
+	output << "{\n\"settings\": " << settingsJSON << ",\n";
+	output << "\"frames\": " << this->m_frameTimesMs.size() << ",\n";
+	output << "\"frame_time_ms\": ";
+	writeStats(output, this->m_frameTimesMs);
+	output << ",\n";
+
+	output << "\"gpu_passes_ms\": [";
+	for (size_t i = 0; i < this->m_passes.size(); ++i) {
+		output << (i == 0 ? "\n" : ",\n") << "  {\"pass\":\"" << jsonEscape(this->m_passes[i].name) << "\",\"depth\":" << this->m_passes[i].depth << ",\"stats\":";
+		writeStats(output, this->m_passes[i].ms);
+		output << "}";
+	}
+	output << "\n],\n";
+
+	output << "\"culling\": [";
+	for (size_t i = 0; i < this->m_batches.size(); ++i) {
+		const BenchmarkBatchStats& b = this->m_batches[i];
+		const double mean = (this->m_numVisibleSample > 0) ? (double)this->m_visibleSums[i] / (double)this->m_numVisibleSample : 0.0;
+		const double trianglesMean = (this->m_numTriangleSample > 0 && i < this->m_triangleSums.size()) ? (double)this->m_triangleSums[i] / (double)this->m_numTriangleSample : 0.0;
+		output << (i == 0 ? "\n" : ",\n") << "  {\"batch\":\"" << jsonEscape(b.name) << "\",\"instances\":" << b.numInstances
+			<< ",\"visible_mean\":" << mean << ",\"visible_min\":" << b.visibleMin << ",\"visible_max\":" << b.visibleMax
+			<< ",\"triangles_mean\":" << trianglesMean << "}";
+	}
+	output << "\n],\n";
+
+	const char* FRAGMENT_PASSES[2] = { "occluders", "foliage" };
+	output << "\"fragments\": [";
+	for (int pass = 0; pass < 2; ++pass) {
+		output << (pass == 0 ? "\n" : ",\n") << "  {\"pass\":\"" << FRAGMENT_PASSES[pass] << "\",\"samples_passed\":";
+		writeStats(output, this->m_samplesPassed[pass]);
+		output << ",\"fs_invocations\":";
+		writeStats(output, this->m_fragmentInvocations[pass]);
+		output << "}";
+	}
+	output << "\n]\n}\n";
+	return true;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <glm/vec3.hpp>
+#include <string>
+#include <vector>
+#include "GpuProfiler.h"
+
+// One keyframe of a scripted camera path. A "cut" key is not interpolated from the key
+// before it (teleports): the previous pose is held until the cut time, then jumps.
+struct CameraPathKey {
+	float time = 0.0f;
+	glm::vec3 playerViewOrg = glm::vec3(0.0f);
+	glm::vec3 playerLookCenter = glm::vec3(0.0f);
+	glm::vec3 godViewOrg = glm::vec3(0.0f);
+	glm::vec3 godLookCenter = glm::vec3(0.0f);
+	bool cut = false;
+};
+
+// Text camera path (see assets/benchmark/teleport_tour.campath):
+//   key <t> <player eye xyz> <player center xyz> [<god eye xyz> <god center xyz>]
+//   teleport <t> <idx>
+// Lines starting with '#' are comments. A key without god values moves the god camera along
+// with the player look center, like the interactive controls do. Keys must be in time order.
+class CameraPath
+{
+public:
+	static CameraPath* fromFile(const std::string& fileFullpath, std::string& error);
+
+	float duration() const { return m_keys.empty() ? 0.0f : m_keys.back().time; }
+	int numKey() const { return (int)m_keys.size(); }
+	// pose at time t (clamped to the path)
+	CameraPathKey sample(const float t) const;
+
+private:
+	std::vector<CameraPathKey> m_keys;
+};
+
+struct BenchmarkBatchStats {
+	std::string name;
+	unsigned int numInstances = 0;
+	unsigned int visibleMin = 0;
+	unsigned int visibleMax = 0;
+};
+
+// Collects per-frame CPU frame times, GpuProfiler scopes and culling counts of a benchmark
+// run and writes them as JSON.
+class BenchmarkRecorder
+{
+public:
+	void addFrameTime(const double ms) { m_frameTimesMs.push_back(ms); }
+	// pick up GpuProfiler frames resolved since the last call (frameIndex >= firstFrame)
+	void collectGpuFrames(const unsigned long long firstFrame);
+	void addVisibleCounts(const std::vector<std::string>& names, const std::vector<unsigned int>& numInstances, const std::vector<unsigned int>& numVisible);
+	// per frame and batch (same order as addVisibleCounts): triangles of the batch's mesh draws
+	void addTriangleCounts(const std::vector<unsigned long long>& numTriangles);
+	// per frame, pass 0: occluders, 1: foliage
+	void addFragmentStats(const GLuint64 samplesPassed[2], const GLuint64 fragmentInvocations[2]);
+
+	bool writeJSON(const std::string& path, const std::string& settingsJSON) const;
+
+	int numFrame() const { return (int)m_frameTimesMs.size(); }
+
+private:
+	struct PassSamples {
+		std::string name;
+		int depth;
+		std::vector<double> ms;
+	};
+
+	std::vector<double> m_frameTimesMs;
+	std::vector<PassSamples> m_passes;
+	unsigned long long m_nextGpuFrame = 0;
+	bool m_gpuStarted = false;
+	std::vector<BenchmarkBatchStats> m_batches;
+	std::vector<unsigned long long> m_visibleSums;
+	int m_numVisibleSample = 0;
+	std::vector<unsigned long long> m_triangleSums;
+	int m_numTriangleSample = 0;
+	std::vector<double> m_samplesPassed[2];
+	std::vector<double> m_fragmentInvocations[2];
+};
@@ -0,0 +1,131 @@
+#include "CpuProfiler.h"
+#include "GpuProfiler.h"
+#include "JsonEscape.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+
+uint64_t CpuProfiler::nowNs() {
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint32_t& CpuProfiler::threadDepth() {
+	thread_local uint32_t depth = 0;
+	return depth;
+}
+
+CpuProfiler::ThreadRing* CpuProfiler::threadRing() {
+	thread_local ThreadRing* ring = nullptr;
+	if (ring == nullptr) {
+		// rings are never freed: the trace writer may still read them after the thread exits
+		ring = new ThreadRing();
+		std::lock_guard<std::mutex> lock(this->m_registryMutex);
+		ring->threadIndex = (uint32_t)this->m_threads.size();
+		ring->name = (ring->threadIndex == 0) ? "Main" : ("Worker " + std::to_string(ring->threadIndex));
+		this->m_threads.push_back(ring);
+	}
+	return ring;
+}
+
+void CpuProfiler::setThreadName(const char* name) {
+	ThreadRing* ring = this->threadRing();
+	std::lock_guard<std::mutex> lock(this->m_registryMutex);
+	ring->name = name;
+}
+
+void CpuProfiler::record(const CpuZoneEvent& e) {
+	ThreadRing* ring = this->threadRing();
+	const uint64_t head = ring->head.load(std::memory_order_relaxed);
+	ring->events[head % RING_SIZE] = e;
+	ring->head.store(head + 1, std::memory_order_release);
+}
+
+void CpuProfiler::requestCapture(const int numFrame, const std::string& path) {
+	if (this->m_captureState != CaptureState::IDLE || numFrame <= 0) { return; }
+	this->m_captureNumFrame = std::min(numFrame, MAX_CAPTURE_FRAME);
+	this->m_capturePath = path;
+	this->m_captureState = CaptureState::ARMED;
+}
+
+void CpuProfiler::beginFrame() {
+	const uint64_t now = nowNs();
+	this->m_frameIndex++;
+
+	switch (this->m_captureState) {
+	case CaptureState::ARMED:
+		this->m_captureFrameStartNs.clear();
+		this->m_captureFrameStartNs.push_back(now);
+		this->m_captureState = CaptureState::RECORDING;
+		break;
+	case CaptureState::RECORDING:
+		this->m_captureFrameStartNs.push_back(now);
+		if ((int)this->m_captureFrameStartNs.size() > this->m_captureNumFrame) {
+			// GPU results arrive a few frames late
+			this->m_gpuWaitFrame = GpuProfiler::NUM_FRAME_SLOT;
+			this->m_captureState = CaptureState::WAIT_GPU;
+		}
+		break;
+	case CaptureState::WAIT_GPU:
+		if (--this->m_gpuWaitFrame <= 0) {
+			if (this->writeCapture()) {
+				this->m_lastCapturePath = this->m_capturePath;
+			}
+			this->m_captureState = CaptureState::IDLE;
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+bool CpuProfiler::writeCapture() const {
+	if (this->m_captureFrameStartNs.size() < 2) { return false; }
+	std::ofstream output(this->m_capturePath);
+	if (!output.is_open()) { return false; }
+
+	const uint64_t captureBegin = this->m_captureFrameStartNs.front();
+	const uint64_t captureEnd = this->m_captureFrameStartNs.back();
+	auto toUs = [captureBegin](const uint64_t ns) { return (double)(int64_t)(ns - captureBegin) * 1.0e-3; };
+
+	const int GPU_TID = 1000;
+	output << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	output << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << GPU_TID << ",\"args\":{\"name\":\"GPU\"}}";
+
+	// frame boundaries
+	for (size_t i = 0; i + 1 < this->m_captureFrameStartNs.size(); ++i) {
+		output << ",\n{\"name\":\"Frame " << i << "\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":1,\"ts\":"
+			<< toUs(this->m_captureFrameStartNs[i]) << "}";
+	}
+
+	// CPU zones from every thread ring (a thread still writing may race on the oldest entries)
+	{
+		std::lock_guard<std::mutex> lock(this->m_registryMutex);
+		for (const ThreadRing* ring : this->m_threads) {
+			const int tid = (int)ring->threadIndex + 1;
+			output << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid << ",\"args\":{\"name\":\"" << jsonEscape(ring->name) << "\"}}";
+			const uint64_t head = ring->head.load(std::memory_order_acquire);
+			const uint64_t first = (head > (uint64_t)RING_SIZE) ? head - RING_SIZE : 0;
+			for (uint64_t i = first; i < head; ++i) {
+				const CpuZoneEvent& e = ring->events[i % RING_SIZE];
+				if (e.beginNs < captureBegin || e.endNs > captureEnd) { continue; }
+				output << ",\n{\"name\":\"" << jsonEscape(e.name) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+					<< ",\"ts\":" << toUs(e.beginNs) << ",\"dur\":" << (double)(e.endNs - e.beginNs) * 1.0e-3 << "}";
+			}
+		}
+	}
+
+	// GPU scopes, moved onto the CPU clock with the per-frame calibration offset
+	for (const GpuFrameResult& frame : GpuProfiler::Instance()->history()) {
+		for (const GpuScopeResult& r : frame.scopes) {
+			const uint64_t beginNs = (uint64_t)((int64_t)r.beginNs + frame.gpuToCpuOffsetNs);
+			const uint64_t endNs = (uint64_t)((int64_t)r.endNs + frame.gpuToCpuOffsetNs);
+			if (beginNs < captureBegin || beginNs > captureEnd) { continue; }
+			output << ",\n{\"name\":\"" << jsonEscape(r.name) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << GPU_TID
+				<< ",\"ts\":" << toUs(beginNs) << ",\"dur\":" << (double)(endNs - beginNs) * 1.0e-3 << "}";
+		}
+	}
+
+	output << "\n]}\n";
+	return true;
+}
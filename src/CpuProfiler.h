@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// CPU zones are compiled in only when CG_CPU_PROFILER is defined (CMake option CG2025_CPU_PROFILER).
+// Without it CPU_PROFILE_SCOPE / CPU_PROFILE_FRAME expand to nothing.
+#define CPU_PROFILE_CONCAT_IMPL(a, b) a##b
+#define CPU_PROFILE_CONCAT(a, b) CPU_PROFILE_CONCAT_IMPL(a, b)
+#if defined(CG_CPU_PROFILER)
+#define CPU_PROFILE_SCOPE(name) CpuZone CPU_PROFILE_CONCAT(cpuZone_, __LINE__)(name)
+#define CPU_PROFILE_FRAME() CpuProfiler::Instance()->beginFrame()
+#else
+#define CPU_PROFILE_SCOPE(name) ((void)0)
+#define CPU_PROFILE_FRAME() ((void)0)
+#endif
+
+struct CpuZoneEvent {
+	const char* name; // must be a string literal (or otherwise outlive the capture)
+	uint64_t beginNs;
+	uint64_t endNs;
+	uint32_t depth;
+};
+
+// Singleton
+
+// Scoped CPU zones recorded into one fixed-size ring per thread (no locks on the hot path;
+// the registry mutex is only taken when a thread records its first zone and when a capture
+// is written). requestCapture() dumps the next N frames as Chrome trace JSON
+// (chrome://tracing, Perfetto), with the resolved GpuProfiler scopes of the same frames
+// placed on the CPU timeline.
+class CpuProfiler
+{
+private:
+	CpuProfiler() {}
+
+public:
+	virtual ~CpuProfiler() {}
+
+	static CpuProfiler* Instance() {
+		static CpuProfiler* m_instance = nullptr;
+		if (m_instance == nullptr) {
+			m_instance = new CpuProfiler();
+		}
+		return m_instance;
+	}
+
+	static constexpr int RING_SIZE = 16384;
+	static constexpr int MAX_CAPTURE_FRAME = 600;
+
+	// steady clock, nanoseconds (same clock GpuProfiler uses for its calibration)
+	static uint64_t nowNs();
+
+public:
+	// called once at the top of the main loop
+	void beginFrame();
+	void requestCapture(const int numFrame, const std::string& path);
+	bool capturing() const { return m_captureState != CaptureState::IDLE; }
+	const std::string& lastCapturePath() const { return m_lastCapturePath; }
+
+	void setThreadName(const char* name);
+	void record(const CpuZoneEvent& e);
+
+	uint32_t& threadDepth();
+
+private:
+	struct ThreadRing {
+		uint32_t threadIndex = 0;
+		std::string name;
+		CpuZoneEvent events[RING_SIZE];
+		std::atomic<uint64_t> head{ 0 };
+	};
+
+	enum class CaptureState { IDLE, ARMED, RECORDING, WAIT_GPU };
+
+	ThreadRing* threadRing();
+	bool writeCapture() const;
+
+	mutable std::mutex m_registryMutex;
+	std::vector<ThreadRing*> m_threads;
+
+	uint64_t m_frameIndex = 0;
+	std::vector<uint64_t> m_captureFrameStartNs;
+	CaptureState m_captureState = CaptureState::IDLE;
+	int m_captureNumFrame = 0;
+	int m_gpuWaitFrame = 0;
+	std::string m_capturePath;
+	std::string m_lastCapturePath;
+};
+
+class CpuZone
+{
+public:
+	explicit CpuZone(const char* name) : m_name(name) {
+		CpuProfiler* profiler = CpuProfiler::Instance();
+		m_depth = profiler->threadDepth()++;
+		m_beginNs = CpuProfiler::nowNs();
+	}
+	~CpuZone() {
+		CpuProfiler* profiler = CpuProfiler::Instance();
+		const CpuZoneEvent e = { m_name, m_beginNs, CpuProfiler::nowNs(), m_depth };
+		profiler->record(e);
+		profiler->threadDepth()--;
+	}
+
+	CpuZone(const CpuZone&) = delete;
+	CpuZone& operator=(const CpuZone&) = delete;
+
+private:
+	const char* m_name;
+	uint64_t m_beginNs;
+	uint32_t m_depth;
+};
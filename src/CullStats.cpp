@@ -0,0 +1,95 @@
+#include "CullStats.h"
+
+CullStatsReadback::CullStatsReadback()
+{
+}
+
+CullStatsReadback::~CullStatsReadback()
+{
+	this->release();
+}
+
+bool CullStatsReadback::init(const std::vector<std::string>& batchNames, const std::vector<unsigned int>& numInstances, const int numRegion) {
+	this->release();
+	if (batchNames.empty() || numRegion <= 0) {
+		return false;
+	}
+	this->m_batchNames = batchNames;
+	this->m_numInstances = numInstances;
+	this->m_regionSize = (GLsizeiptr)batchNames.size() * CULL_STATS_STRIDE * sizeof(unsigned int);
+	this->m_regions.assign(numRegion, Region());
+
+	const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glCreateBuffers(1, &this->m_bufferHandle);
+	glNamedBufferStorage(this->m_bufferHandle, this->m_regionSize * numRegion, nullptr, flags);
+	this->m_mappedPtr = (const unsigned int*)glMapNamedBufferRange(this->m_bufferHandle, 0, this->m_regionSize * numRegion, flags);
+	if (this->m_mappedPtr == nullptr) {
+		this->release();
+		return false;
+	}
+	return true;
+}
+
+void CullStatsReadback::release() {
+	for (Region& region : this->m_regions) {
+		if (region.fence != nullptr) {
+			glDeleteSync(region.fence);
+			region.fence = nullptr;
+		}
+	}
+	if (this->m_bufferHandle != 0) {
+		if (this->m_mappedPtr != nullptr) {
+			glUnmapNamedBuffer(this->m_bufferHandle);
+		}
+		glDeleteBuffers(1, &this->m_bufferHandle);
+		this->m_bufferHandle = 0;
+	}
+	this->m_mappedPtr = nullptr;
+	this->m_regions.clear();
+	this->m_nextRegion = 0;
+	this->m_history.clear();
+}
+
+void CullStatsReadback::capture(const GLuint statsBuffer, const unsigned long long frameIndex) {
+	if (this->m_mappedPtr == nullptr) { return; }
+	Region& region = this->m_regions[this->m_nextRegion];
+	if (region.fence != nullptr) {
+		this->m_droppedFrames++;
+		return;
+	}
+	// the counters were written by shader atomics
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	glCopyNamedBufferSubData(statsBuffer, this->m_bufferHandle, 0, this->m_nextRegion * this->m_regionSize, this->m_regionSize);
+	region.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	region.frameIndex = frameIndex;
+	this->m_nextRegion = (this->m_nextRegion + 1) % (int)this->m_regions.size();
+}
+
+void CullStatsReadback::poll() {
+	if (this->m_mappedPtr == nullptr) { return; }
+	// regions complete in submission order: start at the oldest one
+	const int numRegion = (int)this->m_regions.size();
+	for (int i = 0; i < numRegion; ++i) {
+		const int r = (this->m_nextRegion + i) % numRegion;
+		Region& region = this->m_regions[r];
+		if (region.fence == nullptr) { continue; }
+		const GLenum result = glClientWaitSync(region.fence, 0, 0);
+		if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) { break; }
+		glDeleteSync(region.fence);
+		region.fence = nullptr;
+
+		CullStatsFrame frame;
+		frame.frameIndex = region.frameIndex;
+		frame.counts.resize(this->m_batchNames.size() * CULL_REASON_COUNT);
+		const unsigned int* src = this->m_mappedPtr + (size_t)r * this->m_regionSize / sizeof(unsigned int);
+		for (size_t b = 0; b < this->m_batchNames.size(); ++b) {
+			for (int reason = 0; reason < CULL_REASON_COUNT; ++reason) {
+				frame.counts[b * CULL_REASON_COUNT + reason] = src[b * CULL_STATS_STRIDE + reason];
+			}
+		}
+		this->m_history.push_back(frame);
+		if ((int)this->m_history.size() > HISTORY_LENGTH) {
+			this->m_history.pop_front();
+		}
+	}
+}
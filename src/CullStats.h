@@ -0,0 +1,79 @@
+#pragma once
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+
+// rejection reasons counted by cullInstances.comp (same values as CULL_* there)
+enum CullReason {
+	CULL_VISIBLE = 0,
+	CULL_DISTANCE,
+	CULL_FRUSTUM,
+	CULL_OFFSCREEN,
+	CULL_OCCLUSION,
+	CULL_PVS, // cluster not in the potentially visible set of the view cell (counted on the CPU)
+	CULL_REASON_COUNT
+};
+
+// uints per batch in the CullStats SSBO (binding 6)
+const int CULL_STATS_STRIDE = 8;
+
+inline const char* cullReasonName(const int reason) {
+	static const char* NAMES[CULL_REASON_COUNT] = { "Visible", "Distance", "Frustum", "Off-screen", "Occluded", "Not in PVS" };
+	return (reason >= 0 && reason < CULL_REASON_COUNT) ? NAMES[reason] : "?";
+}
+
+// counters of one culled frame: counts[batch * CULL_REASON_COUNT + reason]
+struct CullStatsFrame {
+	unsigned long long frameIndex = 0;
+	std::vector<unsigned int> counts;
+
+	unsigned int count(const int batch, const int reason) const { return counts[(size_t)batch * CULL_REASON_COUNT + reason]; }
+};
+
+// Asynchronous readback of the per-batch cull counters.
+// capture() copies the GPU counters into a free region of a persistently mapped buffer and
+// fences it; poll() picks up every region whose fence has signaled, so results arrive a few
+// frames late and the CPU never waits on the GPU. When all regions are in flight the frame is
+// skipped (dropped) instead of stalling.
+class CullStatsReadback
+{
+public:
+	static const int HISTORY_LENGTH = 240;
+
+	CullStatsReadback();
+	virtual ~CullStatsReadback();
+
+public:
+	bool init(const std::vector<std::string>& batchNames, const std::vector<unsigned int>& numInstances, const int numRegion = 4);
+	void release();
+
+	void capture(const GLuint statsBuffer, const unsigned long long frameIndex);
+	void poll();
+
+public:
+	int numBatch() const { return (int)m_batchNames.size(); }
+	const std::string& batchName(const int batch) const { return m_batchNames[batch]; }
+	unsigned int numInstances(const int batch) const { return m_numInstances[batch]; }
+	// oldest first
+	const std::deque<CullStatsFrame>& history() const { return m_history; }
+	const CullStatsFrame* latest() const { return m_history.empty() ? nullptr : &m_history.back(); }
+	int droppedFrames() const { return m_droppedFrames; }
+
+private:
+	struct Region {
+		GLsync fence = nullptr;
+		unsigned long long frameIndex = 0;
+	};
+
+	std::vector<std::string> m_batchNames;
+	std::vector<unsigned int> m_numInstances;
+	GLuint m_bufferHandle = 0;
+	const unsigned int* m_mappedPtr = nullptr;
+	GLsizeiptr m_regionSize = 0;
+	std::vector<Region> m_regions;
+	int m_nextRegion = 0;
+	std::deque<CullStatsFrame> m_history;
+	int m_droppedFrames = 0;
+};
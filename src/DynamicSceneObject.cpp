@@ -1,4 +1,5 @@
 #include "DynamicSceneObject.h"
+#include "GLStateCache.h"
 
 
 // Default off; controlled by ImGui checkbox in main.cpp (g_useNormalMap).
@@ -67,31 +68,21 @@ DynamicSceneObject::~DynamicSceneObject()
 }
 
 void DynamicSceneObject::update() {
+	GLStateCache* glState = GLStateCache::Instance();
 	// bind Buffer
-	glBindVertexArray(this->m_vao);
+	glState->bindVertexArray(this->m_vao);
 	// model matrix
 	glUniformMatrix4fv(SceneManager::Instance()->m_modelMatHandle, 1, false, glm::value_ptr(this->m_modelMat));
 
 	if (this->m_useAlbedoTex) {
-		glActiveTexture(SceneManager::Instance()->m_albedoTexUnit);
-		glBindTexture(GL_TEXTURE_2D, this->m_albedoTexHandle);
+		glState->bindTexture(SceneManager::Instance()->m_albedoTexUnit - GL_TEXTURE0, this->m_albedoTexHandle);
 	}
-	int useNormalFlag = 0;
-	if (this->m_useNormalTex && DynamicSceneObject::s_globalUseNormalMap) {
-		glActiveTexture(SceneManager::Instance()->m_normalTexUnit);
-		glBindTexture(GL_TEXTURE_2D, this->m_normalTexHandle);
-		useNormalFlag = 1;
+	if (this->normalMapActive()) {
+		glState->bindTexture(SceneManager::Instance()->m_normalTexUnit - GL_TEXTURE0, this->m_normalTexHandle);
 	}
-	// set sampler for fragment shader normal map (separate handle)
-	glUniform1i(SceneManager::Instance()->m_fs_normalTexHandle, SceneManager::Instance()->m_fs_normalTexIdx);
-	glUniform1i(SceneManager::Instance()->m_useNormalMapHandle, useNormalFlag);
-
-	glUniform3fv(SceneManager::Instance()->m_materialAmbientHandle, 1, glm::value_ptr(this->m_materialAmbient));
-	glUniform3fv(SceneManager::Instance()->m_materialSpecularHandle, 1, glm::value_ptr(this->m_materialSpecular));
-	glUniform1f(SceneManager::Instance()->m_materialShininessHandle, this->m_materialShininess);
-
-	glUniform1i(SceneManager::Instance()->m_fs_pixelProcessIdHandle, this->m_pixelFunctionId);
-	glDrawElements(this->m_primitive, this->m_indexCount, GL_UNSIGNED_INT, nullptr);
+	// material, pixel process and normal map flag are read from the material table
+	glUniform1i(SceneManager::Instance()->m_materialIndexHandle, this->m_materialIndex);
+	glState->drawElements(this->m_primitive, this->m_indexCount, GL_UNSIGNED_INT, nullptr);
 }
 
 float* DynamicSceneObject::dataBuffer() { return this->m_dataBuffer; }
@@ -128,6 +119,9 @@ void DynamicSceneObject::setNormalTexture(const GLuint texHandle) {
 	this->m_normalTexHandle = texHandle;
 	this->m_useNormalTex = (texHandle != 0);
 }
+void DynamicSceneObject::setMaterialIndex(const int idx) {
+	this->m_materialIndex = idx;
+}
 void DynamicSceneObject::setGlobalNormalMapToggle(const bool flag) {
 	DynamicSceneObject::s_globalUseNormalMap = flag;
 }
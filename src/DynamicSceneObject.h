@@ -25,6 +25,7 @@ public:
 	void setAlbedoTexture(const GLuint texHandle);
 	void setMaterial(const glm::vec3& ambient, const glm::vec3& specular, const float shininess);
 	void setNormalTexture(const GLuint texHandle);
+	void setMaterialIndex(const int idx);
 	static void setGlobalNormalMapToggle(const bool flag);
 
 	// Minimal accessors for special rendering passes (e.g., shadow map).
@@ -34,6 +35,13 @@ public:
 	int pixelFunctionId() const { return m_pixelFunctionId; }
 	const glm::mat4& modelMat() const { return m_modelMat; }
 
+	// Material state for the renderer's material table.
+	int materialIndex() const { return m_materialIndex; }
+	const glm::vec3& materialAmbient() const { return m_materialAmbient; }
+	const glm::vec3& materialSpecular() const { return m_materialSpecular; }
+	float materialShininess() const { return m_materialShininess; }
+	bool normalMapActive() const { return m_useNormalTex && s_globalUseNormalMap; }
+
 private:
 	GLuint m_indexBufferHandle;
 	float* m_dataBuffer = nullptr;
@@ -51,6 +59,7 @@ private:
 	glm::vec3 m_materialAmbient = glm::vec3(1.0f);
 	glm::vec3 m_materialSpecular = glm::vec3(0.0f);
 	float m_materialShininess = 1.0f;
+	int m_materialIndex = 0;
 
 	bool m_useNormalTex = false;
 	GLuint m_normalTexHandle = 0;
@@ -1,22 +1,29 @@
 #pragma once
 
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <vector>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_access.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-inline void extractFrustumPlanes(const glm::mat4& VP, glm::vec4 outPlanes[6]) {
-	glm::vec4 col0 = glm::column(VP, 0);
-	glm::vec4 col1 = glm::column(VP, 1);
-	glm::vec4 col2 = glm::column(VP, 2);
-	glm::vec4 col3 = glm::column(VP, 3);
+// reversedZ: VP has [0,1] clip depth with near = 1, far = 0
+inline void extractFrustumPlanes(const glm::mat4& VP, glm::vec4 outPlanes[6], const bool reversedZ = false) {
+	// clip = VP * p: the planes are combinations of the rows of VP
+	glm::vec4 row0 = glm::row(VP, 0);
+	glm::vec4 row1 = glm::row(VP, 1);
+	glm::vec4 row2 = glm::row(VP, 2);
+	glm::vec4 row3 = glm::row(VP, 3);
 
 	glm::vec4 planes[6] = {
-		col3 + col0, // left
-		col3 - col0, // right
-		col3 + col1, // bottom
-		col3 - col1, // top
-		col3 + col2, // near
-		col3 - col2  // far
+		row3 + row0, // left
+		row3 - row0, // right
+		row3 + row1, // bottom
+		row3 - row1, // top
+		reversedZ ? row3 - row2 : row3 + row2, // near
+		reversedZ ? row2 : row3 - row2         // far
 	};
 
 	for (int i = 0; i < 6; ++i) {
@@ -60,3 +67,161 @@ inline void extractFrustumPlanesFromCorners(
 	outPlanes[4] = makePlane(nearCorners[0], nearCorners[3], nearCorners[2], center); // near
 	outPlanes[5] = makePlane(farCorners[3], farCorners[0], farCorners[1], center);   // far
 }
+
+// World-space corners of the view-space clip planes at the given depths, 12 floats per depth
+// in the same corner order as extractFrustumPlanesFromCorners.
+inline void viewFrustumMultiClipCorner(const std::vector<float>& depths, const glm::mat4& viewMat, const glm::mat4& projMat, float* clipCorner)
+{
+	// Calculate Inverse
+	glm::mat4 viewProjInv = glm::inverse(projMat * viewMat);
+
+	// Calculate Clip Plane Corners
+	int clipOffset = 0;
+	for (const float depth : depths)
+	{
+		// Get Depth in NDC, the depth in viewSpace is negative
+		glm::vec4 v = glm::vec4(0, 0, -1 * depth, 1);
+		glm::vec4 vInNDC = projMat * v;
+		if (fabs(vInNDC.w) > 0.00001)
+		{
+			vInNDC.z = vInNDC.z / vInNDC.w;
+		}
+		// Get 4 corner of clip plane
+		float cornerXY[] = {
+			-1, 1,
+			-1, -1,
+			1, -1,
+			1, 1
+		};
+		for (int j = 0; j < 4; j++)
+		{
+			glm::vec4 wcc = {
+				cornerXY[j * 2 + 0], cornerXY[j * 2 + 1], vInNDC.z, 1
+			};
+			wcc = viewProjInv * wcc;
+			wcc = wcc / wcc.w;
+
+			clipCorner[clipOffset * 12 + j * 3 + 0] = wcc[0];
+			clipCorner[clipOffset * 12 + j * 3 + 1] = wcc[1];
+			clipCorner[clipOffset * 12 + j * 3 + 2] = wcc[2];
+		}
+		clipOffset = clipOffset + 1;
+	}
+}
+
+// 8 world-space corners of the sub-frustum slice [nearD, farD]: 0-3 near, 4-7 far.
+inline void computeFrustumCornersWS(const glm::mat4& viewMat, const glm::mat4& projMat, float nearD, float farD, glm::vec3 outCorners[8]) {
+	glm::mat4 invView = glm::inverse(viewMat);
+	glm::mat4 invProj = glm::inverse(projMat);
+	const glm::vec2 ndcCorners[4] = {
+		{-1.0f, -1.0f}, {1.0f, -1.0f}, {1.0f, 1.0f}, {-1.0f, 1.0f}
+	};
+	for (int i = 0; i < 4; ++i) {
+		glm::vec4 cornerVS4 = invProj * glm::vec4(ndcCorners[i].x, ndcCorners[i].y, 1.0f, 1.0f);
+		cornerVS4 /= cornerVS4.w;
+		glm::vec3 ray = glm::vec3(cornerVS4);
+		float nearT = nearD / (-ray.z);
+		float farT = farD / (-ray.z);
+		glm::vec3 nearVS = ray * nearT;
+		glm::vec3 farVS = ray * farT;
+		outCorners[i + 0] = glm::vec3(invView * glm::vec4(nearVS, 1.0f));
+		outCorners[i + 4] = glm::vec3(invView * glm::vec4(farVS, 1.0f));
+	}
+}
+
+// Cascade boundaries in view depth over [nearD, farD] (count + 1 values): practical split scheme,
+// lambda blends uniform (0) and logarithmic (1) splits. Same formula as shadowCascadeFit.comp.
+inline void shadowCascadeSplits(const float nearD, const float farD, const int count, const float lambda, float* outSplits) {
+	for (int c = 0; c <= count; ++c) {
+		const float s = (float)c / (float)count;
+		const float uniformSplit = nearD + (farD - nearD) * s;
+		const float logSplit = nearD * std::pow(farD / nearD, s);
+		outSplits[c] = uniformSplit + (logSplit - uniformSplit) * lambda;
+	}
+	outSplits[0] = nearD;
+	outSplits[count] = farD;
+}
+
+// Orthographic light view-projection fitted around one cascade slice of the camera frustum,
+// snapped to shadow map texels so it does not shimmer when the camera moves.
+// reversedZ: [0,1] depth with the light's near plane at 1 (same convention as the camera).
+inline glm::mat4 computeCascadeLightVP(const glm::mat4& viewMat, const glm::mat4& projMat, float nearD, float farD, const glm::vec3& lightDirWorld, int shadowMapSize, const bool reversedZ = false) {
+	const glm::vec3 forward = glm::normalize(-lightDirWorld);
+	glm::vec3 up(0.0f, 1.0f, 0.0f);
+	if (std::abs(glm::dot(forward, up)) > 0.99f) up = glm::vec3(0.0f, 0.0f, 1.0f);
+
+	glm::vec3 cornersWS[8];
+	computeFrustumCornersWS(viewMat, projMat, nearD, farD, cornersWS);
+
+	glm::vec3 center(0.0f);
+	for (const auto& p : cornersWS) center += p;
+	center *= (1.0f / 8.0f);
+
+	const glm::mat4 lightView = glm::lookAt(center - forward * 1000.0f, center, up);
+	glm::vec3 minLS(FLT_MAX), maxLS(-FLT_MAX);
+	for (const auto& p : cornersWS) {
+		glm::vec3 ls = glm::vec3(lightView * glm::vec4(p, 1.0f));
+		minLS = glm::min(minLS, ls);
+		maxLS = glm::max(maxLS, ls);
+	}
+
+	// Padding to reduce clipping & acne.
+	const float padXY = 10.0f;
+	minLS.x -= padXY; minLS.y -= padXY;
+	maxLS.x += padXY; maxLS.y += padXY;
+	const float padZ = 50.0f;
+
+	// Stabilize by snapping the ortho center to texel size.
+	const float extentX = maxLS.x - minLS.x;
+	const float extentY = maxLS.y - minLS.y;
+	float centerX = 0.5f * (minLS.x + maxLS.x);
+	float centerY = 0.5f * (minLS.y + maxLS.y);
+	const float texelX = extentX / (float)shadowMapSize;
+	const float texelY = extentY / (float)shadowMapSize;
+	if (texelX > 0.0f) centerX = std::floor(centerX / texelX) * texelX;
+	if (texelY > 0.0f) centerY = std::floor(centerY / texelY) * texelY;
+	minLS.x = centerX - 0.5f * extentX;
+	maxLS.x = centerX + 0.5f * extentX;
+	minLS.y = centerY - 0.5f * extentY;
+	maxLS.y = centerY + 0.5f * extentY;
+
+	// glm::lookAt looks down -Z, so convert light-space z (likely negative) to near/far distances.
+	const float zNear = std::max(0.1f, -maxLS.z - padZ);
+	const float zFar  = std::max(zNear + 0.1f, -minLS.z + padZ);
+	const glm::mat4 lightProj = reversedZ
+		? glm::orthoRH_ZO(minLS.x, maxLS.x, minLS.y, maxLS.y, zFar, zNear)
+		: glm::ortho(minLS.x, maxLS.x, minLS.y, maxLS.y, zNear, zFar);
+	return lightProj * lightView;
+}
+
+// Light view without translation (light looks along -z): boxes in this space keep their shadow
+// map texel grid while the camera moves (cached cascades).
+inline glm::mat4 lightRotationView(const glm::vec3& lightDirWorld) {
+	const glm::vec3 forward = glm::normalize(-lightDirWorld);
+	glm::vec3 up(0.0f, 1.0f, 0.0f);
+	if (std::abs(glm::dot(forward, up)) > 0.99f) up = glm::vec3(0.0f, 0.0f, 1.0f);
+	return glm::lookAt(glm::vec3(0.0f), forward, up);
+}
+
+// Light-space bounds of one cascade slice of the camera frustum.
+inline void cascadeLightSpaceBounds(const glm::mat4& viewMat, const glm::mat4& projMat, float nearD, float farD, const glm::mat4& lightView, glm::vec3& outMin, glm::vec3& outMax) {
+	glm::vec3 cornersWS[8];
+	computeFrustumCornersWS(viewMat, projMat, nearD, farD, cornersWS);
+	outMin = glm::vec3(FLT_MAX);
+	outMax = glm::vec3(-FLT_MAX);
+	for (const auto& p : cornersWS) {
+		const glm::vec3 ls = glm::vec3(lightView * glm::vec4(p, 1.0f));
+		outMin = glm::min(outMin, ls);
+		outMax = glm::max(outMax, ls);
+	}
+}
+
+// Orthographic view-projection of a light-space box; z grows towards the light.
+inline glm::mat4 lightBoxVP(const glm::mat4& lightView, const glm::vec3& boxMin, const glm::vec3& boxMax, const bool reversedZ = false) {
+	const float zNear = -boxMax.z;
+	const float zFar = -boxMin.z;
+	const glm::mat4 lightProj = reversedZ
+		? glm::orthoRH_ZO(boxMin.x, boxMax.x, boxMin.y, boxMax.y, zFar, zNear)
+		: glm::ortho(boxMin.x, boxMax.x, boxMin.y, boxMax.y, zNear, zFar);
+	return lightProj * lightView;
+}
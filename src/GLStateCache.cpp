@@ -0,0 +1,140 @@
+#include "GLStateCache.h"
+
+void GLStateCache::beginFrame() {
+	this->m_lastFrame = this->m_curFrame;
+	this->m_curFrame = GLFrameCounters();
+	this->invalidate();
+}
+
+void GLStateCache::invalidate() {
+	this->m_program = ~0u;
+	this->m_vao = ~0u;
+	for (int i = 0; i < MAX_TEXTURE_UNIT; ++i) {
+		this->m_textures[i] = ~0u;
+	}
+	for (int i = 0; i < MAX_BUFFER_BINDING; ++i) {
+		this->m_storageBuffers[i] = ~0u;
+		this->m_uniformBuffers[i] = ~0u;
+		this->m_uniformOffsets[i] = -1;
+		this->m_uniformSizes[i] = -1;
+	}
+	this->m_indirectBuffer = ~0u;
+	this->m_dispatchIndirectBuffer = ~0u;
+	this->m_drawFBO = ~0u;
+	this->m_readFBO = ~0u;
+}
+
+void GLStateCache::useProgram(const GLuint program) {
+	if (this->m_program == program) { this->m_curFrame.skippedBinds++; return; }
+	glUseProgram(program);
+	this->m_program = program;
+	this->m_curFrame.programBinds++;
+}
+
+void GLStateCache::bindVertexArray(const GLuint vao) {
+	if (this->m_vao == vao) { this->m_curFrame.skippedBinds++; return; }
+	glBindVertexArray(vao);
+	this->m_vao = vao;
+	this->m_curFrame.vaoBinds++;
+}
+
+void GLStateCache::bindTexture(const int unit, const GLuint texture) {
+	// DSA bind: never touches the active texture unit
+	if (unit < 0 || unit >= MAX_TEXTURE_UNIT) {
+		glBindTextureUnit(unit, texture);
+		this->m_curFrame.textureBinds++;
+		return;
+	}
+	if (this->m_textures[unit] == texture) { this->m_curFrame.skippedBinds++; return; }
+	glBindTextureUnit(unit, texture);
+	this->m_textures[unit] = texture;
+	this->m_curFrame.textureBinds++;
+}
+
+void GLStateCache::bindStorageBuffer(const int binding, const GLuint buffer) {
+	if (binding >= 0 && binding < MAX_BUFFER_BINDING) {
+		if (this->m_storageBuffers[binding] == buffer) { this->m_curFrame.skippedBinds++; return; }
+		this->m_storageBuffers[binding] = buffer;
+	}
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, buffer);
+	this->m_curFrame.bufferBinds++;
+}
+
+void GLStateCache::bindUniformBufferRange(const int binding, const GLuint buffer, const GLintptr offset, const GLsizeiptr size) {
+	if (binding >= 0 && binding < MAX_BUFFER_BINDING) {
+		if (this->m_uniformBuffers[binding] == buffer && this->m_uniformOffsets[binding] == offset && this->m_uniformSizes[binding] == size) {
+			this->m_curFrame.skippedBinds++;
+			return;
+		}
+		this->m_uniformBuffers[binding] = buffer;
+		this->m_uniformOffsets[binding] = offset;
+		this->m_uniformSizes[binding] = size;
+	}
+	glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, offset, size);
+	this->m_curFrame.bufferBinds++;
+}
+
+void GLStateCache::bindDrawIndirectBuffer(const GLuint buffer) {
+	if (this->m_indirectBuffer == buffer) { this->m_curFrame.skippedBinds++; return; }
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer);
+	this->m_indirectBuffer = buffer;
+	this->m_curFrame.bufferBinds++;
+}
+
+void GLStateCache::bindFramebuffer(const GLenum target, const GLuint fbo) {
+	const bool draw = (target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER);
+	const bool read = (target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER);
+	if ((!draw || this->m_drawFBO == fbo) && (!read || this->m_readFBO == fbo)) {
+		this->m_curFrame.skippedBinds++;
+		return;
+	}
+	glBindFramebuffer(target, fbo);
+	if (draw) { this->m_drawFBO = fbo; }
+	if (read) { this->m_readFBO = fbo; }
+	this->m_curFrame.framebufferBinds++;
+}
+
+void GLStateCache::drawElements(const GLenum mode, const GLsizei count, const GLenum type, const void* indices) {
+	glDrawElements(mode, count, type, indices);
+	this->m_curFrame.drawCalls++;
+}
+
+void GLStateCache::drawElementsIndirect(const GLenum mode, const GLenum type, const void* indirect) {
+	glDrawElementsIndirect(mode, type, indirect);
+	this->m_curFrame.drawCalls++;
+}
+
+void GLStateCache::drawArraysIndirect(const GLenum mode, const void* indirect) {
+	glDrawArraysIndirect(mode, indirect);
+	this->m_curFrame.drawCalls++;
+}
+
+void GLStateCache::drawElementsInstanced(const GLenum mode, const GLsizei count, const GLenum type, const void* indices, const GLsizei instanceCount) {
+	glDrawElementsInstanced(mode, count, type, indices, instanceCount);
+	this->m_curFrame.drawCalls++;
+}
+
+void GLStateCache::drawArraysInstanced(const GLenum mode, const GLint first, const GLsizei count, const GLsizei instanceCount) {
+	glDrawArraysInstanced(mode, first, count, instanceCount);
+	this->m_curFrame.drawCalls++;
+}
+
+void GLStateCache::bindDispatchIndirectBuffer(const GLuint buffer) {
+	if (this->m_dispatchIndirectBuffer == buffer) { this->m_curFrame.skippedBinds++; return; }
+	glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, buffer);
+	this->m_dispatchIndirectBuffer = buffer;
+	this->m_curFrame.bufferBinds++;
+}
+void GLStateCache::dispatchCompute(const GLuint x, const GLuint y, const GLuint z) {
+	glDispatchCompute(x, y, z);
+	this->m_curFrame.dispatchCalls++;
+}
+void GLStateCache::dispatchComputeIndirect(const GLintptr offset) {
+	glDispatchComputeIndirect(offset);
+	this->m_curFrame.dispatchCalls++;
+}
+
+void GLStateCache::countUpload(const long long bytes) {
+	this->m_curFrame.uploads++;
+	this->m_curFrame.uploadBytes += bytes;
+}
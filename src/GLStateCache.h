@@ -0,0 +1,85 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// Per-frame GL call counters (shown in MyImGuiPanel).
+struct GLFrameCounters {
+	int drawCalls = 0;
+	int dispatchCalls = 0;
+	int programBinds = 0;
+	int vaoBinds = 0;
+	int textureBinds = 0;
+	int bufferBinds = 0;
+	int framebufferBinds = 0;
+	int skippedBinds = 0;
+	int uploads = 0;
+	long long uploadBytes = 0;
+};
+
+// Singleton
+
+// Thin tracker around the binds used by the render loop: program, VAO, texture units,
+// indexed SSBO/UBO bindings, indirect buffer and framebuffers. Calls that would not change
+// the bound state are skipped. All in-frame binds must go through here; invalidate() is
+// called at the start of every frame so binds done during loading/resizing don't matter.
+class GLStateCache
+{
+private:
+	GLStateCache() {}
+
+public:
+	virtual ~GLStateCache() {}
+
+	static GLStateCache* Instance() {
+		static GLStateCache* m_instance = nullptr;
+		if (m_instance == nullptr) {
+			m_instance = new GLStateCache();
+		}
+		return m_instance;
+	}
+
+	static const int MAX_TEXTURE_UNIT = 16;
+	static const int MAX_BUFFER_BINDING = 16;
+
+public:
+	// roll the counters over and forget all cached bindings
+	void beginFrame();
+	void invalidate();
+
+	void useProgram(const GLuint program);
+	void bindVertexArray(const GLuint vao);
+	void bindTexture(const int unit, const GLuint texture);
+	void bindStorageBuffer(const int binding, const GLuint buffer);
+	void bindUniformBufferRange(const int binding, const GLuint buffer, const GLintptr offset, const GLsizeiptr size);
+	void bindDrawIndirectBuffer(const GLuint buffer);
+	void bindDispatchIndirectBuffer(const GLuint buffer);
+	void bindFramebuffer(const GLenum target, const GLuint fbo);
+
+	void drawElements(const GLenum mode, const GLsizei count, const GLenum type, const void* indices);
+	void drawElementsIndirect(const GLenum mode, const GLenum type, const void* indirect);
+	void drawArraysIndirect(const GLenum mode, const void* indirect);
+	void drawElementsInstanced(const GLenum mode, const GLsizei count, const GLenum type, const void* indices, const GLsizei instanceCount);
+	void drawArraysInstanced(const GLenum mode, const GLint first, const GLsizei count, const GLsizei instanceCount);
+	void dispatchCompute(const GLuint x, const GLuint y, const GLuint z);
+	void dispatchComputeIndirect(const GLintptr offset);
+	void countUpload(const long long bytes);
+
+	const GLFrameCounters& lastFrameCounters() const { return m_lastFrame; }
+
+private:
+	GLFrameCounters m_curFrame;
+	GLFrameCounters m_lastFrame;
+
+	// ~0u means "unknown", so the first bind after invalidate() always goes through
+	GLuint m_program = ~0u;
+	GLuint m_vao = ~0u;
+	GLuint m_textures[MAX_TEXTURE_UNIT];
+	GLuint m_storageBuffers[MAX_BUFFER_BINDING];
+	GLuint m_uniformBuffers[MAX_BUFFER_BINDING];
+	GLintptr m_uniformOffsets[MAX_BUFFER_BINDING];
+	GLsizeiptr m_uniformSizes[MAX_BUFFER_BINDING];
+	GLuint m_indirectBuffer = ~0u;
+	GLuint m_dispatchIndirectBuffer = ~0u;
+	GLuint m_drawFBO = ~0u;
+	GLuint m_readFBO = ~0u;
+};
@@ -0,0 +1,156 @@
+#include "GpuProfiler.h"
+#include "CpuProfiler.h"
+#include <cstring>
+#include <fstream>
+
+void GpuProfiler::ensureQueries() {
+	if (this->m_queriesCreated) { return; }
+	for (int i = 0; i < NUM_FRAME_SLOT; ++i) {
+		glGenQueries(MAX_SCOPE_PER_FRAME * 2, this->m_slots[i].queries);
+	}
+	this->m_queriesCreated = true;
+}
+
+bool GpuProfiler::tryResolve(FrameSlot& slot) {
+	if (!slot.pending) { return true; }
+	if (slot.numScope == 0) {
+		slot.pending = false;
+		return true;
+	}
+
+	// the outermost scope's end query is issued last: once it is available, all are
+	GLuint available = 0;
+	glGetQueryObjectuiv(slot.queries[slot.lastQuery], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (available == 0) { return false; }
+
+	GpuFrameResult frame;
+	frame.frameIndex = slot.frameIndex;
+	frame.gpuToCpuOffsetNs = slot.gpuToCpuOffsetNs;
+	frame.scopes.resize(slot.numScope);
+	for (int i = 0; i < slot.numScope; ++i) {
+		GpuScopeResult& r = frame.scopes[i];
+		std::memcpy(r.name, slot.scopes[i].name, sizeof(r.name));
+		r.depth = slot.scopes[i].depth;
+		glGetQueryObjectui64v(slot.queries[i * 2 + 0], GL_QUERY_RESULT, &r.beginNs);
+		if (slot.scopes[i].closed) {
+			glGetQueryObjectui64v(slot.queries[i * 2 + 1], GL_QUERY_RESULT, &r.endNs);
+		} else {
+			r.endNs = r.beginNs;
+		}
+		if (r.depth == 0) {
+			frame.totalMs += r.durationMs();
+		}
+	}
+	slot.pending = false;
+
+	if ((int)this->m_history.size() >= HISTORY_LENGTH) {
+		this->m_history.erase(this->m_history.begin());
+	}
+	this->m_history.push_back(std::move(frame));
+	return true;
+}
+
+void GpuProfiler::beginFrame() {
+	this->m_activeThisFrame = this->m_enabled;
+	if (!this->m_activeThisFrame && !this->m_queriesCreated) { return; }
+	this->ensureQueries();
+
+	// an unbalanced push from last frame would corrupt the debug group stack
+	while (this->m_openDepth > 0 || this->m_overflowDepth > 0) {
+		this->popScope();
+	}
+
+	// read back finished frames, oldest first; stop at the first one still in flight
+	if (this->m_currSlot >= 0) {
+		CPU_PROFILE_SCOPE("GPU timer readback");
+		for (int k = 1; k <= NUM_FRAME_SLOT; ++k) {
+			FrameSlot& slot = this->m_slots[(this->m_currSlot + k) % NUM_FRAME_SLOT];
+			if (!this->tryResolve(slot)) { break; }
+		}
+	}
+
+	this->m_currSlot = (this->m_currSlot + 1) % NUM_FRAME_SLOT;
+	FrameSlot& slot = this->m_slots[this->m_currSlot];
+	if (slot.pending) {
+		// GPU is more than NUM_FRAME_SLOT frames behind: drop instead of waiting
+		slot.pending = false;
+		this->m_droppedFrames++;
+	}
+	slot.numScope = 0;
+	slot.lastQuery = 0;
+	slot.frameIndex = this->m_frameIndex++;
+	slot.pending = this->m_activeThisFrame;
+
+	// calibrate once per frame so GPU scopes can be drawn on the CPU timeline without drift
+	if (slot.pending) {
+		GLint64 gpuNow = 0;
+		glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+		slot.gpuToCpuOffsetNs = (long long)CpuProfiler::nowNs() - (long long)gpuNow;
+	}
+}
+
+void GpuProfiler::pushScope(const char* name) {
+	if (!this->m_activeThisFrame || this->m_currSlot < 0) { return; }
+	FrameSlot& slot = this->m_slots[this->m_currSlot];
+	if (slot.numScope >= MAX_SCOPE_PER_FRAME) {
+		this->m_overflowDepth++;
+		return;
+	}
+
+	glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+
+	const int idx = slot.numScope++;
+	std::strncpy(slot.scopes[idx].name, name, sizeof(slot.scopes[idx].name) - 1);
+	slot.scopes[idx].name[sizeof(slot.scopes[idx].name) - 1] = '\0';
+	slot.scopes[idx].depth = this->m_openDepth;
+	slot.scopes[idx].closed = false;
+	glQueryCounter(slot.queries[idx * 2 + 0], GL_TIMESTAMP);
+	slot.lastQuery = idx * 2 + 0;
+	this->m_openStack[this->m_openDepth++] = idx;
+}
+
+void GpuProfiler::popScope() {
+	if (this->m_overflowDepth > 0) {
+		this->m_overflowDepth--;
+		return;
+	}
+	if (this->m_openDepth <= 0 || this->m_currSlot < 0) { return; }
+	FrameSlot& slot = this->m_slots[this->m_currSlot];
+
+	const int idx = this->m_openStack[--this->m_openDepth];
+	glQueryCounter(slot.queries[idx * 2 + 1], GL_TIMESTAMP);
+	slot.scopes[idx].closed = true;
+	slot.lastQuery = idx * 2 + 1;
+
+	glPopDebugGroup();
+}
+
+double GpuProfiler::averageMs(const char* name, const int depth) const {
+	double sum = 0.0;
+	int count = 0;
+	for (const GpuFrameResult& frame : this->m_history) {
+		for (const GpuScopeResult& r : frame.scopes) {
+			if (r.depth == depth && std::strcmp(r.name, name) == 0) {
+				sum += r.durationMs();
+				count++;
+			}
+		}
+	}
+	return (count > 0) ? (sum / count) : -1.0;
+}
+
+bool GpuProfiler::exportCSV(const std::string& path) const {
+	std::ofstream output(path);
+	if (!output.is_open()) { return false; }
+
+	output << "frame,scope,depth,begin_ms,duration_ms\n";
+	for (const GpuFrameResult& frame : this->m_history) {
+		if (frame.scopes.empty()) { continue; }
+		const GLuint64 frameBegin = frame.scopes[0].beginNs;
+		for (const GpuScopeResult& r : frame.scopes) {
+			output << frame.frameIndex << "," << r.name << "," << r.depth << ","
+				<< (double)(r.beginNs - frameBegin) * 1.0e-6 << "," << r.durationMs() << "\n";
+		}
+	}
+	return true;
+}
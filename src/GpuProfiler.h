@@ -0,0 +1,113 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+
+// One resolved GPU scope (timestamps are in the GL_TIMESTAMP domain, nanoseconds).
+struct GpuScopeResult {
+	char name[32];
+	int depth;
+	GLuint64 beginNs;
+	GLuint64 endNs;
+
+	double durationMs() const { return (double)(endNs - beginNs) * 1.0e-6; }
+};
+
+struct GpuFrameResult {
+	unsigned long long frameIndex = 0;
+	std::vector<GpuScopeResult> scopes;
+	double totalMs = 0.0; // sum of top-level scopes
+	long long gpuToCpuOffsetNs = 0; // add to a GPU timestamp to get CpuProfiler::nowNs() time
+};
+
+// Singleton
+
+// Scoped GPU timers built on glQueryCounter(GL_TIMESTAMP) pairs. Queries live in a ring of
+// NUM_FRAME_SLOT frames; a slot is read back only once its last query is available, normally
+// 2-3 frames later, so the CPU never waits on the GPU. A slot that is still pending when it is
+// needed again is dropped. Every scope is also a glPushDebugGroup for external capture tools.
+// Timestamp pairs are used instead of GL_TIME_ELAPSED because elapsed queries cannot nest.
+class GpuProfiler
+{
+private:
+	GpuProfiler() {}
+
+public:
+	virtual ~GpuProfiler() {}
+
+	static GpuProfiler* Instance() {
+		static GpuProfiler* m_instance = nullptr;
+		if (m_instance == nullptr) {
+			m_instance = new GpuProfiler();
+		}
+		return m_instance;
+	}
+
+	static const int NUM_FRAME_SLOT = 4;
+	static const int MAX_SCOPE_PER_FRAME = 64;
+	static const int HISTORY_LENGTH = 240;
+
+public:
+	void beginFrame();
+	void pushScope(const char* name);
+	void popScope();
+
+	void setEnabled(const bool enabled) { m_enabled = enabled; }
+	bool enabled() const { return m_enabled; }
+
+	// resolved frames, oldest first
+	const std::vector<GpuFrameResult>& history() const { return m_history; }
+	const GpuFrameResult* latest() const { return m_history.empty() ? nullptr : &m_history.back(); }
+	int droppedFrames() const { return m_droppedFrames; }
+	// index of the frame currently being recorded
+	unsigned long long currentFrameIndex() const { return (m_frameIndex > 0) ? m_frameIndex - 1 : 0; }
+	// average duration of the scope with the given name and depth over the history (-1 if never seen)
+	double averageMs(const char* name, const int depth) const;
+	// frame,scope,depth,begin_ms,duration_ms (begin relative to the first scope of the frame)
+	bool exportCSV(const std::string& path) const;
+
+private:
+	struct PendingScope {
+		char name[32];
+		int depth;
+		bool closed;
+	};
+	struct FrameSlot {
+		GLuint queries[MAX_SCOPE_PER_FRAME * 2];
+		PendingScope scopes[MAX_SCOPE_PER_FRAME];
+		int numScope = 0;
+		int lastQuery = 0;
+		unsigned long long frameIndex = 0;
+		long long gpuToCpuOffsetNs = 0;
+		bool pending = false;
+	};
+
+	void ensureQueries();
+	bool tryResolve(FrameSlot& slot);
+
+	bool m_enabled = true;
+	bool m_activeThisFrame = false;
+	bool m_queriesCreated = false;
+	FrameSlot m_slots[NUM_FRAME_SLOT];
+	int m_currSlot = -1;
+	unsigned long long m_frameIndex = 0;
+	// indices of open scopes in the current slot
+	int m_openStack[MAX_SCOPE_PER_FRAME];
+	int m_openDepth = 0;
+	// push calls past MAX_SCOPE_PER_FRAME still need a matching pop
+	int m_overflowDepth = 0;
+	int m_droppedFrames = 0;
+	std::vector<GpuFrameResult> m_history;
+};
+
+// RAII helper: GpuScope scope("Display");
+class GpuScope
+{
+public:
+	explicit GpuScope(const char* name) { GpuProfiler::Instance()->pushScope(name); }
+	~GpuScope() { GpuProfiler::Instance()->popScope(); }
+
+	GpuScope(const GpuScope&) = delete;
+	GpuScope& operator=(const GpuScope&) = delete;
+};
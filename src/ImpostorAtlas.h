@@ -0,0 +1,97 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Octahedral impostor of a mesh: frames x frames orthographic views of its bounding sphere from
+// directions on a hemi-octahedral grid (upper hemisphere, object space), packed into two square
+// atlases of frames * frameSize pixels. Frame (i, j) looks at the mesh from impostorFrameDirection().
+//   albedo:      RGBA8, rgb base color, a coverage (alpha-tested at 0.5)
+//   normalDepth: RGBA8, rgb object-space normal * 0.5 + 0.5, a: offset from the frame's center plane
+//                along the frame direction, in [-radius, radius] mapped to [0, 1]
+// Same math in shaders/impostor.glsl. Baked by bakeImpostorAtlas() (ImpostorBaker.h).
+//
+// File (.imp, binary): "IMP1", int frames, int frameSize, float center xyz, float radius, then the
+// albedo and the normalDepth pixels (bottom row first).
+struct ImpostorAtlas {
+	int frames = 8;
+	int frameSize = 128;
+	glm::vec3 center = glm::vec3(0.0f); // object space bounding sphere the frames are fitted to
+	float radius = 1.0f;
+	std::vector<uint8_t> albedo;
+	std::vector<uint8_t> normalDepth;
+
+	int size() const { return this->frames * this->frameSize; }
+
+	bool writeFile(const std::string& fileFullpath) const {
+		std::ofstream output(fileFullpath, std::ios::binary);
+		if (!output.is_open()) return false;
+		output.write("IMP1", 4);
+		output.write((const char*)&this->frames, sizeof(int));
+		output.write((const char*)&this->frameSize, sizeof(int));
+		output.write((const char*)&this->center, sizeof(glm::vec3));
+		output.write((const char*)&this->radius, sizeof(float));
+		output.write((const char*)this->albedo.data(), (std::streamsize)this->albedo.size());
+		output.write((const char*)this->normalDepth.data(), (std::streamsize)this->normalDepth.size());
+		return output.good();
+	}
+
+	static bool fromFile(const std::string& fileFullpath, ImpostorAtlas& atlas, std::string& error) {
+		std::ifstream input(fileFullpath, std::ios::binary);
+		if (!input.is_open()) {
+			error = "cannot open impostor atlas: " + fileFullpath;
+			return false;
+		}
+		char magic[4] = {};
+		input.read(magic, 4);
+		input.read((char*)&atlas.frames, sizeof(int));
+		input.read((char*)&atlas.frameSize, sizeof(int));
+		input.read((char*)&atlas.center, sizeof(glm::vec3));
+		input.read((char*)&atlas.radius, sizeof(float));
+		bool ok = input.good() && std::string(magic, 4) == "IMP1" && atlas.frames >= 2 && atlas.frames <= 64
+			&& atlas.frameSize >= 4 && atlas.frameSize <= 1024 && atlas.radius > 0.0f;
+		if (ok) {
+			const size_t numByte = (size_t)atlas.size() * atlas.size() * 4;
+			atlas.albedo.resize(numByte);
+			atlas.normalDepth.resize(numByte);
+			input.read((char*)atlas.albedo.data(), (std::streamsize)numByte);
+			input.read((char*)atlas.normalDepth.data(), (std::streamsize)numByte);
+			ok = input.good();
+		}
+		if (!ok) {
+			error = "invalid impostor atlas: " + fileFullpath;
+			return false;
+		}
+		return true;
+	}
+};
+
+// hemi-octahedral mapping of the upper hemisphere (y >= 0) onto [0, 1]^2
+inline glm::vec2 hemiOctEncode(const glm::vec3& dir) {
+	const glm::vec3 d = dir / (std::abs(dir.x) + std::abs(dir.y) + std::abs(dir.z));
+	return glm::vec2(d.x + d.z, d.x - d.z) * 0.5f + 0.5f;
+}
+
+inline glm::vec3 hemiOctDecode(const glm::vec2& uv) {
+	const glm::vec2 t = uv * 2.0f - 1.0f;
+	const glm::vec2 p = glm::vec2(t.x + t.y, t.x - t.y) * 0.5f;
+	return glm::normalize(glm::vec3(p.x, 1.0f - std::abs(p.x) - std::abs(p.y), p.y));
+}
+
+// direction from the mesh towards the viewer of frame (i, j); frames on the grid corners and edges
+// look along the horizon
+inline glm::vec3 impostorFrameDirection(const int i, const int j, const int frames) {
+	return hemiOctDecode(glm::vec2((float)i, (float)j) / (float)(frames - 1));
+}
+
+// right / up of a frame's image plane (right x up = dir); straight down views use -z as up
+inline void impostorFrameBasis(const glm::vec3& dir, glm::vec3& right, glm::vec3& up) {
+	const glm::vec3 upRef = (dir.y > 0.999f) ? glm::vec3(0.0f, 0.0f, -1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+	right = glm::normalize(glm::cross(upRef, dir));
+	up = glm::cross(dir, right);
+}
@@ -0,0 +1,177 @@
+#include "ImpostorBaker.h"
+#include "MeshImport.h"
+#include "Shader.h"
+#include <algorithm>
+#include <cfloat>
+#include <iostream>
+
+namespace {
+
+ShaderProgram* loadBakeProgram() {
+	Shader* vs = new Shader(GL_VERTEX_SHADER);
+	Shader* fs = new Shader(GL_FRAGMENT_SHADER);
+	const bool compiled = vs->createShaderFromFile("shaders/impostorBakeVertex.glsl") && fs->createShaderFromFile("shaders/impostorBakeFragment.glsl");
+	if (!compiled) {
+		std::cerr << "impostor bake shaders: " << vs->shaderInfoLog() << fs->shaderInfoLog() << "\n";
+		delete vs;
+		delete fs;
+		return nullptr;
+	}
+	ShaderProgram* program = new ShaderProgram();
+	program->init();
+	program->attachShader(vs);
+	program->attachShader(fs);
+	program->checkStatus();
+	program->linkProgram();
+	vs->releaseShader();
+	fs->releaseShader();
+	delete vs;
+	delete fs;
+	GLint linked = 0;
+	glGetProgramiv(program->programId(), GL_LINK_STATUS, &linked);
+	if (!linked) {
+		glDeleteProgram(program->programId());
+		delete program;
+		return nullptr;
+	}
+	return program;
+}
+
+} // namespace
+
+bool bakeImpostorAtlas(const float* vertices, const int numVertex, const uint32_t* indices, const int numIndex,
+	const GLuint albedoTexture, const int frames, const int frameSize, ImpostorAtlas& atlas) {
+	if (numVertex <= 0 || numIndex <= 0 || frames < 2 || frameSize < 4) return false;
+
+	// bounding sphere around the box center
+	const int S = INTERLEAVED_VERTEX_FLOATS;
+	glm::vec3 boxMin(FLT_MAX), boxMax(-FLT_MAX);
+	for (int v = 0; v < numVertex; ++v) {
+		const glm::vec3 p(vertices[v * S + 0], vertices[v * S + 1], vertices[v * S + 2]);
+		boxMin = glm::min(boxMin, p);
+		boxMax = glm::max(boxMax, p);
+	}
+	atlas.frames = frames;
+	atlas.frameSize = frameSize;
+	atlas.center = (boxMin + boxMax) * 0.5f;
+	atlas.radius = 0.0f;
+	for (int v = 0; v < numVertex; ++v) {
+		const glm::vec3 p(vertices[v * S + 0], vertices[v * S + 1], vertices[v * S + 2]);
+		atlas.radius = std::max(atlas.radius, glm::length(p - atlas.center));
+	}
+	atlas.radius = std::max(atlas.radius, 1e-4f);
+
+	ShaderProgram* program = loadBakeProgram();
+	if (program == nullptr) return false;
+
+	GLint prevFBO = 0, prevProgram = 0, prevVAO = 0, prevViewport[4] = { 0, 0, 0, 0 };
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &prevFBO);
+	glGetIntegerv(GL_CURRENT_PROGRAM, &prevProgram);
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &prevVAO);
+	glGetIntegerv(GL_VIEWPORT, prevViewport);
+
+	const int size = atlas.size();
+	GLuint targets[2] = { 0, 0 }, depth = 0, fbo = 0;
+	glCreateTextures(GL_TEXTURE_2D, 2, targets);
+	glTextureStorage2D(targets[0], 1, GL_RGBA8, size, size);
+	glTextureStorage2D(targets[1], 1, GL_RGBA8, size, size);
+	glCreateRenderbuffers(1, &depth);
+	glNamedRenderbufferStorage(depth, GL_DEPTH_COMPONENT32F, size, size);
+	glCreateFramebuffers(1, &fbo);
+	glNamedFramebufferTexture(fbo, GL_COLOR_ATTACHMENT0, targets[0], 0);
+	glNamedFramebufferTexture(fbo, GL_COLOR_ATTACHMENT1, targets[1], 0);
+	glNamedFramebufferRenderbuffer(fbo, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+	const GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glNamedFramebufferDrawBuffers(fbo, 2, drawBuffers);
+
+	GLuint vao = 0, vbo = 0, ebo = 0;
+	glCreateVertexArrays(1, &vao);
+	glCreateBuffers(1, &vbo);
+	glCreateBuffers(1, &ebo);
+	glNamedBufferData(vbo, (GLsizeiptr)numVertex * S * sizeof(float), vertices, GL_STATIC_DRAW);
+	glNamedBufferData(ebo, (GLsizeiptr)numIndex * sizeof(uint32_t), indices, GL_STATIC_DRAW);
+	glVertexArrayVertexBuffer(vao, 0, vbo, 0, S * sizeof(float));
+	glVertexArrayElementBuffer(vao, ebo);
+	const GLuint attribs[3] = { 0, 1, 3 };
+	const GLuint offsets[3] = { 0, 3, 9 };
+	const GLint sizes[3] = { 3, 3, 2 };
+	for (int k = 0; k < 3; ++k) {
+		glEnableVertexArrayAttrib(vao, attribs[k]);
+		glVertexArrayAttribFormat(vao, attribs[k], sizes[k], GL_FLOAT, GL_FALSE, offsets[k] * sizeof(float));
+		glVertexArrayAttribBinding(vao, attribs[k], 0);
+	}
+
+	// untextured meshes: a white texel
+	GLuint whiteTexture = 0;
+	if (albedoTexture == 0) {
+		const uint8_t white[4] = { 255, 255, 255, 255 };
+		glCreateTextures(GL_TEXTURE_2D, 1, &whiteTexture);
+		glTextureStorage2D(whiteTexture, 1, GL_RGBA8, 1, 1);
+		glTextureSubImage2D(whiteTexture, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, white);
+	}
+	glBindTextureUnit(0, albedoTexture != 0 ? albedoTexture : whiteTexture);
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo);
+	// empty texels: no coverage, normal up and depth on the center plane (what mips blend towards)
+	const float clearAlbedo[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	const float clearNormalDepth[4] = { 0.5f, 1.0f, 0.5f, 0.5f };
+	const float clearDepth = 1.0f;
+	glViewport(0, 0, size, size);
+	glClearNamedFramebufferfv(fbo, GL_COLOR, 0, clearAlbedo);
+	glClearNamedFramebufferfv(fbo, GL_COLOR, 1, clearNormalDepth);
+	glClearNamedFramebufferfv(fbo, GL_DEPTH, 0, &clearDepth);
+
+	const GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+	const GLboolean blend = glIsEnabled(GL_BLEND);
+	GLint prevDepthFunc = GL_LESS;
+	glGetIntegerv(GL_DEPTH_FUNC, &prevDepthFunc);
+	glDisable(GL_CULL_FACE);
+	glDisable(GL_BLEND);
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LESS);
+	glDepthMask(GL_TRUE);
+
+	program->useProgram();
+	glBindVertexArray(vao);
+	glUniform4f(0, atlas.center.x, atlas.center.y, atlas.center.z, atlas.radius);
+	for (int j = 0; j < frames; ++j) {
+		for (int i = 0; i < frames; ++i) {
+			const glm::vec3 dir = impostorFrameDirection(i, j, frames);
+			glm::vec3 right, up;
+			impostorFrameBasis(dir, right, up);
+			glUniform3fv(1, 1, &dir.x);
+			glUniform3fv(2, 1, &right.x);
+			glUniform3fv(3, 1, &up.x);
+			glViewport(i * frameSize, j * frameSize, frameSize, frameSize);
+			glDrawElements(GL_TRIANGLES, numIndex, GL_UNSIGNED_INT, nullptr);
+		}
+	}
+
+	const size_t numByte = (size_t)size * size * 4;
+	atlas.albedo.resize(numByte);
+	atlas.normalDepth.resize(numByte);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glGetTextureImage(targets[0], 0, GL_RGBA, GL_UNSIGNED_BYTE, (GLsizei)numByte, atlas.albedo.data());
+	glGetTextureImage(targets[1], 0, GL_RGBA, GL_UNSIGNED_BYTE, (GLsizei)numByte, atlas.normalDepth.data());
+
+	glDepthFunc((GLenum)prevDepthFunc);
+	if (cullFace) glEnable(GL_CULL_FACE);
+	if (blend) glEnable(GL_BLEND);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, (GLuint)prevFBO);
+	glViewport(prevViewport[0], prevViewport[1], prevViewport[2], prevViewport[3]);
+	glUseProgram((GLuint)prevProgram);
+	glBindVertexArray((GLuint)prevVAO);
+	glBindTextureUnit(0, 0);
+
+	glDeleteFramebuffers(1, &fbo);
+	glDeleteRenderbuffers(1, &depth);
+	glDeleteTextures(2, targets);
+	if (whiteTexture != 0) glDeleteTextures(1, &whiteTexture);
+	glDeleteVertexArrays(1, &vao);
+	glDeleteBuffers(1, &vbo);
+	glDeleteBuffers(1, &ebo);
+	// ShaderProgram keeps its GL program alive
+	glDeleteProgram(program->programId());
+	delete program;
+	return true;
+}
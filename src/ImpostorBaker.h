@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include <glad/glad.h>
+#include "ImpostorAtlas.h"
+
+// Renders an octahedral impostor atlas (ImpostorAtlas.h) of a mesh with the current GL context:
+// every frame is an orthographic view of the mesh's bounding sphere, alpha-tested against the albedo
+// texture like the G-buffer texture pass, into an RGBA8 albedo and an RGBA8 normal + depth target.
+// Loads shaders/impostorBake*.glsl relative to the working directory. Framebuffer, viewport, program,
+// VAO, depth function, face culling and blending are restored; texture unit 0 is left unbound.
+//
+// vertices: interleaved (MeshImport.h), numVertex of them; indices: triangles.
+// albedoTexture: 0 for untextured meshes (white, fully covered).
+bool bakeImpostorAtlas(const float* vertices, const int numVertex, const uint32_t* indices, const int numIndex,
+	const GLuint albedoTexture, const int frames, const int frameSize, ImpostorAtlas& atlas);
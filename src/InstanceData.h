@@ -0,0 +1,41 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "MyPoissonSample.h"
+
+// per-instance SSBO record read by cullInstances.comp and the instanced vertex shader
+struct InstanceDataGPU {
+	glm::mat4 model;
+	glm::vec4 sphere; // xyz center (world), w radius
+};
+
+// front-to-back visible lists (shaders/depthBins.glsl): DepthBins SSBO of a batch =
+// binCount[DEPTH_BIN_COUNT], binOffset[DEPTH_BIN_COUNT], uvec4 scatter dispatch arguments
+const int DEPTH_BIN_COUNT = 64;
+const size_t DEPTH_BIN_DISPATCH_OFFSET = 2 * DEPTH_BIN_COUNT * sizeof(uint32_t);
+
+// model matrix (translate * rotate from the sample's euler radians) and world bounding sphere
+// of samples [first, first + count) (count < 0: to the end); outInstances[0] is sample `first`
+inline void buildInstanceData(const MyPoissonSample& sample, const glm::vec3& sphereCenterOS, const float sphereRadiusOS, InstanceDataGPU* outInstances, const int first = 0, const int count = -1) {
+	const int last = (count < 0) ? sample.m_numSample : std::min(sample.m_numSample, first + count);
+	for (int i = first; i < last; ++i) {
+		glm::vec3 pos(
+			sample.m_positions[i * 3 + 0],
+			sample.m_positions[i * 3 + 1],
+			sample.m_positions[i * 3 + 2]);
+		glm::vec3 rad(
+			sample.m_radians[i * 3 + 0],
+			sample.m_radians[i * 3 + 1],
+			sample.m_radians[i * 3 + 2]);
+		glm::quat q = glm::quat(rad);
+		glm::mat4 model = glm::translate(glm::mat4(1.0f), pos) * glm::mat4_cast(q);
+		outInstances[i - first].model = model;
+		glm::vec3 worldCenter = glm::vec3(model * glm::vec4(sphereCenterOS, 1.0f));
+		outInstances[i - first].sphere = glm::vec4(worldCenter, sphereRadiusOS);
+	}
+}
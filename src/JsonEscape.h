@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+
+// text for a JSON string literal (without the quotes): escapes '"', '\' and control characters
+inline std::string jsonEscape(const std::string& text) {
+	std::string out;
+	out.reserve(text.size());
+	for (const char c : text) {
+		switch (c) {
+		case '"': out += "\\\""; break;
+		case '\\': out += "\\\\"; break;
+		case '\n': out += "\\n"; break;
+		case '\r': out += "\\r"; break;
+		case '\t': out += "\\t"; break;
+		default:
+			if ((unsigned char)c < 0x20) {
+				char code[8];
+				std::snprintf(code, sizeof(code), "\\u%04x", (unsigned int)(unsigned char)c);
+				out += code;
+			}
+			else { out += c; }
+		}
+	}
+	return out;
+}
@@ -0,0 +1,112 @@
+#include "MeshClusters.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace {
+
+// 10 bits per axis interleaved
+uint32_t spreadBits(uint32_t v) {
+	v &= 0x3FFu;
+	v = (v | (v << 16)) & 0x030000FFu;
+	v = (v | (v << 8)) & 0x0300F00Fu;
+	v = (v | (v << 4)) & 0x030C30C3u;
+	v = (v | (v << 2)) & 0x09249249u;
+	return v;
+}
+
+struct ClusterTriangle {
+	uint32_t group; // dominant normal axis and sign
+	uint32_t morton;
+	uint32_t triangle;
+};
+
+}
+
+void buildMeshClusters(const float* positions, const int numVertex, const int strideFloats, uint32_t* indices, const int numIndex,
+	const int maxTriangles, std::vector<MeshCluster>& clusters) {
+	clusters.clear();
+	const int numTriangle = numIndex / 3;
+	if (numTriangle <= 0 || numVertex <= 0 || maxTriangles <= 0) return;
+	auto position = [&](const uint32_t v) {
+		return glm::vec3(positions[(size_t)v * strideFloats], positions[(size_t)v * strideFloats + 1], positions[(size_t)v * strideFloats + 2]);
+	};
+
+	glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+	for (int v = 0; v < numVertex; ++v) {
+		boundsMin = glm::min(boundsMin, position((uint32_t)v));
+		boundsMax = glm::max(boundsMax, position((uint32_t)v));
+	}
+	const glm::vec3 extent = glm::max(boundsMax - boundsMin, glm::vec3(1e-6f));
+
+	std::vector<glm::vec3> normals((size_t)numTriangle);
+	std::vector<ClusterTriangle> order((size_t)numTriangle);
+	for (int t = 0; t < numTriangle; ++t) {
+		const glm::vec3 a = position(indices[t * 3]), b = position(indices[t * 3 + 1]), c = position(indices[t * 3 + 2]);
+		const glm::vec3 n = glm::cross(b - a, c - a);
+		const float length = glm::length(n);
+		normals[t] = (length > 0.0f) ? n / length : glm::vec3(0.0f);
+		int axis = 0;
+		for (int k = 1; k < 3; ++k) {
+			if (std::fabs(normals[t][k]) > std::fabs(normals[t][axis])) axis = k;
+		}
+		const glm::vec3 q = glm::clamp(((a + b + c) / 3.0f - boundsMin) / extent, 0.0f, 1.0f) * 1023.0f;
+		order[t].group = (uint32_t)(axis * 2 + (normals[t][axis] < 0.0f ? 1 : 0));
+		order[t].morton = spreadBits((uint32_t)q.x) | (spreadBits((uint32_t)q.y) << 1) | (spreadBits((uint32_t)q.z) << 2);
+		order[t].triangle = (uint32_t)t;
+	}
+	std::sort(order.begin(), order.end(), [](const ClusterTriangle& x, const ClusterTriangle& y) {
+		return (x.group != y.group) ? x.group < y.group : (x.morton != y.morton) ? x.morton < y.morton : x.triangle < y.triangle;
+	});
+
+	const std::vector<uint32_t> source(indices, indices + (size_t)numTriangle * 3);
+	for (size_t i = 0; i < order.size(); ++i) {
+		for (int k = 0; k < 3; ++k) indices[i * 3 + k] = source[(size_t)order[i].triangle * 3 + k];
+	}
+
+	// every group cut into near-equal runs
+	size_t groupBegin = 0;
+	while (groupBegin < order.size()) {
+		size_t groupEnd = groupBegin;
+		while (groupEnd < order.size() && order[groupEnd].group == order[groupBegin].group) ++groupEnd;
+		const size_t groupSize = groupEnd - groupBegin;
+		const size_t numRun = (groupSize + (size_t)maxTriangles - 1) / (size_t)maxTriangles;
+		for (size_t r = 0; r < numRun; ++r) {
+			const size_t first = groupBegin + groupSize * r / numRun;
+			const size_t last = groupBegin + groupSize * (r + 1) / numRun;
+			MeshCluster cluster;
+			cluster.firstIndex = (uint32_t)(first * 3);
+			cluster.numTriangles = (uint32_t)(last - first);
+
+			glm::vec3 clusterMin(FLT_MAX), clusterMax(-FLT_MAX), normalSum(0.0f);
+			for (size_t i = first; i < last; ++i) {
+				for (int k = 0; k < 3; ++k) {
+					const glm::vec3 p = position(indices[i * 3 + k]);
+					clusterMin = glm::min(clusterMin, p);
+					clusterMax = glm::max(clusterMax, p);
+				}
+				normalSum += normals[order[i].triangle];
+			}
+			cluster.center = (clusterMin + clusterMax) * 0.5f;
+			for (size_t i = first; i < last; ++i) {
+				for (int k = 0; k < 3; ++k) {
+					cluster.radius = std::max(cluster.radius, glm::length(position(indices[i * 3 + k]) - cluster.center));
+				}
+			}
+			// cone: every normal within the half angle of the mean; wider than ~84 degrees or with a
+			// degenerate triangle the cluster is never backfacing
+			const float sumLength = glm::length(normalSum);
+			if (sumLength > 0.0f) {
+				cluster.coneAxis = normalSum / sumLength;
+				float minDot = 1.0f;
+				for (size_t i = first; i < last; ++i) {
+					const glm::vec3& n = normals[order[i].triangle];
+					minDot = (n == glm::vec3(0.0f)) ? -1.0f : std::min(minDot, glm::dot(n, cluster.coneAxis));
+				}
+				cluster.coneCutoff = (minDot > 0.1f) ? std::sqrt(1.0f - minDot * minDot) : 1.0f;
+			}
+			clusters.push_back(cluster);
+		}
+		groupBegin = groupEnd;
+	}
+}
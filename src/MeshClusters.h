@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Triangle clusters (meshlets) of a mesh, culled per visible instance by shaders/clusterCull.comp.
+// Every cluster is a contiguous range of the mesh's index buffer with an object-space bounding sphere
+// and a normal cone: seen from an eye with dot(center - eye, axis) >= cutoff * |center - eye| + radius,
+// every triangle of the cluster faces away (cutoff = sin of the cone's half angle; 1: never).
+struct MeshCluster {
+	glm::vec3 center = glm::vec3(0.0f);
+	float radius = 0.0f;
+	glm::vec3 coneAxis = glm::vec3(0.0f, 1.0f, 0.0f);
+	float coneCutoff = 1.0f;
+	uint32_t firstIndex = 0;
+	uint32_t numTriangles = 0;
+};
+
+// std430 layout of a cluster (Clusters SSBO, binding 10 of clusterCull.comp)
+struct ClusterDataGPU {
+	glm::vec4 sphere; // xyz center, w radius
+	glm::vec4 cone;   // xyz axis, w cutoff
+	glm::uvec4 range; // x first index, y triangles
+};
+
+// ClusterDraw SSBO of a batch (binding 2 of clusterCull.comp / clusterCullArgs.comp): draw command of
+// the compacted index buffer, dispatch arguments of the cull, clusters per result of the last cull
+struct ClusterDrawGPU {
+	uint32_t count;
+	uint32_t instanceCount;
+	uint32_t firstIndex;
+	uint32_t baseVertex;
+	uint32_t baseInstance;
+	uint32_t pad[3];
+	glm::uvec4 dispatch;
+	glm::uvec4 stats; // visible, frustum, backface, occluded
+};
+
+static_assert(sizeof(ClusterDataGPU) == 48, "ClusterData must match std430 layout");
+static_assert(sizeof(ClusterDrawGPU) == 64, "ClusterDraw must match std430 layout");
+
+// Splits a mesh into clusters of at most maxTriangles triangles and reorders its triangles so that
+// every cluster is a contiguous range of indices. Triangles are grouped by the axis their normal is
+// closest to (tight cones on walls and roofs), ordered along a Morton curve of their centroids and cut
+// into near-equal runs, so clusters hold between maxTriangles / 2 and maxTriangles triangles wherever
+// a group has enough of them.
+//
+// positions: xyz of numVertex vertices, strideFloats apart; indices: triangles, reordered in place.
+void buildMeshClusters(const float* positions, const int numVertex, const int strideFloats, uint32_t* indices, const int numIndex,
+	const int maxTriangles, std::vector<MeshCluster>& clusters);
+
+// bits of the vertex index in a compacted cluster index ((instance << bits) | vertex)
+inline int clusterVertexBits(const int numVertex) {
+	int bits = 0;
+	while (bits < 31 && (1 << bits) < numVertex) ++bits;
+	return bits;
+}
+
+// the cone test of clusterCull.comp (object space)
+inline bool clusterBackfacing(const MeshCluster& cluster, const glm::vec3& eye) {
+	if (cluster.coneCutoff >= 1.0f) return false;
+	const glm::vec3 v = cluster.center - eye;
+	return glm::dot(v, cluster.coneAxis) >= cluster.coneCutoff * glm::length(v) + cluster.radius;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <assimp/mesh.h>
+
+// interleaved vertex layout shared by DynamicSceneObject and the instance batches:
+// position(3) normal(3) tangent(3) uv(2)
+const int INTERLEAVED_VERTEX_FLOATS = 11;
+
+// vertices: mesh->mNumVertices * INTERLEAVED_VERTEX_FLOATS floats, indices: mesh->mNumFaces * 3
+// (the mesh must be triangulated)
+inline void interleaveAiMesh(const aiMesh* mesh, float* vertices, unsigned int* indices) {
+	const bool hasUV = mesh->HasTextureCoords(0);
+	const int S = INTERLEAVED_VERTEX_FLOATS;
+	for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
+		const aiVector3D& v = mesh->mVertices[i];
+		const aiVector3D uv = hasUV ? mesh->mTextureCoords[0][i] : aiVector3D(0.0f, 0.0f, 0.0f);
+
+		vertices[i * S + 0] = v.x;
+		vertices[i * S + 1] = v.y;
+		vertices[i * S + 2] = v.z;
+		vertices[i * S + 3] = mesh->mNormals[i].x;
+		vertices[i * S + 4] = mesh->mNormals[i].y;
+		vertices[i * S + 5] = mesh->mNormals[i].z;
+		vertices[i * S + 6] = mesh->mTangents ? mesh->mTangents[i].x : 0.0f;
+		vertices[i * S + 7] = mesh->mTangents ? mesh->mTangents[i].y : 0.0f;
+		vertices[i * S + 8] = mesh->mTangents ? mesh->mTangents[i].z : 0.0f;
+		vertices[i * S + 9] = uv.x;
+		vertices[i * S + 10] = uv.y;
+	}
+
+	for (unsigned int f = 0; f < mesh->mNumFaces; f++) {
+		const aiFace& face = mesh->mFaces[f];
+		indices[f * 3 + 0] = face.mIndices[0];
+		indices[f * 3 + 1] = face.mIndices[1];
+		indices[f * 3 + 2] = face.mIndices[2];
+	}
+}
@@ -1,6 +1,9 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include "MyCameraManager.h"
-#include <glm\gtc\matrix_transform.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
 
 namespace INANOA {
 MyCameraManager::MyCameraManager() : MIN_PLAYER_CAMERA_TERRAIN_OFFSET(5.0), MIN_AIRPLANE_TERRAIN_OFFSET(3.0)
@@ -17,7 +20,9 @@ void MyCameraManager::init(const int w, const int h){
 	this->m_godCameraControl = new INANOA::MyOrbitControl(w, h);
 	this->m_godMyCamera = new INANOA::MyCamera(glm::vec3(50.0, 120.0, 100.0), glm::vec3(50.0, 0.0, 60.0), glm::vec3(0.0, 1.0, 0.0), -1.0);
 	this->m_godCameraControl->setCamera(this->m_godMyCamera);
-	this->m_playerCameraForwardSpeed = 0.4;
+	// 0.4 units / 0.01 rad per frame at 60 fps
+	this->m_playerCameraForwardSpeed = 24.0;
+	this->m_playerCameraTurnSpeed = 0.6;
 	// initialize player camera
 	this->m_playerMyCamera = new INANOA::MyCamera(glm::vec3(50.0, 50.0, 120.0), glm::vec3(50.0, 47.0, 110.0), glm::vec3(0.0, 1.0, 0.0), -1.0);
 
@@ -25,15 +30,31 @@ void MyCameraManager::init(const int w, const int h){
 }
 void MyCameraManager::resize(const int w, const int h){
 	// half for god view, half for player view
-	const float PLAYER_PROJ_FAR = 700.0;
 	this->setupViewports(w, h);
-
-	this->m_godProjMat = glm::perspective(glm::radians(80.0f), this->m_godViewport[2] * 1.0f / h, 0.1f, 1000.0f);
-	this->m_playerProjMat = glm::perspective(glm::radians(45.0f), this->m_playerViewport[2] * 1.0f / h, 0.1f, PLAYER_PROJ_FAR);
+	this->updateProjections();
 
 	// trackball use full screen
 	this->m_godCameraControl->resize(w, h);
 }
+void MyCameraManager::setReversedZ(const bool reversedZ) {
+	if (this->m_reversedZ == reversedZ) { return; }
+	this->m_reversedZ = reversedZ;
+	this->updateProjections();
+}
+void MyCameraManager::updateProjections() {
+	const float PLAYER_PROJ_FAR = 700.0;
+	const float godAspect = this->m_godViewport[2] * 1.0f / this->m_godViewport[3];
+	const float playerAspect = this->m_playerViewport[2] * 1.0f / this->m_playerViewport[3];
+	if (this->m_reversedZ) {
+		// [0,1] depth (glClipControl GL_ZERO_TO_ONE) with near and far swapped: near -> 1, far -> 0
+		this->m_godProjMat = glm::perspectiveRH_ZO(glm::radians(80.0f), godAspect, 1000.0f, 0.1f);
+		this->m_playerProjMat = glm::perspectiveRH_ZO(glm::radians(45.0f), playerAspect, PLAYER_PROJ_FAR, 0.1f);
+	}
+	else {
+		this->m_godProjMat = glm::perspective(glm::radians(80.0f), godAspect, 0.1f, 1000.0f);
+		this->m_playerProjMat = glm::perspective(glm::radians(45.0f), playerAspect, 0.1f, PLAYER_PROJ_FAR);
+	}
+}
 
 void MyCameraManager::updateGodCamera() {
 	this->m_godCameraControl->update();
@@ -79,10 +100,10 @@ void MyCameraManager::keyPress(const RenderWidgetKeyCode key) {
 		this->m_DPressedFlag = true;
 	}
 	else if (key == RenderWidgetKeyCode::KEY_Z) {
-		this->m_playerCameraHeightOffset = 0.1;
+		this->m_playerCameraHeightOffset = this->m_playerCameraHeightSpeed;
 	}
 	else if (key == RenderWidgetKeyCode::KEY_X) {
-		this->m_playerCameraHeightOffset = -0.1;
+		this->m_playerCameraHeightOffset = -this->m_playerCameraHeightSpeed;
 	}	
 }
 void MyCameraManager::keyRelease(const RenderWidgetKeyCode key) {
@@ -104,31 +125,47 @@ void MyCameraManager::keyRelease(const RenderWidgetKeyCode key) {
 	}
 }
 
+int MyCameraManager::advanceSimulation(const double frameSeconds) {
+	this->m_simulationAccumulator += frameSeconds;
+	int numStep = 0;
+	while (this->m_simulationAccumulator >= SIMULATION_TIMESTEP && numStep < MAX_SIMULATION_STEP_PER_FRAME) {
+		this->m_simulationAccumulator -= SIMULATION_TIMESTEP;
+		numStep++;
+	}
+	// after a long stall (loading, breakpoint) drop the backlog instead of fast-forwarding
+	if (numStep == MAX_SIMULATION_STEP_PER_FRAME) {
+		this->m_simulationAccumulator = 0.0;
+	}
+	return numStep;
+}
+
 void MyCameraManager::updatePlayerCamera() {
+	const float dt = SIMULATION_TIMESTEP;
+	this->m_simulationStep++;
 
 	// update player camera
 	if (this->m_WPressedFlag) {
 		glm::vec3 before = this->m_playerMyCamera->lookCenter();
-		this->m_playerMyCamera->forward(glm::vec3(0.0, 0.0, -1.0) * this->m_playerCameraForwardSpeed, true);
+		this->m_playerMyCamera->forward(glm::vec3(0.0, 0.0, -1.0) * this->m_playerCameraForwardSpeed * dt, true);
 		glm::vec3 after = this->m_playerMyCamera->lookCenter();
 
 		this->m_godMyCamera->translateLookCenterAndViewOrg(after - before);
 	}
 	else if (this->m_SPressedFlag) {
 		glm::vec3 before = this->m_playerMyCamera->lookCenter();
-		this->m_playerMyCamera->forward(glm::vec3(0.0, 0.0, 1.0) * this->m_playerCameraForwardSpeed, true);
+		this->m_playerMyCamera->forward(glm::vec3(0.0, 0.0, 1.0) * this->m_playerCameraForwardSpeed * dt, true);
 		glm::vec3 after = this->m_playerMyCamera->lookCenter();
 
 		this->m_godMyCamera->translateLookCenterAndViewOrg(after - before);
 	}
 	else if (this->m_APressedFlag) {
-		this->m_playerMyCamera->rotateLookCenterAccordingToViewOrg(0.01);
+		this->m_playerMyCamera->rotateLookCenterAccordingToViewOrg(this->m_playerCameraTurnSpeed * dt);
 	}
 	else if (this->m_DPressedFlag) {
-		this->m_playerMyCamera->rotateLookCenterAccordingToViewOrg(-0.01);
+		this->m_playerMyCamera->rotateLookCenterAccordingToViewOrg(-this->m_playerCameraTurnSpeed * dt);
 	}
 
-	this->m_playerMyCamera->translateLookCenterAndViewOrg(glm::vec3(0.0, this->m_playerCameraHeightOffset, 0.0));
+	this->m_playerMyCamera->translateLookCenterAndViewOrg(glm::vec3(0.0, this->m_playerCameraHeightOffset * dt, 0.0));
 	this->m_playerMyCamera->update();	
 }
 void MyCameraManager::updateAirplane() {
@@ -189,16 +226,120 @@ void MyCameraManager::teleport(const int idx) {
 		godCamera->translateLookCenterAndViewOrg(moveVec);
 	};
 
+	glm::vec3 viewOrg, lookCenter;
+	if (MyCameraManager::teleportPoint(idx, viewOrg, lookCenter)) {
+		tele(this->m_godMyCamera, this->m_playerMyCamera, viewOrg, lookCenter);
+	}
+}
+bool MyCameraManager::teleportPoint(const int idx, glm::vec3& viewOrg, glm::vec3& lookCenter) {
 	if (idx == 0) {
-		tele(this->m_godMyCamera, this->m_playerMyCamera, glm::vec3(50.0, 50.0, 120.0), glm::vec3(50.0, 47.0, 110.0));
+		viewOrg = glm::vec3(50.0, 50.0, 120.0);
+		lookCenter = glm::vec3(50.0, 47.0, 110.0);
 	}
 	else if (idx == 1) {
-		tele(this->m_godMyCamera, this->m_playerMyCamera, glm::vec3(30.2523, 49.9996, 498.473), glm::vec3(26.8622, 47.2784, 488.98));
+		viewOrg = glm::vec3(30.2523, 49.9996, 498.473);
+		lookCenter = glm::vec3(26.8622, 47.2784, 488.98);
 	}
 	else if (idx == 2) {
-		tele(this->m_godMyCamera, this->m_playerMyCamera, glm::vec3(119.602, 49.9999, 940.079), glm::vec3(115.248, 47.2317, 931.003));
+		viewOrg = glm::vec3(119.602, 49.9999, 940.079);
+		lookCenter = glm::vec3(115.248, 47.2317, 931.003);
+	}
+	else {
+		return false;
+	}
+	return true;
+}
+void MyCameraManager::setCameraStates(const glm::vec3& playerViewOrg, const glm::vec3& playerLookCenter, const glm::vec3& godViewOrg, const glm::vec3& godLookCenter) {
+	this->m_playerMyCamera->reset(playerViewOrg, playerLookCenter, glm::vec3(0.0, 1.0, 0.0), -1.0);
+	this->m_godMyCamera->reset(godViewOrg, godLookCenter, glm::vec3(0.0, 1.0, 0.0), -1.0);
+}
+
+// ===============================
+// Recording file: "CGCR", uint32 version, float timestep, uint32 numStep, then numStep
+// RecordedState (float time + 24 floats), little-endian as written by the recording machine.
+static const char RECORDING_MAGIC[4] = { 'C', 'G', 'C', 'R' };
+static const uint32_t RECORDING_VERSION = 1;
+
+void MyCameraManager::startRecording() {
+	this->stopPlayback();
+	this->m_recordedStates.clear();
+	this->m_recordFirstStep = this->m_simulationStep;
+	this->m_recording = true;
+}
+bool MyCameraManager::stopRecording(const std::string& fileFullpath) {
+	static_assert(sizeof(RecordedState) == sizeof(float) * 25, "recording layout must stay tightly packed");
+	if (!this->m_recording) { return false; }
+	this->m_recording = false;
+
+	std::ofstream output(fileFullpath, std::ios::binary);
+	if (!output.is_open()) { return false; }
+	const float timestep = SIMULATION_TIMESTEP;
+	const uint32_t numStep = (uint32_t)this->m_recordedStates.size();
+	output.write(RECORDING_MAGIC, sizeof(RECORDING_MAGIC));
+	output.write((const char*)&RECORDING_VERSION, sizeof(RECORDING_VERSION));
+	output.write((const char*)&timestep, sizeof(timestep));
+	output.write((const char*)&numStep, sizeof(numStep));
+	output.write((const char*)this->m_recordedStates.data(), (std::streamsize)(numStep * sizeof(RecordedState)));
+	return output.good();
+}
+bool MyCameraManager::startPlayback(const std::string& fileFullpath) {
+	std::ifstream input(fileFullpath, std::ios::binary);
+	if (!input.is_open()) { return false; }
+
+	char magic[4];
+	uint32_t version = 0, numStep = 0;
+	float timestep = 0.0f;
+	input.read(magic, sizeof(magic));
+	input.read((char*)&version, sizeof(version));
+	input.read((char*)&timestep, sizeof(timestep));
+	input.read((char*)&numStep, sizeof(numStep));
+	// a recording is only deterministic at the timestep it was made with
+	if (!input || std::memcmp(magic, RECORDING_MAGIC, sizeof(magic)) != 0 || version != RECORDING_VERSION || timestep != SIMULATION_TIMESTEP) {
+		return false;
+	}
+
+	std::vector<RecordedState> states(numStep);
+	input.read((char*)states.data(), (std::streamsize)(numStep * sizeof(RecordedState)));
+	if (!input || numStep == 0) { return false; }
+
+	this->m_recording = false;
+	this->m_recordedStates.swap(states);
+	this->m_playbackStep = 0;
+	this->m_simulationAccumulator = 0.0;
+	this->m_playingBack = true;
+	return true;
+}
+void MyCameraManager::stopPlayback() {
+	this->m_playingBack = false;
+}
+void MyCameraManager::recordStep() {
+	if (!this->m_recording) { return; }
+	RecordedState s;
+	s.time = (float)(this->m_simulationStep - this->m_recordFirstStep) * SIMULATION_TIMESTEP;
+	s.playerViewOrg = this->m_playerMyCamera->viewOrig();
+	s.playerLookCenter = this->m_playerMyCamera->lookCenter();
+	s.godViewOrg = this->m_godMyCamera->viewOrig();
+	s.godLookCenter = this->m_godMyCamera->lookCenter();
+	for (int i = 0; i < 4; ++i) {
+		s.airplaneAxis[i] = glm::vec3(this->m_airplaneModelMat[i]);
+	}
+	this->m_recordedStates.push_back(s);
+}
+bool MyCameraManager::applyPlaybackStep() {
+	if (!this->m_playingBack) { return false; }
+	if (this->m_playbackStep >= (int)this->m_recordedStates.size()) {
+		// hold the last state
+		this->m_playingBack = false;
+		return false;
+	}
+
+	const RecordedState& s = this->m_recordedStates[this->m_playbackStep++];
+	this->setCameraStates(s.playerViewOrg, s.playerLookCenter, s.godViewOrg, s.godLookCenter);
+	for (int i = 0; i < 4; ++i) {
+		this->m_airplaneModelMat[i] = glm::vec4(s.airplaneAxis[i], (i == 3) ? 1.0f : 0.0f);
 	}
-	
+	this->m_simulationStep++;
+	return true;
 }
 
 // ===============================
@@ -208,6 +349,8 @@ glm::vec3 MyCameraManager::playerViewOrig() const { return this->m_playerMyCamer
 glm::vec3 MyCameraManager::playerCameraLookCenter() const { return this->m_playerMyCamera->lookCenter(); }
 
 glm::mat4 MyCameraManager::godViewMatrix() const { return this->m_godMyCamera->viewMatrix(); }
+glm::vec3 MyCameraManager::godViewOrig() const { return this->m_godMyCamera->viewOrig(); }
+glm::vec3 MyCameraManager::godLookCenter() const { return this->m_godMyCamera->lookCenter(); }
 glm::mat4 MyCameraManager::godProjectionMatrix() const { return this->m_godProjMat; }
 
 glm::mat4 MyCameraManager::airplaneModelMatrix() const { return this->m_airplaneModelMat; }
@@ -1,6 +1,8 @@
 #pragma once
 
-#include "camera\MyOrbitControl.h"
+#include "camera/MyOrbitControl.h"
+#include <string>
+#include <vector>
 
 enum class RenderWidgetKeyCode {
 	KEY_W, KEY_A, KEY_S, KEY_D, KEY_T, KEY_Z, KEY_X
@@ -20,6 +22,9 @@ public:
 public:
 	void init(const int w, const int h);
 	void resize(const int w, const int h);
+	// reversed-Z projections: near plane at depth 1, far plane at 0, for a [0,1] clip depth range
+	void setReversedZ(const bool reversedZ);
+	bool reversedZ() const { return m_reversedZ; }
 
 	void mousePress(const RenderWidgetMouseButton button, const int x, const int y) ;
 	void mouseRelease(const RenderWidgetMouseButton button, const int x, const int y) ;
@@ -29,9 +34,39 @@ public:
 	void keyRelease(const RenderWidgetKeyCode key) ;
 
 	void teleport(const int idx);
+	// player view origin / look center of teleport point idx (0..NUM_TELEPORT-1)
+	static bool teleportPoint(const int idx, glm::vec3& viewOrg, glm::vec3& lookCenter);
+	static const int NUM_TELEPORT = 3;
+
+	// place both cameras directly (scripted camera paths)
+	void setCameraStates(const glm::vec3& playerViewOrg, const glm::vec3& playerLookCenter, const glm::vec3& godViewOrg, const glm::vec3& godLookCenter);
+
+public:
+	// player/airplane motion runs at a fixed timestep, independent of the render rate
+	static constexpr float SIMULATION_TIMESTEP = 1.0f / 60.0f;
+	static const int MAX_SIMULATION_STEP_PER_FRAME = 8;
+	// accumulate real frame time, return the number of simulation steps to run this frame
+	int advanceSimulation(const double frameSeconds);
+
+	// record: one state per simulation step, saved as a binary file on stop
+	void startRecording();
+	bool stopRecording(const std::string& fileFullpath);
+	// playback: replaces the player/god/airplane update with the recorded states, one per step
+	bool startPlayback(const std::string& fileFullpath);
+	void stopPlayback();
+	bool recording() const { return m_recording; }
+	bool playingBack() const { return m_playingBack; }
+	int numRecordedStep() const { return (int)m_recordedStates.size(); }
+	int playbackStep() const { return m_playbackStep; }
+
+	// called once per simulation step after the camera/airplane update
+	void recordStep();
+	// during playback: apply the next recorded state (false when not playing back)
+	bool applyPlaybackStep();
 
 public:
 	void updateGodCamera();
+	// one simulation step
 	void updatePlayerCamera();
 	void updateAirplane();
 	void adjustAirplaneHeight(const float terrainHeight);
@@ -40,6 +75,7 @@ public:
 private:
 	
 	void setupViewports(const int w, const int h);
+	void updateProjections();
 
 public:
 	glm::mat4 playerViewMatrix() const;
@@ -48,6 +84,8 @@ public:
 	glm::vec3 playerCameraLookCenter() const;
 
 	glm::mat4 godViewMatrix() const;
+	glm::vec3 godViewOrig() const;
+	glm::vec3 godLookCenter() const;
 	glm::mat4 godProjectionMatrix() const;
 
 	glm::mat4 airplaneModelMatrix() const;
@@ -72,9 +110,13 @@ private:
 
 	glm::mat4 m_godProjMat;
 	glm::mat4 m_playerProjMat;
+	bool m_reversedZ = false;
 
+	// per second
 	float m_playerCameraHeightOffset = 0.0;
-	float m_playerCameraForwardSpeed = 0.5;
+	float m_playerCameraForwardSpeed = 24.0;
+	float m_playerCameraTurnSpeed = 0.6;
+	float m_playerCameraHeightSpeed = 6.0;
 
 	const float MIN_PLAYER_CAMERA_TERRAIN_OFFSET;
 	const float MIN_AIRPLANE_TERRAIN_OFFSET;
@@ -88,6 +130,25 @@ private:
 	bool m_SPressedFlag = false;
 	bool m_DPressedFlag = false;
 
+private:
+	// one simulation step of a recording (airplane: upper 3 rows of the model matrix)
+	struct RecordedState {
+		float time;
+		glm::vec3 playerViewOrg;
+		glm::vec3 playerLookCenter;
+		glm::vec3 godViewOrg;
+		glm::vec3 godLookCenter;
+		glm::vec3 airplaneAxis[4];
+	};
+
+	double m_simulationAccumulator = 0.0;
+	unsigned int m_simulationStep = 0;
+
+	bool m_recording = false;
+	bool m_playingBack = false;
+	unsigned int m_recordFirstStep = 0;
+	int m_playbackStep = 0;
+	std::vector<RecordedState> m_recordedStates;
 };
 
 
@@ -1,5 +1,9 @@
 #include "MyImGuiPanel.h"
 #include <imgui.h>
+#include <cfloat>
+#include <cstring>
+#include "GpuProfiler.h"
+#include "CpuProfiler.h"
 
 MyImGuiPanel::MyImGuiPanel()
 {
@@ -19,12 +23,186 @@ void MyImGuiPanel::update() {
 	const std::string FT_STR = "Frame: " + std::to_string(this->m_avgFrameTime);
 	ImGui::TextColored(ImVec4(0, 220, 0, 255), FT_STR.c_str());
 	ImGui::Separator();
+	// GL calls issued by the renderer during the previous frame
+	const GLFrameCounters& c = this->m_glCounters;
+	if (ImGui::BeginTable("glCounters", 2, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+		auto row = [](const char* name, const long long value) {
+			ImGui::TableNextRow();
+			ImGui::TableSetColumnIndex(0);
+			ImGui::TextUnformatted(name);
+			ImGui::TableSetColumnIndex(1);
+			ImGui::Text("%lld", value);
+		};
+		row("Draw calls", c.drawCalls);
+		row("Dispatches", c.dispatchCalls);
+		row("Program binds", c.programBinds);
+		row("VAO binds", c.vaoBinds);
+		row("Texture binds", c.textureBinds);
+		row("Buffer binds", c.bufferBinds);
+		row("FBO binds", c.framebufferBinds);
+		row("Skipped (redundant)", c.skippedBinds);
+		row("Uploads", c.uploads);
+		row("Upload bytes", c.uploadBytes);
+		ImGui::EndTable();
+	}
+	this->updateGpuTimings();
+	this->updateCullStats();
+	ImGui::Separator();
 	ImGui::Text("Depth Mip Level: %d", this->m_depthMipLevel);
 }
 
+void MyImGuiPanel::updateGpuTimings() {
+	GpuProfiler* profiler = GpuProfiler::Instance();
+	if (!ImGui::CollapsingHeader("GPU Timings")) {
+		return;
+	}
+	bool enabled = profiler->enabled();
+	if (ImGui::Checkbox("Enable GPU Timers", &enabled)) {
+		profiler->setEnabled(enabled);
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("Export CSV")) {
+		profiler->exportCSV("gpu_timings.csv");
+	}
+#if defined(CG_CPU_PROFILER)
+	// CPU zones + GPU scopes of the next 120 frames as Chrome trace JSON (also F9)
+	CpuProfiler* cpuProfiler = CpuProfiler::Instance();
+	if (cpuProfiler->capturing()) {
+		ImGui::Text("Capturing trace...");
+	} else {
+		if (ImGui::Button("Capture Trace (120 frames)")) {
+			cpuProfiler->requestCapture(120, "frame_trace.json");
+		}
+		if (!cpuProfiler->lastCapturePath().empty()) {
+			ImGui::SameLine();
+			ImGui::Text("saved %s", cpuProfiler->lastCapturePath().c_str());
+		}
+	}
+#endif
+
+	const GpuFrameResult* latest = profiler->latest();
+	if (latest == nullptr) {
+		ImGui::Text("No resolved frame yet");
+		return;
+	}
+	ImGui::Text("Frame %llu: %.3f ms (dropped %d)", latest->frameIndex, latest->totalMs, profiler->droppedFrames());
+
+	// per-pass table of the latest resolved frame; click a row to plot its history
+	if (this->m_gpuPlotScope >= (int)latest->scopes.size()) {
+		this->m_gpuPlotScope = -1;
+	}
+	if (ImGui::BeginTable("gpuTimings", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+		ImGui::TableSetupColumn("Pass");
+		ImGui::TableSetupColumn("ms");
+		ImGui::TableSetupColumn("avg ms");
+		ImGui::TableHeadersRow();
+		for (int i = 0; i < (int)latest->scopes.size(); ++i) {
+			const GpuScopeResult& r = latest->scopes[i];
+			ImGui::TableNextRow();
+			ImGui::TableSetColumnIndex(0);
+			ImGui::PushID(i);
+			ImGui::Indent(r.depth * 8.0f + 1.0f);
+			if (ImGui::Selectable(r.name, this->m_gpuPlotScope == i, ImGuiSelectableFlags_SpanAllColumns)) {
+				this->m_gpuPlotScope = (this->m_gpuPlotScope == i) ? -1 : i;
+			}
+			ImGui::Unindent(r.depth * 8.0f + 1.0f);
+			ImGui::PopID();
+			ImGui::TableSetColumnIndex(1);
+			ImGui::Text("%.3f", r.durationMs());
+			ImGui::TableSetColumnIndex(2);
+			ImGui::Text("%.3f", profiler->averageMs(r.name, r.depth));
+		}
+		ImGui::EndTable();
+	}
+
+	// history graph: frame total, or the selected pass
+	const std::vector<GpuFrameResult>& history = profiler->history();
+	std::vector<float> values;
+	values.reserve(history.size());
+	const GpuScopeResult* selected = (this->m_gpuPlotScope >= 0) ? &latest->scopes[this->m_gpuPlotScope] : nullptr;
+	for (const GpuFrameResult& frame : history) {
+		if (selected == nullptr) {
+			values.push_back((float)frame.totalMs);
+			continue;
+		}
+		float ms = 0.0f;
+		for (const GpuScopeResult& r : frame.scopes) {
+			if (r.depth == selected->depth && std::strcmp(r.name, selected->name) == 0) {
+				ms += (float)r.durationMs();
+			}
+		}
+		values.push_back(ms);
+	}
+	if (!values.empty()) {
+		ImGui::PlotLines("##gpuHistory", values.data(), (int)values.size(), 0,
+			(selected == nullptr) ? "frame total (ms)" : selected->name, 0.0f, FLT_MAX, ImVec2(0.0f, 60.0f));
+	}
+}
+
 void MyImGuiPanel::setAvgFPS(const double avgFPS) {
 	this->m_avgFPS = avgFPS;
 }
 void MyImGuiPanel::setAvgFrameTime(const double avgFrameTime) {
 	this->m_avgFrameTime = avgFrameTime;
 }
+
+void MyImGuiPanel::updateCullStats() {
+	if (this->m_cullStats == nullptr || !ImGui::CollapsingHeader("Culling Statistics")) {
+		return;
+	}
+	const CullStatsReadback& stats = *this->m_cullStats;
+	const CullStatsFrame* latest = stats.latest();
+	if (latest == nullptr) {
+		ImGui::Text("No culled frame read back yet");
+		return;
+	}
+	ImGui::Text("Frame %llu (dropped %d)", latest->frameIndex, stats.droppedFrames());
+
+	// rejections per batch of the latest frame read back; click a row to plot its history
+	if (this->m_cullPlotBatch >= stats.numBatch()) {
+		this->m_cullPlotBatch = -1;
+	}
+	if (ImGui::BeginTable("cullStats", 2 + CULL_REASON_COUNT, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+		ImGui::TableSetupColumn("Batch");
+		ImGui::TableSetupColumn("Instances");
+		for (int reason = 0; reason < CULL_REASON_COUNT; ++reason) {
+			ImGui::TableSetupColumn(cullReasonName(reason));
+		}
+		ImGui::TableHeadersRow();
+		for (int b = 0; b < stats.numBatch(); ++b) {
+			ImGui::TableNextRow();
+			ImGui::TableSetColumnIndex(0);
+			ImGui::PushID(b);
+			if (ImGui::Selectable(stats.batchName(b).c_str(), this->m_cullPlotBatch == b, ImGuiSelectableFlags_SpanAllColumns)) {
+				this->m_cullPlotBatch = (this->m_cullPlotBatch == b) ? -1 : b;
+			}
+			ImGui::PopID();
+			ImGui::TableSetColumnIndex(1);
+			ImGui::Text("%u", stats.numInstances(b));
+			for (int reason = 0; reason < CULL_REASON_COUNT; ++reason) {
+				ImGui::TableSetColumnIndex(2 + reason);
+				ImGui::Text("%u", latest->count(b, reason));
+			}
+		}
+		ImGui::EndTable();
+	}
+
+	// history graph of one reason: all batches, or the selected one
+	const char* reasonItems[CULL_REASON_COUNT];
+	for (int reason = 0; reason < CULL_REASON_COUNT; ++reason) { reasonItems[reason] = cullReasonName(reason); }
+	ImGui::Combo("Plot", &this->m_cullPlotReason, reasonItems, CULL_REASON_COUNT);
+	std::vector<float> values;
+	values.reserve(stats.history().size());
+	for (const CullStatsFrame& frame : stats.history()) {
+		unsigned int n = 0;
+		for (int b = 0; b < stats.numBatch(); ++b) {
+			if (this->m_cullPlotBatch < 0 || this->m_cullPlotBatch == b) {
+				n += frame.count(b, this->m_cullPlotReason);
+			}
+		}
+		values.push_back((float)n);
+	}
+	const std::string label = std::string(cullReasonName(this->m_cullPlotReason)) + " (" +
+		((this->m_cullPlotBatch < 0) ? std::string("all batches") : stats.batchName(this->m_cullPlotBatch)) + ")";
+	ImGui::PlotLines("##cullHistory", values.data(), (int)values.size(), 0, label.c_str(), 0.0f, FLT_MAX, ImVec2(0.0f, 60.0f));
+}
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <string>
+#include "GLStateCache.h"
+#include "CullStats.h"
 
 class MyImGuiPanel
 {
@@ -12,12 +14,23 @@ public:
 	void update();
 	void setAvgFPS(const double avgFPS);
 	void setAvgFrameTime(const double avgFrameTime);
+	void setGLCounters(const GLFrameCounters& counters) { m_glCounters = counters; }
+	void setCullStats(const CullStatsReadback* stats) { m_cullStats = stats; }
 	void setDepthMipLevel(const int level) { m_depthMipLevel = level; }
 	int depthMipLevel() const { return m_depthMipLevel; }
 
+private:
+	void updateGpuTimings();
+	void updateCullStats();
+
 private:
 	double m_avgFPS;
 	double m_avgFrameTime;
 	int m_depthMipLevel = 0;
+	int m_gpuPlotScope = -1; // index into the latest frame's scopes, -1 = frame total
+	GLFrameCounters m_glCounters;
+	const CullStatsReadback* m_cullStats = nullptr;
+	int m_cullPlotBatch = -1; // -1 = all batches
+	int m_cullPlotReason = CULL_VISIBLE;
 };
 
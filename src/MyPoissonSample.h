@@ -8,6 +8,7 @@ public:
 	MyPoissonSample(){}
 	virtual ~MyPoissonSample() {
 		delete[] this->m_positions;
+		delete[] this->m_radians;
 	}
 
 public:
@@ -21,6 +22,9 @@ public:
 		int numPoissonSample = -1;
 		std::ifstream ppInput(fileFullpath, std::ios::binary);
 		ppInput.read((char*)(&numPoissonSample), sizeof(int));
+		if (!ppInput.good() || numPoissonSample < 0) {
+			return nullptr;
+		}
 		float* poissonSamples = new float[numPoissonSample * 3];
 		ppInput.read((char*)(poissonSamples), sizeof(float) * 3 * numPoissonSample);
 		float* angles = new float[numPoissonSample * 3];
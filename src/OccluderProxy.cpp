@@ -0,0 +1,229 @@
+#include "OccluderProxy.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <glm/glm.hpp>
+
+namespace {
+
+// separating axis test of a triangle against the box center +- half (Akenine-Moller)
+bool triangleOverlapsBox(const glm::vec3& center, const glm::vec3& half, const glm::vec3 tri[3]) {
+	const glm::vec3 v[3] = { tri[0] - center, tri[1] - center, tri[2] - center };
+	for (int k = 0; k < 3; ++k) {
+		const float lo = std::min(v[0][k], std::min(v[1][k], v[2][k]));
+		const float hi = std::max(v[0][k], std::max(v[1][k], v[2][k]));
+		if (lo > half[k] || hi < -half[k]) return false;
+	}
+	const glm::vec3 e[3] = { v[1] - v[0], v[2] - v[1], v[0] - v[2] };
+	for (int i = 0; i < 3; ++i) {
+		for (int k = 0; k < 3; ++k) {
+			glm::vec3 axisK(0.0f);
+			axisK[k] = 1.0f;
+			const glm::vec3 axis = glm::cross(axisK, e[i]);
+			const float p0 = glm::dot(v[0], axis), p1 = glm::dot(v[1], axis), p2 = glm::dot(v[2], axis);
+			const float r = half.x * std::fabs(axis.x) + half.y * std::fabs(axis.y) + half.z * std::fabs(axis.z);
+			if (std::min(p0, std::min(p1, p2)) > r || std::max(p0, std::max(p1, p2)) < -r) return false;
+		}
+	}
+	const glm::vec3 n = glm::cross(e[0], e[1]);
+	const float r = half.x * std::fabs(n.x) + half.y * std::fabs(n.y) + half.z * std::fabs(n.z);
+	return std::fabs(glm::dot(n, v[0])) <= r;
+}
+
+// 2D point in triangle (either winding, edges included); on success the barycentric weights of b and c
+bool pointInTriangle2D(const glm::vec2& p, const glm::vec2& a, const glm::vec2& b, const glm::vec2& c, float& wb, float& wc) {
+	const float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+	if (std::fabs(area) < 1e-12f) return false;
+	wb = ((p.x - a.x) * (c.y - a.y) - (p.y - a.y) * (c.x - a.x)) / area;
+	wc = ((b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x)) / area;
+	return wb >= 0.0f && wc >= 0.0f && wb + wc <= 1.0f;
+}
+
+} // namespace
+
+void buildOccluderProxy(const float* positions, const int numVertex, const int strideFloats, const uint32_t* indices, const int numIndex,
+	const int resolution, const int maxTriangles, std::vector<float>& outVertices, std::vector<uint32_t>& outIndices) {
+	outVertices.clear();
+	outIndices.clear();
+	if (numVertex <= 0 || numIndex < 3 || resolution <= 0 || maxTriangles < 12) return;
+
+	glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+	for (int i = 0; i < numVertex; ++i) {
+		const glm::vec3 p(positions[(size_t)i * strideFloats], positions[(size_t)i * strideFloats + 1], positions[(size_t)i * strideFloats + 2]);
+		boundsMin = glm::min(boundsMin, p);
+		boundsMax = glm::max(boundsMax, p);
+	}
+	const glm::vec3 extent = boundsMax - boundsMin;
+	const float voxel = std::max(extent.x, std::max(extent.y, extent.z)) / (float)resolution;
+	if (!(voxel > 0.0f)) return;
+	int dim[3];
+	for (int k = 0; k < 3; ++k) {
+		dim[k] = std::max(1, (int)std::ceil(extent[k] / voxel));
+	}
+	const size_t numVoxel = (size_t)dim[0] * dim[1] * dim[2];
+	auto voxelIndex = [&dim](const int x, const int y, const int z) { return ((size_t)z * dim[1] + y) * dim[0] + x; };
+	auto voxelCenter = [&](const int x, const int y, const int z) { return boundsMin + voxel * glm::vec3(x + 0.5f, y + 0.5f, z + 0.5f); };
+	auto triangle = [&](const int t, glm::vec3 tri[3]) {
+		for (int j = 0; j < 3; ++j) {
+			const float* p = positions + (size_t)indices[t * 3 + j] * strideFloats;
+			tri[j] = glm::vec3(p[0], p[1], p[2]);
+		}
+	};
+	const int numTriangle = numIndex / 3;
+
+	// voxels touched by a triangle (slightly enlarged, so a surface on a voxel face counts)
+	std::vector<uint8_t> surface(numVoxel, 0);
+	const glm::vec3 half(voxel * 0.5f * 1.001f);
+	for (int t = 0; t < numTriangle; ++t) {
+		glm::vec3 tri[3];
+		triangle(t, tri);
+		const glm::vec3 lo = (glm::min(tri[0], glm::min(tri[1], tri[2])) - boundsMin) / voxel;
+		const glm::vec3 hi = (glm::max(tri[0], glm::max(tri[1], tri[2])) - boundsMin) / voxel;
+		int vMin[3], vMax[3];
+		for (int k = 0; k < 3; ++k) {
+			vMin[k] = std::max((int)std::floor(lo[k]) - 1, 0);
+			vMax[k] = std::min((int)std::floor(hi[k]) + 1, dim[k] - 1);
+		}
+		for (int z = vMin[2]; z <= vMax[2]; ++z) {
+			for (int y = vMin[1]; y <= vMax[1]; ++y) {
+				for (int x = vMin[0]; x <= vMax[0]; ++x) {
+					if (triangleOverlapsBox(voxelCenter(x, y, z), half, tri)) {
+						surface[voxelIndex(x, y, z)] = 1;
+					}
+				}
+			}
+		}
+	}
+
+	// nearest / farthest hit of the axis line through every row of voxel centers: a center has a hit
+	// in -axis when the nearest hit is below it, in +axis when the farthest is above it
+	const uint8_t HIT_MINUS[3] = { 1, 4, 16 }, HIT_PLUS[3] = { 2, 8, 32 };
+	std::vector<uint8_t> hits(numVoxel, 0);
+	for (int axis = 0; axis < 3; ++axis) {
+		const int u = (axis + 1) % 3, v = (axis + 2) % 3;
+		std::vector<float> hitMin((size_t)dim[u] * dim[v], FLT_MAX), hitMax((size_t)dim[u] * dim[v], -FLT_MAX);
+		for (int t = 0; t < numTriangle; ++t) {
+			glm::vec3 tri[3];
+			triangle(t, tri);
+			const glm::vec2 a(tri[0][u], tri[0][v]), b(tri[1][u], tri[1][v]), c(tri[2][u], tri[2][v]);
+			const int iu0 = std::max((int)std::ceil((std::min(a.x, std::min(b.x, c.x)) - boundsMin[u]) / voxel - 0.5f), 0);
+			const int iu1 = std::min((int)std::floor((std::max(a.x, std::max(b.x, c.x)) - boundsMin[u]) / voxel - 0.5f), dim[u] - 1);
+			const int iv0 = std::max((int)std::ceil((std::min(a.y, std::min(b.y, c.y)) - boundsMin[v]) / voxel - 0.5f), 0);
+			const int iv1 = std::min((int)std::floor((std::max(a.y, std::max(b.y, c.y)) - boundsMin[v]) / voxel - 0.5f), dim[v] - 1);
+			for (int iv = iv0; iv <= iv1; ++iv) {
+				for (int iu = iu0; iu <= iu1; ++iu) {
+					const glm::vec2 p(boundsMin[u] + (iu + 0.5f) * voxel, boundsMin[v] + (iv + 0.5f) * voxel);
+					float wb, wc;
+					if (!pointInTriangle2D(p, a, b, c, wb, wc)) continue;
+					const float hit = tri[0][axis] + wb * (tri[1][axis] - tri[0][axis]) + wc * (tri[2][axis] - tri[0][axis]);
+					const size_t line = (size_t)iv * dim[u] + iu;
+					hitMin[line] = std::min(hitMin[line], hit);
+					hitMax[line] = std::max(hitMax[line], hit);
+				}
+			}
+		}
+		for (int z = 0; z < dim[2]; ++z) {
+			for (int y = 0; y < dim[1]; ++y) {
+				for (int x = 0; x < dim[0]; ++x) {
+					const int p[3] = { x, y, z };
+					const size_t line = (size_t)p[v] * dim[u] + p[u];
+					const float center = boundsMin[axis] + (p[axis] + 0.5f) * voxel;
+					uint8_t& h = hits[voxelIndex(x, y, z)];
+					if (hitMin[line] < center) h |= HIT_MINUS[axis];
+					if (hitMax[line] > center) h |= HIT_PLUS[axis];
+				}
+			}
+		}
+	}
+	const uint8_t INSIDE = HIT_MINUS[0] | HIT_PLUS[0] | HIT_PLUS[1] | HIT_MINUS[2] | HIT_PLUS[2];
+	std::vector<uint8_t> inside(numVoxel, 0);
+	for (size_t i = 0; i < numVoxel; ++i) {
+		inside[i] = (!surface[i] && (hits[i] & INSIDE) == INSIDE) ? 1 : 0;
+	}
+
+	// distance to the nearest outside voxel (city block, two-pass chamfer): seeds the largest boxes first
+	std::vector<int> depth(numVoxel, 0);
+	for (int pass = 0; pass < 2; ++pass) {
+		const int step = (pass == 0) ? 1 : -1;
+		for (int z = (pass == 0) ? 0 : dim[2] - 1; z >= 0 && z < dim[2]; z += step) {
+			for (int y = (pass == 0) ? 0 : dim[1] - 1; y >= 0 && y < dim[1]; y += step) {
+				for (int x = (pass == 0) ? 0 : dim[0] - 1; x >= 0 && x < dim[0]; x += step) {
+					const size_t i = voxelIndex(x, y, z);
+					if (!inside[i]) continue;
+					const int px = x - step, py = y - step, pz = z - step;
+					const int dx = (px >= 0 && px < dim[0]) ? depth[voxelIndex(px, y, z)] : 0;
+					const int dy = (py >= 0 && py < dim[1]) ? depth[voxelIndex(x, py, z)] : 0;
+					const int dz = (pz >= 0 && pz < dim[2]) ? depth[voxelIndex(x, y, pz)] : 0;
+					const int d = 1 + std::min(dx, std::min(dy, dz));
+					depth[i] = (pass == 0) ? d : std::min(depth[i], d);
+				}
+			}
+		}
+	}
+
+	// boxes grow one layer per face in turn while the layer is inside; they may overlap earlier boxes,
+	// but each starts from a voxel no box covers yet
+	std::vector<uint8_t> covered(numVoxel, 0);
+	auto layerInside = [&](const int lo[3], const int hi[3]) {
+		for (int z = lo[2]; z <= hi[2]; ++z) {
+			for (int y = lo[1]; y <= hi[1]; ++y) {
+				for (int x = lo[0]; x <= hi[0]; ++x) {
+					if (!inside[voxelIndex(x, y, z)]) return false;
+				}
+			}
+		}
+		return true;
+	};
+	const int maxBoxes = maxTriangles / 12;
+	for (int box = 0; box < maxBoxes; ++box) {
+		size_t seed = numVoxel;
+		for (size_t i = 0; i < numVoxel; ++i) {
+			if (inside[i] && !covered[i] && (seed == numVoxel || depth[i] > depth[seed])) seed = i;
+		}
+		if (seed == numVoxel) break;
+		int lo[3] = { (int)(seed % dim[0]), (int)(seed / dim[0] % dim[1]), (int)(seed / ((size_t)dim[0] * dim[1])) };
+		int hi[3] = { lo[0], lo[1], lo[2] };
+		for (bool grown = true; grown;) {
+			grown = false;
+			for (int face = 0; face < 6; ++face) {
+				const int k = face / 2;
+				const bool up = (face & 1) != 0;
+				const int next = up ? hi[k] + 1 : lo[k] - 1;
+				if (next < 0 || next >= dim[k]) continue;
+				int layerLo[3] = { lo[0], lo[1], lo[2] }, layerHi[3] = { hi[0], hi[1], hi[2] };
+				layerLo[k] = layerHi[k] = next;
+				if (layerInside(layerLo, layerHi)) {
+					(up ? hi[k] : lo[k]) = next;
+					grown = true;
+				}
+			}
+		}
+		for (int z = lo[2]; z <= hi[2]; ++z) {
+			for (int y = lo[1]; y <= hi[1]; ++y) {
+				for (int x = lo[0]; x <= hi[0]; ++x) {
+					covered[voxelIndex(x, y, z)] = 1;
+				}
+			}
+		}
+
+		// corner c: bit 0 x, bit 1 y, bit 2 z at the box max
+		const glm::vec3 p0 = boundsMin + voxel * glm::vec3(lo[0], lo[1], lo[2]);
+		const glm::vec3 p1 = boundsMin + voxel * glm::vec3(hi[0] + 1, hi[1] + 1, hi[2] + 1);
+		const uint32_t base = (uint32_t)(outVertices.size() / 3);
+		for (int c = 0; c < 8; ++c) {
+			outVertices.push_back((c & 1) ? p1.x : p0.x);
+			outVertices.push_back((c & 2) ? p1.y : p0.y);
+			outVertices.push_back((c & 4) ? p1.z : p0.z);
+		}
+		// -x, +x, -y, +y, -z, +z; counter-clockwise seen from outside
+		const uint32_t FACES[6][4] = {
+			{ 0, 4, 6, 2 }, { 1, 3, 7, 5 },
+			{ 0, 1, 5, 4 }, { 2, 6, 7, 3 },
+			{ 0, 2, 3, 1 }, { 4, 5, 7, 6 }
+		};
+		for (const uint32_t* q : FACES) {
+			const uint32_t quad[6] = { base + q[0], base + q[1], base + q[2], base + q[0], base + q[2], base + q[3] };
+			outIndices.insert(outIndices.end(), quad, quad + 6);
+		}
+	}
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Conservative inner occluder of a triangle mesh: boxes that lie inside it, so whatever a proxy hides
+// the mesh hides too. The mesh is voxelized; a voxel is inside when it touches no triangle and the
+// axis rays from its center hit the mesh in +x, -x, +z, -z and +y (not -y: buildings have no floor,
+// the ground closes them). Boxes are grown from the deepest free inside voxel until the triangle
+// budget (12 per box) is used up.
+//
+// positions: xyz of numVertex vertices, strideFloats apart; indices: triangles.
+// resolution: voxels along the longest axis of the mesh bounds.
+// The proxy triangles are counter-clockwise seen from outside. Meshes without any inside voxel
+// (open or thin) give no proxy.
+void buildOccluderProxy(const float* positions, const int numVertex, const int strideFloats, const uint32_t* indices, const int numIndex,
+	const int resolution, const int maxTriangles, std::vector<float>& outVertices, std::vector<uint32_t>& outIndices);
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <vector>
+#include <glm/vec2.hpp>
+#include <glm/geometric.hpp>
+#include <glm/gtc/constants.hpp>
+
+// Poisson-disk points (no two closer than radius) over [minXZ, maxXZ) with Bridson's algorithm.
+// Background grid of radius/sqrt(2) cells, at most one point per cell.
+//
+// sampleTiled(): the domain is split into square tiles of TILE_CELLS cells, run in 4 phases by
+// tile parity. Tiles of one phase are a full tile apart (> radius), so they are filled in parallel
+// without locks: a tile only writes its own cells and only reads finished neighbours. Every tile
+// has its own random stream, so the result does not depend on the number of threads.
+class PoissonDiskSampler
+{
+public:
+	static constexpr int TILE_CELLS = 32;
+
+	PoissonDiskSampler(const float radius, const glm::vec2& minXZ, const glm::vec2& maxXZ, const unsigned int seed, const int maxAttempt = 30) :
+		m_radius(radius), m_minXZ(minXZ), m_maxXZ(maxXZ), m_seed(seed), m_maxAttempt(maxAttempt)
+	{
+		this->m_cellSize = radius / std::sqrt(2.0f);
+		this->m_gridW = std::max(1, (int)std::ceil((maxXZ.x - minXZ.x) / this->m_cellSize));
+		this->m_gridH = std::max(1, (int)std::ceil((maxXZ.y - minXZ.y) / this->m_cellSize));
+	}
+
+	int gridWidth() const { return m_gridW; }
+	int gridHeight() const { return m_gridH; }
+
+	// classic single-threaded Bridson over the whole domain
+	std::vector<glm::vec2> sampleSerial() {
+		this->resetGrid();
+		std::mt19937 rng(this->m_seed);
+		this->fillRegion(this->m_minXZ, this->m_maxXZ, rng);
+		return this->collect();
+	}
+
+	// numThread <= 0: hardware concurrency
+	std::vector<glm::vec2> sampleTiled(int numThread) {
+		this->resetGrid();
+		if (numThread <= 0) {
+			numThread = std::max(1, (int)std::thread::hardware_concurrency());
+		}
+		const int tilesX = (this->m_gridW + TILE_CELLS - 1) / TILE_CELLS;
+		const int tilesZ = (this->m_gridH + TILE_CELLS - 1) / TILE_CELLS;
+		const float tileSize = this->m_cellSize * (float)TILE_CELLS;
+
+		for (int phase = 0; phase < 4; ++phase) {
+			std::vector<int> tiles;
+			for (int tz = (phase >> 1); tz < tilesZ; tz += 2) {
+				for (int tx = (phase & 1); tx < tilesX; tx += 2) {
+					tiles.push_back(tz * tilesX + tx);
+				}
+			}
+
+			std::atomic<int> next(0);
+			auto worker = [&]() {
+				for (int t = next++; t < (int)tiles.size(); t = next++) {
+					const int tile = tiles[t];
+					const glm::vec2 lo = this->m_minXZ + tileSize * glm::vec2((float)(tile % tilesX), (float)(tile / tilesX));
+					const glm::vec2 hi = glm::min(lo + glm::vec2(tileSize), this->m_maxXZ);
+					std::seed_seq tileSeed{ this->m_seed, (unsigned int)tile };
+					std::mt19937 rng(tileSeed);
+					this->fillRegion(lo, hi, rng);
+				}
+			};
+			const int numWorker = std::min(numThread, (int)tiles.size());
+			std::vector<std::thread> threads;
+			for (int i = 1; i < numWorker; ++i) {
+				threads.emplace_back(worker);
+			}
+			worker();
+			for (std::thread& thread : threads) {
+				thread.join();
+			}
+		}
+		return this->collect();
+	}
+
+private:
+	void resetGrid() {
+		this->m_cells.assign((size_t)this->m_gridW * this->m_gridH, glm::vec2(FLT_MAX));
+	}
+
+	size_t cellIndex(const glm::vec2& p) const {
+		const int cx = std::min(this->m_gridW - 1, (int)((p.x - this->m_minXZ.x) / this->m_cellSize));
+		const int cz = std::min(this->m_gridH - 1, (int)((p.y - this->m_minXZ.y) / this->m_cellSize));
+		return (size_t)cz * this->m_gridW + cx;
+	}
+
+	bool fits(const glm::vec2& p) const {
+		const int cx = std::min(this->m_gridW - 1, (int)((p.x - this->m_minXZ.x) / this->m_cellSize));
+		const int cz = std::min(this->m_gridH - 1, (int)((p.y - this->m_minXZ.y) / this->m_cellSize));
+		const float r2 = this->m_radius * this->m_radius;
+		// a point within radius is at most 2 cells away
+		for (int z = std::max(0, cz - 2); z <= std::min(this->m_gridH - 1, cz + 2); ++z) {
+			for (int x = std::max(0, cx - 2); x <= std::min(this->m_gridW - 1, cx + 2); ++x) {
+				const glm::vec2& q = this->m_cells[(size_t)z * this->m_gridW + x];
+				if (q.x != FLT_MAX) {
+					const glm::vec2 d = q - p;
+					if (glm::dot(d, d) < r2) { return false; }
+				}
+			}
+		}
+		return true;
+	}
+
+	// Bridson inside [lo, hi): grow from a random dart until the active list is empty, then throw
+	// new darts until maxAttempt of them in a row fail (fills regions the growth couldn't reach)
+	void fillRegion(const glm::vec2& lo, const glm::vec2& hi, std::mt19937& rng) {
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		auto inside = [&](const glm::vec2& p) {
+			return p.x >= lo.x && p.y >= lo.y && p.x < hi.x && p.y < hi.y;
+		};
+		std::vector<glm::vec2> active;
+		auto tryInsert = [&](const glm::vec2& p) {
+			if (!inside(p) || !this->fits(p)) { return false; }
+			this->m_cells[this->cellIndex(p)] = p;
+			active.push_back(p);
+			return true;
+		};
+
+		int failedDarts = 0;
+		while (failedDarts < this->m_maxAttempt) {
+			if (!tryInsert(lo + (hi - lo) * glm::vec2(unit(rng), unit(rng)))) {
+				failedDarts++;
+				continue;
+			}
+			failedDarts = 0;
+
+			while (!active.empty()) {
+				const size_t i = std::min(active.size() - 1, (size_t)(unit(rng) * (float)active.size()));
+				const glm::vec2 center = active[i];
+				bool placed = false;
+				for (int k = 0; k < this->m_maxAttempt && !placed; ++k) {
+					// uniform in area over the annulus [r, 2r)
+					const float dist = this->m_radius * std::sqrt(1.0f + 3.0f * unit(rng));
+					const float angle = glm::two_pi<float>() * unit(rng);
+					placed = tryInsert(center + dist * glm::vec2(std::cos(angle), std::sin(angle)));
+				}
+				if (!placed) {
+					active[i] = active.back();
+					active.pop_back();
+				}
+			}
+		}
+	}
+
+	// row-major cell order: nearby points end up close together in the output
+	std::vector<glm::vec2> collect() const {
+		std::vector<glm::vec2> points;
+		for (const glm::vec2& p : this->m_cells) {
+			if (p.x != FLT_MAX) { points.push_back(p); }
+		}
+		return points;
+	}
+
+	float m_radius;
+	float m_cellSize;
+	glm::vec2 m_minXZ;
+	glm::vec2 m_maxXZ;
+	unsigned int m_seed;
+	int m_maxAttempt;
+	int m_gridW = 1;
+	int m_gridH = 1;
+	std::vector<glm::vec2> m_cells;
+};
@@ -0,0 +1,237 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/common.hpp>
+#include "MyPoissonSample.h"
+
+// Instances of a PVS batch are grouped into clusters: square world cells of clusterSize, one cluster
+// per non-empty cell, ordered by (z, x). sortSamplesByCluster() reorders the samples so that every
+// cluster is a contiguous range [first, first + count) of the batch's instances.
+struct InstanceCluster {
+	glm::ivec2 cell = glm::ivec2(0);
+	int first = 0;
+	int count = 0;
+};
+
+inline glm::ivec2 clusterCellOf(const float x, const float z, const float clusterSize) {
+	return glm::ivec2((int)std::floor(x / clusterSize), (int)std::floor(z / clusterSize));
+}
+
+// stable counting sort of the samples by cluster cell
+inline void sortSamplesByCluster(MyPoissonSample& sample, const float clusterSize, std::vector<InstanceCluster>& clusters) {
+	clusters.clear();
+	const int n = sample.m_numSample;
+	if (n <= 0) return;
+	glm::ivec2 cellMin(INT32_MAX), cellMax(INT32_MIN);
+	std::vector<glm::ivec2> cells((size_t)n);
+	for (int i = 0; i < n; ++i) {
+		cells[i] = clusterCellOf(sample.m_positions[i * 3 + 0], sample.m_positions[i * 3 + 2], clusterSize);
+		cellMin = glm::min(cellMin, cells[i]);
+		cellMax = glm::max(cellMax, cells[i]);
+	}
+	const int spanX = cellMax.x - cellMin.x + 1;
+	const size_t numKey = (size_t)spanX * (cellMax.y - cellMin.y + 1);
+	std::vector<int> offsets(numKey + 1, 0);
+	auto keyOf = [&](const glm::ivec2& c) { return (size_t)(c.y - cellMin.y) * spanX + (c.x - cellMin.x); };
+	for (int i = 0; i < n; ++i) offsets[keyOf(cells[i]) + 1]++;
+	for (size_t k = 0; k < numKey; ++k) {
+		if (offsets[k + 1] > 0) {
+			InstanceCluster cluster;
+			cluster.cell = cellMin + glm::ivec2((int)(k % spanX), (int)(k / spanX));
+			cluster.first = offsets[k];
+			cluster.count = offsets[k + 1];
+			clusters.push_back(cluster);
+		}
+		offsets[k + 1] += offsets[k];
+	}
+	float* positions = new float[(size_t)n * 3];
+	float* radians = new float[(size_t)n * 3];
+	for (int i = 0; i < n; ++i) {
+		const int dst = offsets[keyOf(cells[i])]++;
+		std::copy(sample.m_positions + (size_t)i * 3, sample.m_positions + (size_t)i * 3 + 3, positions + (size_t)dst * 3);
+		std::copy(sample.m_radians + (size_t)i * 3, sample.m_radians + (size_t)i * 3 + 3, radians + (size_t)dst * 3);
+	}
+	delete[] sample.m_positions;
+	delete[] sample.m_radians;
+	sample.m_positions = positions;
+	sample.m_radians = radians;
+}
+
+// Potentially visible set baked by CG2025_pvsbake (tools/pvs_baker.cpp): the walkable area is divided
+// into square view cells, and every view cell has a bitset over the clusters of all PVS batches
+// (batch after batch, clusters in sortSamplesByCluster order) that are potentially visible from an
+// eye anywhere in it, between eyeOffset and eyeOffset + eyeRange above the ground, up to maxDistance.
+//
+// Bitsets are stored run-length encoded: alternating run lengths of 0 and 1 bits (starting with 0s)
+// as LEB128 varints. Nearby clusters are neighbours in the order, so visible clusters come in runs.
+//
+// File (.pvs, binary): "PVS1", then the fields below in order; strings as int length + chars, vectors
+// as int size + elements; per view cell its maxEyeHeight and its encoded bitset.
+struct PotentiallyVisibleSet {
+	struct Batch {
+		std::string name;
+		int numInstances = 0;
+		std::vector<glm::ivec2> clusterCells;
+		int firstCluster = 0; // index of its first cluster bit
+	};
+
+	float clusterSize = 32.0f;
+	float viewCellSize = 32.0f;
+	float maxDistance = 600.0f;
+	float eyeOffset = 5.0f;
+	float eyeRange = 10.0f;
+	glm::vec2 origin = glm::vec2(0.0f); // world xz of view cell (0, 0)'s corner
+	int cellsX = 0;
+	int cellsZ = 0;
+	std::vector<Batch> batches;
+	int numCluster = 0;
+	// per view cell: highest eye the bitset was baked for, and the encoded bitset
+	std::vector<float> maxEyeHeight;
+	std::vector<std::vector<uint8_t>> cellBits;
+
+	const Batch* batch(const std::string& name) const {
+		for (const Batch& b : this->batches) {
+			if (b.name == name) return &b;
+		}
+		return nullptr;
+	}
+
+	// view cell of an eye, -1 outside the grid or above the baked eye heights
+	int cellIndex(const glm::vec3& eye) const {
+		const int cx = (int)std::floor((eye.x - this->origin.x) / this->viewCellSize);
+		const int cz = (int)std::floor((eye.z - this->origin.y) / this->viewCellSize);
+		if (cx < 0 || cz < 0 || cx >= this->cellsX || cz >= this->cellsZ) return -1;
+		const int cell = cz * this->cellsX + cx;
+		return (eye.y <= this->maxEyeHeight[cell]) ? cell : -1;
+	}
+
+	static void encodeBits(const std::vector<uint8_t>& bits, std::vector<uint8_t>& out) {
+		out.clear();
+		auto writeVarint = [&out](uint32_t v) {
+			while (v >= 0x80u) { out.push_back((uint8_t)(v | 0x80u)); v >>= 7; }
+			out.push_back((uint8_t)v);
+		};
+		uint8_t value = 0;
+		uint32_t run = 0;
+		for (const uint8_t bit : bits) {
+			if ((bit != 0) != (value != 0)) {
+				writeVarint(run);
+				value ^= 1;
+				run = 0;
+			}
+			run++;
+		}
+		writeVarint(run);
+	}
+
+	// false on a malformed stream or a length other than numBit
+	static bool decodeBits(const std::vector<uint8_t>& encoded, const int numBit, std::vector<uint8_t>& bits) {
+		bits.assign((size_t)numBit, 0);
+		size_t pos = 0, bit = 0;
+		uint8_t value = 0;
+		while (pos < encoded.size()) {
+			uint32_t run = 0;
+			for (int shift = 0; ; shift += 7) {
+				if (pos >= encoded.size() || shift > 28) return false;
+				const uint8_t byte = encoded[pos++];
+				run |= (uint32_t)(byte & 0x7Fu) << shift;
+				if ((byte & 0x80u) == 0) break;
+			}
+			if (bit + run > (size_t)numBit) return false;
+			if (value) std::fill(bits.begin() + bit, bits.begin() + bit + run, (uint8_t)1);
+			bit += run;
+			value ^= 1;
+		}
+		return bit == (size_t)numBit;
+	}
+
+	bool writeFile(const std::string& fileFullpath) const {
+		std::ofstream output(fileFullpath, std::ios::binary);
+		if (!output.is_open()) return false;
+		auto writeInt = [&output](const int v) { output.write((const char*)&v, sizeof(int)); };
+		auto writeFloat = [&output](const float v) { output.write((const char*)&v, sizeof(float)); };
+		output.write("PVS1", 4);
+		writeFloat(this->clusterSize);
+		writeFloat(this->viewCellSize);
+		writeFloat(this->maxDistance);
+		writeFloat(this->eyeOffset);
+		writeFloat(this->eyeRange);
+		writeFloat(this->origin.x);
+		writeFloat(this->origin.y);
+		writeInt(this->cellsX);
+		writeInt(this->cellsZ);
+		writeInt((int)this->batches.size());
+		for (const Batch& b : this->batches) {
+			writeInt((int)b.name.size());
+			output.write(b.name.data(), (std::streamsize)b.name.size());
+			writeInt(b.numInstances);
+			writeInt((int)b.clusterCells.size());
+			output.write((const char*)b.clusterCells.data(), (std::streamsize)(b.clusterCells.size() * sizeof(glm::ivec2)));
+		}
+		for (size_t c = 0; c < this->cellBits.size(); ++c) {
+			writeFloat(this->maxEyeHeight[c]);
+			writeInt((int)this->cellBits[c].size());
+			output.write((const char*)this->cellBits[c].data(), (std::streamsize)this->cellBits[c].size());
+		}
+		return output.good();
+	}
+
+	static bool fromFile(const std::string& fileFullpath, PotentiallyVisibleSet& pvs, std::string& error) {
+		std::ifstream input(fileFullpath, std::ios::binary);
+		if (!input.is_open()) {
+			error = "cannot open PVS: " + fileFullpath;
+			return false;
+		}
+		pvs = PotentiallyVisibleSet();
+		auto readInt = [&input](int& v) { return static_cast<bool>(input.read((char*)&v, sizeof(int))); };
+		auto readFloat = [&input](float& v) { return static_cast<bool>(input.read((char*)&v, sizeof(float))); };
+		char magic[4] = {};
+		input.read(magic, 4);
+		int numBatch = 0;
+		bool ok = input.good() && std::string(magic, 4) == "PVS1"
+			&& readFloat(pvs.clusterSize) && readFloat(pvs.viewCellSize) && readFloat(pvs.maxDistance)
+			&& readFloat(pvs.eyeOffset) && readFloat(pvs.eyeRange) && readFloat(pvs.origin.x) && readFloat(pvs.origin.y)
+			&& readInt(pvs.cellsX) && readInt(pvs.cellsZ) && readInt(numBatch)
+			&& pvs.cellsX > 0 && pvs.cellsZ > 0 && numBatch >= 0 && pvs.clusterSize > 0.0f && pvs.viewCellSize > 0.0f;
+		for (int i = 0; ok && i < numBatch; ++i) {
+			Batch b;
+			int nameLength = 0, numCluster = 0;
+			ok = readInt(nameLength) && nameLength >= 0 && nameLength < 4096;
+			if (ok) {
+				b.name.resize((size_t)nameLength);
+				ok = static_cast<bool>(input.read(&b.name[0], nameLength));
+			}
+			ok = ok && readInt(b.numInstances) && readInt(numCluster) && numCluster >= 0;
+			if (ok) {
+				b.clusterCells.resize((size_t)numCluster);
+				ok = static_cast<bool>(input.read((char*)b.clusterCells.data(), (std::streamsize)(numCluster * sizeof(glm::ivec2))));
+				b.firstCluster = pvs.numCluster;
+				pvs.numCluster += numCluster;
+				pvs.batches.push_back(b);
+			}
+		}
+		const size_t numCell = (size_t)pvs.cellsX * pvs.cellsZ;
+		pvs.maxEyeHeight.resize(numCell);
+		pvs.cellBits.resize(numCell);
+		for (size_t c = 0; ok && c < numCell; ++c) {
+			int numByte = 0;
+			ok = readFloat(pvs.maxEyeHeight[c]) && readInt(numByte) && numByte >= 0;
+			if (ok) {
+				pvs.cellBits[c].resize((size_t)numByte);
+				ok = static_cast<bool>(input.read((char*)pvs.cellBits[c].data(), numByte));
+			}
+		}
+		if (!ok) {
+			error = "invalid PVS file: " + fileFullpath;
+			return false;
+		}
+		return true;
+	}
+};
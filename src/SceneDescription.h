@@ -0,0 +1,185 @@
+#pragma once
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <glm/vec3.hpp>
+
+// one instanced model drawn by SceneRenderer (mesh + texture + .ppd2 placements)
+struct InstanceBatchDesc {
+	std::string name;
+	std::string objPath;
+	std::string texPath;
+	std::string samplePath;
+	glm::vec3 sphereCenterOS = glm::vec3(0.0f);
+	float sphereRadiusOS = 1.0f;
+	glm::vec3 ambient = glm::vec3(1.0f);
+	glm::vec3 specular = glm::vec3(0.0f);
+	float shininess = 1.0f;
+	bool useOcclusion = true; // foliage only
+	bool isOccluder = false;  // rendered before HZB build
+	int occluderTriangles = 96; // triangle budget of the occluder proxy (OccluderProxy.h); 0: the full mesh
+	bool castShadow = false;    // drawn into the shadow cascades (meshes and impostors)
+	float impostorDistance = 0.0f; // visible instances farther than this are drawn as impostors; 0: never
+	std::string impostorPath;      // baked atlas (CG2025_impostorbake); empty: baked at load
+	int clusterTriangles = 0; // occluder batches: triangles per cluster (MeshClusters.h) culled per instance; 0: drawn whole
+};
+
+// Terrain files and instance batches of a scene. Text format (.scene, see SceneGenerator.h):
+//   terrain <mytd> <chunkdata> <chunkSize>
+//   batch <name> <obj> <texture|-> <ppd2> <sphere center xyz> <sphere radius> <useOcclusion 0|1> <isOccluder 0|1> [occluder triangles] [castShadow 0|1]
+//   pvs <pvs>   (optional, baked by CG2025_pvsbake)
+//   impostor <batch name> <distance> [atlas]   (optional, after the batch; atlas baked by CG2025_impostorbake)
+//   clusters <batch name> <triangles per cluster>   (optional, after an occluder batch)
+// Lines starting with '#' are comments; paths are relative to the working directory.
+struct SceneDescription {
+	std::string elevationPath = "assets/outdoor/elevationMap_2.mytd";
+	std::string chunkDataPath = "assets/outdoor/terrain.chunkdata";
+	float chunkSize = 512.0f;
+	std::vector<InstanceBatchDesc> batches;
+	std::string pvsPath; // empty: no potentially visible set
+
+	// the hand-authored outdoor scene
+	static SceneDescription defaultScene() {
+		SceneDescription scene;
+		auto add = [&scene](const char* name, const char* objPath, const char* texPath, const char* samplePath, const glm::vec3& sphereCenterOS, const float sphereRadiusOS, const bool useOcclusion, const bool isOccluder, const bool castShadow) {
+			InstanceBatchDesc desc;
+			desc.name = name;
+			desc.objPath = objPath;
+			desc.texPath = texPath;
+			desc.samplePath = samplePath;
+			desc.sphereCenterOS = sphereCenterOS;
+			desc.sphereRadiusOS = sphereRadiusOS;
+			desc.useOcclusion = useOcclusion;
+			desc.isOccluder = isOccluder;
+			desc.castShadow = castShadow;
+			scene.batches.push_back(desc);
+		};
+		add("grassB", "assets/outdoor/grassB.obj", "assets/outdoor/grassB_albedo.png",
+			"assets/outdoor/poissonPoints_621043_after.ppd2", glm::vec3(0.0f, 0.66f, 0.0f), 1.4f, true, false, false);
+		add("bush01", "assets/outdoor/bush01_lod2.obj", "assets/outdoor/bush01.png",
+			"assets/outdoor/poissonPoints_1010.ppd2", glm::vec3(0.0f, 2.55f, 0.0f), 3.4f, true, false, true);
+		add("bush05", "assets/outdoor/bush05_lod2.obj", "assets/outdoor/bush05.png",
+			"assets/outdoor/poissonPoints_2797.ppd2", glm::vec3(0.0f, 1.76f, 0.0f), 2.6f, true, false, true);
+		add("buildingV2", "assets/outdoor/Medieval_Building_LowPoly/medieval_building_lowpoly_2.obj",
+			"assets/outdoor/Medieval_Building_LowPoly/Medieval_Building_LowPoly_V2_Albedo_small.png",
+			"assets/outdoor/cityLots_sub_0.ppd2", glm::vec3(0.0f, 4.57f, 0.0f), 8.5f, false, true, true);
+		add("buildingV1", "assets/outdoor/Medieval_Building_LowPoly/medieval_building_lowpoly_1.obj",
+			"assets/outdoor/Medieval_Building_LowPoly/Medieval_Building_LowPoly_V1_Albedo_small.png",
+			"assets/outdoor/cityLots_sub_1.ppd2", glm::vec3(0.0f, 4.57f, 0.0f), 10.2f, false, true, true);
+		// distant bushes and buildings: two triangles per instance
+		for (InstanceBatchDesc& desc : scene.batches) {
+			if (desc.name != "grassB") desc.impostorDistance = 150.0f;
+			// buildings: only the clusters facing the camera
+			if (desc.isOccluder) desc.clusterTriangles = 128;
+		}
+		return scene;
+	}
+
+	// batch of the default scene with this name (model/texture/bounds presets for generated scenes)
+	static const InstanceBatchDesc* preset(const std::string& name) {
+		static const SceneDescription scene = defaultScene();
+		for (const InstanceBatchDesc& desc : scene.batches) {
+			if (desc.name == name) { return &desc; }
+		}
+		return nullptr;
+	}
+
+	static bool fromFile(const std::string& fileFullpath, SceneDescription& scene, std::string& error) {
+		std::ifstream input(fileFullpath);
+		if (!input.is_open()) {
+			error = "cannot open scene: " + fileFullpath;
+			return false;
+		}
+
+		scene = SceneDescription();
+		std::string line;
+		int lineNumber = 0;
+		while (std::getline(input, line)) {
+			lineNumber++;
+			std::istringstream ss(line);
+			std::string type;
+			if (!(ss >> type) || type[0] == '#') { continue; }
+
+			bool ok = false;
+			if (type == "terrain") {
+				ok = static_cast<bool>(ss >> scene.elevationPath >> scene.chunkDataPath >> scene.chunkSize) && scene.chunkSize > 0.0f;
+			}
+			else if (type == "batch") {
+				InstanceBatchDesc desc;
+				int useOcclusion = 0, isOccluder = 0;
+				ok = static_cast<bool>(ss >> desc.name >> desc.objPath >> desc.texPath >> desc.samplePath
+					>> desc.sphereCenterOS.x >> desc.sphereCenterOS.y >> desc.sphereCenterOS.z >> desc.sphereRadiusOS
+					>> useOcclusion >> isOccluder);
+				if (desc.texPath == "-") { desc.texPath.clear(); }
+				desc.useOcclusion = (useOcclusion != 0);
+				desc.isOccluder = (isOccluder != 0);
+				int occluderTriangles = 0, castShadow = 0;
+				if (ok && (ss >> occluderTriangles)) { desc.occluderTriangles = std::max(occluderTriangles, 0); }
+				if (ok && (ss >> castShadow)) { desc.castShadow = (castShadow != 0); }
+				if (ok) { scene.batches.push_back(desc); }
+			}
+			else if (type == "pvs") {
+				ok = static_cast<bool>(ss >> scene.pvsPath);
+			}
+			else if (type == "impostor") {
+				std::string name;
+				float distance = 0.0f;
+				ok = static_cast<bool>(ss >> name >> distance) && distance >= 0.0f;
+				InstanceBatchDesc* desc = nullptr;
+				for (InstanceBatchDesc& other : scene.batches) {
+					if (other.name == name) { desc = &other; }
+				}
+				ok = ok && desc != nullptr;
+				if (ok) {
+					desc->impostorDistance = distance;
+					ss >> desc->impostorPath;
+				}
+			}
+			else if (type == "clusters") {
+				std::string name;
+				int triangles = 0;
+				ok = static_cast<bool>(ss >> name >> triangles) && triangles >= 0;
+				InstanceBatchDesc* desc = nullptr;
+				for (InstanceBatchDesc& other : scene.batches) {
+					if (other.name == name) { desc = &other; }
+				}
+				ok = ok && desc != nullptr && desc->isOccluder;
+				if (ok) {
+					desc->clusterTriangles = triangles;
+				}
+			}
+
+			if (!ok) {
+				error = fileFullpath + ":" + std::to_string(lineNumber) + ": invalid line: " + line;
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool writeFile(const std::string& fileFullpath) const {
+		std::ofstream output(fileFullpath);
+		if (!output.is_open()) { return false; }
+		output << "terrain " << this->elevationPath << " " << this->chunkDataPath << " " << this->chunkSize << "\n";
+		for (const InstanceBatchDesc& desc : this->batches) {
+			output << "batch " << desc.name << " " << desc.objPath << " " << (desc.texPath.empty() ? "-" : desc.texPath) << " " << desc.samplePath << " "
+				<< desc.sphereCenterOS.x << " " << desc.sphereCenterOS.y << " " << desc.sphereCenterOS.z << " " << desc.sphereRadiusOS << " "
+				<< (desc.useOcclusion ? 1 : 0) << " " << (desc.isOccluder ? 1 : 0) << " " << desc.occluderTriangles << " " << (desc.castShadow ? 1 : 0) << "\n";
+		}
+		if (!this->pvsPath.empty()) {
+			output << "pvs " << this->pvsPath << "\n";
+		}
+		for (const InstanceBatchDesc& desc : this->batches) {
+			if (desc.impostorDistance > 0.0f) {
+				output << "impostor " << desc.name << " " << desc.impostorDistance << (desc.impostorPath.empty() ? "" : " " + desc.impostorPath) << "\n";
+			}
+			if (desc.clusterTriangles > 0) {
+				output << "clusters " << desc.name << " " << desc.clusterTriangles << "\n";
+			}
+		}
+		return true;
+	}
+};
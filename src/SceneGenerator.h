@@ -0,0 +1,400 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <glm/geometric.hpp>
+#include <glm/gtc/constants.hpp>
+#include "SceneDescription.h"
+#include "terrain/MyTerrainData.h"
+
+// Synthetic stress scenes for scaling tests: a tileable terrain (.mytd + .chunkdata), one .ppd2
+// per batch and a .scene file that SceneRenderer / MyTerrain load (--scene, CG2025_scenegen).
+// No GL: used by the CG2025_scenegen tool and by the --generate-scene startup option.
+
+enum class SampleDistribution { UNIFORM, CLUSTERED, CITY_GRID };
+
+struct GeneratedBatchDesc {
+	std::string preset; // batch name in SceneDescription::defaultScene() (mesh, texture, bounds)
+	int count = 0;
+	SampleDistribution distribution = SampleDistribution::UNIFORM;
+};
+
+struct SceneGeneratorOptions {
+	std::string outputDir = "assets/generated";
+	int terrainMapSize = 1024;   // elevation/normal/albedo map resolution
+	float chunkSize = 512.0f;    // the terrain tile covers [-chunkSize, chunkSize] on x and z
+	int chunkResolution = 256;   // quads per chunk edge
+	float terrainHeight = 60.0f;
+	unsigned int seed = 1;
+	int numCluster = 64;
+	float clusterRadius = 24.0f; // gaussian sigma around each cluster center
+	float lotSpacing = 24.0f;    // city grid: lot pitch, 4x4 lots per block
+	float streetWidth = 12.0f;
+	std::vector<GeneratedBatchDesc> batches;
+};
+
+// samples are generated and written in blocks so tens of millions of instances fit in memory
+const int SCENE_GENERATOR_BLOCK = 1 << 20;
+
+inline bool parseSampleDistribution(const std::string& name, SampleDistribution& distribution) {
+	if (name == "uniform") { distribution = SampleDistribution::UNIFORM; return true; }
+	if (name == "clustered") { distribution = SampleDistribution::CLUSTERED; return true; }
+	if (name == "city") { distribution = SampleDistribution::CITY_GRID; return true; }
+	return false;
+}
+
+// Parses the generator option at argv[i] (advancing i past its values). Returns false if argv[i] is
+// not a generator option; error is set when it is one but its values are invalid.
+//   --terrain-size N  --chunk-size S  --chunk-res N  --height H  --seed N
+//   --clusters N  --cluster-radius R  --lot-spacing L  --street-width W
+//   --batch <preset> <count> <uniform|clustered|city>   (repeatable)
+inline bool parseSceneGeneratorArg(int argc, char** argv, int& i, SceneGeneratorOptions& opt, std::string& error) {
+	const std::string arg = argv[i];
+	const bool hasValue = (i + 1 < argc);
+	if (arg == "--terrain-size" && hasValue) { opt.terrainMapSize = std::atoi(argv[++i]); }
+	else if (arg == "--chunk-size" && hasValue) { opt.chunkSize = (float)std::atof(argv[++i]); }
+	else if (arg == "--chunk-res" && hasValue) { opt.chunkResolution = std::atoi(argv[++i]); }
+	else if (arg == "--height" && hasValue) { opt.terrainHeight = (float)std::atof(argv[++i]); }
+	else if (arg == "--seed" && hasValue) { opt.seed = (unsigned int)std::strtoul(argv[++i], nullptr, 10); }
+	else if (arg == "--clusters" && hasValue) { opt.numCluster = std::atoi(argv[++i]); }
+	else if (arg == "--cluster-radius" && hasValue) { opt.clusterRadius = (float)std::atof(argv[++i]); }
+	else if (arg == "--lot-spacing" && hasValue) { opt.lotSpacing = (float)std::atof(argv[++i]); }
+	else if (arg == "--street-width" && hasValue) { opt.streetWidth = (float)std::atof(argv[++i]); }
+	else if (arg == "--batch" && i + 3 < argc) {
+		GeneratedBatchDesc batch;
+		batch.preset = argv[i + 1];
+		const long long count = std::atoll(argv[i + 2]);
+		if (SceneDescription::preset(batch.preset) == nullptr) {
+			error = "unknown batch preset: " + batch.preset;
+		}
+		else if (count < 0 || count > 0x7fffffffLL) {
+			error = std::string("invalid instance count: ") + argv[i + 2];
+		}
+		else if (!parseSampleDistribution(argv[i + 3], batch.distribution)) {
+			error = std::string("unknown distribution: ") + argv[i + 3];
+		}
+		batch.count = (int)count;
+		opt.batches.push_back(batch);
+		i += 3;
+	}
+	else { return false; }
+
+	if (error.empty() && (opt.terrainMapSize < 2 || opt.chunkSize <= 0.0f || opt.chunkResolution < 1 || opt.numCluster < 1 || opt.lotSpacing <= 0.0f)) {
+		error = "invalid value for " + arg;
+	}
+	return true;
+}
+
+// the outdoor scene's batches at roughly its own density
+inline void addDefaultGeneratedBatches(SceneGeneratorOptions& opt) {
+	opt.batches.push_back({ "grassB", 1000000, SampleDistribution::UNIFORM });
+	opt.batches.push_back({ "bush01", 20000, SampleDistribution::CLUSTERED });
+	opt.batches.push_back({ "bush05", 50000, SampleDistribution::CLUSTERED });
+	opt.batches.push_back({ "buildingV2", 1500, SampleDistribution::CITY_GRID });
+	opt.batches.push_back({ "buildingV1", 1500, SampleDistribution::CITY_GRID });
+}
+
+// ---------------------------------------------------------------------------------------------
+// terrain
+
+// sum of sines with integer frequencies over the [0,1]^2 map, so the terrain tiles like the UV wrap
+class SyntheticHeightField
+{
+public:
+	SyntheticHeightField(const unsigned int seed, const float height) : m_height(height) {
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> phase(0.0f, glm::two_pi<float>());
+		float amplitude = 1.0f;
+		for (int octave = 0; octave < 6; ++octave) {
+			const int f = 1 << octave;
+			std::uniform_int_distribution<int> frequency(-f, f);
+			for (int k = 0; k < 4; ++k) {
+				Wave w;
+				do {
+					w.kx = (float)frequency(rng);
+					w.kz = (float)frequency(rng);
+				} while (w.kx == 0.0f && w.kz == 0.0f);
+				w.phase = phase(rng);
+				w.amplitude = amplitude;
+				this->m_waves.push_back(w);
+				this->m_amplitudeSum += amplitude;
+			}
+			amplitude *= 0.5f;
+		}
+	}
+
+	float operator()(const float u, const float v) const {
+		float s = 0.0f;
+		for (const Wave& w : this->m_waves) {
+			s += w.amplitude * std::sin(glm::two_pi<float>() * (w.kx * u + w.kz * v) + w.phase);
+		}
+		return this->m_height * 0.5f * (1.0f + s / this->m_amplitudeSum);
+	}
+
+private:
+	struct Wave { float kx, kz, phase, amplitude; };
+	std::vector<Wave> m_waves;
+	float m_amplitudeSum = 0.0f;
+	float m_height;
+};
+
+// Writes the .mytd (RGBA32F elevation/normal/albedo maps) and keeps the elevation map in td for
+// height queries; td.m_elevationMap points into elevation.
+inline bool writeSyntheticTerrain(const SceneGeneratorOptions& opt, const std::string& mytdPath, std::vector<float>& elevation, MyTerrainData& td) {
+	const int w = opt.terrainMapSize;
+	const int h = opt.terrainMapSize;
+	const SyntheticHeightField field(opt.seed, opt.terrainHeight);
+
+	// texel (x, z) is sampled at uv (x, z) / (size - 1), see MyTerrainData::height
+	elevation.assign((size_t)w * h * 4, 0.0f);
+	for (int z = 0; z < h; ++z) {
+		for (int x = 0; x < w; ++x) {
+			float* texel = &elevation[((size_t)z * w + x) * 4];
+			texel[0] = field((float)x / (float)(w - 1), (float)z / (float)(h - 1));
+			texel[3] = 1.0f;
+		}
+	}
+
+	std::ofstream output(mytdPath, std::ios::binary);
+	if (!output.is_open()) { return false; }
+	const int sizeInfo[2] = { w, h };
+	output.write((const char*)sizeInfo, sizeof(sizeInfo));
+	output.write((const char*)elevation.data(), sizeof(float) * elevation.size());
+
+	// normals from central differences (texel pitch 2 * chunkSize / (size - 1)), wrapped at the border.
+	// Stored as [0,1] and pre-rotated by 180 degrees around y: terrainProcess() rotates them back.
+	auto heightAt = [&](int x, int z) {
+		x = (x + w) % w;
+		z = (z + h) % h;
+		return elevation[((size_t)z * w + x) * 4];
+	};
+	const float pitchX = 2.0f * opt.chunkSize / (float)(w - 1);
+	const float pitchZ = 2.0f * opt.chunkSize / (float)(h - 1);
+	std::vector<float> row((size_t)w * 4);
+	for (int z = 0; z < h; ++z) {
+		for (int x = 0; x < w; ++x) {
+			const float dx = (heightAt(x + 1, z) - heightAt(x - 1, z)) / (2.0f * pitchX);
+			const float dz = (heightAt(x, z + 1) - heightAt(x, z - 1)) / (2.0f * pitchZ);
+			const glm::vec3 n = glm::normalize(glm::vec3(-dx, 1.0f, -dz));
+			row[x * 4 + 0] = -n.x * 0.5f + 0.5f;
+			row[x * 4 + 1] = n.y * 0.5f + 0.5f;
+			row[x * 4 + 2] = -n.z * 0.5f + 0.5f;
+			row[x * 4 + 3] = 1.0f;
+		}
+		output.write((const char*)row.data(), sizeof(float) * row.size());
+	}
+
+	// albedo: grass on flat ground, rock on slopes, lighter towards the peaks
+	const glm::vec3 grass(0.28f, 0.42f, 0.16f);
+	const glm::vec3 rock(0.42f, 0.38f, 0.33f);
+	for (int z = 0; z < h; ++z) {
+		for (int x = 0; x < w; ++x) {
+			const float dx = (heightAt(x + 1, z) - heightAt(x - 1, z)) / (2.0f * pitchX);
+			const float dz = (heightAt(x, z + 1) - heightAt(x, z - 1)) / (2.0f * pitchZ);
+			const float slope = std::min(1.0f, std::sqrt(dx * dx + dz * dz) * 1.5f);
+			const float peak = (opt.terrainHeight > 0.0f) ? heightAt(x, z) / opt.terrainHeight : 0.0f;
+			const glm::vec3 c = glm::mix(grass, rock, slope) * (0.85f + 0.3f * peak);
+			row[x * 4 + 0] = c.r;
+			row[x * 4 + 1] = c.g;
+			row[x * 4 + 2] = c.b;
+			row[x * 4 + 3] = 1.0f;
+		}
+		output.write((const char*)row.data(), sizeof(float) * row.size());
+	}
+	if (!output.good()) { return false; }
+
+	td.m_elevationMapWidth = w;
+	td.m_elevationMapHeight = h;
+	td.m_elevationMap = elevation.data();
+	td.m_worldVtoElevationUVMat = MyTerrainData::worldVtoElevationUV(opt.chunkSize);
+	return true;
+}
+
+// one flat quadrant [0, chunkSize]^2 (MyTerrain rotates 4 copies around the camera); the vertex
+// shader displaces it with the elevation map
+inline bool writeSyntheticChunk(const SceneGeneratorOptions& opt, const std::string& chunkPath) {
+	const int n = opt.chunkResolution;
+	std::vector<float> vertices;
+	vertices.reserve((size_t)(n + 1) * (n + 1) * 3);
+	for (int z = 0; z <= n; ++z) {
+		for (int x = 0; x <= n; ++x) {
+			vertices.push_back(opt.chunkSize * (float)x / (float)n);
+			vertices.push_back(0.0f);
+			vertices.push_back(opt.chunkSize * (float)z / (float)n);
+		}
+	}
+	std::vector<unsigned int> indices;
+	indices.reserve((size_t)n * n * 6);
+	for (int z = 0; z < n; ++z) {
+		for (int x = 0; x < n; ++x) {
+			const unsigned int i0 = z * (n + 1) + x;
+			const unsigned int i1 = i0 + 1;
+			const unsigned int i2 = i0 + (n + 1);
+			const unsigned int i3 = i2 + 1;
+			indices.insert(indices.end(), { i0, i2, i1, i1, i2, i3 });
+		}
+	}
+
+	std::ofstream output(chunkPath, std::ios::binary);
+	if (!output.is_open()) { return false; }
+	const int numVertex = (int)(vertices.size() / 3);
+	const int numIndex = (int)indices.size();
+	output.write((const char*)&numVertex, sizeof(int));
+	output.write((const char*)vertices.data(), sizeof(float) * vertices.size());
+	output.write((const char*)&numIndex, sizeof(int));
+	output.write((const char*)indices.data(), sizeof(unsigned int) * indices.size());
+	return output.good();
+}
+
+// ---------------------------------------------------------------------------------------------
+// instances
+
+// Writes count samples as .ppd2 (count, positions[count], radians[count]) in blocks. City lots are
+// numbered across all city batches (firstLot, totalLots) so batches don't share lots.
+inline bool writeSyntheticSamples(const SceneGeneratorOptions& opt, const GeneratedBatchDesc& batch, const unsigned int batchSeed,
+	const MyTerrainData& td, const long long firstLot, const long long totalLots, const std::string& path) {
+	std::ofstream output(path, std::ios::binary);
+	if (!output.is_open()) { return false; }
+	const int count = batch.count;
+	output.write((const char*)&count, sizeof(int));
+
+	const float extent = opt.chunkSize;
+	auto wrap = [extent](const float v) { return v - 2.0f * extent * std::floor((v + extent) / (2.0f * extent)); };
+
+	std::vector<glm::vec2> clusterCenters;
+	if (batch.distribution == SampleDistribution::CLUSTERED) {
+		std::mt19937 rng(batchSeed);
+		std::uniform_real_distribution<float> uniformXZ(-extent, extent);
+		for (int c = 0; c < opt.numCluster; ++c) {
+			clusterCenters.push_back(glm::vec2(uniformXZ(rng), uniformXZ(rng)));
+		}
+	}
+
+	// city grid: square of lots centered at the origin, 4x4 lots per block, streets between blocks
+	const long long lotsPerRow = std::max(1LL, (long long)std::ceil(std::sqrt((double)totalLots)));
+	const float citySpan = (float)lotsPerRow * opt.lotSpacing + (float)((lotsPerRow - 1) / 4) * opt.streetWidth;
+
+	std::vector<float> positions, radians;
+	const std::streamoff radiansOffset = (std::streamoff)sizeof(int) + (std::streamoff)count * 3 * sizeof(float);
+	for (int first = 0; first < count; first += SCENE_GENERATOR_BLOCK) {
+		const int n = std::min(SCENE_GENERATOR_BLOCK, count - first);
+		positions.resize((size_t)n * 3);
+		radians.resize((size_t)n * 3);
+
+		// per-block stream: the output doesn't depend on the block being generated in order
+		std::seed_seq blockSeed{ batchSeed, (unsigned int)(first / SCENE_GENERATOR_BLOCK) };
+		std::mt19937 rng(blockSeed);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		std::normal_distribution<float> gaussian(0.0f, opt.clusterRadius);
+
+		for (int i = 0; i < n; ++i) {
+			float x = 0.0f, z = 0.0f, yaw = 0.0f;
+			if (batch.distribution == SampleDistribution::UNIFORM) {
+				x = (unit(rng) * 2.0f - 1.0f) * extent;
+				z = (unit(rng) * 2.0f - 1.0f) * extent;
+				yaw = unit(rng) * glm::two_pi<float>();
+			}
+			else if (batch.distribution == SampleDistribution::CLUSTERED) {
+				const glm::vec2& center = clusterCenters[std::min((int)(unit(rng) * opt.numCluster), opt.numCluster - 1)];
+				x = wrap(center.x + gaussian(rng));
+				z = wrap(center.y + gaussian(rng));
+				yaw = unit(rng) * glm::two_pi<float>();
+			}
+			else {
+				const long long lot = firstLot + first + i;
+				const long long lx = lot % lotsPerRow;
+				const long long lz = lot / lotsPerRow;
+				const float jitter = 0.05f * opt.lotSpacing;
+				x = wrap(-0.5f * citySpan + ((float)lx + 0.5f) * opt.lotSpacing + (float)(lx / 4) * opt.streetWidth + (unit(rng) - 0.5f) * jitter);
+				z = wrap(-0.5f * citySpan + ((float)lz + 0.5f) * opt.lotSpacing + (float)(lz / 4) * opt.streetWidth + (unit(rng) - 0.5f) * jitter);
+				yaw = glm::half_pi<float>() * (float)std::min((int)(unit(rng) * 4.0f), 3);
+			}
+			positions[i * 3 + 0] = x;
+			positions[i * 3 + 1] = td.height(x, z);
+			positions[i * 3 + 2] = z;
+			radians[i * 3 + 0] = 0.0f;
+			radians[i * 3 + 1] = yaw;
+			radians[i * 3 + 2] = 0.0f;
+		}
+
+		output.seekp((std::streamoff)sizeof(int) + (std::streamoff)first * 3 * sizeof(float));
+		output.write((const char*)positions.data(), sizeof(float) * positions.size());
+		output.seekp(radiansOffset + (std::streamoff)first * 3 * sizeof(float));
+		output.write((const char*)radians.data(), sizeof(float) * radians.size());
+	}
+	return output.good();
+}
+
+// ---------------------------------------------------------------------------------------------
+
+// Writes <outputDir>/terrain.mytd, terrain.chunkdata, <batch>.ppd2 and generated.scene; scene is
+// the loaded description of the written files.
+inline bool generateScene(const SceneGeneratorOptions& opt, SceneDescription& scene, std::string& error, std::ostream& log) {
+	namespace fs = std::filesystem;
+	std::error_code ec;
+	fs::create_directories(opt.outputDir, ec);
+	if (ec) {
+		error = "cannot create " + opt.outputDir + ": " + ec.message();
+		return false;
+	}
+	const fs::path dir(opt.outputDir);
+
+	scene = SceneDescription();
+	scene.elevationPath = (dir / "terrain.mytd").string();
+	scene.chunkDataPath = (dir / "terrain.chunkdata").string();
+	scene.chunkSize = opt.chunkSize;
+
+	std::vector<float> elevation;
+	MyTerrainData td;
+	if (!writeSyntheticTerrain(opt, scene.elevationPath, elevation, td)) {
+		error = "cannot write " + scene.elevationPath;
+		return false;
+	}
+	if (!writeSyntheticChunk(opt, scene.chunkDataPath)) {
+		error = "cannot write " + scene.chunkDataPath;
+		return false;
+	}
+	log << "terrain: " << opt.terrainMapSize << "x" << opt.terrainMapSize << " map, " << opt.chunkResolution << "x" << opt.chunkResolution
+		<< " chunk, extent +-" << opt.chunkSize << "\n";
+
+	long long totalLots = 0;
+	for (const GeneratedBatchDesc& batch : opt.batches) {
+		if (batch.distribution == SampleDistribution::CITY_GRID) { totalLots += batch.count; }
+	}
+
+	long long nextLot = 0;
+	for (size_t b = 0; b < opt.batches.size(); ++b) {
+		const GeneratedBatchDesc& batch = opt.batches[b];
+		InstanceBatchDesc desc = *SceneDescription::preset(batch.preset);
+		int numSameName = 0;
+		for (const InstanceBatchDesc& other : scene.batches) {
+			if (other.name.compare(0, batch.preset.size(), batch.preset) == 0) { numSameName++; }
+		}
+		if (numSameName > 0) { desc.name = batch.preset + "_" + std::to_string(numSameName); }
+		desc.samplePath = (dir / (desc.name + ".ppd2")).string();
+
+		if (!writeSyntheticSamples(opt, batch, opt.seed * 7919u + (unsigned int)b + 1u, td, nextLot, totalLots, desc.samplePath)) {
+			error = "cannot write " + desc.samplePath;
+			return false;
+		}
+		if (batch.distribution == SampleDistribution::CITY_GRID) { nextLot += batch.count; }
+		log << desc.name << ": " << batch.count << " instances -> " << desc.samplePath << "\n";
+		scene.batches.push_back(desc);
+	}
+	td.m_elevationMap = nullptr;
+
+	const std::string scenePath = (dir / "generated.scene").string();
+	if (!scene.writeFile(scenePath)) {
+		error = "cannot write " + scenePath;
+		return false;
+	}
+	log << "scene: " << scenePath << "\n";
+	return true;
+}
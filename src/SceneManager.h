@@ -1,6 +1,6 @@
 #pragma once
 
-#include <glad\glad.h>
+#include <glad/glad.h>
 
 // Singleton
 
@@ -27,47 +27,22 @@ public:
 	GLuint m_tangentHandle = 0;
 	GLuint m_uvHandle = 0;
 
+	// per-draw uniforms; view/light/material state lives in the uniform blocks (UniformBlocks.h)
 	GLuint m_modelMatHandle = 0;
-	GLuint m_viewMatHandle = 0;
-	GLuint m_projMatHandle = 0;
 	GLuint m_terrainVToUVMatHandle = 0;
-	GLuint m_lightDirWorldHandle = 0;
-	GLuint m_cameraPosHandle = 0;
-
-
-
-	GLuint m_albedoMapHandle = 0;
-	GLuint m_normalMapHandle = 0;
-	GLuint m_elevationMapHandle = 0;
-	
-	GLuint m_fs_pixelProcessIdHandle = 0;
-	GLuint m_vs_vertexProcessIdHandle = 0;
+	GLuint m_materialIndexHandle = 0;
 
 	GLenum m_albedoTexUnit = 0;
 	GLenum m_normalTexUnit = 0;
 	GLenum m_elevationTexUnit = 0;
 
-
-	int m_albedoMapTexIdx = 0;
-	int m_elevationMapTexIdx = 0;
-	int m_normalMapTexIdx = 0;
-
+	// vertex / pixel process ids stored in MaterialData.flags
 	int m_vs_commonProcess = 0;
 	int m_vs_terrainProcess = 0;	
 	int m_vs_instanceProcess = 0;
+	int m_vs_clusterProcess = 0;
 	
 	int m_fs_pureColor = 0;	
-	int m_fs_terrainPass = 0;
 	int m_fs_texturePass = 0;
-
-	// lighting / material (Phong)
-	GLuint m_lightDirHandle = 0; // deprecated, kept for compatibility
-	GLuint m_materialAmbientHandle = 0;
-	GLuint m_materialSpecularHandle = 0;
-	GLuint m_materialShininessHandle = 0;
-	GLuint m_useNormalMapHandle = 0;
-
-	// fragment shader normal sampler (for magic stone, etc.)
-	GLuint m_fs_normalTexHandle = 0;
-	int m_fs_normalTexIdx = 0;
+	int m_fs_terrainPass = 0;
 };
@@ -1,14 +1,21 @@
 #include "SceneRenderer.h"
 #include "FrustumUtils.h"
+#include "GLStateCache.h"
+#include "GpuProfiler.h"
+#include "CpuProfiler.h"
+#include "MeshImport.h"
+#include "ImpostorBaker.h"
 #include <algorithm>
 #include <cfloat>
 #include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <iostream>
 #include <stb_image.h>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
-static void computeFrustumCornersWS(const glm::mat4& viewMat, const glm::mat4& projMat, float nearD, float farD, glm::vec3 outCorners[8]);
 
 
 SceneRenderer::SceneRenderer()
@@ -19,6 +26,7 @@ SceneRenderer::SceneRenderer()
 SceneRenderer::~SceneRenderer()
 {
 	this->destroyGBuffer();
+	this->destroyOverdrawResources();
 	if (this->m_screenVAO != 0) {
 		glDeleteVertexArrays(1, &this->m_screenVAO);
 		glDeleteBuffers(1, &this->m_screenVBO);
@@ -33,22 +41,103 @@ SceneRenderer::~SceneRenderer()
 		delete this->m_shadowProgram;
 		this->m_shadowProgram = nullptr;
 	}
-	if (this->m_depthVizProgram != nullptr) {
-		delete this->m_depthVizProgram;
-		this->m_depthVizProgram = nullptr;
+	if (this->m_shadowFitProgram != nullptr) {
+		delete this->m_shadowFitProgram;
+		this->m_shadowFitProgram = nullptr;
+	}
+	if (this->m_shadowMomentBlurProgram != nullptr) {
+		delete this->m_shadowMomentBlurProgram;
+		this->m_shadowMomentBlurProgram = nullptr;
+	}
+	if (this->m_shadowCascadeBuffer != 0) {
+		glDeleteBuffers(1, &this->m_shadowCascadeBuffer);
+		this->m_shadowCascadeBuffer = 0;
 	}
 	if (this->m_hzbProgram != nullptr) {
 		delete this->m_hzbProgram;
 		this->m_hzbProgram = nullptr;
 	}
+	if (this->m_hzbCounterBuffer != 0) {
+		glDeleteBuffers(1, &this->m_hzbCounterBuffer);
+		this->m_hzbCounterBuffer = 0;
+	}
+	if (this->m_softwareOcclusionTex != 0) {
+		glDeleteTextures(1, &this->m_softwareOcclusionTex);
+		this->m_softwareOcclusionTex = 0;
+	}
 	if (this->m_cullProgram != nullptr) {
 		delete this->m_cullProgram;
 		this->m_cullProgram = nullptr;
 	}
+	if (this->m_foliageDepthProgram != nullptr) {
+		delete this->m_foliageDepthProgram;
+		this->m_foliageDepthProgram = nullptr;
+	}
+	if (this->m_foliageGBufferProgram != nullptr) {
+		delete this->m_foliageGBufferProgram;
+		this->m_foliageGBufferProgram = nullptr;
+	}
+	if (this->m_cullOverlayProgram != nullptr) {
+		delete this->m_cullOverlayProgram;
+		this->m_cullOverlayProgram = nullptr;
+	}
+	if (this->m_cullOverlayVAO != 0) {
+		glDeleteVertexArrays(1, &this->m_cullOverlayVAO);
+		this->m_cullOverlayVAO = 0;
+	}
+	if (this->m_impostorProgram != nullptr) {
+		delete this->m_impostorProgram;
+		this->m_impostorProgram = nullptr;
+	}
+	for (ShaderProgram** program : { &this->m_overdrawGBufferProgram, &this->m_overdrawFoliageGBufferProgram, &this->m_overdrawImpostorProgram }) {
+		delete *program;
+		*program = nullptr;
+	}
+	if (this->m_impostorVAO != 0) {
+		glDeleteVertexArrays(1, &this->m_impostorVAO);
+		this->m_impostorVAO = 0;
+	}
+	for (const ImpostorAtlasTextures& atlas : this->m_impostorAtlases) {
+		glDeleteTextures(1, &atlas.albedo);
+		glDeleteTextures(1, &atlas.normalDepth);
+	}
+	if (this->m_clusterCullArgsProgram != nullptr) {
+		delete this->m_clusterCullArgsProgram;
+		this->m_clusterCullArgsProgram = nullptr;
+	}
+	if (this->m_clusterCullProgram != nullptr) {
+		delete this->m_clusterCullProgram;
+		this->m_clusterCullProgram = nullptr;
+	}
+	if (this->m_depthBinScanProgram != nullptr) {
+		delete this->m_depthBinScanProgram;
+		this->m_depthBinScanProgram = nullptr;
+	}
+	if (this->m_depthBinScatterProgram != nullptr) {
+		delete this->m_depthBinScatterProgram;
+		this->m_depthBinScatterProgram = nullptr;
+	}
+	this->m_cullStats.release();
+	if (this->m_cullStatsBuffer != 0) {
+		glDeleteBuffers(1, &this->m_cullStatsBuffer);
+		this->m_cullStatsBuffer = 0;
+	}
+	if (this->m_fragmentQueries[0][0][0] != 0) {
+		glDeleteQueries(FRAGMENT_QUERY_SLOTS * 2 * 2, &this->m_fragmentQueries[0][0][0]);
+	}
 	for (auto& b : this->m_instanceBatches) {
 		if (b.instanceBuffer) glDeleteBuffers(1, &b.instanceBuffer);
 		if (b.visibleIndexBuffer) glDeleteBuffers(1, &b.visibleIndexBuffer);
 		if (b.indirectBuffer) glDeleteBuffers(1, &b.indirectBuffer);
+		if (b.depthBinEntryBuffer) glDeleteBuffers(1, &b.depthBinEntryBuffer);
+		if (b.depthBinBuffer) glDeleteBuffers(1, &b.depthBinBuffer);
+		if (b.cullReasonBuffer) glDeleteBuffers(1, &b.cullReasonBuffer);
+		if (b.pvsRangeBuffer) glDeleteBuffers(1, &b.pvsRangeBuffer);
+		if (b.impostorBuffer) glDeleteBuffers(1, &b.impostorBuffer);
+		if (b.clusterBuffer) glDeleteBuffers(1, &b.clusterBuffer);
+		if (b.clusterDrawBuffer) glDeleteBuffers(1, &b.clusterDrawBuffer);
+		if (b.clusterIndexBuffer) glDeleteBuffers(1, &b.clusterIndexBuffer);
+		if (b.clusterVAO) glDeleteVertexArrays(1, &b.clusterVAO);
 		if (b.vao) glDeleteVertexArrays(1, &b.vao);
 		if (b.vbo) glDeleteBuffers(1, &b.vbo);
 		if (b.ebo) glDeleteBuffers(1, &b.ebo);
@@ -56,28 +145,127 @@ SceneRenderer::~SceneRenderer()
 	}
 }
 void SceneRenderer::startNewFrame() {
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	CPU_PROFILE_SCOPE("startNewFrame");
+	// anything bound outside the renderer (ImGui, loading) is unknown to the cache
+	GLStateCache::Instance()->beginFrame();
+	GLStateCache::Instance()->bindFramebuffer(GL_FRAMEBUFFER, this->m_outputFBO);
+	// read back timers of earlier frames before any scope of this frame is opened
+	GpuProfiler::Instance()->beginFrame();
+	glClipControl(GL_LOWER_LEFT, this->m_reversedZ ? GL_ZERO_TO_ONE : GL_NEGATIVE_ONE_TO_ONE);
+	glDepthFunc(this->depthFunc());
 	this->clear();
+	this->resolveFragmentQueries();
+	this->m_cullStats.poll();
+	if (this->m_cullStatsBuffer != 0) {
+		const uint32_t zero = 0;
+		glClearNamedBufferData(this->m_cullStatsBuffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+	}
+	if (this->m_overdrawEnabled) {
+		this->pollOverdrawStats();
+		this->ensureOverdrawResources();
+		const uint32_t zero = 0;
+		glClearTexImage(this->m_overdrawCountTex, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+		glClearTexImage(this->m_overdrawOwnerTex, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+		glClearNamedBufferData(this->m_overdrawStatsBuffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+	}
 	// allow culling dispatch once per frame
 	this->m_cullDoneThisFrame = false;
 	this->m_hzbBuiltThisFrame = false;
 	this->m_shadowBuiltThisFrame = false;
+
+	// per-frame constants: written once, read by every pass of this frame
+	this->m_uniformRing.beginFrame();
+	this->uploadFrameBlocks();
 }
 void SceneRenderer::renderPass(int gbufferDisplayMode){
 	this->m_gbufferDisplayMode = gbufferDisplayMode;
-	this->renderGeometryPass();
-	this->renderDisplayPass();
+	this->m_viewBlockOffset = this->uploadViewBlock(this->m_viewMat, this->m_projMat);
+	{
+		CPU_PROFILE_SCOPE("Geometry");
+		GpuScope scope("Geometry");
+		this->renderGeometryPass();
+	}
+	{
+		GpuScope scope("Display");
+		this->renderDisplayPass();
+	}
 }
 
 void SceneRenderer::renderDisplayOnly(int gbufferDisplayMode) {
 	this->m_gbufferDisplayMode = gbufferDisplayMode;
+	this->m_viewBlockOffset = this->uploadViewBlock(this->m_viewMat, this->m_projMat);
+	GpuScope scope("Display");
 	this->renderDisplayPass();
 }
 
 void SceneRenderer::renderPassReuseVisibility(int gbufferDisplayMode) {
 	this->m_gbufferDisplayMode = gbufferDisplayMode;
-	this->renderGeometryPass(false, false);
-	this->renderDisplayPass();
+	this->m_viewBlockOffset = this->uploadViewBlock(this->m_viewMat, this->m_projMat);
+	{
+		GpuScope scope("Geometry (reuse)");
+		this->renderGeometryPass(false, false);
+	}
+	{
+		GpuScope scope("Display");
+		this->renderDisplayPass();
+	}
+}
+
+// -1 when the table is full: the caller fails the load (another entry would give the draw a wrong
+// vertex/pixel path)
+int SceneRenderer::registerMaterial(const MaterialDataGPU& material) {
+	if (this->m_numMaterial >= MAX_NUM_MATERIAL) {
+		std::cerr << "material table is full (MAX_NUM_MATERIAL = " << MAX_NUM_MATERIAL << " entries, UniformBlocks.h)\n";
+		this->m_materialTableFull = true;
+		return -1;
+	}
+	this->m_materialTable.materials[this->m_numMaterial] = material;
+	return this->m_numMaterial++;
+}
+
+void SceneRenderer::uploadFrameBlocks() {
+	// dynamic object materials can change at runtime (e.g. the normal map toggle)
+	for (const DynamicSceneObject* obj : this->m_dynamicSOs) {
+		MaterialDataGPU& m = this->m_materialTable.materials[obj->materialIndex()];
+		m.ambient = glm::vec4(obj->materialAmbient(), 1.0f);
+		m.specularShininess = glm::vec4(obj->materialSpecular(), obj->materialShininess());
+		m.flags = glm::ivec4(obj->pixelFunctionId(), SceneManager::Instance()->m_vs_commonProcess, obj->normalMapActive() ? 1 : 0, 0);
+	}
+
+	FrameBlockGPU frame;
+	frame.cullVP = this->m_cullVP;
+	frame.cullViewMat = this->m_cullView;
+	frame.lightDirWorld = glm::vec4(glm::normalize(glm::vec3(0.4f, 0.5f, 0.8f)), 0.0f);
+	// w: prefiltered moments; the texture exists once a shadow map was built with them on
+	const bool shadowMoments = this->m_shadowMomentsEnabled && this->m_shadowMomentTexArray != 0;
+	frame.shadowFlags = glm::ivec4(this->m_shadowEnabled ? 1 : 0, this->m_shadowCascadeVizEnabled ? 1 : 0, this->m_numShadowCascades, shadowMoments ? 1 : 0);
+	frame.depthFlags = glm::ivec4(this->m_reversedZ ? 1 : 0, 0, 0, 0);
+	frame.shadowFit = glm::vec4(this->m_shadowMinDistance, this->m_shadowMaxDistance, this->m_shadowSplitLambda, this->m_shadowCasterDistance);
+	frame.shadowMapInfo = glm::ivec4(this->m_shadowMapSize, 0, 0, 0);
+
+	const GLintptr frameOffset = this->m_uniformRing.write(&frame, sizeof(FrameBlockGPU));
+	this->m_uniformRing.bindRange(UBO_FRAME_BINDING, frameOffset, sizeof(FrameBlockGPU));
+	const GLintptr materialOffset = this->m_uniformRing.write(&this->m_materialTable, sizeof(MaterialBlockGPU));
+	this->m_uniformRing.bindRange(UBO_MATERIAL_BINDING, materialOffset, sizeof(MaterialBlockGPU));
+
+	if (this->m_shadowEnabled) {
+		// fixed splits; replaced by the GPU fit once the depth pyramid of this frame exists
+		this->m_shadowFrame++;
+		this->updateShadowMatrices();
+		const GLintptr shadowOffset = this->m_uniformRing.write(&this->m_shadowBlock, sizeof(ShadowBlockGPU));
+		this->m_uniformRing.bindRange(UBO_SHADOW_BINDING, shadowOffset, sizeof(ShadowBlockGPU));
+	}
+}
+
+GLintptr SceneRenderer::uploadViewBlock(const glm::mat4& viewMat, const glm::mat4& projMat) {
+	ViewBlockGPU block;
+	block.viewMat = viewMat;
+	block.projMat = projMat;
+	block.invProjMat = glm::inverse(projMat);
+	block.cameraPosWorld = glm::vec4(glm::vec3(glm::inverse(viewMat)[3]), 1.0f);
+	const GLintptr offset = this->m_uniformRing.write(&block, sizeof(ViewBlockGPU));
+	this->m_uniformRing.bindRange(UBO_VIEW_BINDING, offset, sizeof(ViewBlockGPU));
+	return offset;
 }
 
 // =======================================
@@ -86,8 +274,9 @@ void SceneRenderer::resize(const int w, const int h){
 	this->m_frameHeight = h;
 	this->destroyGBuffer();
 	this->createGBuffer(w, h);
+	this->destroyOverdrawResources();
 }
-bool SceneRenderer::initialize(const int w, const int h, ShaderProgram* shaderProgram){
+bool SceneRenderer::initialize(const int w, const int h, ShaderProgram* shaderProgram, const SceneDescription& scene){
 	this->m_shaderProgram = shaderProgram;
 
 	this->resize(w, h);
@@ -102,14 +291,41 @@ bool SceneRenderer::initialize(const int w, const int h, ShaderProgram* shaderPr
 	if (!this->setUpHZBShader()) {
 		return false;
 	}
-	if (!this->setUpDepthVizShader()) {
+	if (!this->setUpShadowShader()) {
+		return false;
+	}
+	if (!this->setUpFoliagePrepassShaders()) {
 		return false;
 	}
-	if (!this->setUpShadowShader()) {
+	if (!this->setUpCullOverlayShader()) {
+		return false;
+	}
+	if (!this->setUpImpostorShader()) {
+		return false;
+	}
+	if (!this->setUpOverdrawShaders()) {
+		return false;
+	}
+	// per frame: the frame, material, shadow and view blocks, plus one CullBlock per batch (a 256-byte
+	// slot each, the largest offset alignment GL allows)
+	const GLsizeiptr ringRegionSize = 16 * 1024 + (GLsizeiptr)scene.batches.size() * 256;
+	if (!this->m_uniformRing.init(ringRegionSize, 3)) {
+		std::cerr << "cannot allocate the uniform ring (" << ringRegionSize << " bytes per frame)\n";
 		return false;
 	}
 	this->ensureScreenQuad();
-	this->setUpInstanceBatches();
+	if (!scene.pvsPath.empty()) {
+		std::string error;
+		this->m_pvsLoaded = PotentiallyVisibleSet::fromFile(scene.pvsPath, this->m_pvs, error);
+		if (!this->m_pvsLoaded) {
+			std::cerr << error << "\n";
+		}
+	}
+	this->setUpInstanceBatches(scene.batches);
+	if (this->m_materialTableFull) {
+		std::cerr << "scene needs more than " << MAX_NUM_MATERIAL << " materials\n";
+		return false;
+	}
 	
 	glEnable(GL_DEPTH_TEST);
 
@@ -133,15 +349,33 @@ void SceneRenderer::setViewport(const int x, const int y, const int w, const int
 	this->m_displaySampleViewportW = w;
 	this->m_displaySampleViewportH = h;
 }
-void SceneRenderer::appendDynamicSceneObject(DynamicSceneObject *obj){
+bool SceneRenderer::appendDynamicSceneObject(DynamicSceneObject *obj){
+	// table entry is refreshed every frame in uploadFrameBlocks()
+	const int materialIndex = this->registerMaterial(MaterialDataGPU());
+	if (materialIndex < 0) {
+		return false;
+	}
+	obj->setMaterialIndex(materialIndex);
 	this->m_dynamicSOs.push_back(obj);
+	return true;
 }
-void SceneRenderer::appendTerrainSceneObject(TerrainSceneObject* tSO) {
+bool SceneRenderer::appendTerrainSceneObject(TerrainSceneObject* tSO) {
+	if (this->m_terrainMaterialIndex < 0) {
+		// material: ambient = diffuse, specular 0, shininess 1, no normal map
+		MaterialDataGPU terrainMaterial;
+		terrainMaterial.flags = glm::ivec4(SceneManager::Instance()->m_fs_terrainPass, SceneManager::Instance()->m_vs_terrainProcess, 0, 0);
+		this->m_terrainMaterialIndex = this->registerMaterial(terrainMaterial);
+	}
+	if (this->m_terrainMaterialIndex < 0) {
+		return false;
+	}
+	tSO->setMaterialIndex(this->m_terrainMaterialIndex);
 	this->m_terrainSO = tSO;
+	return true;
 }
-void SceneRenderer::clear(const glm::vec4 &clearColor, const float depth){
+void SceneRenderer::clear(const glm::vec4 &clearColor){
 	static const float COLOR[] = { 0.0, 0.0, 0.0, 1.0 };
-	static const float DEPTH[] = { 1.0 };
+	const float DEPTH[] = { this->farDepth() };
 
 	glClearBufferfv(GL_COLOR, 0, COLOR);
 	glClearBufferfv(GL_DEPTH, 0, DEPTH);
@@ -163,43 +397,21 @@ bool SceneRenderer::setUpShader(){
 	manager->m_uvHandle = 3;
 
 	// =================================
+	// per-draw uniforms (see oglVertexShader.glsl / oglFragmentShader.glsl)
 	manager->m_modelMatHandle = 0;
-	manager->m_viewMatHandle = 7;
-	manager->m_projMatHandle = 8;
 	manager->m_terrainVToUVMatHandle = 9;
-	manager->m_lightDirWorldHandle = 17;
-	manager->m_cameraPosHandle = 18;
-	manager->m_materialAmbientHandle = 11;
-	manager->m_materialSpecularHandle = 12;
-	manager->m_materialShininessHandle = 13;
-	manager->m_useNormalMapHandle = 14;
-	manager->m_fs_normalTexHandle = 15;
-
-	manager->m_albedoMapHandle = 4;
-	manager->m_albedoMapTexIdx = 0;
-	glUniform1i(manager->m_albedoMapHandle, manager->m_albedoMapTexIdx);
-
-	manager->m_elevationMapHandle = 5;
-	manager->m_elevationMapTexIdx = 3;
-	glUniform1i(manager->m_elevationMapHandle, manager->m_elevationMapTexIdx);
-	
-	manager->m_normalMapHandle = 6;
-	manager->m_normalMapTexIdx = 2;
-	glUniform1i(manager->m_normalMapHandle, manager->m_normalMapTexIdx);
-	// fragment normal sampler (e.g., magic stone)
-	manager->m_fs_normalTexIdx = 2;
-	glUniform1i(manager->m_fs_normalTexHandle, manager->m_fs_normalTexIdx);
-	
+	manager->m_materialIndexHandle = 10;
+
+	// sampler units are fixed with layout(binding) in the shaders
 	manager->m_albedoTexUnit = GL_TEXTURE0;
 	manager->m_elevationTexUnit = GL_TEXTURE3;
 	manager->m_normalTexUnit = GL_TEXTURE2;
 
-	manager->m_vs_vertexProcessIdHandle = 1;
 	manager->m_vs_commonProcess = 0;
 	manager->m_vs_terrainProcess = 3;
 	manager->m_vs_instanceProcess = 4;
+	manager->m_vs_clusterProcess = 8;
 
-	manager->m_fs_pixelProcessIdHandle = 2;
 	manager->m_fs_pureColor = 5;
 	manager->m_fs_texturePass = 6;
 	manager->m_fs_terrainPass = 7;
@@ -209,9 +421,9 @@ bool SceneRenderer::setUpShader(){
 
 bool SceneRenderer::setUpDisplayShader() {
 	Shader* vs = new Shader(GL_VERTEX_SHADER);
-	vs->createShaderFromFile("shaders\\gbufferDisplayVertex.glsl");
+	vs->createShaderFromFile("shaders/gbufferDisplayVertex.glsl");
 	Shader* fs = new Shader(GL_FRAGMENT_SHADER);
-	fs->createShaderFromFile("shaders\\gbufferDisplayFragment.glsl");
+	fs->createShaderFromFile("shaders/gbufferDisplayFragment.glsl");
 
 	this->m_displayProgram = new ShaderProgram();
 	this->m_displayProgram->init();
@@ -225,30 +437,18 @@ bool SceneRenderer::setUpDisplayShader() {
 	delete vs;
 	delete fs;
 
-	this->m_displayProgram->useProgram();
-	// sampler bindings
-	glUniform1i(0, 0); // gPositionTex -> unit0
-	glUniform1i(1, 1); // gNormalTex   -> unit1
-	glUniform1i(2, 2); // gAmbientTex  -> unit2
-	glUniform1i(3, 3); // gDiffuseTex  -> unit3
-	glUniform1i(4, 4); // gSpecularTex -> unit4
-	glUniform1i(11, 5); // depthPyramid -> unit5
-	glUniform1i(this->m_shadowMapHandle, 6); // shadowMap -> unit6
+	// samplers use layout(binding) units 0..6; light/camera/shadow state comes from the uniform blocks
 	this->m_displayModeHandle = 5;
 	this->m_displayUVScaleHandle = 6;
 	this->m_displayUVBiasHandle = 7;
-	this->m_displayLightDirHandle = 8;
-	this->m_displayCamPosHandle = 9;
-	this->m_displayViewMatHandle = 10;
 	this->m_displayDepthMipLevelHandle = 12;
-	this->m_displayInvProjHandle = 13;
 
 	return true;
 }
 
 bool SceneRenderer::setUpHZBShader() {
 	Shader* cs = new Shader(GL_COMPUTE_SHADER);
-	cs->createShaderFromFile("shaders\\hzbBuild.comp");
+	cs->createShaderFromFile("shaders/hzbBuild.comp");
 	this->m_hzbProgram = new ShaderProgram();
 	this->m_hzbProgram->init();
 	this->m_hzbProgram->attachShader(cs);
@@ -257,17 +457,18 @@ bool SceneRenderer::setUpHZBShader() {
 	cs->releaseShader();
 	delete cs;
 
-	this->m_hzbProgram->useProgram();
-	this->m_hzbSrcLevelHandle = 0;
-	this->m_hzbDstLevelHandle = 1;
+	// the last group of every build resets it to 0
+	const uint32_t zero = 0;
+	glCreateBuffers(1, &this->m_hzbCounterBuffer);
+	glNamedBufferData(this->m_hzbCounterBuffer, sizeof(uint32_t), &zero, GL_DYNAMIC_COPY);
 	return true;
 }
 
 bool SceneRenderer::setUpShadowShader() {
 	Shader* vs = new Shader(GL_VERTEX_SHADER);
-	vs->createShaderFromFile("shaders\\shadowDepthVertex.glsl");
+	vs->createShaderFromFile("shaders/shadowDepthVertex.glsl");
 	Shader* fs = new Shader(GL_FRAGMENT_SHADER);
-	fs->createShaderFromFile("shaders\\shadowDepthFragment.glsl");
+	fs->createShaderFromFile("shaders/shadowDepthFragment.glsl");
 
 	this->m_shadowProgram = new ShaderProgram();
 	this->m_shadowProgram->init();
@@ -280,6 +481,132 @@ bool SceneRenderer::setUpShadowShader() {
 	fs->releaseShader();
 	delete vs;
 	delete fs;
+
+	Shader* cs = new Shader(GL_COMPUTE_SHADER);
+	cs->createShaderFromFile("shaders/shadowCascadeFit.comp");
+	this->m_shadowFitProgram = new ShaderProgram();
+	this->m_shadowFitProgram->init();
+	this->m_shadowFitProgram->attachShader(cs);
+	this->m_shadowFitProgram->checkStatus();
+	this->m_shadowFitProgram->linkProgram();
+	cs->releaseShader();
+	delete cs;
+
+	Shader* blurCs = new Shader(GL_COMPUTE_SHADER);
+	blurCs->createShaderFromFile("shaders/shadowMomentBlur.comp");
+	this->m_shadowMomentBlurProgram = new ShaderProgram();
+	this->m_shadowMomentBlurProgram->init();
+	this->m_shadowMomentBlurProgram->attachShader(blurCs);
+	this->m_shadowMomentBlurProgram->checkStatus();
+	this->m_shadowMomentBlurProgram->linkProgram();
+	blurCs->releaseShader();
+	delete blurCs;
+	// see shadowMomentBlur.comp
+	this->m_momentBlurPassHandle = 0;
+	this->m_momentBlurLayerHandle = 1;
+	this->m_momentBlurDownsampleHandle = 2;
+	this->m_momentBlurRadiusHandle = 3;
+
+	// same layout as the ShadowBlock uniform block, bound as one after the fit
+	glCreateBuffers(1, &this->m_shadowCascadeBuffer);
+	glNamedBufferData(this->m_shadowCascadeBuffer, sizeof(ShadowBlockGPU), nullptr, GL_DYNAMIC_COPY);
+	return true;
+}
+
+bool SceneRenderer::setUpFoliagePrepassShaders() {
+	auto build = [](const char* vsPath, const char* fsPath) {
+		Shader* vs = new Shader(GL_VERTEX_SHADER);
+		vs->createShaderFromFile(vsPath);
+		Shader* fs = new Shader(GL_FRAGMENT_SHADER);
+		fs->createShaderFromFile(fsPath);
+		ShaderProgram* program = new ShaderProgram();
+		program->init();
+		program->attachShader(vs);
+		program->attachShader(fs);
+		program->checkStatus();
+		program->linkProgram();
+		vs->releaseShader();
+		fs->releaseShader();
+		delete vs;
+		delete fs;
+		return program;
+	};
+	this->m_foliageDepthProgram = build("shaders/foliageDepthVertex.glsl", "shaders/foliageDepthFragment.glsl");
+	// same vertex shader as the main program, so positions (and depths) are invariant between them
+	this->m_foliageGBufferProgram = build("shaders/oglVertexShader.glsl", "shaders/foliageGBufferFragment.glsl");
+	return true;
+}
+
+bool SceneRenderer::setUpOverdrawShaders() {
+	auto build = [](const char* vsPath, const char* fsPath) {
+		Shader* vs = new Shader(GL_VERTEX_SHADER);
+		vs->createShaderFromFile(vsPath);
+		Shader* fs = new Shader(GL_FRAGMENT_SHADER);
+		fs->createShaderFromFile(fsPath, "#define OVERDRAW_COUNT\n");
+		ShaderProgram* program = new ShaderProgram();
+		program->init();
+		program->attachShader(vs);
+		program->attachShader(fs);
+		program->checkStatus();
+		program->linkProgram();
+		vs->releaseShader();
+		fs->releaseShader();
+		delete vs;
+		delete fs;
+		return program;
+	};
+	this->m_overdrawGBufferProgram = build("shaders/oglVertexShader.glsl", "shaders/oglFragmentShader.glsl");
+	this->m_overdrawFoliageGBufferProgram = build("shaders/oglVertexShader.glsl", "shaders/foliageGBufferFragment.glsl");
+	this->m_overdrawImpostorProgram = build("shaders/impostorVertex.glsl", "shaders/impostorFragment.glsl");
+	// looked up per program: the three shader pairs link overdraw.glsl independently
+	this->m_overdrawGBufferSlotHandle = glGetUniformLocation(this->m_overdrawGBufferProgram->programId(), "overdrawSlot");
+	this->m_overdrawFoliageGBufferSlotHandle = glGetUniformLocation(this->m_overdrawFoliageGBufferProgram->programId(), "overdrawSlot");
+	this->m_overdrawImpostorSlotHandle = glGetUniformLocation(this->m_overdrawImpostorProgram->programId(), "overdrawSlot");
+	return true;
+}
+
+bool SceneRenderer::setUpCullOverlayShader() {
+	Shader* vs = new Shader(GL_VERTEX_SHADER);
+	vs->createShaderFromFile("shaders/cullOverlayVertex.glsl");
+	Shader* fs = new Shader(GL_FRAGMENT_SHADER);
+	fs->createShaderFromFile("shaders/cullOverlayFragment.glsl");
+	this->m_cullOverlayProgram = new ShaderProgram();
+	this->m_cullOverlayProgram->init();
+	this->m_cullOverlayProgram->attachShader(vs);
+	this->m_cullOverlayProgram->attachShader(fs);
+	this->m_cullOverlayProgram->checkStatus();
+	this->m_cullOverlayProgram->linkProgram();
+	vs->releaseShader();
+	fs->releaseShader();
+	delete vs;
+	delete fs;
+	// vertices come from gl_VertexID, but a VAO must still be bound
+	glGenVertexArrays(1, &this->m_cullOverlayVAO);
+	return true;
+}
+
+bool SceneRenderer::setUpImpostorShader() {
+	Shader* vs = new Shader(GL_VERTEX_SHADER);
+	vs->createShaderFromFile("shaders/impostorVertex.glsl");
+	Shader* fs = new Shader(GL_FRAGMENT_SHADER);
+	fs->createShaderFromFile("shaders/impostorFragment.glsl");
+	this->m_impostorProgram = new ShaderProgram();
+	this->m_impostorProgram->init();
+	this->m_impostorProgram->attachShader(vs);
+	this->m_impostorProgram->attachShader(fs);
+	this->m_impostorProgram->checkStatus();
+	this->m_impostorProgram->linkProgram();
+	vs->releaseShader();
+	fs->releaseShader();
+	delete vs;
+	delete fs;
+	// per-batch uniforms of impostorVertex.glsl / impostorFragment.glsl
+	this->m_impostorMaterialIndexHandle = 10;
+	this->m_impostorBoundsHandle = 12;
+	this->m_impostorFramesHandle = 13;
+	this->m_impostorShadowCascadeHandle = 14;
+	// quads come from gl_VertexID
+	glGenVertexArrays(1, &this->m_impostorVAO);
 	return true;
 }
 
@@ -287,6 +614,22 @@ void SceneRenderer::destroyShadowResources() {
 	if (this->m_shadowTexArray != 0) {
 		glDeleteTextures(1, &this->m_shadowTexArray);
 		this->m_shadowTexArray = 0;
+		this->m_shadowTexLayers = 0;
+		this->m_shadowTexSize = 0;
+	}
+	if (this->m_shadowStaticTexArray != 0) {
+		glDeleteTextures(1, &this->m_shadowStaticTexArray);
+		this->m_shadowStaticTexArray = 0;
+	}
+	if (this->m_shadowMomentTexArray != 0) {
+		glDeleteTextures(1, &this->m_shadowMomentTexArray);
+		glDeleteTextures(1, &this->m_shadowMomentTempTex);
+		this->m_shadowMomentTexArray = 0;
+		this->m_shadowMomentTempTex = 0;
+	}
+	for (ShadowCascadeCache& cache : this->m_shadowCache) {
+		cache.valid = false;
+		cache.dirty = true;
 	}
 	if (this->m_shadowFBO != 0) {
 		glDeleteFramebuffers(1, &this->m_shadowFBO);
@@ -295,94 +638,146 @@ void SceneRenderer::destroyShadowResources() {
 }
 
 void SceneRenderer::ensureShadowResources() {
-	if (this->m_shadowFBO != 0 && this->m_shadowTexArray != 0) return;
+	if (this->m_shadowFBO != 0 && this->m_shadowTexArray != 0 &&
+		this->m_shadowTexLayers == this->m_numShadowCascades && this->m_shadowTexSize == this->m_shadowMapSize) {
+		if (this->shadowCacheActive() && this->m_shadowStaticTexArray == 0) {
+			glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &this->m_shadowStaticTexArray);
+			glTextureStorage3D(this->m_shadowStaticTexArray, 1, GL_DEPTH_COMPONENT32F, this->m_shadowMapSize, this->m_shadowMapSize, this->m_numShadowCascades);
+			for (ShadowCascadeCache& cache : this->m_shadowCache) {
+				cache.dirty = true;
+			}
+		}
+		if (this->m_shadowMomentsEnabled && this->m_shadowMomentTexArray == 0) {
+			this->createShadowMomentTextures();
+		}
+		return;
+	}
+	// cascade count or resolution changed
+	this->destroyShadowResources();
 
 	glGenFramebuffers(1, &this->m_shadowFBO);
 
 	glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &this->m_shadowTexArray);
-	glTextureStorage3D(this->m_shadowTexArray, 1, GL_DEPTH_COMPONENT32F, this->m_shadowMapSize, this->m_shadowMapSize, 3);
+	glTextureStorage3D(this->m_shadowTexArray, 1, GL_DEPTH_COMPONENT32F, this->m_shadowMapSize, this->m_shadowMapSize, this->m_numShadowCascades);
+	this->m_shadowTexLayers = this->m_numShadowCascades;
+	this->m_shadowTexSize = this->m_shadowMapSize;
 	glTextureParameteri(this->m_shadowTexArray, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTextureParameteri(this->m_shadowTexArray, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glTextureParameteri(this->m_shadowTexArray, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
 	glTextureParameteri(this->m_shadowTexArray, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-	const float border[] = { 1.0f, 1.0f, 1.0f, 1.0f };
-	glTextureParameterfv(this->m_shadowTexArray, GL_TEXTURE_BORDER_COLOR, border);
 	glTextureParameteri(this->m_shadowTexArray, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
-	glTextureParameteri(this->m_shadowTexArray, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	// border and compare function follow the depth convention (buildShadowMaps)
+	if (this->shadowCacheActive()) {
+		// only ever copied from: no sampling state
+		glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &this->m_shadowStaticTexArray);
+		glTextureStorage3D(this->m_shadowStaticTexArray, 1, GL_DEPTH_COMPONENT32F, this->m_shadowMapSize, this->m_shadowMapSize, this->m_numShadowCascades);
+	}
+	if (this->m_shadowMomentsEnabled) {
+		this->createShadowMomentTextures();
+	}
 }
 
-static void computeFrustumCornersWS(const glm::mat4& viewMat, const glm::mat4& projMat, float nearD, float farD, glm::vec3 outCorners[8]) {
-	// Build 8 corners for the sub-frustum slice [nearD, farD] in world space.
-	glm::mat4 invView = glm::inverse(viewMat);
-	glm::mat4 invProj = glm::inverse(projMat);
-	const glm::vec2 ndcCorners[4] = {
-		{-1.0f, -1.0f}, {1.0f, -1.0f}, {1.0f, 1.0f}, {-1.0f, 1.0f}
-	};
-	for (int i = 0; i < 4; ++i) {
-		glm::vec4 cornerVS4 = invProj * glm::vec4(ndcCorners[i].x, ndcCorners[i].y, 1.0f, 1.0f);
-		cornerVS4 /= cornerVS4.w;
-		glm::vec3 ray = glm::vec3(cornerVS4);
-		float nearT = nearD / (-ray.z);
-		float farT = farD / (-ray.z);
-		glm::vec3 nearVS = ray * nearT;
-		glm::vec3 farVS = ray * farT;
-		outCorners[i + 0] = glm::vec3(invView * glm::vec4(nearVS, 1.0f));
-		outCorners[i + 4] = glm::vec3(invView * glm::vec4(farVS, 1.0f));
-	}
+void SceneRenderer::createShadowMomentTextures() {
+	const int size = std::max(this->m_shadowMapSize / this->m_shadowMomentDownsample, 1);
+	int levels = 1;
+	while ((size >> levels) > 0) levels++;
+
+	glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &this->m_shadowMomentTexArray);
+	glTextureStorage3D(this->m_shadowMomentTexArray, levels, GL_RGBA32F, size, size, this->m_numShadowCascades);
+	glTextureParameteri(this->m_shadowMomentTexArray, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTextureParameteri(this->m_shadowMomentTexArray, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	// outside the cascade is never sampled (chooseCascadeMapBased), edges just clamp
+	glTextureParameteri(this->m_shadowMomentTexArray, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(this->m_shadowMomentTexArray, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTextureParameterf(this->m_shadowMomentTexArray, GL_TEXTURE_MAX_ANISOTROPY, 8.0f);
+
+	glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &this->m_shadowMomentTempTex);
+	glTextureStorage3D(this->m_shadowMomentTempTex, 1, GL_RGBA32F, size, size, 1);
+	glTextureParameteri(this->m_shadowMomentTempTex, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTextureParameteri(this->m_shadowMomentTempTex, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 }
 
 void SceneRenderer::updateShadowMatrices() {
 	const glm::vec3 lightDirWorld = glm::normalize(glm::vec3(0.4f, 0.5f, 0.8f));
-	const glm::vec3 forward = glm::normalize(-lightDirWorld);
-	glm::vec3 up(0.0f, 1.0f, 0.0f);
-	if (std::abs(glm::dot(forward, up)) > 0.99f) up = glm::vec3(0.0f, 0.0f, 1.0f);
 
 	// Always base cascades on player view/projection (culling view/VP).
 	const glm::mat4 playerView = this->m_cullView;
 	const glm::mat4 playerProj = this->m_cullVP * glm::inverse(this->m_cullView);
 
-	for (int c = 0; c < 3; ++c) {
-		glm::vec3 cornersWS[8];
-		computeFrustumCornersWS(playerView, playerProj, this->m_shadowCascadeNear[c], this->m_shadowCascadeFar[c], cornersWS);
-
-		glm::vec3 center(0.0f);
-		for (const auto& p : cornersWS) center += p;
-		center *= (1.0f / 8.0f);
-
-		const glm::mat4 lightView = glm::lookAt(center - forward * 1000.0f, center, up);
-		glm::vec3 minLS(FLT_MAX), maxLS(-FLT_MAX);
-		for (const auto& p : cornersWS) {
-			glm::vec3 ls = glm::vec3(lightView * glm::vec4(p, 1.0f));
-			minLS = glm::min(minLS, ls);
-			maxLS = glm::max(maxLS, ls);
+	// the fit's fallback (no depth pyramid yet) uses its split scheme
+	float splits[MAX_SHADOW_CASCADES + 1];
+	if (this->m_shadowPracticalSplits || this->m_shadowFitToDepth) {
+		shadowCascadeSplits(this->m_shadowMinDistance, this->m_shadowMaxDistance, this->m_numShadowCascades, this->m_shadowSplitLambda, splits);
+	}
+	else {
+		std::copy(this->m_shadowCascadeTable[this->m_numShadowCascades - 1], this->m_shadowCascadeTable[this->m_numShadowCascades - 1] + this->m_numShadowCascades + 1, splits);
+	}
+	const glm::mat4 lightView = lightRotationView(lightDirWorld);
+	for (int c = 0; c < MAX_SHADOW_CASCADES; ++c) {
+		if (c < this->m_numShadowCascades && this->shadowCacheActive()) {
+			// same padding as computeCascadeLightVP, casters towards the light
+			glm::vec3 requiredMin, requiredMax;
+			cascadeLightSpaceBounds(playerView, playerProj, splits[c], splits[c + 1], lightView, requiredMin, requiredMax);
+			requiredMin -= glm::vec3(10.0f, 10.0f, 1.0f);
+			requiredMax += glm::vec3(10.0f, 10.0f, this->m_shadowCasterDistance);
+			this->updateShadowCache(c, requiredMin, requiredMax);
+			this->m_shadowBlock.lightVP[c] = lightBoxVP(lightView, this->m_shadowCache[c].boxMin, this->m_shadowCache[c].boxMax, this->m_reversedZ);
+		}
+		else if (c < this->m_numShadowCascades) {
+			this->m_shadowBlock.lightVP[c] = computeCascadeLightVP(playerView, playerProj, splits[c], splits[c + 1], lightDirWorld, this->m_shadowMapSize, this->m_reversedZ);
+		}
+		else {
+			this->m_shadowBlock.lightVP[c] = glm::mat4(1.0f);
 		}
+		this->m_shadowBlock.cascadeFar[c] = splits[std::min(c + 1, this->m_numShadowCascades)];
+	}
+	this->m_shadowBlock.depthRange = glm::vec4(splits[0], splits[this->m_numShadowCascades], 0.0f, 0.0f);
+}
+
+void SceneRenderer::updateShadowCache(const int cascade, const glm::vec3& requiredMin, const glm::vec3& requiredMax) {
+	ShadowCascadeCache& cache = this->m_shadowCache[cascade];
+	const bool covered = cache.valid && cache.reversedZ == this->m_reversedZ &&
+		glm::all(glm::greaterThanEqual(requiredMin, cache.boxMin)) && glm::all(glm::lessThanEqual(requiredMax, cache.boxMax));
+	if (covered) {
+		// refresh once half the margin is used up; cascades > 0 only on every other frame
+		const glm::vec3 slack = (cache.boxMax - cache.boxMin) * (0.5f * this->m_shadowCacheMargin / (1.0f + 2.0f * this->m_shadowCacheMargin));
+		const bool inside = glm::all(glm::greaterThanEqual(requiredMin, cache.boxMin + slack)) &&
+			glm::all(glm::lessThanEqual(requiredMax, cache.boxMax - slack));
+		const bool refreshFrame = (cascade == 0) || ((this->m_shadowFrame + (unsigned int)cascade) % 2u == 0u);
+		if (inside || !refreshFrame) return;
+	}
 
-		// Padding to reduce clipping & acne.
-		const float padXY = 10.0f;
-		minLS.x -= padXY; minLS.y -= padXY;
-		maxLS.x += padXY; maxLS.y += padXY;
-		const float padZ = 50.0f;
-
-		// Stabilize by snapping the ortho center to texel size.
-		const float extentX = maxLS.x - minLS.x;
-		const float extentY = maxLS.y - minLS.y;
-		float centerX = 0.5f * (minLS.x + maxLS.x);
-		float centerY = 0.5f * (minLS.y + maxLS.y);
-		const float texelX = extentX / (float)this->m_shadowMapSize;
-		const float texelY = extentY / (float)this->m_shadowMapSize;
-		if (texelX > 0.0f) centerX = std::floor(centerX / texelX) * texelX;
-		if (texelY > 0.0f) centerY = std::floor(centerY / texelY) * texelY;
-		minLS.x = centerX - 0.5f * extentX;
-		maxLS.x = centerX + 0.5f * extentX;
-		minLS.y = centerY - 0.5f * extentY;
-		maxLS.y = centerY + 0.5f * extentY;
-
-		// glm::lookAt looks down -Z, so convert light-space z (likely negative) to near/far distances.
-		const float zNear = std::max(0.1f, -maxLS.z - padZ);
-		const float zFar  = std::max(zNear + 0.1f, -minLS.z + padZ);
-		const glm::mat4 lightProj = glm::ortho(minLS.x, maxLS.x, minLS.y, maxLS.y, zNear, zFar);
-		this->m_shadowLightVP[c] = lightProj * lightView;
+	// margin around the required box; xy extent in 1/8 octave steps and center on the texel grid,
+	// so refreshes while moving do not change the texel footprint
+	const glm::vec3 extent = requiredMax - requiredMin;
+	const glm::vec3 center = 0.5f * (requiredMin + requiredMax);
+	glm::vec3 boxExtent = extent * (1.0f + 2.0f * this->m_shadowCacheMargin);
+	for (int i = 0; i < 2; ++i) {
+		boxExtent[i] = std::exp2(std::ceil(std::log2(std::max(boxExtent[i], 0.01f)) * 8.0f) / 8.0f);
+	}
+	glm::vec3 boxCenter = center;
+	for (int i = 0; i < 2; ++i) {
+		const float texel = boxExtent[i] / (float)this->m_shadowMapSize;
+		boxCenter[i] = std::floor(center[i] / texel) * texel;
 	}
+	cache.boxMin = boxCenter - 0.5f * boxExtent;
+	cache.boxMax = boxCenter + 0.5f * boxExtent;
+	cache.valid = true;
+	cache.dirty = true;
+	cache.reversedZ = this->m_reversedZ;
+}
+
+void SceneRenderer::fitShadowCascades() {
+	// the fit constants come from FrameBlock
+	GLStateCache* glState = GLStateCache::Instance();
+	this->m_shadowFitProgram->useProgram();
+	glState->bindTexture(5, this->m_depthPyramidTex);
+	glState->bindStorageBuffer(3, this->m_shadowCascadeBuffer);
+	glState->dispatchCompute(1, 1, 1);
+
+	// the matrices never leave the GPU: the shadow and display passes read the buffer as ShadowBlock
+	glMemoryBarrier(GL_UNIFORM_BARRIER_BIT);
+	glState->bindUniformBufferRange(UBO_SHADOW_BINDING, this->m_shadowCascadeBuffer, 0, sizeof(ShadowBlockGPU));
 }
 
 void SceneRenderer::buildShadowMaps() {
@@ -390,61 +785,218 @@ void SceneRenderer::buildShadowMaps() {
 	this->ensureShadowResources();
 	if (this->m_shadowFBO == 0 || this->m_shadowTexArray == 0) return;
 
-	this->updateShadowMatrices();
+	// light matrices: fixed splits from uploadFrameBlocks(), or fitted to this frame's depth pyramid
+	if (this->m_shadowFitToDepth && this->m_hzbBuiltThisFrame && this->m_shadowFitProgram != nullptr) {
+		GpuScope scope("Cascade fit");
+		this->fitShadowCascades();
+	}
+
+	// outside the map is lit: the border is the far depth, lit when the receiver is not farther
+	const float border[] = { this->farDepth(), this->farDepth(), this->farDepth(), this->farDepth() };
+	glTextureParameterfv(this->m_shadowTexArray, GL_TEXTURE_BORDER_COLOR, border);
+	glTextureParameteri(this->m_shadowTexArray, GL_TEXTURE_COMPARE_FUNC, this->m_reversedZ ? GL_GEQUAL : GL_LEQUAL);
 
-	glBindFramebuffer(GL_FRAMEBUFFER, this->m_shadowFBO);
+	GLStateCache* glState = GLStateCache::Instance();
+	glState->bindFramebuffer(GL_FRAMEBUFFER, this->m_shadowFBO);
 	glDrawBuffer(GL_NONE);
 	glReadBuffer(GL_NONE);
 	glEnable(GL_DEPTH_TEST);
 	glEnable(GL_CULL_FACE);
 	glCullFace(GL_BACK);
 	glEnable(GL_POLYGON_OFFSET_FILL);
-	glPolygonOffset(2.0f, 4.0f);
+	// push casters away from the light: towards 0 with reversed-Z
+	const float offsetSign = this->m_reversedZ ? -1.0f : 1.0f;
+	glPolygonOffset(2.0f * offsetSign, 4.0f * offsetSign);
 
 	this->m_shadowProgram->useProgram();
 
-	for (int layer = 0; layer < 3; ++layer) {
-		glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, this->m_shadowTexArray, 0, layer);
+	const bool cached = this->shadowCacheActive() && this->m_shadowStaticTexArray != 0;
+	for (int layer = 0; layer < this->m_numShadowCascades; ++layer) {
+		// Common shadow state: this cascade's light view-projection (ShadowBlock)
+		glUniform1i(22, layer);
 		glViewport(0, 0, this->m_shadowMapSize, this->m_shadowMapSize);
-		glClearDepth(1.0);
-		glClear(GL_DEPTH_BUFFER_BIT);
+		glClearDepth(this->farDepth());
 
-		// Common shadow uniforms
-		glUniformMatrix4fv(20, 1, GL_FALSE, glm::value_ptr(this->m_shadowLightVP[layer])); // lightVP
-
-		// Dynamic objects: airplane + magic stone (skip pure-color debug objects)
-		glUniform1i(21, 0); // useInstancing = 0
-		for (DynamicSceneObject* obj : this->m_dynamicSOs) {
-			if (!obj) continue;
-			if (obj->pixelFunctionId() != SceneManager::Instance()->m_fs_texturePass) continue;
-			glBindVertexArray(obj->vao());
-			glUniformMatrix4fv(0, 1, GL_FALSE, glm::value_ptr(obj->modelMat()));
-			glDrawElements(obj->primitive(), obj->indexCount(), GL_UNSIGNED_INT, nullptr);
+		if (cached) {
+			ShadowCascadeCache& cache = this->m_shadowCache[layer];
+			if (cache.dirty) {
+				GpuScope scope("Static casters");
+				glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, this->m_shadowStaticTexArray, 0, layer);
+				glClear(GL_DEPTH_BUFFER_BIT);
+				this->drawShadowStaticCasters(true);
+				cache.dirty = false;
+			}
+			// dynamic objects on top of a copy of the static layer
+			glCopyImageSubData(this->m_shadowStaticTexArray, GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer,
+				this->m_shadowTexArray, GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, this->m_shadowMapSize, this->m_shadowMapSize, 1);
+			glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, this->m_shadowTexArray, 0, layer);
+			this->drawShadowDynamicCasters();
+			continue;
 		}
 
-		// Instance batches: airplane/stone are not here; cast for buildings + bush01/bush05.
-		glUniform1i(21, 1); // useInstancing = 1 (uses VisibleBuffer indices)
-		for (auto& batch : this->m_instanceBatches) {
-			if (batch.numInstances == 0) continue;
-			const bool castShadow =
-				(batch.name == "bush01") || (batch.name == "bush05") ||
-				(batch.name == "buildingV1") || (batch.name == "buildingV2");
-			if (!castShadow) continue;
-			glBindVertexArray(batch.vao);
-			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, batch.instanceBuffer);
-			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, batch.visibleIndexBuffer);
-			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, batch.indirectBuffer);
-			glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, 0);
-		}
+		glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, this->m_shadowTexArray, 0, layer);
+		glClear(GL_DEPTH_BUFFER_BIT);
+		this->drawShadowDynamicCasters();
+		this->drawShadowStaticCasters(false);
+		this->drawShadowImpostors(layer);
+	}
+
+	if (this->m_shadowMomentsEnabled && this->m_shadowMomentTexArray != 0 && this->m_shadowMomentBlurProgram != nullptr) {
+		GpuScope scope("Shadow prefilter");
+		this->blurShadowMoments();
 	}
 
 	glDisable(GL_POLYGON_OFFSET_FILL);
-	glBindVertexArray(0);
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glState->bindVertexArray(0);
+	glState->bindFramebuffer(GL_FRAMEBUFFER, this->m_outputFBO);
 
 	// Restore viewport for subsequent passes.
 	glViewport(this->m_curViewportX, this->m_curViewportY, this->m_curViewportW, this->m_curViewportH);
 }
+
+void SceneRenderer::blurShadowMoments() {
+	const int size = std::max(this->m_shadowMapSize / this->m_shadowMomentDownsample, 1);
+	const GLuint groups = (GLuint)((size + 7) / 8);
+
+	GLStateCache* glState = GLStateCache::Instance();
+	this->m_shadowMomentBlurProgram->useProgram();
+	// the blur reads raw depths
+	glTextureParameteri(this->m_shadowTexArray, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+	glState->bindTexture(1, this->m_shadowTexArray);
+	glState->bindTexture(2, this->m_shadowMomentTempTex);
+	glUniform1i(this->m_momentBlurDownsampleHandle, this->m_shadowMomentDownsample);
+	glUniform1i(this->m_momentBlurRadiusHandle, this->m_shadowBlurRadius);
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+	for (int layer = 0; layer < this->m_numShadowCascades; ++layer) {
+		glUniform1i(this->m_momentBlurLayerHandle, layer);
+
+		glUniform1i(this->m_momentBlurPassHandle, 0);
+		glBindImageTexture(0, this->m_shadowMomentTempTex, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+		glState->dispatchCompute(groups, groups, 1);
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+		glUniform1i(this->m_momentBlurPassHandle, 1);
+		glBindImageTexture(0, this->m_shadowMomentTexArray, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+		glState->dispatchCompute(groups, groups, 1);
+		// the next layer's horizontal pass overwrites the temporary image
+		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+	}
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+	glGenerateTextureMipmap(this->m_shadowMomentTexArray);
+	glTextureParameteri(this->m_shadowTexArray, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+}
+
+void SceneRenderer::drawShadowDynamicCasters() {
+	// Dynamic objects: airplane + magic stone (skip pure-color debug objects)
+	GLStateCache* glState = GLStateCache::Instance();
+	glUniform1i(21, 0); // useInstancing = 0
+	for (DynamicSceneObject* obj : this->m_dynamicSOs) {
+		if (!obj) continue;
+		if (obj->pixelFunctionId() != SceneManager::Instance()->m_fs_texturePass) continue;
+		glState->bindVertexArray(obj->vao());
+		glUniformMatrix4fv(0, 1, GL_FALSE, glm::value_ptr(obj->modelMat()));
+		glState->drawElements(obj->primitive(), obj->indexCount(), GL_UNSIGNED_INT, nullptr);
+	}
+}
+
+void SceneRenderer::drawShadowStaticCasters(const bool allInstances) {
+	// Instance batches: airplane/stone are not here; batches with castShadow (buildings + bush01/bush05 by default).
+	// allInstances (cache): not limited to what the player sees, culled against the cascade in the vertex shader
+	GLStateCache* glState = GLStateCache::Instance();
+	glUniform1i(21, allInstances ? 2 : 1); // useInstancing = 1 uses VisibleBuffer indices
+	for (auto& batch : this->m_instanceBatches) {
+		if (batch.numInstances == 0 || !batch.castShadow) continue;
+		glState->bindVertexArray(batch.vao);
+		glState->bindStorageBuffer(0, batch.instanceBuffer);
+		if (allInstances) {
+			glState->drawElementsInstanced(GL_TRIANGLES, batch.indexCount, GL_UNSIGNED_INT, nullptr, (GLsizei)batch.numInstances);
+		}
+		else {
+			glState->bindStorageBuffer(1, batch.visibleIndexBuffer);
+			glState->bindDrawIndirectBuffer(batch.indirectBuffer);
+			glState->drawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, 0);
+		}
+	}
+}
+
+// impostor lists of the player view's cull, seen from the light (the cache draws every instance as a mesh)
+void SceneRenderer::drawShadowImpostors(const int cascade) {
+	bool any = false;
+	for (const auto& batch : this->m_instanceBatches) {
+		if (batch.castShadow && this->impostorsActive(batch)) { any = true; break; }
+	}
+	if (!any) return;
+	GLStateCache* glState = GLStateCache::Instance();
+	this->m_impostorProgram->useProgram();
+	glState->bindVertexArray(this->m_impostorVAO);
+	for (const auto& batch : this->m_instanceBatches) {
+		if (batch.castShadow && this->impostorsActive(batch)) {
+			this->drawImpostors(batch, cascade);
+		}
+	}
+	this->m_shadowProgram->useProgram();
+}
+
+// the batch's impostor list; the impostor program and VAO are bound
+void SceneRenderer::drawImpostors(const InstanceBatch& batch, const int shadowCascade) {
+	const ImpostorAtlasTextures& atlas = this->m_impostorAtlases[batch.impostorAtlas];
+	GLStateCache* glState = GLStateCache::Instance();
+	glState->bindStorageBuffer(0, batch.instanceBuffer);
+	glState->bindStorageBuffer(9, batch.impostorBuffer);
+	glState->bindTexture(0, atlas.albedo);
+	glState->bindTexture(1, atlas.normalDepth);
+	glUniform1i(this->m_impostorMaterialIndexHandle, batch.materialIndex);
+	glUniform4fv(this->m_impostorBoundsHandle, 1, glm::value_ptr(atlas.bounds));
+	glUniform1i(this->m_impostorFramesHandle, atlas.frames);
+	glUniform1i(this->m_impostorShadowCascadeHandle, shadowCascade);
+	glState->bindDrawIndirectBuffer(batch.impostorBuffer);
+	glState->drawArraysIndirect(GL_TRIANGLES, nullptr);
+}
+
+// atlases are shared by batches of the same mesh, texture and atlas file; -1 when the file can't be
+// loaded and the bake fails
+int SceneRenderer::loadImpostorAtlas(const InstanceBatchDesc& desc, const float* vertices, const int numVertices, const unsigned int* indices, const int numIndices, const GLuint texture) {
+	const std::string key = desc.objPath + "|" + desc.texPath + "|" + desc.impostorPath;
+	for (size_t i = 0; i < this->m_impostorAtlases.size(); ++i) {
+		if (this->m_impostorAtlases[i].key == key) return (int)i;
+	}
+	ImpostorAtlas atlas;
+	bool loaded = false;
+	if (!desc.impostorPath.empty()) {
+		std::string error;
+		loaded = ImpostorAtlas::fromFile(desc.impostorPath, atlas, error);
+		if (!loaded) {
+			std::cerr << error << "\n";
+		}
+	}
+	if (!loaded && !bakeImpostorAtlas(vertices, numVertices, indices, numIndices, texture, IMPOSTOR_FRAMES, IMPOSTOR_FRAME_SIZE, atlas)) {
+		std::cerr << "instance batch " << desc.name << ": impostor bake failed, drawn as meshes\n";
+		return -1;
+	}
+
+	ImpostorAtlasTextures textures;
+	textures.key = key;
+	textures.bounds = glm::vec4(atlas.center, atlas.radius);
+	textures.frames = atlas.frames;
+	// mips stop at 4 texels per frame, before neighbouring frames blend together
+	int levels = 1;
+	while ((atlas.frameSize >> levels) >= 4) levels++;
+	const int size = atlas.size();
+	GLuint* targets[2] = { &textures.albedo, &textures.normalDepth };
+	const std::vector<uint8_t>* pixels[2] = { &atlas.albedo, &atlas.normalDepth };
+	for (int k = 0; k < 2; ++k) {
+		glCreateTextures(GL_TEXTURE_2D, 1, targets[k]);
+		glTextureStorage2D(*targets[k], levels, GL_RGBA8, size, size);
+		glTextureSubImage2D(*targets[k], 0, 0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, pixels[k]->data());
+		glGenerateTextureMipmap(*targets[k]);
+		glTextureParameteri(*targets[k], GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTextureParameteri(*targets[k], GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTextureParameteri(*targets[k], GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(*targets[k], GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+	this->m_impostorAtlases.push_back(textures);
+	return (int)this->m_impostorAtlases.size() - 1;
+}
 
 GLuint SceneRenderer::loadTexture(const std::string& path) {
 	int w=0,h=0,ch=0;
@@ -467,10 +1019,10 @@ GLuint SceneRenderer::loadTexture(const std::string& path) {
 	return tex;
 }
 
-void SceneRenderer::setUpInstanceBatches() {
+void SceneRenderer::setUpInstanceBatches(const std::vector<InstanceBatchDesc>& batches) {
 	// build compute shader for culling
 	Shader* cs = new Shader(GL_COMPUTE_SHADER);
-	cs->createShaderFromFile("shaders\\cullInstances.comp");
+	cs->createShaderFromFile("shaders/cullInstances.comp");
 	this->m_cullProgram = new ShaderProgram();
 	this->m_cullProgram->init();
 	this->m_cullProgram->attachShader(cs);
@@ -478,195 +1030,528 @@ void SceneRenderer::setUpInstanceBatches() {
 	this->m_cullProgram->linkProgram();
 	cs->releaseShader();
 	delete cs;
-	this->m_cullProgram->useProgram();
-	this->m_cullNumInstancesHandle = 0;
-	this->m_cullFrustumHandle = 1;
-
-	auto createBatch = [&](const std::string& name,
-		const std::string& objPath,
-		const std::string& texPath,
-		const std::string& samplePath,
-		const glm::vec3& sphereCenterOS,
-		float sphereRadiusOS,
-		const glm::vec3& ambient,
-		const glm::vec3& specular,
-		float shininess,
-		bool useOcclusion,
-		bool isOccluder) {
-			InstanceBatch batch;
-			batch.name = name;
-			batch.materialAmbient = ambient;
-			batch.materialSpecular = specular;
-			batch.materialShininess = shininess;
-			batch.useOcclusion = useOcclusion;
-			batch.isOccluder = isOccluder;
-
-			Assimp::Importer importer;
-			const aiScene* scene = importer.ReadFile(objPath,
-				aiProcess_Triangulate |
-				aiProcess_JoinIdenticalVertices |
-				aiProcess_GenSmoothNormals |
-				aiProcess_CalcTangentSpace);
-			if(!scene || scene->mNumMeshes==0){ return; }
-			const aiMesh* mesh = scene->mMeshes[0];
-			bool hasUV = mesh->HasTextureCoords(0);
-			int numVertices = (int)mesh->mNumVertices;
-			int numIndices = (int)mesh->mNumFaces * 3;
-			std::vector<float> vertices(numVertices * 11);
-			for(unsigned int i=0;i<mesh->mNumVertices;i++){
-				const aiVector3D& v = mesh->mVertices[i];
-				const aiVector3D uv = hasUV ? mesh->mTextureCoords[0][i] : aiVector3D(0,0,0);
-				vertices[i*11+0]=v.x; vertices[i*11+1]=v.y; vertices[i*11+2]=v.z;
-				vertices[i*11+3]=mesh->mNormals[i].x; vertices[i*11+4]=mesh->mNormals[i].y; vertices[i*11+5]=mesh->mNormals[i].z;
-				vertices[i*11+6]=mesh->mTangents ? mesh->mTangents[i].x : 0.0f;
-				vertices[i*11+7]=mesh->mTangents ? mesh->mTangents[i].y : 0.0f;
-				vertices[i*11+8]=mesh->mTangents ? mesh->mTangents[i].z : 0.0f;
-				vertices[i*11+9]=uv.x; vertices[i*11+10]=uv.y;
-			}
-			std::vector<unsigned int> indices(numIndices);
-			for(unsigned int f=0; f<mesh->mNumFaces; f++){
-				const aiFace& face = mesh->mFaces[f];
-				indices[f*3+0]=face.mIndices[0];
-				indices[f*3+1]=face.mIndices[1];
-				indices[f*3+2]=face.mIndices[2];
-			}
-			glGenVertexArrays(1,&batch.vao);
-			glGenBuffers(1,&batch.vbo);
-			glGenBuffers(1,&batch.ebo);
-			glBindVertexArray(batch.vao);
-			glBindBuffer(GL_ARRAY_BUFFER,batch.vbo);
-			glBufferData(GL_ARRAY_BUFFER, vertices.size()*sizeof(float), vertices.data(), GL_STATIC_DRAW);
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,batch.ebo);
-			glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size()*sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
-			int stride = 11*sizeof(float);
-			glVertexAttribPointer(SceneManager::Instance()->m_vertexHandle,3,GL_FLOAT,GL_FALSE,stride,(void*)0);
-			glEnableVertexAttribArray(SceneManager::Instance()->m_vertexHandle);
-			glVertexAttribPointer(SceneManager::Instance()->m_normalHandle,3,GL_FLOAT,GL_FALSE,stride,(void*)(3*sizeof(float)));
-			glEnableVertexAttribArray(SceneManager::Instance()->m_normalHandle);
-			glVertexAttribPointer(SceneManager::Instance()->m_tangentHandle,3,GL_FLOAT,GL_FALSE,stride,(void*)(6*sizeof(float)));
-			glEnableVertexAttribArray(SceneManager::Instance()->m_tangentHandle);
-			glVertexAttribPointer(SceneManager::Instance()->m_uvHandle,2,GL_FLOAT,GL_FALSE,stride,(void*)(9*sizeof(float)));
-			glEnableVertexAttribArray(SceneManager::Instance()->m_uvHandle);
-			glBindVertexArray(0);
-			batch.indexCount = numIndices;
-			if(!texPath.empty()){
-				batch.texture = loadTexture(texPath);
-			}
+	// culling parameters come from FrameBlock + CullBlock
+	this->setUpDepthBinShaders();
+	this->setUpClusterCullShaders();
 
-			MyPoissonSample* sample = MyPoissonSample::fromFile(samplePath);
-			batch.numInstances = sample->m_numSample;
-
-			std::vector<InstanceDataGPU> instanceData(batch.numInstances);
-			for(uint32_t i = 0; i < batch.numInstances; ++i){
-				glm::vec3 pos(
-					sample->m_positions[i*3+0],
-					sample->m_positions[i*3+1],
-					sample->m_positions[i*3+2]);
-				glm::vec3 rad(
-					sample->m_radians[i*3+0],
-					sample->m_radians[i*3+1],
-					sample->m_radians[i*3+2]);
-				glm::quat q = glm::quat(rad);
-				glm::mat4 model = glm::translate(glm::mat4(1.0f), pos) * glm::toMat4(q);
-				instanceData[i].model = model;
-				glm::vec3 worldCenter = glm::vec3(model * glm::vec4(sphereCenterOS,1.0f));
-				instanceData[i].sphere = glm::vec4(worldCenter, sphereRadiusOS);
-			}
-			glCreateBuffers(1,&batch.instanceBuffer);
-			glNamedBufferData(batch.instanceBuffer, instanceData.size()*sizeof(InstanceDataGPU), instanceData.data(), GL_STATIC_DRAW);
+	for (const InstanceBatchDesc& desc : batches) {
+		this->appendInstanceBatch(desc);
+	}
 
-			glCreateBuffers(1,&batch.visibleIndexBuffer);
-			size_t visSize = (size_t)(batch.numInstances + 1) * sizeof(uint32_t);
-			glNamedBufferData(batch.visibleIndexBuffer, visSize, nullptr, GL_DYNAMIC_DRAW);
+	std::vector<std::string> names;
+	std::vector<unsigned int> numInstances;
+	for (const InstanceBatch& batch : this->m_instanceBatches) {
+		names.push_back(batch.name);
+		numInstances.push_back(batch.numInstances);
+	}
+	if (!names.empty()) {
+		glCreateBuffers(1, &this->m_cullStatsBuffer);
+		glNamedBufferData(this->m_cullStatsBuffer, (GLsizeiptr)names.size() * CULL_STATS_STRIDE * sizeof(uint32_t), nullptr, GL_DYNAMIC_COPY);
+		this->m_cullStats.init(names, numInstances);
+	}
+}
 
-			struct DrawCmd { uint32_t count, instanceCount, firstIndex, baseVertex, baseInstance; };
-			DrawCmd cmd = { (uint32_t)batch.indexCount, 0u, 0u, 0u, 0u };
-			glCreateBuffers(1,&batch.indirectBuffer);
-			glNamedBufferData(batch.indirectBuffer, sizeof(DrawCmd), &cmd, GL_DYNAMIC_DRAW);
+void SceneRenderer::appendInstanceBatch(const InstanceBatchDesc& desc) {
+	MyPoissonSample* sample = MyPoissonSample::fromFile(desc.samplePath);
+	if (sample == nullptr) {
+		std::cerr << "instance batch " << desc.name << ": cannot load " << desc.samplePath << "\n";
+		return;
+	}
 
+	InstanceBatch batch;
+	batch.name = desc.name;
+	batch.materialAmbient = desc.ambient;
+	batch.materialSpecular = desc.specular;
+	batch.materialShininess = desc.shininess;
+	batch.materialIndex = -1;
+	// generated scenes can have many batches of the same model: share their material entry
+	for (const InstanceBatch& other : this->m_instanceBatches) {
+		if (other.materialAmbient == desc.ambient && other.materialSpecular == desc.specular && other.materialShininess == desc.shininess) {
+			batch.materialIndex = other.materialIndex;
+			break;
+		}
+	}
+	if (batch.materialIndex < 0) {
+		MaterialDataGPU material;
+		material.ambient = glm::vec4(desc.ambient, 1.0f);
+		material.specularShininess = glm::vec4(desc.specular, desc.shininess);
+		material.flags = glm::ivec4(SceneManager::Instance()->m_fs_texturePass, SceneManager::Instance()->m_vs_instanceProcess, 0, 0);
+		batch.materialIndex = this->registerMaterial(material);
+		if (batch.materialIndex < 0) {
+			std::cerr << "instance batch " << desc.name << ": no material table entry left\n";
 			delete sample;
-			this->m_instanceBatches.push_back(batch);
+			return;
+		}
+	}
+	batch.useOcclusion = desc.useOcclusion;
+	batch.isOccluder = desc.isOccluder;
+	batch.castShadow = desc.castShadow;
+	const PotentiallyVisibleSet::Batch* pvsBatch = this->m_pvsLoaded ? this->m_pvs.batch(desc.name) : nullptr;
+	bool pvsRanges = false;
+	if (pvsBatch != nullptr) {
+		// same order as CG2025_pvsbake: every cluster is a contiguous range of instances
+		sortSamplesByCluster(*sample, this->m_pvs.clusterSize, batch.clusters);
+		bool match = pvsBatch->numInstances == sample->m_numSample && pvsBatch->clusterCells.size() == batch.clusters.size();
+		for (size_t c = 0; match && c < batch.clusters.size(); ++c) {
+			match = batch.clusters[c].cell == pvsBatch->clusterCells[c];
+		}
+		if (match) {
+			batch.pvsFirstCluster = pvsBatch->firstCluster;
+			pvsRanges = true;
+		}
+		else {
+			std::cerr << "instance batch " << desc.name << ": instances differ from the PVS bake, not pruned\n";
+			batch.clusters.clear();
+		}
+	}
+
+	Assimp::Importer importer;
+	const aiScene* scene = importer.ReadFile(desc.objPath,
+		aiProcess_Triangulate |
+		aiProcess_JoinIdenticalVertices |
+		aiProcess_GenSmoothNormals |
+		aiProcess_CalcTangentSpace);
+	if(!scene || scene->mNumMeshes==0){
+		std::cerr << "instance batch " << desc.name << ": cannot load " << desc.objPath << "\n";
+		delete sample;
+		return;
+	}
+	if (pvsRanges) {
+		glCreateBuffers(1, &batch.pvsRangeBuffer);
+		glNamedBufferData(batch.pvsRangeBuffer, (GLsizeiptr)std::max<size_t>(batch.clusters.size(), 1) * 2 * sizeof(uint32_t), nullptr, GL_DYNAMIC_DRAW);
+	}
+	const aiMesh* mesh = scene->mMeshes[0];
+	int numVertices = (int)mesh->mNumVertices;
+	int numIndices = (int)mesh->mNumFaces * 3;
+	std::vector<float> vertices(numVertices * INTERLEAVED_VERTEX_FLOATS);
+	std::vector<unsigned int> indices(numIndices);
+	interleaveAiMesh(mesh, vertices.data(), indices.data());
+	std::vector<MeshCluster> clusters;
+	if (desc.clusterTriangles > 0 && desc.isOccluder) {
+		// triangles in cluster order; the whole-instance draws (shadows, clusters off) share the index buffer
+		buildMeshClusters(vertices.data(), numVertices, INTERLEAVED_VERTEX_FLOATS, indices.data(), numIndices, desc.clusterTriangles, clusters);
+	}
+	glGenVertexArrays(1,&batch.vao);
+	glGenBuffers(1,&batch.vbo);
+	glGenBuffers(1,&batch.ebo);
+	glBindVertexArray(batch.vao);
+	glBindBuffer(GL_ARRAY_BUFFER,batch.vbo);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size()*sizeof(float), vertices.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,batch.ebo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size()*sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+	int stride = 11*sizeof(float);
+	glVertexAttribPointer(SceneManager::Instance()->m_vertexHandle,3,GL_FLOAT,GL_FALSE,stride,(void*)0);
+	glEnableVertexAttribArray(SceneManager::Instance()->m_vertexHandle);
+	glVertexAttribPointer(SceneManager::Instance()->m_normalHandle,3,GL_FLOAT,GL_FALSE,stride,(void*)(3*sizeof(float)));
+	glEnableVertexAttribArray(SceneManager::Instance()->m_normalHandle);
+	glVertexAttribPointer(SceneManager::Instance()->m_tangentHandle,3,GL_FLOAT,GL_FALSE,stride,(void*)(6*sizeof(float)));
+	glEnableVertexAttribArray(SceneManager::Instance()->m_tangentHandle);
+	glVertexAttribPointer(SceneManager::Instance()->m_uvHandle,2,GL_FLOAT,GL_FALSE,stride,(void*)(9*sizeof(float)));
+	glEnableVertexAttribArray(SceneManager::Instance()->m_uvHandle);
+	glBindVertexArray(0);
+	batch.indexCount = numIndices;
+	if(!desc.texPath.empty()){
+		batch.texture = loadTexture(desc.texPath);
+	}
+
+	batch.numInstances = sample->m_numSample;
+
+	// built and uploaded in blocks: a full copy of tens of millions of instances would not fit in memory
+	const int UPLOAD_BLOCK = 1 << 18;
+	glCreateBuffers(1,&batch.instanceBuffer);
+	glNamedBufferData(batch.instanceBuffer, (GLsizeiptr)batch.numInstances*sizeof(InstanceDataGPU), nullptr, GL_STATIC_DRAW);
+	std::vector<InstanceDataGPU> instanceData(std::min((int)batch.numInstances, UPLOAD_BLOCK));
+	for (int first = 0; first < (int)batch.numInstances; first += UPLOAD_BLOCK) {
+		const int count = std::min(UPLOAD_BLOCK, (int)batch.numInstances - first);
+		buildInstanceData(*sample, desc.sphereCenterOS, desc.sphereRadiusOS, instanceData.data(), first, count);
+		glNamedBufferSubData(batch.instanceBuffer, (GLintptr)first*sizeof(InstanceDataGPU), (GLsizeiptr)count*sizeof(InstanceDataGPU), instanceData.data());
+	}
+	if (batch.isOccluder) {
+		// occluder batches are small (buildings): keep what the software occlusion buffer rasterizes,
+		// boxes inside the mesh or (no budget) the mesh itself
+		if (desc.occluderTriangles > 0) {
+			buildOccluderProxy(vertices.data(), numVertices, INTERLEAVED_VERTEX_FLOATS, indices.data(), numIndices,
+				OCCLUDER_PROXY_RESOLUTION, desc.occluderTriangles, batch.occluderVertices, batch.occluderIndices);
+		}
+		else {
+			batch.occluderVertices.resize((size_t)numVertices * 3);
+			for (int v = 0; v < numVertices; ++v) {
+				for (int k = 0; k < 3; ++k) batch.occluderVertices[(size_t)v * 3 + k] = vertices[(size_t)v * INTERLEAVED_VERTEX_FLOATS + k];
+			}
+			batch.occluderIndices.assign(indices.begin(), indices.end());
+		}
+		batch.occluderInstances.resize(batch.numInstances);
+		buildInstanceData(*sample, desc.sphereCenterOS, desc.sphereRadiusOS, batch.occluderInstances.data());
+	}
+
+	glCreateBuffers(1,&batch.visibleIndexBuffer);
+	size_t visSize = (size_t)(batch.numInstances + 1) * sizeof(uint32_t);
+	glNamedBufferData(batch.visibleIndexBuffer, visSize, nullptr, GL_DYNAMIC_DRAW);
+
+	struct DrawCmd { uint32_t count, instanceCount, firstIndex, baseVertex, baseInstance; };
+	DrawCmd cmd = { (uint32_t)batch.indexCount, 0u, 0u, 0u, 0u };
+	glCreateBuffers(1,&batch.indirectBuffer);
+	glNamedBufferData(batch.indirectBuffer, sizeof(DrawCmd), &cmd, GL_DYNAMIC_DRAW);
+
+	if (desc.impostorDistance > 0.0f) {
+		batch.impostorAtlas = this->loadImpostorAtlas(desc, vertices.data(), numVertices, indices.data(), numIndices, batch.texture);
+	}
+	if (batch.impostorAtlas >= 0) {
+		batch.impostorDistance = desc.impostorDistance;
+		// vertex count, instance count, first vertex, base instance; then the instance indices
+		const uint32_t impostorCmd[4] = { 6u, 0u, 0u, 0u };
+		glCreateBuffers(1, &batch.impostorBuffer);
+		glNamedBufferData(batch.impostorBuffer, (GLsizeiptr)(4 + batch.numInstances) * sizeof(uint32_t), nullptr, GL_DYNAMIC_DRAW);
+		glNamedBufferSubData(batch.impostorBuffer, 0, sizeof(impostorCmd), impostorCmd);
+	}
+
+	if (!clusters.empty()) {
+		// compacted indices encode (instance << vertexBits) | vertex and need room for every triangle
+		const int vertexBits = clusterVertexBits(numVertices);
+		const size_t maxClusterIndices = (size_t)batch.numInstances * (size_t)numIndices;
+		if (((uint64_t)batch.numInstances << vertexBits) > (uint64_t(1) << 32) || maxClusterIndices > MAX_CLUSTER_INDICES) {
+			std::cerr << "instance batch " << desc.name << ": too many instances for cluster culling, drawn whole\n";
+			clusters.clear();
+		}
+		else {
+			this->setUpBatchClusters(batch, clusters, vertexBits, maxClusterIndices);
+		}
+	}
+
+	delete sample;
+	this->m_instanceBatches.push_back(batch);
+}
+
+void SceneRenderer::setUpBatchClusters(InstanceBatch& batch, const std::vector<MeshCluster>& clusters, const int vertexBits, const size_t maxClusterIndices) {
+	std::vector<ClusterDataGPU> clusterData(clusters.size());
+	for (size_t c = 0; c < clusters.size(); ++c) {
+		clusterData[c].sphere = glm::vec4(clusters[c].center, clusters[c].radius);
+		clusterData[c].cone = glm::vec4(clusters[c].coneAxis, clusters[c].coneCutoff);
+		clusterData[c].range = glm::uvec4(clusters[c].firstIndex, clusters[c].numTriangles, 0u, 0u);
+	}
+	glCreateBuffers(1, &batch.clusterBuffer);
+	glNamedBufferData(batch.clusterBuffer, (GLsizeiptr)(clusterData.size() * sizeof(ClusterDataGPU)), clusterData.data(), GL_STATIC_DRAW);
+
+	// nothing drawn until the first cull
+	ClusterDrawGPU draw;
+	draw.count = 0;
+	draw.instanceCount = 1;
+	draw.firstIndex = 0;
+	draw.baseVertex = 0;
+	draw.baseInstance = 0;
+	draw.pad[0] = draw.pad[1] = draw.pad[2] = 0;
+	draw.dispatch = glm::uvec4(0u, 1u, 1u, 0u);
+	draw.stats = glm::uvec4(0u);
+	glCreateBuffers(1, &batch.clusterDrawBuffer);
+	glNamedBufferData(batch.clusterDrawBuffer, sizeof(ClusterDrawGPU), &draw, GL_DYNAMIC_DRAW);
+
+	glCreateBuffers(1, &batch.clusterIndexBuffer);
+	glNamedBufferData(batch.clusterIndexBuffer, (GLsizeiptr)(std::max<size_t>(maxClusterIndices, 1) * sizeof(uint32_t)), nullptr, GL_DYNAMIC_DRAW);
+	glCreateVertexArrays(1, &batch.clusterVAO);
+	glVertexArrayElementBuffer(batch.clusterVAO, batch.clusterIndexBuffer);
+
+	batch.numClusters = (uint32_t)clusters.size();
+	batch.clusterVertexBits = vertexBits;
+	for (const InstanceBatch& other : this->m_instanceBatches) {
+		if (other.clusterMaterialIndex >= 0 && other.materialIndex == batch.materialIndex) {
+			batch.clusterMaterialIndex = other.clusterMaterialIndex;
+			break;
+		}
+	}
+	if (batch.clusterMaterialIndex < 0) {
+		// the batch's material, vertices fetched by clusterProcess()
+		MaterialDataGPU material;
+		material.ambient = glm::vec4(batch.materialAmbient, 1.0f);
+		material.specularShininess = glm::vec4(batch.materialSpecular, batch.materialShininess);
+		material.flags = glm::ivec4(SceneManager::Instance()->m_fs_texturePass, SceneManager::Instance()->m_vs_clusterProcess, 0, 0);
+		batch.clusterMaterialIndex = this->registerMaterial(material);
+	}
+}
+
+bool SceneRenderer::setUpClusterCullShaders() {
+	auto build = [](const char* path) {
+		Shader* cs = new Shader(GL_COMPUTE_SHADER);
+		cs->createShaderFromFile(path);
+		ShaderProgram* program = new ShaderProgram();
+		program->init();
+		program->attachShader(cs);
+		program->checkStatus();
+		program->linkProgram();
+		cs->releaseShader();
+		delete cs;
+		return program;
+	};
+	this->m_clusterCullArgsProgram = build("shaders/clusterCullArgs.comp");
+	this->m_clusterCullProgram = build("shaders/clusterCull.comp");
+	return true;
+}
+
+bool SceneRenderer::setUpDepthBinShaders() {
+	auto build = [](const char* path) {
+		Shader* cs = new Shader(GL_COMPUTE_SHADER);
+		cs->createShaderFromFile(path);
+		ShaderProgram* program = new ShaderProgram();
+		program->init();
+		program->attachShader(cs);
+		program->checkStatus();
+		program->linkProgram();
+		cs->releaseShader();
+		delete cs;
+		return program;
 	};
+	this->m_depthBinScanProgram = build("shaders/depthBinScan.comp");
+	this->m_depthBinScatterProgram = build("shaders/depthBinScatter.comp");
+	return true;
+}
+
+void SceneRenderer::ensureDepthBinBuffers(InstanceBatch& batch) {
+	if (batch.depthBinBuffer != 0) return;
+	glCreateBuffers(1, &batch.depthBinEntryBuffer);
+	glNamedBufferData(batch.depthBinEntryBuffer, (GLsizeiptr)std::max(1u, batch.numInstances) * 2 * sizeof(uint32_t), nullptr, GL_DYNAMIC_DRAW);
+	glCreateBuffers(1, &batch.depthBinBuffer);
+	glNamedBufferData(batch.depthBinBuffer, DEPTH_BIN_DISPATCH_OFFSET + 4 * sizeof(uint32_t), nullptr, GL_DYNAMIC_DRAW);
+}
+
+// visible lists of this pass in near-to-far bin order: scan the bin counts of every batch, then
+// scatter each batch's (instance, bin) entries with the dispatch size the scan wrote
+void SceneRenderer::sortVisibleByDepth(const bool foliageOnly) {
+	GpuScope scope("Depth bin sort");
+	GLStateCache* glState = GLStateCache::Instance();
+	this->m_depthBinScanProgram->useProgram();
+	for (auto& batch : this->m_instanceBatches) {
+		if (batch.isOccluder == foliageOnly || batch.numInstances == 0) continue;
+		glState->bindStorageBuffer(1, batch.visibleIndexBuffer);
+		glState->bindStorageBuffer(4, batch.depthBinBuffer);
+		glState->dispatchCompute(1, 1, 1);
+	}
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+	this->m_depthBinScatterProgram->useProgram();
+	for (auto& batch : this->m_instanceBatches) {
+		if (batch.isOccluder == foliageOnly || batch.numInstances == 0) continue;
+		glState->bindStorageBuffer(1, batch.visibleIndexBuffer);
+		glState->bindStorageBuffer(3, batch.depthBinEntryBuffer);
+		glState->bindStorageBuffer(4, batch.depthBinBuffer);
+		glState->bindDispatchIndirectBuffer(batch.depthBinBuffer);
+		glState->dispatchComputeIndirect(DEPTH_BIN_DISPATCH_OFFSET);
+	}
+}
 
-	createBatch("grassB",
-		"assets\\outdoor\\grassB.obj",
-		"assets\\outdoor\\grassB_albedo.png",
-		"assets\\outdoor\\poissonPoints_621043_after.ppd2",
-		glm::vec3(0.0f,0.66f,0.0f), 1.4f,
-		glm::vec3(1.0f), glm::vec3(0.0f), 1.0f,
-		true, false);
-
-	createBatch("bush01",
-		"assets\\outdoor\\bush01_lod2.obj",
-		"assets\\outdoor\\bush01.png",
-		"assets\\outdoor\\poissonPoints_1010.ppd2",
-		glm::vec3(0.0f,2.55f,0.0f), 3.4f,
-		glm::vec3(1.0f), glm::vec3(0.0f), 1.0f,
-		true, false);
-
-	createBatch("bush05",
-		"assets\\outdoor\\bush05_lod2.obj",
-		"assets\\outdoor\\bush05.png",
-		"assets\\outdoor\\poissonPoints_2797.ppd2",
-		glm::vec3(0.0f,1.76f,0.0f), 2.6f,
-		glm::vec3(1.0f), glm::vec3(0.0f), 1.0f,
-		true, false);
-
-	createBatch("buildingV2",
-		"assets\\outdoor\\Medieval_Building_LowPoly\\medieval_building_lowpoly_2.obj",
-		"assets\\outdoor\\Medieval_Building_LowPoly\\Medieval_Building_LowPoly_V2_Albedo_small.png",
-		"assets\\outdoor\\cityLots_sub_0.ppd2",
-		glm::vec3(0.0f,4.57f,0.0f), 8.5f,
-		glm::vec3(1.0f), glm::vec3(0.0f), 1.0f,
-		false, true);
-
-	createBatch("buildingV1",
-		"assets\\outdoor\\Medieval_Building_LowPoly\\medieval_building_lowpoly_1.obj",
-		"assets\\outdoor\\Medieval_Building_LowPoly\\Medieval_Building_LowPoly_V1_Albedo_small.png",
-		"assets\\outdoor\\cityLots_sub_1.ppd2",
-		glm::vec3(0.0f,4.57f,0.0f), 10.2f,
-		glm::vec3(1.0f), glm::vec3(0.0f), 1.0f,
-		false, true);
+// results of the oldest slot; a slot whose queries aren't available yet is skipped this frame
+void SceneRenderer::resolveFragmentQueries() {
+	const int slot = this->m_fragmentQuerySlot;
+	if (!this->m_fragmentQueryPending[slot]) return;
+	GLuint available = 0;
+	glGetQueryObjectuiv(this->m_fragmentQueries[slot][1][0], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available) return;
+	for (int pass = 0; pass < 2; ++pass) {
+		glGetQueryObjectui64v(this->m_fragmentQueries[slot][pass][0], GL_QUERY_RESULT, &this->m_fragmentStats.samplesPassed[pass]);
+		this->m_fragmentStats.fragmentInvocations[pass] = 0;
+		if (this->m_pipelineStatisticsSupported) {
+			glGetQueryObjectui64v(this->m_fragmentQueries[slot][pass][1], GL_QUERY_RESULT, &this->m_fragmentStats.fragmentInvocations[pass]);
+		}
+	}
+	this->m_fragmentStats.valid = true;
+	this->m_fragmentQueryPending[slot] = false;
 }
 
 void SceneRenderer::dispatchCulling(InstanceBatch& batch){
 	if(batch.numInstances == 0) return;
+	char scopeName[32];
+	std::snprintf(scopeName, sizeof(scopeName), "Cull %s", batch.name.c_str());
+	GpuScope scope(scopeName);
 	// reset counters
+	GLStateCache* glState = GLStateCache::Instance();
 	uint32_t zero = 0;
 	glClearNamedBufferSubData(batch.visibleIndexBuffer, GL_R32UI, 0, sizeof(uint32_t), GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
 	glClearNamedBufferSubData(batch.indirectBuffer, GL_R32UI, sizeof(uint32_t), sizeof(uint32_t), GL_RED_INTEGER, GL_UNSIGNED_INT, &zero); // instanceCount to 0
+	glState->countUpload(2 * sizeof(uint32_t));
+	const bool impostors = this->impostorsActive(batch);
+	if (impostors) {
+		glClearNamedBufferSubData(batch.impostorBuffer, GL_R32UI, sizeof(uint32_t), sizeof(uint32_t), GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+		glState->countUpload(sizeof(uint32_t));
+	}
 
 	this->m_cullProgram->useProgram();
-	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, batch.instanceBuffer);
-	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, batch.visibleIndexBuffer);
-	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, batch.indirectBuffer);
-	glUniform1ui(this->m_cullNumInstancesHandle, batch.numInstances);
+	glState->bindStorageBuffer(0, batch.instanceBuffer);
+	glState->bindStorageBuffer(1, batch.visibleIndexBuffer);
+	glState->bindStorageBuffer(2, batch.indirectBuffer);
+	glState->bindStorageBuffer(6, this->m_cullStatsBuffer);
+	if (impostors) {
+		glState->bindStorageBuffer(9, batch.impostorBuffer);
+	}
+	if (this->m_cullOverlayEnabled) {
+		if (batch.cullReasonBuffer == 0) {
+			glCreateBuffers(1, &batch.cullReasonBuffer);
+			glNamedBufferData(batch.cullReasonBuffer, (GLsizeiptr)batch.numInstances * sizeof(uint32_t), nullptr, GL_DYNAMIC_COPY);
+			glClearNamedBufferData(batch.cullReasonBuffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+		}
+		glState->bindStorageBuffer(7, batch.cullReasonBuffer);
+	}
+	// outside the PVS: counted here, the shader never sees these instances
+	const uint32_t batchIndex = (uint32_t)(&batch - this->m_instanceBatches.data());
+	const bool pruned = this->m_pvsCell >= 0 && batch.pvsFirstCluster >= 0;
+	if (pruned) {
+		this->updatePvsRanges(batch);
+		glState->bindStorageBuffer(8, batch.pvsRangeBuffer);
+		const uint32_t numPruned = batch.numInstances - batch.numPvsInstances;
+		glNamedBufferSubData(this->m_cullStatsBuffer, (GLintptr)(batchIndex * CULL_STATS_STRIDE + CULL_PVS) * sizeof(uint32_t), sizeof(uint32_t), &numPruned);
+		if (this->m_cullOverlayEnabled) {
+			const uint32_t reason = CULL_PVS;
+			glClearNamedBufferData(batch.cullReasonBuffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &reason);
+		}
+		glState->countUpload(sizeof(uint32_t));
+	}
+	if (this->m_depthSortEnabled) {
+		this->ensureDepthBinBuffers(batch);
+		glClearNamedBufferSubData(batch.depthBinBuffer, GL_R32UI, 0, DEPTH_BIN_COUNT * sizeof(uint32_t), GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+		glState->countUpload(DEPTH_BIN_COUNT * sizeof(uint32_t));
+		glState->bindStorageBuffer(3, batch.depthBinEntryBuffer);
+		glState->bindStorageBuffer(4, batch.depthBinBuffer);
+	}
+
+	// per-batch cull parameters (cullVP / cullView are in FrameBlock)
+	CullBlockGPU block;
 	if (this->m_hasCullPlanesOverride) {
-		glUniform4fv(this->m_cullFrustumHandle, 6, glm::value_ptr(this->m_cullPlanesOverride[0]));
+		for (int i = 0; i < 6; ++i) block.frustumPlanes[i] = this->m_cullPlanesOverride[i];
 	} else {
-		extractFrustumPlanes(this->m_cullVP, this->m_frustumPlanes);
-		glUniform4fv(this->m_cullFrustumHandle, 6, glm::value_ptr(this->m_frustumPlanes[0]));
+		extractFrustumPlanes(this->m_cullVP, this->m_frustumPlanes, this->m_reversedZ);
+		for (int i = 0; i < 6; ++i) block.frustumPlanes[i] = this->m_frustumPlanes[i];
 	}
-	// occlusion uniforms
-	glUniform1i(9, (this->m_occlusionEnabled && batch.useOcclusion) ? 1 : 0);
 	int fixedLevel = (this->m_occlusionFixedLevelOverride >= 0) ? this->m_occlusionFixedLevelOverride : (int)std::ceil((float)this->m_occlusionLevels * 0.5f);
 	fixedLevel = std::clamp(fixedLevel, 0, std::max(0, this->m_occlusionLevels - 1));
-	glUniform1i(10, fixedLevel);
-	glUniformMatrix4fv(11, 1, GL_FALSE, glm::value_ptr(this->m_cullVP));
-	glUniformMatrix4fv(12, 1, GL_FALSE, glm::value_ptr(this->m_cullView));
-	glUniform1f(13, this->m_occlusionMaxViewDepth);
-	glUniform1f(14, this->m_occlusionBias);
-	glUniform2f(15, (float)this->m_frameWidth, (float)this->m_frameHeight);
+	block.cullParams = glm::vec4(this->m_occlusionMaxViewDepth, this->m_occlusionBias, (float)this->m_frameWidth, (float)this->m_frameHeight);
+	const uint32_t numThread = pruned ? batch.numPvsInstances : batch.numInstances;
+	block.cullFlags = glm::uvec4(numThread, (this->m_occlusionEnabled && batch.useOcclusion) ? 1u : 0u, (uint32_t)fixedLevel, this->m_depthSortEnabled ? 1u : 0u);
+	block.cullInfo = glm::uvec4(batchIndex, this->m_cullOverlayEnabled ? 1u : 0u, this->m_softwareOcclusionReady ? 1u : 0u, pruned ? batch.numPvsRanges : 0u);
+	block.impostorParams = glm::vec4(impostors ? batch.impostorDistance : 0.0f, 0.0f, 0.0f, 0.0f);
+	const GLintptr cullOffset = this->m_uniformRing.write(&block, sizeof(CullBlockGPU));
+	if (cullOffset < 0) {
+		// no CullBlock of this batch: the bound one belongs to another batch, draw nothing instead
+		batch.cullBlockOffset = -1;
+		return;
+	}
+	this->m_uniformRing.bindRange(UBO_CULL_BINDING, cullOffset, sizeof(CullBlockGPU));
+	batch.cullBlockOffset = cullOffset;
 	// bind depth pyramid on unit 5
 	if (this->m_depthPyramidTex != 0) {
-		glActiveTexture(GL_TEXTURE5);
-		glBindTexture(GL_TEXTURE_2D, this->m_depthPyramidTex);
+		glState->bindTexture(5, this->m_depthPyramidTex);
+	}
+	if (this->m_softwareOcclusionReady) {
+		glState->bindTexture(9, this->m_softwareOcclusionTex);
 	}
 
+	if (numThread == 0) return;
+	// more than 65535 groups (16.7M instances) are spread over rows; see cullInstances.comp
 	uint32_t groupSize = 256;
-	uint32_t numGroup = (batch.numInstances + groupSize - 1) / groupSize;
-	glDispatchCompute(numGroup, 1, 1);
-	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+	uint32_t numGroup = (numThread + groupSize - 1) / groupSize;
+	uint32_t numGroupX = std::min(numGroup, 65535u);
+	uint32_t numGroupY = (numGroup + numGroupX - 1) / numGroupX;
+	glState->dispatchCompute(numGroupX, numGroupY, 1);
+}
+
+// clusters of this pass's clustered batches: dispatch sizes from the visible counts, then one workgroup
+// per visible instance appends the indices of its clusters that pass the frustum, the normal cone and
+// the software occlusion buffer (the only depth hierarchy that exists before the occluders are drawn)
+void SceneRenderer::dispatchClusterCulling(const bool foliageOnly) {
+	auto clusteredInPass = [&](const InstanceBatch& batch) {
+		return batch.isOccluder != foliageOnly && this->clustersActive(batch);
+	};
+	if (std::none_of(this->m_instanceBatches.begin(), this->m_instanceBatches.end(), clusteredInPass)) return;
+	GpuScope scope("Cull clusters");
+	GLStateCache* glState = GLStateCache::Instance();
+	this->m_clusterCullArgsProgram->useProgram();
+	for (auto& batch : this->m_instanceBatches) {
+		if (!clusteredInPass(batch)) continue;
+		glState->bindStorageBuffer(1, batch.visibleIndexBuffer);
+		glState->bindStorageBuffer(2, batch.clusterDrawBuffer);
+		glState->dispatchCompute(1, 1, 1);
+	}
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+	this->m_clusterCullProgram->useProgram();
+	if (this->m_softwareOcclusionReady) {
+		glState->bindTexture(9, this->m_softwareOcclusionTex);
+	}
+	for (auto& batch : this->m_instanceBatches) {
+		// no CullBlock this frame: nothing visible, the args pass left a dispatch of 0 groups
+		if (!clusteredInPass(batch) || batch.cullBlockOffset < 0) continue;
+		// frustum planes and occlusion flags of the batch's instance cull
+		this->m_uniformRing.bindRange(UBO_CULL_BINDING, batch.cullBlockOffset, sizeof(CullBlockGPU));
+		glState->bindStorageBuffer(0, batch.instanceBuffer);
+		glState->bindStorageBuffer(1, batch.visibleIndexBuffer);
+		glState->bindStorageBuffer(2, batch.clusterDrawBuffer);
+		glState->bindStorageBuffer(10, batch.clusterBuffer);
+		glState->bindStorageBuffer(11, batch.ebo);
+		glState->bindStorageBuffer(12, batch.clusterIndexBuffer);
+		glUniform1ui(0, batch.numClusters);
+		glUniform1ui(1, (GLuint)batch.clusterVertexBits);
+		glState->bindDispatchIndirectBuffer(batch.clusterDrawBuffer);
+		glState->dispatchComputeIndirect(offsetof(ClusterDrawGPU, dispatch));
+	}
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void SceneRenderer::renderCullOverlay() {
+	if (!this->m_cullOverlayEnabled || this->m_cullOverlayProgram == nullptr) return;
+	GpuScope scope("Cull overlay");
+	GLStateCache* glState = GLStateCache::Instance();
+	this->m_cullOverlayProgram->useProgram();
+	glUniform1ui(0, this->m_cullOverlayReasonMask);
+	glUniform1i(1, this->m_cullOverlayBoxes ? 1 : 0);
+	glState->bindTexture(5, this->m_gbufferDepthTex);
+	glState->bindVertexArray(this->m_cullOverlayVAO);
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	// 3 circles of 16 segments, or 12 box edges
+	const GLsizei numVertex = this->m_cullOverlayBoxes ? 24 : 3 * 16 * 2;
+	for (size_t b = 0; b < this->m_instanceBatches.size(); ++b) {
+		const InstanceBatch& batch = this->m_instanceBatches[b];
+		if (batch.cullReasonBuffer == 0 || (this->m_cullOverlayBatch >= 0 && this->m_cullOverlayBatch != (int)b)) continue;
+		glState->bindStorageBuffer(0, batch.instanceBuffer);
+		glState->bindStorageBuffer(7, batch.cullReasonBuffer);
+		glState->drawArraysInstanced(GL_LINES, 0, numVertex, (GLsizei)batch.numInstances);
+	}
+	glState->bindVertexArray(0);
+	glDisable(GL_BLEND);
+	glEnable(GL_DEPTH_TEST);
+}
+
+void SceneRenderer::readBatchVisibility(std::vector<std::string>& names, std::vector<unsigned int>& numInstances, std::vector<unsigned int>& numVisible) const {
+	names.clear();
+	numInstances.clear();
+	numVisible.clear();
+	for (const auto& batch : this->m_instanceBatches) {
+		uint32_t count = 0;
+		if (batch.visibleIndexBuffer != 0) {
+			glGetNamedBufferSubData(batch.visibleIndexBuffer, 0, sizeof(uint32_t), &count);
+		}
+		if (this->impostorsActive(batch)) {
+			uint32_t numImpostor = 0;
+			glGetNamedBufferSubData(batch.impostorBuffer, sizeof(uint32_t), sizeof(uint32_t), &numImpostor);
+			count += numImpostor;
+		}
+		names.push_back(batch.name);
+		numInstances.push_back(batch.numInstances);
+		numVisible.push_back(count);
+	}
+}
+
+void SceneRenderer::readBatchTriangles(std::vector<unsigned long long>& numTriangles) const {
+	numTriangles.clear();
+	for (const auto& batch : this->m_instanceBatches) {
+		uint32_t count = 0;
+		if (this->clustersActive(batch)) {
+			glGetNamedBufferSubData(batch.clusterDrawBuffer, 0, sizeof(uint32_t), &count);
+			numTriangles.push_back(count / 3);
+			continue;
+		}
+		if (batch.visibleIndexBuffer != 0) {
+			glGetNamedBufferSubData(batch.visibleIndexBuffer, 0, sizeof(uint32_t), &count);
+		}
+		numTriangles.push_back((unsigned long long)count * (unsigned long long)(batch.indexCount / 3));
+	}
 }
 
 void SceneRenderer::renderInstanceBatches(bool foliageOnly){
@@ -676,32 +1561,267 @@ void SceneRenderer::renderInstanceBatches(bool foliageOnly){
 void SceneRenderer::renderInstanceBatches(bool foliageOnly, const bool recomputeVisibility){
 	if(this->m_instanceBatches.empty()) return;
 	SceneManager* manager = SceneManager::Instance();
-		for(auto& batch : this->m_instanceBatches){
-			// pass split: occluder pass renders occluders; foliage pass renders non-occluders
-			if (foliageOnly && batch.isOccluder) continue;
-			if (!foliageOnly && !batch.isOccluder) continue;
-			if (recomputeVisibility) {
+	GLStateCache* glState = GLStateCache::Instance();
+	// pass split: occluder pass renders occluders; foliage pass renders non-occluders
+	auto inPass = [&](const InstanceBatch& batch) {
+		return foliageOnly ? !batch.isOccluder : batch.isOccluder;
+	};
+
+	// cull every batch of this pass first, so the cull and draw programs are each bound once
+	// and a single barrier covers all indirect commands
+	if (recomputeVisibility) {
+		GpuScope scope(foliageOnly ? "Cull foliage" : "Cull occluders");
+		for (auto& batch : this->m_instanceBatches) {
+			if (inPass(batch)) {
 				this->dispatchCulling(batch);
 			}
-			this->m_shaderProgram->useProgram();
-			// Instances never use fragment normal mapping in this project.
-			glUniform1i(manager->m_useNormalMapHandle, 0);
-			glBindVertexArray(batch.vao);
-			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, batch.instanceBuffer);
-			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, batch.visibleIndexBuffer);
+		}
+		if (this->m_depthSortEnabled) {
+			glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+			this->sortVisibleByDepth(foliageOnly);
+		}
+		glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+		this->dispatchClusterCulling(foliageOnly);
+	}
+
+	const bool foliagePrepass = foliageOnly && this->m_foliagePrepassEnabled;
+	if (foliagePrepass) {
+		this->renderFoliageDepthPrepass();
+	}
+
+	GpuScope scope(foliageOnly ? "Draw foliage" : "Draw occluders");
+	// fragment counters only around the player view's draws (the god view reuses its visibility)
+	const bool measureFragments = this->m_fragmentStatsEnabled && recomputeVisibility;
+	const int pass = foliageOnly ? 1 : 0;
+	if (measureFragments) {
+		if (this->m_fragmentQueries[0][0][0] == 0) {
+			glGenQueries(FRAGMENT_QUERY_SLOTS * 2 * 2, &this->m_fragmentQueries[0][0][0]);
+			this->m_pipelineStatisticsSupported = GLAD_GL_VERSION_4_6 != 0;
+		}
+		glBeginQuery(GL_SAMPLES_PASSED, this->m_fragmentQueries[this->m_fragmentQuerySlot][pass][0]);
+		if (this->m_pipelineStatisticsSupported) {
+			glBeginQuery(GL_FRAGMENT_SHADER_INVOCATIONS, this->m_fragmentQueries[this->m_fragmentQuerySlot][pass][1]);
+		}
+	}
+	if (foliagePrepass) {
+		// depth is final after the prepass: shade only the surviving fragment of each pixel
+		glDepthFunc(GL_EQUAL);
+		glDepthMask(GL_FALSE);
+	}
+	ShaderProgram* batchProgram = foliagePrepass ? this->foliageGBufferProgram() : this->gbufferProgram();
+	batchProgram->useProgram();
+	// clustered draws need back-face culling; the caller's state is restored after each of them
+	const GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+	for (size_t b = 0; b < this->m_instanceBatches.size(); ++b) {
+		InstanceBatch& batch = this->m_instanceBatches[b];
+		if (!inPass(batch) || batch.numInstances == 0) continue;
+		const bool clustered = this->clustersActive(batch);
+		glState->bindVertexArray(clustered ? batch.clusterVAO : batch.vao);
+		glState->bindStorageBuffer(0, batch.instanceBuffer);
+		glState->bindStorageBuffer(1, batch.visibleIndexBuffer);
 		if(batch.texture){
-			glActiveTexture(manager->m_albedoTexUnit);
-			glBindTexture(GL_TEXTURE_2D, batch.texture);
+			glState->bindTexture(manager->m_albedoTexUnit - GL_TEXTURE0, batch.texture);
+		}
+		// texture pass + instance process, no normal map: all in the batch's material entry
+		glUniform1i(manager->m_materialIndexHandle, clustered ? batch.clusterMaterialIndex : batch.materialIndex);
+		this->setOverdrawSlot(batchProgram, 1 + (int)b, recomputeVisibility);
+		if (clustered) {
+			// surviving clusters of the visible instances; their remaining back faces go to the rasterizer's
+			// culling, which the cone test is consistent with
+			glState->bindStorageBuffer(13, batch.vbo);
+			glUniform1i(this->m_clusterVertexBitsHandle, batch.clusterVertexBits);
+			if (!cullFace) glEnable(GL_CULL_FACE);
+			glState->bindDrawIndirectBuffer(batch.clusterDrawBuffer);
+			glState->drawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, 0);
+			if (!cullFace) glDisable(GL_CULL_FACE);
+			continue;
 		}
-		glUniform1i(manager->m_fs_pixelProcessIdHandle, manager->m_fs_texturePass);
-		glUniform1i(manager->m_vs_vertexProcessIdHandle, manager->m_vs_instanceProcess);
-		glUniform3fv(manager->m_materialAmbientHandle,1,glm::value_ptr(batch.materialAmbient));
-		glUniform3fv(manager->m_materialSpecularHandle,1,glm::value_ptr(batch.materialSpecular));
-		glUniform1f(manager->m_materialShininessHandle,batch.materialShininess);
-		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, batch.indirectBuffer);
-		glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, 0);
-	}
-	glBindVertexArray(0);
+		glState->bindDrawIndirectBuffer(batch.indirectBuffer);
+		glState->drawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, 0);
+	}
+	glState->bindVertexArray(0);
+	if (foliagePrepass) {
+		glDepthFunc(this->depthFunc());
+		glDepthMask(GL_TRUE);
+	}
+	// distant instances of the pass's batches: one quad each, depth from the atlas
+	bool anyImpostors = false;
+	for (size_t b = 0; b < this->m_instanceBatches.size(); ++b) {
+		const InstanceBatch& batch = this->m_instanceBatches[b];
+		if (!inPass(batch) || !this->impostorsActive(batch)) continue;
+		if (!anyImpostors) {
+			this->impostorProgram()->useProgram();
+			glState->bindVertexArray(this->m_impostorVAO);
+			anyImpostors = true;
+		}
+		// own slot: the owner texels were taken over by other batches since this batch's meshes
+		this->setOverdrawSlot(this->impostorProgram(), 1 + (int)(this->m_instanceBatches.size() + b), recomputeVisibility);
+		this->drawImpostors(batch, -1);
+	}
+	if (anyImpostors) {
+		glState->bindVertexArray(0);
+	}
+	if (foliagePrepass || anyImpostors) {
+		this->gbufferProgram()->useProgram();
+	}
+	if (measureFragments) {
+		glEndQuery(GL_SAMPLES_PASSED);
+		if (this->m_pipelineStatisticsSupported) {
+			glEndQuery(GL_FRAGMENT_SHADER_INVOCATIONS);
+		}
+		// the foliage pass closes the frame's slot
+		if (foliageOnly) {
+			this->m_fragmentQueryPending[this->m_fragmentQuerySlot] = true;
+			this->m_fragmentQuerySlot = (this->m_fragmentQuerySlot + 1) % FRAGMENT_QUERY_SLOTS;
+		}
+	}
+}
+
+void SceneRenderer::ensureOverdrawResources() {
+	// all, terrain + objects, then the mesh and the impostor slot of every batch
+	const int numSlot = 2 + 2 * (int)this->m_instanceBatches.size();
+	if (this->m_overdrawCountTex != 0 && this->m_overdrawStatsSlots == numSlot) return;
+	this->destroyOverdrawResources();
+	// full G-buffer size: both viewports count into their own region
+	glCreateTextures(GL_TEXTURE_2D, 1, &this->m_overdrawCountTex);
+	glTextureStorage2D(this->m_overdrawCountTex, 1, GL_R32UI, this->m_frameWidth, this->m_frameHeight);
+	glTextureParameteri(this->m_overdrawCountTex, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTextureParameteri(this->m_overdrawCountTex, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glCreateTextures(GL_TEXTURE_2D, 1, &this->m_overdrawOwnerTex);
+	glTextureStorage2D(this->m_overdrawOwnerTex, 1, GL_R32UI, this->m_frameWidth, this->m_frameHeight);
+	glCreateBuffers(1, &this->m_overdrawStatsBuffer);
+	glNamedBufferData(this->m_overdrawStatsBuffer, (GLsizeiptr)numSlot * 4 * sizeof(uint32_t), nullptr, GL_DYNAMIC_COPY);
+	this->m_overdrawStatsSlots = numSlot;
+
+	const GLsizeiptr readbackSize = (GLsizeiptr)numSlot * 4 * sizeof(uint32_t) * OVERDRAW_READBACK_REGIONS;
+	const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glCreateBuffers(1, &this->m_overdrawReadbackBuffer);
+	glNamedBufferStorage(this->m_overdrawReadbackBuffer, readbackSize, nullptr, flags);
+	this->m_overdrawReadbackPtr = (const uint32_t*)glMapNamedBufferRange(this->m_overdrawReadbackBuffer, 0, readbackSize, flags);
+	this->m_overdrawReadbackNext = 0;
+}
+
+void SceneRenderer::destroyOverdrawResources() {
+	if (this->m_overdrawCountTex != 0) {
+		glDeleteTextures(1, &this->m_overdrawCountTex);
+		glDeleteTextures(1, &this->m_overdrawOwnerTex);
+		glDeleteBuffers(1, &this->m_overdrawStatsBuffer);
+		this->m_overdrawCountTex = 0;
+		this->m_overdrawOwnerTex = 0;
+		this->m_overdrawStatsBuffer = 0;
+		this->m_overdrawStatsSlots = 0;
+	}
+	for (GLsync& fence : this->m_overdrawReadbackFences) {
+		if (fence != nullptr) {
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+	}
+	if (this->m_overdrawReadbackBuffer != 0) {
+		if (this->m_overdrawReadbackPtr != nullptr) {
+			glUnmapNamedBuffer(this->m_overdrawReadbackBuffer);
+		}
+		glDeleteBuffers(1, &this->m_overdrawReadbackBuffer);
+		this->m_overdrawReadbackBuffer = 0;
+	}
+	this->m_overdrawReadbackPtr = nullptr;
+	this->m_overdrawLatest.clear();
+}
+
+// end of frame: copy the slot counters into a free readback region (skipped while all are in flight)
+void SceneRenderer::captureOverdrawStats() {
+	if (this->m_overdrawReadbackPtr == nullptr) return;
+	GLsync& fence = this->m_overdrawReadbackFences[this->m_overdrawReadbackNext];
+	if (fence != nullptr) return;
+	const GLsizeiptr regionSize = (GLsizeiptr)this->m_overdrawStatsSlots * 4 * sizeof(uint32_t);
+	glCopyNamedBufferSubData(this->m_overdrawStatsBuffer, this->m_overdrawReadbackBuffer, 0, this->m_overdrawReadbackNext * regionSize, regionSize);
+	fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	this->m_overdrawReadbackNext = (this->m_overdrawReadbackNext + 1) % OVERDRAW_READBACK_REGIONS;
+}
+
+// keep the newest region whose fence has signaled; never waits on the GPU
+void SceneRenderer::pollOverdrawStats() {
+	if (this->m_overdrawReadbackPtr == nullptr) return;
+	const size_t regionValues = (size_t)this->m_overdrawStatsSlots * 4;
+	// regions complete in submission order: start at the oldest one
+	for (int i = 0; i < OVERDRAW_READBACK_REGIONS; ++i) {
+		const int r = (this->m_overdrawReadbackNext + i) % OVERDRAW_READBACK_REGIONS;
+		GLsync& fence = this->m_overdrawReadbackFences[r];
+		if (fence == nullptr) continue;
+		const GLenum result = glClientWaitSync(fence, 0, 0);
+		if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) break;
+		glDeleteSync(fence);
+		fence = nullptr;
+		const uint32_t* src = this->m_overdrawReadbackPtr + (size_t)r * regionValues;
+		this->m_overdrawLatest.assign(src, src + regionValues);
+	}
+}
+
+// overdrawSlot uniform of shaders/overdraw.glsl; the god view only adds to the heat image
+int SceneRenderer::overdrawSlot(const int slot, const bool playerView) const {
+	if (!this->m_overdrawEnabled || this->m_overdrawCountTex == 0) return -1;
+	return playerView ? slot : -2;
+}
+
+bool SceneRenderer::overdrawActive() const {
+	return this->m_overdrawEnabled && this->m_overdrawCountTex != 0 && this->m_overdrawGBufferProgram != nullptr;
+}
+
+// program: the bound one, an OVERDRAW_COUNT variant while the heatmap is on
+void SceneRenderer::setOverdrawSlot(const ShaderProgram* program, const int slot, const bool playerView) {
+	if (!this->overdrawActive()) return;
+	GLint handle = this->m_overdrawGBufferSlotHandle;
+	if (program == this->m_overdrawFoliageGBufferProgram) handle = this->m_overdrawFoliageGBufferSlotHandle;
+	else if (program == this->m_overdrawImpostorProgram) handle = this->m_overdrawImpostorSlotHandle;
+	glUniform1i(handle, this->overdrawSlot(slot, playerView));
+}
+
+ShaderProgram* SceneRenderer::gbufferProgram() const {
+	return this->overdrawActive() ? this->m_overdrawGBufferProgram : this->m_shaderProgram;
+}
+
+ShaderProgram* SceneRenderer::foliageGBufferProgram() const {
+	return this->overdrawActive() ? this->m_overdrawFoliageGBufferProgram : this->m_foliageGBufferProgram;
+}
+
+ShaderProgram* SceneRenderer::impostorProgram() const {
+	return this->overdrawActive() ? this->m_overdrawImpostorProgram : this->m_impostorProgram;
+}
+
+void SceneRenderer::readOverdrawStats(std::vector<OverdrawSlotStats>& stats) const {
+	stats.clear();
+	if (!this->m_overdrawEnabled || this->m_overdrawLatest.empty()) return;
+	const std::vector<uint32_t>& values = this->m_overdrawLatest;
+	for (int i = 0; i < this->m_overdrawStatsSlots; ++i) {
+		OverdrawSlotStats slot;
+		const int numBatch = (int)this->m_instanceBatches.size();
+		slot.name = (i == 0) ? "All" : (i == 1) ? "Terrain + objects"
+			: (i < 2 + numBatch) ? this->m_instanceBatches[i - 2].name : this->m_instanceBatches[i - 2 - numBatch].name + " impostors";
+		slot.invocations = values[(size_t)i * 4 + 0];
+		slot.pixels = values[(size_t)i * 4 + 1];
+		slot.maxOverdraw = values[(size_t)i * 4 + 2];
+		stats.push_back(slot);
+	}
+}
+
+// alpha-tested depth of the foliage batches from the visible lists the cull just wrote
+void SceneRenderer::renderFoliageDepthPrepass() {
+	GpuScope scope("Foliage depth prepass");
+	GLStateCache* glState = GLStateCache::Instance();
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	this->m_foliageDepthProgram->useProgram();
+	for (auto& batch : this->m_instanceBatches) {
+		if (batch.isOccluder || batch.numInstances == 0) continue;
+		glState->bindVertexArray(batch.vao);
+		glState->bindStorageBuffer(0, batch.instanceBuffer);
+		glState->bindStorageBuffer(1, batch.visibleIndexBuffer);
+		if (batch.texture) {
+			glState->bindTexture(SceneManager::Instance()->m_albedoTexUnit - GL_TEXTURE0, batch.texture);
+		}
+		glState->bindDrawIndirectBuffer(batch.indirectBuffer);
+		glState->drawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, 0);
+	}
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
 }
 
 bool SceneRenderer::createGBuffer(const int w, const int h) {
@@ -741,7 +1861,8 @@ bool SceneRenderer::createGBuffer(const int w, const int h) {
 	glGenTextures(1, &this->m_gbufferDepthTex);
 	glBindTexture(GL_TEXTURE_2D, this->m_gbufferDepthTex);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, w, h, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	// single level: a mipmap filter would leave it incomplete (sampled directly by hzbBuild.comp)
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
@@ -764,8 +1885,6 @@ void SceneRenderer::destroyGBuffer() {
 		glDeleteTextures(1, &this->m_gbufferDepthTex);
 		this->m_gbufferDepthTex = 0;
 	}
-	this->destroyDepthVizTex();
-	this->destroyDepthVizPyramid();
 	if (this->m_depthPyramidTex != 0) {
 		glDeleteTextures(1, &this->m_depthPyramidTex);
 		this->m_depthPyramidTex = 0;
@@ -785,69 +1904,6 @@ void SceneRenderer::destroyGBuffer() {
 	}
 }
 
-void SceneRenderer::ensureDepthVizTex(const int w, const int h) {
-	if (w <= 0 || h <= 0) return;
-	const int maxDim = (w > h) ? w : h;
-	const int levels = (int)std::floor(std::log2((float)maxDim)) + 1;
-	if (this->m_depthVizTex != 0 && this->m_depthVizW == w && this->m_depthVizH == h && this->m_depthVizLevels == levels) {
-		return;
-	}
-	this->destroyDepthVizTex();
-	this->m_depthVizW = w;
-	this->m_depthVizH = h;
-	this->m_depthVizLevels = std::max(1, levels);
-	glCreateTextures(GL_TEXTURE_2D, 1, &this->m_depthVizTex);
-	glTextureStorage2D(this->m_depthVizTex, this->m_depthVizLevels, GL_DEPTH_COMPONENT32F, w, h);
-	glTextureParameteri(this->m_depthVizTex, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
-	glTextureParameteri(this->m_depthVizTex, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTextureParameteri(this->m_depthVizTex, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTextureParameteri(this->m_depthVizTex, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glCreateFramebuffers(1, &this->m_depthVizFBO);
-	glNamedFramebufferTexture(this->m_depthVizFBO, GL_DEPTH_ATTACHMENT, this->m_depthVizTex, 0);
-	glNamedFramebufferDrawBuffer(this->m_depthVizFBO, GL_NONE);
-	glNamedFramebufferReadBuffer(this->m_depthVizFBO, GL_NONE);
-}
-
-void SceneRenderer::destroyDepthVizTex() {
-	if (this->m_depthVizTex != 0) {
-		glDeleteTextures(1, &this->m_depthVizTex);
-		this->m_depthVizTex = 0;
-	}
-	if (this->m_depthVizFBO != 0) {
-		glDeleteFramebuffers(1, &this->m_depthVizFBO);
-		this->m_depthVizFBO = 0;
-	}
-	this->m_depthVizW = 0;
-	this->m_depthVizH = 0;
-	this->m_depthVizLevels = 1;
-}
-
-void SceneRenderer::ensureDepthVizPyramid(const int w, const int h) {
-	if (w <= 0 || h <= 0) return;
-	const int maxDim = (w > h) ? w : h;
-	const int levels = (int)std::floor(std::log2((float)maxDim)) + 1;
-	if (this->m_depthVizPyramidTex != 0 && this->m_depthVizW == w && this->m_depthVizH == h && this->m_depthVizLevels == levels) {
-		return;
-	}
-	this->destroyDepthVizPyramid();
-	this->m_depthVizW = w;
-	this->m_depthVizH = h;
-	this->m_depthVizLevels = std::max(1, levels);
-	glCreateTextures(GL_TEXTURE_2D, 1, &this->m_depthVizPyramidTex);
-	glTextureStorage2D(this->m_depthVizPyramidTex, this->m_depthVizLevels, GL_R32F, w, h);
-	glTextureParameteri(this->m_depthVizPyramidTex, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
-	glTextureParameteri(this->m_depthVizPyramidTex, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTextureParameteri(this->m_depthVizPyramidTex, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTextureParameteri(this->m_depthVizPyramidTex, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-}
-
-void SceneRenderer::destroyDepthVizPyramid() {
-	if (this->m_depthVizPyramidTex != 0) {
-		glDeleteTextures(1, &this->m_depthVizPyramidTex);
-		this->m_depthVizPyramidTex = 0;
-	}
-}
-
 void SceneRenderer::ensureOcclusionPyramid(const int w, const int h) {
 	if (w <= 0 || h <= 0) return;
 	const int maxDim = (w > h) ? w : h;
@@ -863,117 +1919,159 @@ void SceneRenderer::ensureOcclusionPyramid(const int w, const int h) {
 	this->m_occlusionH = h;
 	this->m_occlusionLevels = std::max(1, levels);
 	glCreateTextures(GL_TEXTURE_2D, 1, &this->m_depthPyramidTex);
-	glTextureStorage2D(this->m_depthPyramidTex, this->m_occlusionLevels, GL_R32F, w, h);
+	glTextureStorage2D(this->m_depthPyramidTex, this->m_occlusionLevels, GL_RG32F, w, h);
 	glTextureParameteri(this->m_depthPyramidTex, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
 	glTextureParameteri(this->m_depthPyramidTex, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glTextureParameteri(this->m_depthPyramidTex, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTextureParameteri(this->m_depthPyramidTex, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 }
 
-bool SceneRenderer::setUpDepthVizShader() {
-	Shader* cs = new Shader(GL_COMPUTE_SHADER);
-	cs->createShaderFromFile("shaders\\depthVizBuild.comp");
-	this->m_depthVizProgram = new ShaderProgram();
-	this->m_depthVizProgram->init();
-	this->m_depthVizProgram->attachShader(cs);
-	this->m_depthVizProgram->checkStatus();
-	this->m_depthVizProgram->linkProgram();
-	cs->releaseShader();
-	delete cs;
+void SceneRenderer::renderSoftwareOcclusion() {
+	this->m_softwareOcclusionReady = false;
+	if (!this->m_softwareOcclusionEnabled || this->m_frameWidth <= 0 || this->m_frameHeight <= 0) return;
+	CPU_PROFILE_SCOPE("Software occlusion");
+	const int w = this->m_softwareOcclusionWidth;
+	const int h = std::max(1, (int)std::lround((float)w * (float)this->m_curViewportH / (float)std::max(this->m_curViewportW, 1)));
+	if (this->m_softwareOcclusion.width() != ((w + SoftwareOcclusionBuffer::TILE_W - 1) / SoftwareOcclusionBuffer::TILE_W) * SoftwareOcclusionBuffer::TILE_W ||
+		this->m_softwareOcclusion.height() != ((h + SoftwareOcclusionBuffer::TILE_H - 1) / SoftwareOcclusionBuffer::TILE_H) * SoftwareOcclusionBuffer::TILE_H) {
+		this->m_softwareOcclusion.resize(w, h);
+	}
 
-	this->m_depthVizProgram->useProgram();
-	this->m_depthVizDstLevelHandle = 0;
-	this->m_depthVizSrcLevelHandle = 1;
-	return true;
+	// player view: cullVP may be set while another camera renders
+	const glm::vec3 eye = glm::vec3(glm::inverse(this->m_cullView)[3]);
+	glm::vec4 planes[6];
+	extractFrustumPlanes(this->m_cullVP, planes, this->m_reversedZ);
+	this->m_softwareOcclusion.begin(this->m_cullVP, this->m_reversedZ);
+	this->m_numSoftwareOccluders = 0;
+	if (this->m_terrainOccluderProxy.update(eye)) {
+		this->m_softwareOcclusion.addTriangles(this->m_terrainOccluderProxy.vertices(), this->m_terrainOccluderProxy.numVertex(), 3,
+			this->m_terrainOccluderProxy.indices(), this->m_terrainOccluderProxy.numIndex(), glm::mat4(1.0f));
+		this->m_numSoftwareOccluders++;
+	}
+
+	// nearest building instances in the frustum, front to back
+	struct Candidate { float distance; const InstanceBatch* batch; const InstanceDataGPU* instance; };
+	std::vector<Candidate> candidates;
+	for (const InstanceBatch& batch : this->m_instanceBatches) {
+		if (batch.occluderInstances.empty()) continue;
+		for (const InstanceDataGPU& inst : batch.occluderInstances) {
+			const glm::vec3 center(inst.sphere);
+			const float distance = glm::length(center - eye) - inst.sphere.w;
+			if (distance > this->m_softwareOccluderDistance) continue;
+			bool inside = true;
+			for (int i = 0; i < 6 && inside; ++i) {
+				inside = glm::dot(planes[i], glm::vec4(center, 1.0f)) >= -inst.sphere.w;
+			}
+			if (inside) candidates.push_back({ distance, &batch, &inst });
+		}
+	}
+	const size_t numOccluder = std::min(candidates.size(), (size_t)std::max(this->m_maxSoftwareOccluders, 0));
+	std::partial_sort(candidates.begin(), candidates.begin() + numOccluder, candidates.end(),
+		[](const Candidate& a, const Candidate& b) { return a.distance < b.distance; });
+	for (size_t i = 0; i < numOccluder; ++i) {
+		const InstanceBatch& batch = *candidates[i].batch;
+		this->m_softwareOcclusion.addTriangles(batch.occluderVertices.data(), (int)batch.occluderVertices.size() / 3, 3,
+			batch.occluderIndices.data(), (int)batch.occluderIndices.size(), candidates[i].instance->model);
+	}
+	this->m_numSoftwareOccluders += (int)numOccluder;
+	this->m_softwareOcclusion.rasterize();
+	this->m_softwareOcclusion.resolveDepthPyramid(this->m_softwareOcclusionLevels);
+
+	const int texW = this->m_softwareOcclusion.width(), texH = this->m_softwareOcclusion.height();
+	if (this->m_softwareOcclusionTex == 0 || this->m_softwareOcclusionTexW != texW || this->m_softwareOcclusionTexH != texH) {
+		if (this->m_softwareOcclusionTex != 0) {
+			glDeleteTextures(1, &this->m_softwareOcclusionTex);
+		}
+		glCreateTextures(GL_TEXTURE_2D, 1, &this->m_softwareOcclusionTex);
+		glTextureStorage2D(this->m_softwareOcclusionTex, (GLsizei)this->m_softwareOcclusionLevels.size(), GL_R32F, texW, texH);
+		glTextureParameteri(this->m_softwareOcclusionTex, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+		glTextureParameteri(this->m_softwareOcclusionTex, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		this->m_softwareOcclusionTexW = texW;
+		this->m_softwareOcclusionTexH = texH;
+	}
+	GLStateCache* glState = GLStateCache::Instance();
+	for (size_t level = 0; level < this->m_softwareOcclusionLevels.size(); ++level) {
+		const int levelW = std::max(texW >> (int)level, 1), levelH = std::max(texH >> (int)level, 1);
+		glTextureSubImage2D(this->m_softwareOcclusionTex, (GLint)level, 0, 0, levelW, levelH, GL_RED, GL_FLOAT, this->m_softwareOcclusionLevels[level].data());
+		glState->countUpload((long long)levelW * levelH * sizeof(float));
+	}
+	this->m_softwareOcclusionReady = true;
 }
 
-void SceneRenderer::buildDepthVizPyramid() {
-	if (!this->m_depthVizEnabled || this->m_depthVizTex == 0 || this->m_depthVizPyramidTex == 0 || this->m_depthVizProgram == nullptr) return;
-	this->m_depthVizProgram->useProgram();
-
-	// Level 0: copy input depth -> R32F pyramid level 0.
-	glBindImageTexture(0, this->m_depthVizPyramidTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
-	glBindTextureUnit(1, this->m_depthVizTex);
-	glUniform1i(this->m_depthVizDstLevelHandle, 0);
-	glUniform1i(this->m_depthVizSrcLevelHandle, 0);
-	int gx0 = (int)std::ceil((float)this->m_depthVizW / 8.0f);
-	int gy0 = (int)std::ceil((float)this->m_depthVizH / 8.0f);
-	glDispatchCompute(gx0, gy0, 1);
-	glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
-
-	// Levels 1..N: max reduction from previous level (stored in the same R32F texture).
-	glBindTextureUnit(1, this->m_depthVizPyramidTex);
-	int srcW = this->m_depthVizW;
-	int srcH = this->m_depthVizH;
-	for (int level = 1; level < this->m_depthVizLevels; ++level) {
-		int dstW = std::max(1, srcW >> 1);
-		int dstH = std::max(1, srcH >> 1);
-		glBindImageTexture(0, this->m_depthVizPyramidTex, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
-		glUniform1i(this->m_depthVizDstLevelHandle, level);
-		glUniform1i(this->m_depthVizSrcLevelHandle, level - 1);
-		int gx = (int)std::ceil((float)dstW / 8.0f);
-		int gy = (int)std::ceil((float)dstH / 8.0f);
-		glDispatchCompute(gx, gy, 1);
-		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
-		srcW = dstW;
-		srcH = dstH;
+void SceneRenderer::updatePvsCell() {
+	this->m_pvsCell = -1;
+	this->m_numPvsVisibleClusters = 0;
+	if (!this->m_pvsLoaded || !this->m_pvsEnabled) return;
+	// the farthest point of the cull range (frustum corner at the max view depth) must be inside the bake
+	const glm::mat4 proj = this->m_cullVP * glm::inverse(this->m_cullView);
+	const float cornerScale = std::sqrt(1.0f + 1.0f / (proj[0][0] * proj[0][0]) + 1.0f / (proj[1][1] * proj[1][1]));
+	if (this->m_occlusionMaxViewDepth * cornerScale > this->m_pvs.maxDistance) return;
+	const int cell = this->m_pvs.cellIndex(glm::vec3(glm::inverse(this->m_cullView)[3]));
+	if (cell < 0) return;
+	if (cell != this->m_pvsDecodedCell) {
+		CPU_PROFILE_SCOPE("PVS decode");
+		if (!PotentiallyVisibleSet::decodeBits(this->m_pvs.cellBits[cell], this->m_pvs.numCluster, this->m_pvsBits)) {
+			std::cerr << "PVS: invalid bitset of view cell " << cell << ", disabled\n";
+			this->m_pvsLoaded = false;
+			return;
+		}
+		this->m_pvsDecodedCell = cell;
 	}
+	this->m_pvsCell = cell;
+	this->m_numPvsVisibleClusters = (int)std::count(this->m_pvsBits.begin(), this->m_pvsBits.end(), (uint8_t)1);
 }
 
-void SceneRenderer::createDepthPyramid(const int w, const int h) {
-	if (this->m_depthPyramidTex != 0) {
-		glDeleteTextures(1, &this->m_depthPyramidTex);
-		this->m_depthPyramidTex = 0;
+// potentially visible clusters of the batch merged into runs of instances, uploaded once per view cell
+void SceneRenderer::updatePvsRanges(InstanceBatch& batch) {
+	if (batch.pvsRangeCell == this->m_pvsCell) return;
+	std::vector<glm::uvec2> ranges;
+	uint32_t numThread = 0;
+	for (size_t c = 0; c < batch.clusters.size(); ++c) {
+		if (this->m_pvsBits[batch.pvsFirstCluster + c] == 0) continue;
+		const InstanceCluster& cluster = batch.clusters[c];
+		const bool extends = !ranges.empty() && ranges.back().x + (numThread - ranges.back().y) == (uint32_t)cluster.first;
+		if (!extends) {
+			ranges.push_back(glm::uvec2((uint32_t)cluster.first, numThread));
+		}
+		numThread += (uint32_t)cluster.count;
 	}
-	if (w <= 0 || h <= 0) return;
-	glCreateTextures(GL_TEXTURE_2D, 1, &this->m_depthPyramidTex);
-	glTextureStorage2D(this->m_depthPyramidTex, this->m_depthNumLevels, GL_R32F, w, h);
-	glTextureParameteri(this->m_depthPyramidTex, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTextureParameteri(this->m_depthPyramidTex, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTextureParameteri(this->m_depthPyramidTex, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTextureParameteri(this->m_depthPyramidTex, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-}
-
-void SceneRenderer::destroyDepthPyramid() {
-	if (this->m_depthPyramidTex != 0) {
-		glDeleteTextures(1, &this->m_depthPyramidTex);
-		this->m_depthPyramidTex = 0;
+	if (!ranges.empty()) {
+		glNamedBufferSubData(batch.pvsRangeBuffer, 0, (GLsizeiptr)(ranges.size() * sizeof(glm::uvec2)), ranges.data());
+		GLStateCache::Instance()->countUpload(ranges.size() * sizeof(glm::uvec2));
 	}
+	batch.numPvsRanges = (uint32_t)ranges.size();
+	batch.numPvsInstances = numThread;
+	batch.pvsRangeCell = this->m_pvsCell;
 }
 
 void SceneRenderer::buildDepthPyramid() {
-	// Build viewport-sized occlusion pyramid from the viewport-sized depthVizTex using MIN reduction (nearest depth).
-	if (this->m_hzbProgram == nullptr || this->m_depthPyramidTex == 0 || this->m_depthVizTex == 0) return;
+	// nearest + farthest pyramid of the player viewport, read straight from the G-buffer depth (see hzbBuild.comp)
+	if (this->m_hzbProgram == nullptr || this->m_depthPyramidTex == 0 || this->m_gbufferDepthTex == 0) return;
+	GLStateCache* glState = GLStateCache::Instance();
 	this->m_hzbProgram->useProgram();
-	// level 0: copy from depth texture into R32F target
-	glBindImageTexture(0, this->m_depthPyramidTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
-	glBindTextureUnit(1, this->m_depthVizTex);
-	glBindTextureUnit(2, this->m_depthPyramidTex);
-	glUniform1i(this->m_hzbSrcLevelHandle, -1);
-	glUniform1i(this->m_hzbDstLevelHandle, 0);
-	glUniform1i(2, 0); // reduceOp = MIN
-	int w = (int)std::ceil((float)this->m_occlusionW / 8.0f);
-	int h = (int)std::ceil((float)this->m_occlusionH / 8.0f);
-	glDispatchCompute(w, h, 1);
-	glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
-
-	// build remaining levels from pyramid itself
-	int srcW = this->m_occlusionW;
-	int srcH = this->m_occlusionH;
-	for (int level = 1; level < this->m_occlusionLevels; ++level) {
-		int dstW = std::max(1, srcW >> 1);
-		int dstH = std::max(1, srcH >> 1);
-		glBindImageTexture(0, this->m_depthPyramidTex, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
-		glUniform1i(this->m_hzbSrcLevelHandle, level - 1);
-		glUniform1i(this->m_hzbDstLevelHandle, level);
-		glUniform1i(2, 0); // reduceOp = MIN
-		int gx = (int)std::ceil((float)dstW / 8.0f);
-		int gy = (int)std::ceil((float)dstH / 8.0f);
-		glDispatchCompute(gx, gy, 1);
-		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
-		srcW = dstW;
-		srcH = dstH;
+	glState->bindTexture(1, this->m_gbufferDepthTex);
+	glState->bindStorageBuffer(3, this->m_hzbCounterBuffer);
+	// GL only guarantees 8 image units: the first dispatch writes levels 0..7, deeper pyramids
+	// (256+ texels) get single-group tail dispatches continuing from the last level written
+	const int LEVELS_PER_PASS = 8;
+	for (int baseLevel = 0; baseLevel == 0 || baseLevel < this->m_occlusionLevels - 1; baseLevel += LEVELS_PER_PASS - 1) {
+		const int numLevels = std::min(LEVELS_PER_PASS, this->m_occlusionLevels - baseLevel);
+		for (int i = 0; i < numLevels; ++i) {
+			glBindImageTexture(i, this->m_depthPyramidTex, baseLevel + i, GL_FALSE, 0, GL_READ_WRITE, GL_RG32F);
+		}
+		glUniform2i(0, this->m_curViewportX, this->m_curViewportY);
+		glUniform1i(1, baseLevel);
+		glUniform1i(2, numLevels);
+		glUniform1i(3, this->m_reversedZ ? 1 : 0);
+		if (baseLevel == 0) {
+			glState->dispatchCompute((this->m_occlusionW + 63) / 64, (this->m_occlusionH + 63) / 64, 1);
+		}
+		else {
+			glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+			glState->dispatchCompute(1, 1, 1);
+		}
 	}
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
 }
 
 void SceneRenderer::renderGeometryPass() {
@@ -981,9 +2079,8 @@ void SceneRenderer::renderGeometryPass() {
 }
 
 void SceneRenderer::renderGeometryPass(const bool recomputeVisibility, const bool buildPyramids) {
-	SceneManager *manager = SceneManager::Instance();	
-
-	glBindFramebuffer(GL_FRAMEBUFFER, this->m_gbufferFBO);
+	GLStateCache* glState = GLStateCache::Instance();
+	glState->bindFramebuffer(GL_FRAMEBUFFER, this->m_gbufferFBO);
 	GLenum attachments[5] = {
 		GL_COLOR_ATTACHMENT0,
 		GL_COLOR_ATTACHMENT1,
@@ -996,70 +2093,57 @@ void SceneRenderer::renderGeometryPass(const bool recomputeVisibility, const boo
 	for (int i = 0; i < 5; ++i) {
 		glClearBufferfv(GL_COLOR, i, CLEAR_COLOR);
 	}
-	const float DEPTH[] = { 1.0f };
+	const float DEPTH[] = { this->farDepth() };
 	glClearBufferfv(GL_DEPTH, 0, DEPTH);
 
-	this->m_shaderProgram->useProgram();
-	glUniformMatrix4fv(manager->m_projMatHandle, 1, false, glm::value_ptr(this->m_projMat));
-	glUniformMatrix4fv(manager->m_viewMatHandle, 1, false, glm::value_ptr(this->m_viewMat));
-	// Only magic stone uses fragment normal mapping; default other draws to off.
-	glUniform1i(manager->m_useNormalMapHandle, 0);
+	this->gbufferProgram()->useProgram();
+	// view / projection / camera / light come from FrameBlock + ViewBlock (uploaded per view)
 	// culling VP is provided externally via setCullingVP (player frustum)
 	glm::mat4 invView = glm::inverse(this->m_viewMat);
 	this->m_cullCamPos = glm::vec3(invView[3]);
-
-	// directional light in world space
-	const glm::vec3 lightDirWorld = glm::normalize(glm::vec3(0.4f, 0.5f, 0.8f));
-	glUniform3fv(manager->m_lightDirWorldHandle, 1, glm::value_ptr(lightDirWorld));
-	glUniform3fv(manager->m_cameraPosHandle, 1, glm::value_ptr(this->m_cullCamPos));
-
-	if (this->m_terrainSO != nullptr) {
-		glUniform1i(SceneManager::Instance()->m_vs_vertexProcessIdHandle, SceneManager::Instance()->m_vs_terrainProcess);
-		this->m_terrainSO->update();
+	if (this->m_overdrawEnabled && this->m_overdrawCountTex != 0) {
+		glBindImageTexture(2, this->m_overdrawCountTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+		glBindImageTexture(3, this->m_overdrawOwnerTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+		glState->bindStorageBuffer(5, this->m_overdrawStatsBuffer);
+	}
+	this->setOverdrawSlot(this->gbufferProgram(), 0, recomputeVisibility);
+	if (recomputeVisibility) {
+		// before the first culling dispatch (occluder batches)
+		this->updatePvsCell();
+		this->renderSoftwareOcclusion();
 	}
 
-	if (this->m_dynamicSOs.size() > 0) {
-		glUniform1i(SceneManager::Instance()->m_vs_vertexProcessIdHandle, SceneManager::Instance()->m_vs_commonProcess);
-		for (DynamicSceneObject *obj : this->m_dynamicSOs) {
-			obj->update();
+	{
+		GpuScope scope("Terrain + objects");
+		if (this->m_terrainSO != nullptr) {
+			this->m_terrainSO->update();
+		}
+
+		if (this->m_dynamicSOs.size() > 0) {
+			for (DynamicSceneObject *obj : this->m_dynamicSOs) {
+				obj->update();
+			}
 		}
 	}
 	// pass 1: occluder instances only (buildings)
 	this->renderInstanceBatches(false, recomputeVisibility);
 
 	if (buildPyramids) {
-		// build depth mipmap for visualization (viewport-sized texture to avoid edge contamination)
+		// one min/max pyramid of the player viewport serves occlusion culling and the depth mip view
 		bool anyOcclusion = false;
 		for (const auto& b : this->m_instanceBatches) {
 			if (b.useOcclusion) { anyOcclusion = true; break; }
 		}
-		if ((this->m_depthVizEnabled || anyOcclusion) && this->m_gbufferDepthTex != 0) {
-			this->ensureDepthVizTex(this->m_curViewportW, this->m_curViewportH);
-			if (anyOcclusion) {
-				this->ensureOcclusionPyramid(this->m_curViewportW, this->m_curViewportH);
-			}
-			if (this->m_depthVizEnabled) {
-				this->ensureDepthVizPyramid(this->m_curViewportW, this->m_curViewportH);
-			}
-			if (this->m_depthVizTex != 0 && this->m_depthVizFBO != 0) {
-				// Blit only the player viewport region to a viewport-sized depth texture.
-				glBindFramebuffer(GL_READ_FRAMEBUFFER, this->m_gbufferFBO);
-				glBindFramebuffer(GL_DRAW_FRAMEBUFFER, this->m_depthVizFBO);
-				glBlitFramebuffer(
-					this->m_curViewportX, this->m_curViewportY,
-					this->m_curViewportX + this->m_curViewportW, this->m_curViewportY + this->m_curViewportH,
-					0, 0, this->m_curViewportW, this->m_curViewportH,
-					GL_DEPTH_BUFFER_BIT, GL_NEAREST);
-				glBindFramebuffer(GL_FRAMEBUFFER, this->m_gbufferFBO);
-				// Visualization pyramid (MAX) only when requested.
-				if (this->m_depthVizEnabled) {
-					this->buildDepthVizPyramid();
-				}
-				// Occlusion pyramid (MIN = nearest depth) when any foliage uses occlusion.
-				if (anyOcclusion) {
-					this->buildDepthPyramid();
-					this->m_hzbBuiltThisFrame = true;
-				}
+		const bool shadowFit = this->m_shadowEnabled && this->m_shadowFitToDepth;
+		if ((this->m_depthVizEnabled || anyOcclusion || shadowFit) && this->m_gbufferDepthTex != 0) {
+			this->ensureOcclusionPyramid(this->m_curViewportW, this->m_curViewportH);
+			GpuScope scope("HZB build");
+			this->buildDepthPyramid();
+			this->m_hzbBuiltThisFrame = true;
+			if (this->m_overdrawEnabled && this->m_overdrawCountTex != 0) {
+				// the build used image units 0..7
+				glBindImageTexture(2, this->m_overdrawCountTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+				glBindImageTexture(3, this->m_overdrawOwnerTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
 			}
 		}
 	}
@@ -1071,13 +2155,28 @@ void SceneRenderer::renderGeometryPass(const bool recomputeVisibility, const boo
 
 	// Build shadow maps once per frame, AFTER visibility is computed, so culled objects don't cast shadows.
 	if (recomputeVisibility && buildPyramids && this->m_shadowEnabled && !this->m_shadowBuiltThisFrame) {
-		this->buildShadowMaps();
+		{
+			CPU_PROFILE_SCOPE("Shadow maps");
+			GpuScope scope("Shadow maps");
+			this->buildShadowMaps();
+		}
 		this->m_shadowBuiltThisFrame = true;
 		// Restore G-buffer binding/viewport in case subsequent code assumes it.
-		glBindFramebuffer(GL_FRAMEBUFFER, this->m_gbufferFBO);
+		glState->bindFramebuffer(GL_FRAMEBUFFER, this->m_gbufferFBO);
 		glViewport(this->m_curViewportX, this->m_curViewportY, this->m_curViewportW, this->m_curViewportH);
 	}
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	if (recomputeVisibility && buildPyramids) {
+		this->m_cullStats.capture(this->m_cullStatsBuffer, GpuProfiler::Instance()->currentFrameIndex());
+	}
+	if (this->m_overdrawEnabled) {
+		// counts are sampled by the display pass and copied for readOverdrawStats
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+		if (recomputeVisibility) {
+			// the god view does not add to the slot stats
+			this->captureOverdrawStats();
+		}
+	}
+	glState->bindFramebuffer(GL_FRAMEBUFFER, this->m_outputFBO);
 }
 
 void SceneRenderer::ensureScreenQuad() {
@@ -1113,48 +2212,34 @@ void SceneRenderer::renderDisplayPass() {
 	this->m_displayProgram->useProgram();
 	glDisable(GL_DEPTH_TEST);
 
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, this->m_gbufferTextures[0]);
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, this->m_gbufferTextures[1]);
-	glActiveTexture(GL_TEXTURE2);
-	glBindTexture(GL_TEXTURE_2D, this->m_gbufferTextures[2]);
-	glActiveTexture(GL_TEXTURE3);
-	glBindTexture(GL_TEXTURE_2D, this->m_gbufferTextures[3]);
-	glActiveTexture(GL_TEXTURE4);
-	glBindTexture(GL_TEXTURE_2D, this->m_gbufferTextures[4]);
-	glActiveTexture(GL_TEXTURE5);
-	if (this->m_gbufferDisplayMode == 6 && this->m_depthVizTex != 0) {
-		glBindTexture(GL_TEXTURE_2D, (this->m_depthVizPyramidTex != 0) ? this->m_depthVizPyramidTex : this->m_depthVizTex);
+	GLStateCache* glState = GLStateCache::Instance();
+	for (int i = 0; i < 5; ++i) {
+		glState->bindTexture(i, this->m_gbufferTextures[i]);
+	}
+	if (this->m_gbufferDisplayMode == 6 && this->m_depthPyramidTex != 0) {
+		glState->bindTexture(5, this->m_depthPyramidTex);
 	} else {
-		glBindTexture(GL_TEXTURE_2D, this->m_gbufferDepthTex);
+		glState->bindTexture(5, this->m_gbufferDepthTex);
 	}
-	glActiveTexture(GL_TEXTURE6);
-	if (this->m_shadowTexArray != 0) {
-		glBindTexture(GL_TEXTURE_2D_ARRAY, this->m_shadowTexArray);
-	} else {
-		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	glState->bindTexture(6, this->m_shadowTexArray);
+	if (this->m_shadowMomentsEnabled) {
+		glState->bindTexture(8, this->m_shadowMomentTexArray);
+	}
+	if (this->m_gbufferDisplayMode == 7) {
+		glState->bindTexture(7, this->m_overdrawCountTex);
 	}
 
 	glUniform1i(this->m_displayModeHandle, this->m_gbufferDisplayMode);
 	glUniform1i(this->m_displayDepthMipLevelHandle, this->m_depthDisplayLevel);
-	glm::mat4 invProj = glm::inverse(this->m_projMat);
-	glUniformMatrix4fv(this->m_displayInvProjHandle, 1, GL_FALSE, glm::value_ptr(invProj));
 	glUniform1f(14, this->m_depthVisFar);
 	glUniform1f(16, this->m_depthVisGamma);
-	glUniform1i(this->m_shadowEnabledHandle, this->m_shadowEnabled ? 1 : 0);
-	glUniform1i(this->m_shadowCascadeVizEnabledHandle, this->m_shadowCascadeVizEnabled ? 1 : 0);
-	glUniform3f(this->m_shadowCascadeFarHandle, this->m_shadowCascadeFar[0], this->m_shadowCascadeFar[1], this->m_shadowCascadeFar[2]);
-	glUniformMatrix4fv(this->m_shadowLightVPHandle, 3, GL_FALSE, glm::value_ptr(this->m_shadowLightVP[0]));
-	// Always base cascade visualization ranges on player (culling) view-space depth.
-	glUniformMatrix4fv(this->m_shadowCullViewMatHandle, 1, GL_FALSE, glm::value_ptr(this->m_cullView));
 	float uvScaleX = 1.0f, uvScaleY = 1.0f, uvBiasX = 0.0f, uvBiasY = 0.0f;
-	if (this->m_gbufferDisplayMode == 6 && this->m_depthVizTex != 0) {
-		// depth viz texture is already viewport-sized: map to texel centers in [0,1]
-		uvScaleX = (this->m_depthVizW > 1) ? ((float)(this->m_depthVizW - 1) / (float)this->m_depthVizW) : 0.0f;
-		uvScaleY = (this->m_depthVizH > 1) ? ((float)(this->m_depthVizH - 1) / (float)this->m_depthVizH) : 0.0f;
-		uvBiasX = (this->m_depthVizW > 0) ? (0.5f / (float)this->m_depthVizW) : 0.0f;
-		uvBiasY = (this->m_depthVizH > 0) ? (0.5f / (float)this->m_depthVizH) : 0.0f;
+	if (this->m_gbufferDisplayMode == 6 && this->m_depthPyramidTex != 0) {
+		// the pyramid is already viewport-sized: map to texel centers in [0,1]
+		uvScaleX = (this->m_occlusionW > 1) ? ((float)(this->m_occlusionW - 1) / (float)this->m_occlusionW) : 0.0f;
+		uvScaleY = (this->m_occlusionH > 1) ? ((float)(this->m_occlusionH - 1) / (float)this->m_occlusionH) : 0.0f;
+		uvBiasX = (this->m_occlusionW > 0) ? (0.5f / (float)this->m_occlusionW) : 0.0f;
+		uvBiasY = (this->m_occlusionH > 0) ? (0.5f / (float)this->m_occlusionH) : 0.0f;
 	} else {
 		// Map the quad UV [0,1] onto texel centers of the sampled viewport region (within full-resolution G-buffer).
 		uvScaleX = (this->m_frameWidth > 0)
@@ -1173,16 +2258,8 @@ void SceneRenderer::renderDisplayPass() {
 	glUniform2f(this->m_displayUVScaleHandle, uvScaleX, uvScaleY);
 	glUniform2f(this->m_displayUVBiasHandle, uvBiasX, uvBiasY);
 
-	// light & camera for default lighting view
-	const glm::vec3 lightDirWorld = glm::normalize(glm::vec3(0.4f, 0.5f, 0.8f));
-	glm::mat4 invView = glm::inverse(this->m_viewMat);
-	glm::vec3 camPos = glm::vec3(invView[3]);
-	glUniform3fv(this->m_displayLightDirHandle, 1, glm::value_ptr(lightDirWorld));
-	glUniform3fv(this->m_displayCamPosHandle, 1, glm::value_ptr(camPos));
-	glUniformMatrix4fv(this->m_displayViewMatHandle, 1, GL_FALSE, glm::value_ptr(this->m_viewMat));
-
-	glBindVertexArray(this->m_screenVAO);
-	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-	glBindVertexArray(0);
+	glState->bindVertexArray(this->m_screenVAO);
+	glState->drawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+	glState->bindVertexArray(0);
 	glEnable(GL_DEPTH_TEST);
 }
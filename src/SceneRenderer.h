@@ -1,20 +1,42 @@
 #pragma once
 
+#include <algorithm>
 #include <vector>
 #include "Shader.h"
 #include "SceneManager.h"
 #include "DynamicSceneObject.h"
 #include "terrain/TerrainSceneObject.h"
 #include "MyPoissonSample.h"
+#include "InstanceData.h"
+#include "SceneDescription.h"
+#include "UniformBlocks.h"
+#include "UniformBufferRing.h"
+#include "CullStats.h"
+#include "SoftwareOcclusion.h"
+#include "OccluderProxy.h"
+#include "PotentiallyVisibleSet.h"
+#include "MeshClusters.h"
+#include "terrain/TerrainOccluderProxy.h"
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtx/quaternion.hpp>
 #include <glm/gtc/matrix_access.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
-struct InstanceDataGPU {
-	glm::mat4 model;
-	glm::vec4 sphere; // xyz center (world), w radius
+// fragment counters of the player view's instance draws, pass 0: occluders, 1: foliage
+struct InstanceFragmentStats {
+	GLuint64 samplesPassed[2] = { 0, 0 };
+	GLuint64 fragmentInvocations[2] = { 0, 0 }; // 0 without pipeline statistics queries
+	bool valid = false;
+};
+
+// overdraw heatmap counters of one draw slot (shaders/overdraw.glsl)
+struct OverdrawSlotStats {
+	std::string name;
+	uint32_t invocations = 0; // fragment shader invocations
+	uint32_t pixels = 0;      // pixels with at least one
+	uint32_t maxOverdraw = 0; // invocations of the worst pixel
+	float meanOverdraw() const { return (pixels > 0) ? (float)invocations / (float)pixels : 0.0f; }
 };
 
 struct InstanceBatch {
@@ -27,15 +49,63 @@ struct InstanceBatch {
 	glm::vec3 materialAmbient = glm::vec3(1.0f);
 	glm::vec3 materialSpecular = glm::vec3(0.0f);
 	float materialShininess = 1.0f;
+	int materialIndex = 0;
 
 	GLuint instanceBuffer = 0;
 	GLuint visibleIndexBuffer = 0;
 	GLuint indirectBuffer = 0;
+	GLuint depthBinEntryBuffer = 0; // created when depth sorting is first enabled
+	GLuint depthBinBuffer = 0;
+	GLuint cullReasonBuffer = 0; // CullReason per instance, created when the cull overlay is first enabled
 	uint32_t numInstances = 0;
 	glm::vec3 sphereCenter = glm::vec3(0.0f);
 	float sphereRadius = 1.0f;
 	bool useOcclusion = true; // foliage only
 	bool isOccluder = true;   // rendered before HZB build
+	bool castShadow = false;  // InstanceBatchDesc::castShadow
+	// occluder proxy of occluder batches (or their mesh) for the software occlusion buffer
+	std::vector<float> occluderVertices; // xyz
+	std::vector<uint32_t> occluderIndices;
+	std::vector<InstanceDataGPU> occluderInstances;
+	// batches baked into the PVS: instances sorted by cluster, bit of the first cluster (-1: not pruned)
+	std::vector<InstanceCluster> clusters;
+	int pvsFirstCluster = -1;
+	GLuint pvsRangeBuffer = 0;  // runs of potentially visible clusters (cullInstances.comp, binding 8)
+	int pvsRangeCell = -1;      // view cell the ranges are uploaded for
+	uint32_t numPvsRanges = 0;
+	uint32_t numPvsInstances = 0;
+	// visible instances past impostorDistance are drawn as octahedral impostors instead
+	float impostorDistance = 0.0f;
+	int impostorAtlas = -1;    // m_impostorAtlases entry, -1: none
+	GLuint impostorBuffer = 0; // DrawArraysIndirectCommand + instance indices (cullInstances.comp, binding 9)
+	// occluder batches split into clusters (MeshClusters.h): the clusters of the visible instances that
+	// pass clusterCull.comp are compacted into one index buffer and drawn with clusterProcess()
+	uint32_t numClusters = 0;
+	int clusterVertexBits = 0;
+	int clusterMaterialIndex = -1;
+	GLuint clusterBuffer = 0;      // ClusterDataGPU per cluster
+	GLuint clusterDrawBuffer = 0;  // ClusterDrawGPU
+	GLuint clusterIndexBuffer = 0; // room for every triangle of every instance
+	GLuint clusterVAO = 0;         // no attributes, clusterIndexBuffer as element buffer
+	GLintptr cullBlockOffset = 0;  // CullBlock of this frame's dispatchCulling, reused by the cluster cull
+};
+
+// albedo and normal + depth atlas of an ImpostorAtlas, shared by the batches of one mesh and texture
+struct ImpostorAtlasTextures {
+	std::string key;
+	GLuint albedo = 0;
+	GLuint normalDepth = 0;
+	glm::vec4 bounds = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f); // object space center, radius
+	int frames = 0;
+};
+
+// light box a cascade's static casters were rendered with; kept while the cascade stays inside it
+struct ShadowCascadeCache {
+	glm::vec3 boxMin = glm::vec3(0.0f);
+	glm::vec3 boxMax = glm::vec3(0.0f);
+	bool valid = false;
+	bool dirty = true;   // static layer must be re-rendered
+	bool reversedZ = false;
 };
 
 class SceneRenderer
@@ -58,43 +128,23 @@ private:
 	GLuint m_gbufferFBO = 0;
 	GLuint m_gbufferTextures[5] = { 0, 0, 0, 0, 0 }; // pos, normal, ambient, diffuse, specular
 	GLuint m_gbufferDepthTex = 0; // depth texture for HZB
-	// viewport-sized depth texture for mipmap visualization (avoids mixing with cleared outside-viewport depth)
-	GLuint m_depthVizTex = 0;
-	GLuint m_depthVizFBO = 0;
-	int m_depthVizW = 0;
-	int m_depthVizH = 0;
-	int m_depthVizLevels = 1;
-	// max-reduced depth pyramid for visualization (R32F)
-	GLuint m_depthVizPyramidTex = 0;
-	ShaderProgram* m_depthVizProgram = nullptr;
-	GLint m_depthVizDstLevelHandle = -1;
-	GLint m_depthVizSrcLevelHandle = -1;
-	GLuint m_depthPyramidTex = 0; // R32F pyramid for occlusion
+	// viewport-sized RG32F depth pyramid built by hzbBuild.comp: r = nearest (occlusion), g = farthest (depth mip viz)
+	GLuint m_depthPyramidTex = 0;
 	int m_occlusionW = 0;
 	int m_occlusionH = 0;
 	int m_occlusionLevels = 1;
 	int m_depthNumLevels = 1;
 	int m_depthFixedLevel = 0;
 	bool m_hzbBuiltThisFrame = false;
+	// reversed-Z: [0,1] clip depth, near = 1, far = 0, cleared to 0 and tested with GL_GREATER
+	bool m_reversedZ = false;
 	ShaderProgram* m_hzbProgram = nullptr;
-	GLint m_hzbSrcLevelHandle = -1;
-	GLint m_hzbDstLevelHandle = -1;
+	GLuint m_hzbCounterBuffer = 0; // finished groups of the single-pass build
 
 	// display pass
 	ShaderProgram* m_displayProgram = nullptr;
 	GLint m_displayModeHandle = -1;
-	GLint m_displayLightDirHandle = -1;
-	GLint m_displayCamPosHandle = -1;
-	GLint m_displayViewMatHandle = -1;
 	GLint m_displayDepthMipLevelHandle = -1;
-	GLint m_displayInvProjHandle = -1;
-	// shadow display uniforms (in gbufferDisplayFragment.glsl)
-	GLint m_shadowEnabledHandle = 17;
-	GLint m_shadowCascadeVizEnabledHandle = 18;
-	GLint m_shadowCascadeFarHandle = 19;
-	GLint m_shadowLightVPHandle = 20; // mat4[3] occupies locations 20..31
-	GLint m_shadowMapHandle = 32;
-	GLint m_shadowCullViewMatHandle = 34; // mat4 occupies locations 34..37
 	GLuint m_screenVAO = 0;
 	GLuint m_screenVBO = 0;
 	GLuint m_screenEBO = 0;
@@ -118,8 +168,6 @@ private:
 	// gpu-driven instancing
 	std::vector<InstanceBatch> m_instanceBatches;
 	ShaderProgram* m_cullProgram = nullptr;
-	GLint m_cullNumInstancesHandle = -1;
-	GLint m_cullFrustumHandle = -1;
 	glm::mat4 m_cullVP = glm::mat4(1.0f);
 	glm::mat4 m_cullView = glm::mat4(1.0f);
 	glm::vec4 m_frustumPlanes[6];
@@ -132,22 +180,158 @@ private:
 	float m_occlusionBias = 0.0005f;
 	int m_occlusionFixedLevelOverride = -1; // -1 => use ceil(levels * 0.5)
 	float m_occlusionMaxViewDepth = 400.0f;
+	// CPU masked occlusion buffer of the nearest occluders (terrain proxy, buildings), tested by
+	// cullInstances.comp for every batch before anything is drawn
+	bool m_softwareOcclusionEnabled = false;
+	bool m_softwareOcclusionReady = false; // built for this frame's cullVP
+	int m_softwareOcclusionWidth = 320;
+	float m_softwareOccluderDistance = 150.0f;
+	int m_maxSoftwareOccluders = 48; // building instances, nearest first
+	// voxels along the longest axis of a mesh when its occluder proxy is built
+	static const int OCCLUDER_PROXY_RESOLUTION = 32;
+	int m_numSoftwareOccluders = 0;
+	SoftwareOcclusionBuffer m_softwareOcclusion;
+	TerrainOccluderProxy m_terrainOccluderProxy;
+	std::vector<std::vector<float>> m_softwareOcclusionLevels;
+	GLuint m_softwareOcclusionTex = 0; // R32F window depth of the farthest occluder, mips on unit 9
+	int m_softwareOcclusionTexW = 0;
+	int m_softwareOcclusionTexH = 0;
+	// potentially visible set baked by CG2025_pvsbake: while the eye is inside a view cell, only the
+	// instances of its potentially visible clusters are culled and drawn
+	PotentiallyVisibleSet m_pvs;
+	bool m_pvsLoaded = false;
+	bool m_pvsEnabled = true;
+	int m_pvsCell = -1;        // view cell of this frame's culling, -1: not pruned
+	int m_pvsDecodedCell = -1; // cell of m_pvsBits
+	std::vector<uint8_t> m_pvsBits;
+	int m_numPvsVisibleClusters = 0;
+	// octahedral impostors (ImpostorAtlas.h): loaded from InstanceBatchDesc::impostorPath or baked at load
+	static const int IMPOSTOR_FRAMES = 8;
+	static const int IMPOSTOR_FRAME_SIZE = 128;
+	bool m_impostorsEnabled = true;
+	std::vector<ImpostorAtlasTextures> m_impostorAtlases;
+	ShaderProgram* m_impostorProgram = nullptr;
+	GLuint m_impostorVAO = 0;
+	GLint m_impostorMaterialIndexHandle = -1;
+	GLint m_impostorBoundsHandle = -1;
+	GLint m_impostorFramesHandle = -1;
+	GLint m_impostorShadowCascadeHandle = -1;
+	// cluster culling of occluder batches (InstanceBatchDesc::clusterTriangles)
+	bool m_clusterCullingEnabled = true;
+	static const size_t MAX_CLUSTER_INDICES = size_t(1) << 26; // compacted index buffer of a batch, 256 MB
+	ShaderProgram* m_clusterCullArgsProgram = nullptr;
+	ShaderProgram* m_clusterCullProgram = nullptr;
+	GLint m_clusterVertexBitsHandle = 12;
+	// per-batch rejection counters (cullInstances.comp), read back asynchronously
+	GLuint m_cullStatsBuffer = 0;
+	CullStatsReadback m_cullStats;
+	// god-view overlay: instance bounds colored by the CullReason of the player view
+	bool m_cullOverlayEnabled = false;
+	int m_cullOverlayBatch = -1; // -1: all batches
+	uint32_t m_cullOverlayReasonMask = (1u << CULL_REASON_COUNT) - 1u;
+	bool m_cullOverlayBoxes = false;
+	ShaderProgram* m_cullOverlayProgram = nullptr;
+	GLuint m_cullOverlayVAO = 0;
+	// front-to-back visible lists
+	bool m_depthSortEnabled = false;
+	ShaderProgram* m_depthBinScanProgram = nullptr;
+	ShaderProgram* m_depthBinScatterProgram = nullptr;
+	// foliage depth prepass: alpha-tested depth only, then the G-buffer pass with GL_EQUAL
+	bool m_foliagePrepassEnabled = false;
+	ShaderProgram* m_foliageDepthProgram = nullptr;
+	ShaderProgram* m_foliageGBufferProgram = nullptr;
+	// overdraw heatmap (display mode 7): R32UI invocation count + slot owner images, per-slot stats
+	bool m_overdrawEnabled = false;
+	GLuint m_overdrawCountTex = 0;
+	GLuint m_overdrawOwnerTex = 0;
+	GLuint m_overdrawStatsBuffer = 0;
+	int m_overdrawStatsSlots = 0;
+	// OVERDRAW_COUNT variants of the G-buffer, foliage G-buffer and impostor programs, bound only while
+	// the heatmap is on: the normal programs have no image writes and keep early depth tests
+	ShaderProgram* m_overdrawGBufferProgram = nullptr;
+	ShaderProgram* m_overdrawFoliageGBufferProgram = nullptr;
+	ShaderProgram* m_overdrawImpostorProgram = nullptr;
+	// overdrawSlot location of each variant
+	GLint m_overdrawGBufferSlotHandle = -1;
+	GLint m_overdrawFoliageGBufferSlotHandle = -1;
+	GLint m_overdrawImpostorSlotHandle = -1;
+	// per-slot stats are copied into fenced regions of a persistently mapped buffer (like
+	// CullStatsReadback) and picked up frames later; the UI reads the newest completed copy
+	static const int OVERDRAW_READBACK_REGIONS = 3;
+	GLuint m_overdrawReadbackBuffer = 0;
+	const uint32_t* m_overdrawReadbackPtr = nullptr;
+	GLsync m_overdrawReadbackFences[OVERDRAW_READBACK_REGIONS] = {};
+	int m_overdrawReadbackNext = 0;
+	std::vector<uint32_t> m_overdrawLatest;
+	// samples passed / fragment shader invocations of the instance draws, read back FRAGMENT_QUERY_SLOTS frames later
+	static const int FRAGMENT_QUERY_SLOTS = 3;
+	bool m_fragmentStatsEnabled = false;
+	bool m_pipelineStatisticsSupported = false;
+	GLuint m_fragmentQueries[FRAGMENT_QUERY_SLOTS][2][2] = {}; // slot, pass, samples passed / invocations
+	bool m_fragmentQueryPending[FRAGMENT_QUERY_SLOTS] = { false, false, false };
+	int m_fragmentQuerySlot = 0;
+	InstanceFragmentStats m_fragmentStats;
 
-	// cascaded shadow mapping
+	// cascaded shadow mapping: fixed split table or practical splits over [min, max] distance on the CPU,
+	// or splits and light bounds fitted to the visible depth (depth pyramid) by shadowCascadeFit.comp
 	bool m_shadowEnabled = false;
 	bool m_shadowCascadeVizEnabled = false;
 	bool m_shadowBuiltThisFrame = false;
-	int m_shadowMapSize = 2048;
+	bool m_shadowFitToDepth = false;
+	bool m_shadowPracticalSplits = false; // always on with the fit
+	int m_numShadowCascades = 3;
+	int m_shadowMapSize = 2048; // per cascade
+	// fixed cascade boundaries per cascade count, the original 1 / 50 / 200 / 500 for three cascades
+	float m_shadowCascadeTable[MAX_SHADOW_CASCADES][MAX_SHADOW_CASCADES + 1] = {
+		{ 1.0f, 500.0f },
+		{ 1.0f, 50.0f, 500.0f },
+		{ 1.0f, 50.0f, 200.0f, 500.0f },
+		{ 1.0f, 20.0f, 50.0f, 200.0f, 500.0f } };
+	float m_shadowMinDistance = 1.0f;
+	float m_shadowMaxDistance = 400.0f;
+	float m_shadowSplitLambda = 0.75f;
+	float m_shadowCasterDistance = 50.0f; // casters above the receivers, towards the light
 	GLuint m_shadowFBO = 0;
-	GLuint m_shadowTexArray = 0; // depth texture array [3]
+	GLuint m_shadowTexArray = 0; // depth texture array, one layer per cascade
+	int m_shadowTexLayers = 0;
+	int m_shadowTexSize = 0;
 	ShaderProgram* m_shadowProgram = nullptr;
-	glm::mat4 m_shadowLightVP[3] = { glm::mat4(1.0f), glm::mat4(1.0f), glm::mat4(1.0f) };
-	float m_shadowCascadeNear[3] = { 1.0f, 50.0f, 200.0f };
-	float m_shadowCascadeFar[3]  = { 50.0f, 200.0f, 500.0f };
+	ShaderProgram* m_shadowFitProgram = nullptr;
+	GLuint m_shadowCascadeBuffer = 0; // ShadowBlockGPU written by the fit
+	ShadowBlockGPU m_shadowBlock;
+	// cached static casters (fixed splits only): a layer per cascade copied under the dynamic objects
+	// every frame; cascades > 0 refresh early on alternating frames
+	bool m_shadowCacheEnabled = false;
+	float m_shadowCacheMargin = 0.2f; // fraction of the extent added on each side of a refreshed box
+	GLuint m_shadowStaticTexArray = 0;
+	ShadowCascadeCache m_shadowCache[MAX_SHADOW_CASCADES];
+	unsigned int m_shadowFrame = 0;
+	// prefiltered shadows (EVSM): blurred moments of every cascade, mipmapped for the display pass
+	bool m_shadowMomentsEnabled = false;
+	int m_shadowMomentDownsample = 2; // moment map resolution = shadow map size / downsample
+	int m_shadowBlurRadius = 2; // Gaussian taps on each side, in moment texels
+	GLuint m_shadowMomentTexArray = 0;
+	GLuint m_shadowMomentTempTex = 0; // horizontal pass output, one layer
+	ShaderProgram* m_shadowMomentBlurProgram = nullptr;
+	GLint m_momentBlurPassHandle = -1;
+	GLint m_momentBlurLayerHandle = -1;
+	GLint m_momentBlurDownsampleHandle = -1;
+	GLint m_momentBlurRadiusHandle = -1;
+
+	// uniform blocks (shaders/uniformBlocks.glsl), triple-buffered in a persistent-mapped ring
+	UniformBufferRing m_uniformRing;
+	MaterialBlockGPU m_materialTable;
+	int m_numMaterial = 0;
+	bool m_materialTableFull = false; // a registration failed: initialize() / append*SceneObject() fail
+	int m_terrainMaterialIndex = -1;
+	GLintptr m_viewBlockOffset = -1;
+
+	// final display target (0 = default framebuffer; the benchmark renders into an offscreen FBO)
+	GLuint m_outputFBO = 0;
 
 public:
 	void resize(const int w, const int h);
-	bool initialize(const int w, const int h, ShaderProgram* shaderProgram);
+	bool initialize(const int w, const int h, ShaderProgram* shaderProgram, const SceneDescription& scene);
 
 	void setProjection(const glm::mat4 &proj);
 	void setView(const glm::mat4 &view);
@@ -167,8 +351,9 @@ public:
 	}
 	void clearCullingPlanesOverride() { m_hasCullPlanesOverride = false; }
 	void setDepthDisplayLevel(const int level) { m_depthDisplayLevel = level; }
-	void appendDynamicSceneObject(DynamicSceneObject *obj);
-	void appendTerrainSceneObject(TerrainSceneObject* tSO);
+	// false when the material table is full (MAX_NUM_MATERIAL)
+	bool appendDynamicSceneObject(DynamicSceneObject *obj);
+	bool appendTerrainSceneObject(TerrainSceneObject* tSO);
 
 // pipeline
 public:
@@ -181,15 +366,78 @@ public:
 	void setDepthVizEnabled(const bool enabled) { m_depthVizEnabled = enabled; }
 	void setDepthVisFar(const float farZ) { m_depthVisFar = farZ; }
 	void setDepthVisGamma(const float gamma) { m_depthVisGamma = gamma; }
+	// projections must match (MyCameraManager::setReversedZ)
+	void setReversedZEnabled(const bool enabled) { m_reversedZ = enabled; }
 	void setOcclusionEnabled(const bool enabled) { m_occlusionEnabled = enabled; }
 	void setOcclusionBias(const float bias) { m_occlusionBias = bias; }
 	void setOcclusionFixedLevelOverride(const int level) { m_occlusionFixedLevelOverride = level; }
 	void setOcclusionMaxViewDepth(const float maxDepth) { m_occlusionMaxViewDepth = maxDepth; }
+	// occluders rasterized on the CPU before the geometry pass; every batch, buildings included, is tested
+	void setSoftwareOcclusionEnabled(const bool enabled) { m_softwareOcclusionEnabled = enabled; }
+	// heightfield of the terrain occluder proxy (nullptr: buildings only)
+	void setOcclusionTerrain(const MyTerrainData* td) { m_terrainOccluderProxy.init(td, 8.0f); }
+	// of the last software occlusion buffer: meshes (terrain proxy included) and triangles after clipping
+	int numSoftwareOccluders() const { return m_numSoftwareOccluders; }
+	int numSoftwareOcclusionTriangles() const { return m_softwareOcclusion.numRasterizedTriangles(); }
+	// prune culling by the scene's PVS (SceneDescription::pvsPath); inactive outside its view cells,
+	// above its eye heights or when the cull distance reaches farther than it was baked for
+	void setPvsEnabled(const bool enabled) { m_pvsEnabled = enabled; }
+	bool hasPvs() const { return m_pvsLoaded; }
+	int pvsCell() const { return m_pvsCell; }
+	int numPvsClusters() const { return m_pvs.numCluster; }
+	int numPvsVisibleClusters() const { return m_numPvsVisibleClusters; }
+	// visible instances past their batch's impostor distance become camera-facing atlas quads
+	void setImpostorsEnabled(const bool enabled) { m_impostorsEnabled = enabled; }
+	int numImpostorAtlases() const { return (int)m_impostorAtlases.size(); }
+	// clustered batches draw only the clusters of their visible instances that face the player camera,
+	// are inside its frustum and pass the CPU occlusion buffer
+	void setClusterCullingEnabled(const bool enabled) { m_clusterCullingEnabled = enabled; }
+	int numClusteredBatches() const {
+		return (int)std::count_if(m_instanceBatches.begin(), m_instanceBatches.end(), [](const InstanceBatch& b) { return b.numClusters > 0; });
+	}
+	// per-batch cull reason counters of the player view, a few frames late
+	const CullStatsReadback& cullStats() const { return m_cullStats; }
+	// per-instance cull reasons are only written while the overlay is enabled
+	void setCullOverlayEnabled(const bool enabled) { m_cullOverlayEnabled = enabled; }
+	// batch -1: all; reasonMask: bit per CullReason
+	void setCullOverlayFilter(const int batch, const uint32_t reasonMask) { m_cullOverlayBatch = batch; m_cullOverlayReasonMask = reasonMask; }
+	void setCullOverlayBoxes(const bool boxes) { m_cullOverlayBoxes = boxes; }
+	// bounds of the filtered instances as lines over the current view (after its display pass)
+	void renderCullOverlay();
+	// bucket visible instances by view depth so the indirect draws run roughly front to back
+	void setDepthSortEnabled(const bool enabled) { m_depthSortEnabled = enabled; }
+	// foliage is shaded once per pixel after an alpha-tested depth prepass (same visible lists)
+	void setFoliagePrepassEnabled(const bool enabled) { m_foliagePrepassEnabled = enabled; }
+	// count fragment shader invocations per pixel and per batch during the geometry pass
+	void setOverdrawEnabled(const bool enabled) { m_overdrawEnabled = enabled; }
+	// [0]: all, [1]: terrain + objects, [2 + i]: instance batch i, [2 + n + i]: impostors of batch i
+	// (n batches, player view of a recent frame)
+	void readOverdrawStats(std::vector<OverdrawSlotStats>& stats) const;
+	void setFragmentStatsEnabled(const bool enabled) { m_fragmentStatsEnabled = enabled; }
+	const InstanceFragmentStats& instanceFragmentStats() const { return m_fragmentStats; }
 	void setShadowEnabled(const bool enabled) { m_shadowEnabled = enabled; }
 	void setShadowCascadeVizEnabled(const bool enabled) { m_shadowCascadeVizEnabled = enabled; }
+	// fit the cascades to the depth range the player view sees (builds the depth pyramid)
+	void setShadowFitToDepthEnabled(const bool enabled) { m_shadowFitToDepth = enabled; }
+	// practical splits over [min, max] distance instead of the fixed table without the fit
+	void setShadowPracticalSplitsEnabled(const bool enabled) { m_shadowPracticalSplits = enabled; }
+	void setNumShadowCascades(const int count) { m_numShadowCascades = std::max(1, std::min(count, MAX_SHADOW_CASCADES)); }
+	void setShadowMapSize(const int size) { m_shadowMapSize = std::max(size, 16); }
+	// static casters rendered once into a cache, only the airplane and magic stone every frame
+	void setShadowCacheEnabled(const bool enabled) { m_shadowCacheEnabled = enabled; }
+	// EVSM moments blurred once per cascade instead of 3x3 PCF per pixel
+	void setShadowMomentsEnabled(const bool enabled) { m_shadowMomentsEnabled = enabled; }
+	void setOutputFramebuffer(const GLuint fbo) { m_outputFBO = fbo; }
+	// Blocking readback of the visible instance count of every batch, impostors included (benchmark / debugging only).
+	void readBatchVisibility(std::vector<std::string>& names, std::vector<unsigned int>& numInstances, std::vector<unsigned int>& numVisible) const;
+	// Blocking readback of the triangles drawn by every batch's mesh draws, impostors excluded (benchmark / debugging only).
+	void readBatchTriangles(std::vector<unsigned long long>& numTriangles) const;
 
 private:
-	void clear(const glm::vec4 &clearColor = glm::vec4(0.0, 0.0, 0.0, 1.0), const float depth = 1.0);
+	void clear(const glm::vec4 &clearColor = glm::vec4(0.0, 0.0, 0.0, 1.0));
+	// depth of the far plane / empty pixels and the matching depth test
+	float farDepth() const { return m_reversedZ ? 0.0f : 1.0f; }
+	GLenum depthFunc() const { return m_reversedZ ? GL_GREATER : GL_LESS; }
 	bool setUpShader();
 	bool createGBuffer(const int w, const int h);
 	void destroyGBuffer();
@@ -198,25 +446,58 @@ private:
 	void renderGeometryPass(const bool recomputeVisibility, const bool buildPyramids);
 	void renderDisplayPass();
 	void ensureScreenQuad();
-	void setUpInstanceBatches();
+	void setUpInstanceBatches(const std::vector<InstanceBatchDesc>& batches);
+	void appendInstanceBatch(const InstanceBatchDesc& desc);
 	void renderInstanceBatches(bool foliageOnly);
 	void renderInstanceBatches(bool foliageOnly, const bool recomputeVisibility);
 	void dispatchCulling(struct InstanceBatch& batch);
+	bool setUpDepthBinShaders();
+	void ensureDepthBinBuffers(InstanceBatch& batch);
+	bool setUpCullOverlayShader();
+	void sortVisibleByDepth(const bool foliageOnly);
+	void resolveFragmentQueries();
+	void ensureOverdrawResources();
+	void destroyOverdrawResources();
+	void captureOverdrawStats();
+	void pollOverdrawStats();
+	int overdrawSlot(const int slot, const bool playerView) const;
+	bool overdrawActive() const;
+	void setOverdrawSlot(const ShaderProgram* program, const int slot, const bool playerView);
+	ShaderProgram* gbufferProgram() const;
+	ShaderProgram* foliageGBufferProgram() const;
+	ShaderProgram* impostorProgram() const;
 	GLuint loadTexture(const std::string& path);
-	void createDepthPyramid(const int w, const int h);
-	void destroyDepthPyramid();
 	bool setUpHZBShader();
 	void buildDepthPyramid();
-	void ensureDepthVizTex(const int w, const int h);
-	void destroyDepthVizTex();
-	bool setUpDepthVizShader();
-	void ensureDepthVizPyramid(const int w, const int h);
-	void destroyDepthVizPyramid();
-	void buildDepthVizPyramid();
 	void ensureOcclusionPyramid(const int w, const int h);
+	void renderSoftwareOcclusion();
+	void updatePvsCell();
+	void updatePvsRanges(InstanceBatch& batch);
+	bool setUpImpostorShader();
+	int loadImpostorAtlas(const InstanceBatchDesc& desc, const float* vertices, const int numVertices, const unsigned int* indices, const int numIndices, const GLuint texture);
+	void drawImpostors(const InstanceBatch& batch, const int shadowCascade);
+	void drawShadowImpostors(const int cascade);
+	void setUpBatchClusters(InstanceBatch& batch, const std::vector<MeshCluster>& clusters, const int vertexBits, const size_t maxClusterIndices);
+	bool setUpClusterCullShaders();
+	void dispatchClusterCulling(const bool foliageOnly);
+	bool clustersActive(const InstanceBatch& batch) const { return m_clusterCullingEnabled && batch.numClusters > 0 && batch.numInstances > 0; }
+	bool impostorsActive(const InstanceBatch& batch) const { return m_impostorsEnabled && batch.impostorAtlas >= 0 && batch.numInstances > 0; }
 	bool setUpShadowShader();
+	bool setUpFoliagePrepassShaders();
+	bool setUpOverdrawShaders();
+	void renderFoliageDepthPrepass();
 	void ensureShadowResources();
 	void destroyShadowResources();
+	void createShadowMomentTextures();
 	void buildShadowMaps();
 	void updateShadowMatrices();
+	void fitShadowCascades();
+	bool shadowCacheActive() const { return m_shadowCacheEnabled && !m_shadowFitToDepth; }
+	void updateShadowCache(const int cascade, const glm::vec3& requiredMin, const glm::vec3& requiredMax);
+	void drawShadowStaticCasters(const bool allInstances);
+	void drawShadowDynamicCasters();
+	void blurShadowMoments();
+	int registerMaterial(const MaterialDataGPU& material);
+	void uploadFrameBlocks();
+	GLintptr uploadViewBlock(const glm::mat4& viewMat, const glm::mat4& projMat);
 };
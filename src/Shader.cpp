@@ -1,4 +1,5 @@
 #include "Shader.h"
+#include "GLStateCache.h"
 
 
 // version: 221030
@@ -44,7 +45,7 @@ void Shader::releaseShader() {
 	this->m_shaderStatus = ShaderStatus::NULL_SHADER;
 	glDeleteShader(this->m_shaderId);	
 }
-bool Shader::createShaderFromFile(const std::string& fileFullpath) {
+bool Shader::createShaderFromFile(const std::string& fileFullpath, const std::string& defines) {
 	// read shader code from file
 	std::ifstream inputStream;
 	inputStream.exceptions(std::ifstream::failbit | std::ifstream::badbit);
@@ -64,6 +65,34 @@ bool Shader::createShaderFromFile(const std::string& fileFullpath) {
 		return false;
 	}
 
+	// expand #include "file" lines (resolved next to the including file), defines go after #version
+	const size_t slashPos = fileFullpath.find_last_of("\\/");
+	const std::string directory = (slashPos == std::string::npos) ? std::string() : fileFullpath.substr(0, slashPos + 1);
+	std::stringstream expandedStream;
+	std::istringstream lineStream(shaderCode);
+	std::string line;
+	while (std::getline(lineStream, line)) {
+		const size_t includePos = line.find("#include");
+		const bool isDirective = (includePos != std::string::npos) && (line.find_first_not_of(" \t") == includePos);
+		const size_t firstQuote = line.find('"');
+		const size_t lastQuote = line.rfind('"');
+		if (!isDirective || firstQuote == std::string::npos || lastQuote <= firstQuote) {
+			expandedStream << line << "\n";
+			if (line.compare(0, 8, "#version") == 0) {
+				expandedStream << defines;
+			}
+			continue;
+		}
+		std::ifstream includeStream(directory + line.substr(firstQuote + 1, lastQuote - firstQuote - 1));
+		if (!includeStream.is_open()) {
+			this->m_shaderInfoLog = "cannot open include: " + line;
+			this->m_shaderStatus = ShaderStatus::NULL_SHADER_CODE;
+			return false;
+		}
+		expandedStream << includeStream.rdbuf() << "\n";
+	}
+	shaderCode = expandedStream.str();
+
 	// append shader code
 	this->appendShaderCode(shaderCode);
 
@@ -146,7 +175,7 @@ void ShaderProgram::useProgram() {
 		return;
 	}
 
-	glUseProgram(this->m_programId);
+	GLStateCache::Instance()->useProgram(this->m_programId);
 }
 
 GLuint ShaderProgram::programId() const { return this->m_programId; }
@@ -28,7 +28,8 @@ public:
 	virtual ~Shader();
 
 public:
-	bool createShaderFromFile(const std::string& fileFullpath);
+	// defines: lines inserted after #version (e.g. "#define OVERDRAW_COUNT\n")
+	bool createShaderFromFile(const std::string& fileFullpath, const std::string& defines = std::string());
 	void appendShaderCode(const std::string& code);
 	bool compileShader();
 	void releaseShader();
@@ -0,0 +1,475 @@
+#include "SoftwareOcclusion.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SOFTWARE_OCCLUSION_SSE2 1
+#endif
+
+enum EdgeType {
+	EDGE_LOWER = 0,
+	EDGE_UPPER = 1,
+	EDGE_HORIZONTAL = 2
+};
+
+// near, left, right, bottom, top
+const int NUM_CLIP_PLANE = 5;
+// polygon of a triangle clipped by NUM_CLIP_PLANE planes
+const int MAX_CLIP_VERTEX = 3 + NUM_CLIP_PLANE;
+
+// bits [lo, hi) of a tile row
+static inline uint32_t spanMask(const int lo, const int hi) {
+	if (hi <= lo) return 0u;
+	const uint32_t below = (hi >= 32) ? 0xffffffffu : ((1u << hi) - 1u);
+	return below & ~((1u << lo) - 1u);
+}
+
+static inline bool isFull(const uint32_t mask[SoftwareOcclusionBuffer::TILE_H]) {
+	uint32_t all = 0xffffffffu;
+	for (int r = 0; r < SoftwareOcclusionBuffer::TILE_H; ++r) all &= mask[r];
+	return all == 0xffffffffu;
+}
+
+static inline bool isEmpty(const uint32_t mask[SoftwareOcclusionBuffer::TILE_H]) {
+	uint32_t any = 0u;
+	for (int r = 0; r < SoftwareOcclusionBuffer::TILE_H; ++r) any |= mask[r];
+	return any == 0u;
+}
+
+SoftwareOcclusionBuffer::SoftwareOcclusionBuffer()
+{
+}
+
+SoftwareOcclusionBuffer::~SoftwareOcclusionBuffer()
+{
+	this->stopWorkers();
+}
+
+void SoftwareOcclusionBuffer::resize(const int width, const int height) {
+	this->m_tilesX = std::max(1, (width + TILE_W - 1) / TILE_W);
+	this->m_tilesY = std::max(1, (height + TILE_H - 1) / TILE_H);
+	this->m_width = this->m_tilesX * TILE_W;
+	this->m_height = this->m_tilesY * TILE_H;
+	this->m_tiles.assign((size_t)this->m_tilesX * this->m_tilesY, Tile());
+}
+
+void SoftwareOcclusionBuffer::setNumWorkers(int numWorker) {
+	if (numWorker < 0) {
+		numWorker = std::max(0, (int)std::thread::hardware_concurrency() - 1);
+	}
+	this->stopWorkers();
+	this->startWorkers(numWorker);
+}
+
+void SoftwareOcclusionBuffer::startWorkers(const int numWorker) {
+	this->m_quit = false;
+	for (int i = 0; i < numWorker; ++i) {
+		this->m_workers.emplace_back(&SoftwareOcclusionBuffer::workerLoop, this);
+	}
+	this->m_workersStarted = true;
+}
+
+void SoftwareOcclusionBuffer::stopWorkers() {
+	{
+		std::lock_guard<std::mutex> lock(this->m_mutex);
+		this->m_quit = true;
+	}
+	this->m_wake.notify_all();
+	for (std::thread& worker : this->m_workers) {
+		worker.join();
+	}
+	this->m_workers.clear();
+	this->m_workersStarted = false;
+}
+
+void SoftwareOcclusionBuffer::workerLoop() {
+	unsigned int seenGeneration = 0;
+	for (;;) {
+		const std::function<void(int)>* job = nullptr;
+		int numJob = 0;
+		{
+			std::unique_lock<std::mutex> lock(this->m_mutex);
+			this->m_wake.wait(lock, [&]() { return this->m_quit || this->m_generation != seenGeneration; });
+			if (this->m_quit) return;
+			seenGeneration = this->m_generation;
+			job = this->m_job;
+			numJob = this->m_numJob;
+		}
+		for (int i = this->m_nextJob++; i < numJob; i = this->m_nextJob++) {
+			(*job)(i);
+		}
+		std::lock_guard<std::mutex> lock(this->m_mutex);
+		if (--this->m_busyWorkers == 0) {
+			this->m_done.notify_one();
+		}
+	}
+}
+
+void SoftwareOcclusionBuffer::parallelFor(const int numJob, const std::function<void(int)>& job) {
+	if (this->m_workers.empty() || numJob <= 1) {
+		for (int i = 0; i < numJob; ++i) job(i);
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(this->m_mutex);
+		this->m_job = &job;
+		this->m_numJob = numJob;
+		this->m_nextJob = 0;
+		this->m_busyWorkers = (int)this->m_workers.size();
+		this->m_generation++;
+	}
+	this->m_wake.notify_all();
+	for (int i = this->m_nextJob++; i < numJob; i = this->m_nextJob++) {
+		job(i);
+	}
+	std::unique_lock<std::mutex> lock(this->m_mutex);
+	this->m_done.wait(lock, [this]() { return this->m_busyWorkers == 0; });
+	this->m_job = nullptr;
+}
+
+void SoftwareOcclusionBuffer::begin(const glm::mat4& viewProj, const bool reversedZ) {
+	this->m_viewProj = viewProj;
+	this->m_reversedZ = reversedZ;
+	this->m_meshes.clear();
+	for (Tile& tile : this->m_tiles) {
+		std::fill(tile.mask, tile.mask + TILE_H, 0u);
+		tile.zMin[0] = 0.0f;
+		tile.zMin[1] = 0.0f;
+	}
+}
+
+void SoftwareOcclusionBuffer::addTriangles(const float* positions, const int numVertex, const int strideFloats, const uint32_t* indices, const int numIndex, const glm::mat4& model) {
+	if (positions == nullptr || indices == nullptr || numVertex <= 0 || numIndex < 3) return;
+	Mesh mesh;
+	mesh.positions = positions;
+	mesh.numVertex = numVertex;
+	mesh.strideFloats = strideFloats;
+	mesh.indices = indices;
+	mesh.numIndex = numIndex;
+	mesh.model = model;
+	this->m_meshes.push_back(mesh);
+}
+
+float SoftwareOcclusionBuffer::clipPlaneDistance(const glm::vec4& c, const int plane) const {
+	switch (plane) {
+	case 0: return this->m_reversedZ ? c.w - c.z : c.w + c.z;
+	case 1: return c.w + c.x;
+	case 2: return c.w - c.x;
+	case 3: return c.w + c.y;
+	default: return c.w - c.y;
+	}
+}
+
+float SoftwareOcclusionBuffer::nearness(const glm::vec4& c) const {
+	const float ndcZ = c.z / c.w;
+	return this->m_reversedZ ? ndcZ : 0.5f - 0.5f * ndcZ;
+}
+
+float SoftwareOcclusionBuffer::windowDepth(const float n) const {
+	const float clamped = std::min(std::max(n, 0.0f), 1.0f);
+	return this->m_reversedZ ? clamped : 1.0f - clamped;
+}
+
+void SoftwareOcclusionBuffer::rasterize() {
+	if (!this->m_workersStarted) {
+		this->setNumWorkers(-1);
+	}
+	if (this->m_setups.size() < this->m_meshes.size()) {
+		this->m_setups.resize(this->m_meshes.size());
+	}
+	const std::function<void(int)> setUp = [this](const int i) {
+		this->setUpMesh(this->m_meshes[i], this->m_setups[i]);
+	};
+	this->parallelFor((int)this->m_meshes.size(), setUp);
+
+	this->m_numRasterized = 0;
+	for (size_t i = 0; i < this->m_meshes.size(); ++i) {
+		this->m_numRasterized += (int)this->m_setups[i].triangles.size();
+	}
+	// a tile row is only touched by its own thread
+	const std::function<void(int)> rasterizeRow = [this](const int tileY) {
+		this->rasterizeTileRow(tileY);
+	};
+	this->parallelFor(this->m_tilesY, rasterizeRow);
+}
+
+void SoftwareOcclusionBuffer::setUpMesh(const Mesh& mesh, MeshSetup& setup) const {
+	const glm::mat4 mvp = this->m_viewProj * mesh.model;
+	setup.clip.resize(mesh.numVertex);
+	setup.outcodes.resize(mesh.numVertex);
+	setup.triangles.clear();
+	for (int v = 0; v < mesh.numVertex; ++v) {
+		const float* p = mesh.positions + (size_t)v * mesh.strideFloats;
+		const glm::vec4 c = mvp * glm::vec4(p[0], p[1], p[2], 1.0f);
+		uint8_t code = 0;
+		for (int plane = 0; plane < NUM_CLIP_PLANE; ++plane) {
+			if (this->clipPlaneDistance(c, plane) < 0.0f) code |= (uint8_t)(1u << plane);
+		}
+		setup.clip[v] = c;
+		setup.outcodes[v] = code;
+	}
+
+	for (int i = 0; i + 2 < mesh.numIndex; i += 3) {
+		const uint32_t idx[3] = { mesh.indices[i], mesh.indices[i + 1], mesh.indices[i + 2] };
+		if (idx[0] >= (uint32_t)mesh.numVertex || idx[1] >= (uint32_t)mesh.numVertex || idx[2] >= (uint32_t)mesh.numVertex) continue;
+		const uint8_t codeAnd = setup.outcodes[idx[0]] & setup.outcodes[idx[1]] & setup.outcodes[idx[2]];
+		const uint8_t codeOr = setup.outcodes[idx[0]] | setup.outcodes[idx[1]] | setup.outcodes[idx[2]];
+		if (codeAnd != 0) continue; // outside one plane
+		glm::vec4 polygon[MAX_CLIP_VERTEX] = { setup.clip[idx[0]], setup.clip[idx[1]], setup.clip[idx[2]] };
+		int numVertex = 3;
+		// Sutherland-Hodgman against the planes some vertex is outside of
+		for (int plane = 0; plane < NUM_CLIP_PLANE && numVertex >= 3; ++plane) {
+			if ((codeOr & (1u << plane)) == 0) continue;
+			glm::vec4 clipped[MAX_CLIP_VERTEX];
+			int numClipped = 0;
+			for (int v = 0; v < numVertex; ++v) {
+				const glm::vec4& a = polygon[v];
+				const glm::vec4& b = polygon[(v + 1) % numVertex];
+				const float da = this->clipPlaneDistance(a, plane);
+				const float db = this->clipPlaneDistance(b, plane);
+				if (da >= 0.0f) clipped[numClipped++] = a;
+				if ((da >= 0.0f) != (db >= 0.0f) && numClipped < MAX_CLIP_VERTEX) {
+					clipped[numClipped++] = a + (b - a) * (da / (da - db));
+				}
+			}
+			numVertex = numClipped;
+			std::copy(clipped, clipped + numClipped, polygon);
+		}
+		if (numVertex >= 3) {
+			this->setUpTriangle(polygon, numVertex, setup.triangles);
+		}
+	}
+}
+
+void SoftwareOcclusionBuffer::setUpTriangle(const glm::vec4* polygon, const int numVertex, std::vector<Triangle>& out) const {
+	// pixels, y up (window coordinates) and nearness
+	glm::vec3 s[MAX_CLIP_VERTEX];
+	for (int v = 0; v < numVertex; ++v) {
+		const glm::vec4& c = polygon[v];
+		if (!(c.w > 0.0f)) return;
+		s[v] = glm::vec3((c.x / c.w * 0.5f + 0.5f) * (float)this->m_width, (c.y / c.w * 0.5f + 0.5f) * (float)this->m_height, this->nearness(c));
+	}
+	for (int v = 1; v + 1 < numVertex; ++v) {
+		const glm::vec3 p[3] = { s[0], s[v], s[v + 1] };
+		const float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[2].x - p[0].x) * (p[1].y - p[0].y);
+		if (!(area > 0.0f)) continue; // back face or degenerate
+
+		Triangle tri;
+		tri.bboxMin[0] = std::max(std::min(p[0].x, std::min(p[1].x, p[2].x)), 0.0f);
+		tri.bboxMin[1] = std::max(std::min(p[0].y, std::min(p[1].y, p[2].y)), 0.0f);
+		tri.bboxMax[0] = std::min(std::max(p[0].x, std::max(p[1].x, p[2].x)), (float)this->m_width);
+		tri.bboxMax[1] = std::min(std::max(p[0].y, std::max(p[1].y, p[2].y)), (float)this->m_height);
+		// no pixel center inside the bounding box
+		if (std::ceil(tri.bboxMin[0] - 0.5f) > std::floor(tri.bboxMax[0] - 0.5f) ||
+			std::ceil(tri.bboxMin[1] - 0.5f) > std::floor(tri.bboxMax[1] - 0.5f)) continue;
+
+		for (int e = 0; e < 3; ++e) {
+			// inside: a * x + b * y + c >= 0 (left of the edge, counter-clockwise)
+			const glm::vec3& pi = p[e];
+			const glm::vec3& pj = p[(e + 1) % 3];
+			const float a = pi.y - pj.y;
+			const float b = pj.x - pi.x;
+			const float c = -(a * pi.x + b * pi.y);
+			if (a == 0.0f) {
+				tri.edgeType[e] = EDGE_HORIZONTAL;
+				tri.edgeK[e] = b;
+				tri.edgeM[e] = c;
+			} else {
+				tri.edgeType[e] = (a > 0.0f) ? EDGE_LOWER : EDGE_UPPER;
+				tri.edgeK[e] = -b / a;
+				tri.edgeM[e] = -c / a;
+			}
+		}
+		const float dx1 = p[1].x - p[0].x, dy1 = p[1].y - p[0].y, dz1 = p[1].z - p[0].z;
+		const float dx2 = p[2].x - p[0].x, dy2 = p[2].y - p[0].y, dz2 = p[2].z - p[0].z;
+		tri.zA = (dz1 * dy2 - dz2 * dy1) / area;
+		tri.zB = (dx1 * dz2 - dx2 * dz1) / area;
+		tri.zC = p[0].z - tri.zA * p[0].x - tri.zB * p[0].y;
+		tri.zMinTri = std::min(p[0].z, std::min(p[1].z, p[2].z));
+
+		tri.tileMin[0] = std::min((int)(tri.bboxMin[0] / (float)TILE_W), this->m_tilesX - 1);
+		tri.tileMin[1] = std::min((int)(tri.bboxMin[1] / (float)TILE_H), this->m_tilesY - 1);
+		tri.tileMax[0] = std::min((int)(tri.bboxMax[0] / (float)TILE_W), this->m_tilesX - 1);
+		tri.tileMax[1] = std::min((int)(tri.bboxMax[1] / (float)TILE_H), this->m_tilesY - 1);
+		out.push_back(tri);
+	}
+}
+
+void SoftwareOcclusionBuffer::coverage(const Triangle& tri, const int tileX, const int tileY, uint32_t mask[TILE_H]) const {
+	// column c of the tile has its pixel center at x = firstCenter + c
+	const float firstCenter = (float)(tileX * TILE_W) + 0.5f;
+	const float firstRowCenter = (float)(tileY * TILE_H) + 0.5f;
+	int lo[TILE_H], hi[TILE_H];
+#ifdef SOFTWARE_OCCLUSION_SSE2
+	// four rows per register: x span of every row, then column bounds
+	for (int half = 0; half < TILE_H; half += 4) {
+		const __m128 y = _mm_add_ps(_mm_set1_ps(firstRowCenter + (float)half), _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f));
+		__m128 xl = _mm_set1_ps(-FLT_MAX);
+		__m128 xr = _mm_set1_ps(FLT_MAX);
+		for (int e = 0; e < 3; ++e) {
+			const __m128 v = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(tri.edgeK[e]), y), _mm_set1_ps(tri.edgeM[e]));
+			if (tri.edgeType[e] == EDGE_LOWER) {
+				xl = _mm_max_ps(xl, v);
+			} else if (tri.edgeType[e] == EDGE_UPPER) {
+				xr = _mm_min_ps(xr, v);
+			} else {
+				const __m128 outside = _mm_cmplt_ps(v, _mm_setzero_ps());
+				xl = _mm_or_ps(_mm_and_ps(outside, _mm_set1_ps(FLT_MAX)), _mm_andnot_ps(outside, xl));
+			}
+		}
+		// relative to the first center, clamped to [-1, TILE_W + 1]; the offsets make truncation a floor
+		const __m128 minC = _mm_set1_ps(-1.0f), maxC = _mm_set1_ps((float)TILE_W + 1.0f);
+		const __m128 l = _mm_min_ps(_mm_max_ps(_mm_sub_ps(xl, _mm_set1_ps(firstCenter)), minC), maxC);
+		const __m128 r = _mm_min_ps(_mm_max_ps(_mm_sub_ps(xr, _mm_set1_ps(firstCenter)), minC), maxC);
+		const __m128i offset = _mm_set1_epi32(TILE_W + 2);
+		// ceil(l) = -floor(-l), floor(r) + 1
+		const __m128i ceilL = _mm_sub_epi32(offset, _mm_cvttps_epi32(_mm_add_ps(_mm_sub_ps(_mm_setzero_ps(), l), _mm_set1_ps((float)TILE_W + 2.0f))));
+		const __m128i floorR1 = _mm_sub_epi32(_mm_cvttps_epi32(_mm_add_ps(r, _mm_set1_ps((float)TILE_W + 2.0f))), _mm_set1_epi32(TILE_W + 1));
+		_mm_storeu_si128((__m128i*)(lo + half), ceilL);
+		_mm_storeu_si128((__m128i*)(hi + half), floorR1);
+	}
+#else
+	for (int row = 0; row < TILE_H; ++row) {
+		const float y = firstRowCenter + (float)row;
+		float xl = -FLT_MAX, xr = FLT_MAX;
+		for (int e = 0; e < 3; ++e) {
+			const float v = tri.edgeK[e] * y + tri.edgeM[e];
+			if (tri.edgeType[e] == EDGE_LOWER) xl = std::max(xl, v);
+			else if (tri.edgeType[e] == EDGE_UPPER) xr = std::min(xr, v);
+			else if (v < 0.0f) xl = FLT_MAX;
+		}
+		const float l = std::min(std::max(xl - firstCenter, -1.0f), (float)TILE_W + 1.0f);
+		const float r = std::min(std::max(xr - firstCenter, -1.0f), (float)TILE_W + 1.0f);
+		lo[row] = (int)std::ceil(l);
+		hi[row] = (int)std::floor(r) + 1;
+	}
+#endif
+	for (int row = 0; row < TILE_H; ++row) {
+		mask[row] = spanMask(std::max(lo[row], 0), std::min(hi[row], TILE_W));
+	}
+}
+
+void SoftwareOcclusionBuffer::rasterizeTileRow(const int tileY) {
+	const float rowMin = (float)(tileY * TILE_H), rowMax = rowMin + (float)TILE_H;
+	for (size_t m = 0; m < this->m_meshes.size(); ++m) {
+		for (const Triangle& tri : this->m_setups[m].triangles) {
+			if (tileY < tri.tileMin[1] || tileY > tri.tileMax[1]) continue;
+			// farthest point of the depth plane over tile ∩ bounding box: a corner
+			const float y0 = std::max(rowMin, tri.bboxMin[1]), y1 = std::min(rowMax, tri.bboxMax[1]);
+			const float zRow = tri.zC + std::min(tri.zB * y0, tri.zB * y1);
+			for (int tileX = tri.tileMin[0]; tileX <= tri.tileMax[0]; ++tileX) {
+				uint32_t cover[TILE_H];
+				this->coverage(tri, tileX, tileY, cover);
+				if (isEmpty(cover)) continue;
+				const float x0 = std::max((float)(tileX * TILE_W), tri.bboxMin[0]);
+				const float x1 = std::min((float)((tileX + 1) * TILE_W), tri.bboxMax[0]);
+				const float zTri = std::max(zRow + std::min(tri.zA * x0, tri.zA * x1), tri.zMinTri);
+
+				Tile& tile = this->m_tiles[(size_t)tileY * this->m_tilesX + tileX];
+				if (zTri <= tile.zMin[0]) continue; // not nearer than the tile layer
+				// start a new mask layer when the triangle is far nearer than the current one
+				if (isEmpty(tile.mask) || zTri - tile.zMin[1] > tile.zMin[1] - tile.zMin[0]) {
+					std::copy(cover, cover + TILE_H, tile.mask);
+					tile.zMin[1] = zTri;
+				} else {
+					for (int row = 0; row < TILE_H; ++row) tile.mask[row] |= cover[row];
+					tile.zMin[1] = std::min(tile.zMin[1], zTri);
+				}
+				if (isFull(tile.mask)) {
+					tile.zMin[0] = tile.zMin[1];
+					std::fill(tile.mask, tile.mask + TILE_H, 0u);
+					tile.zMin[1] = 0.0f;
+				}
+			}
+		}
+	}
+}
+
+bool SoftwareOcclusionBuffer::isRectVisible(int x0, int y0, int x1, int y1, const float nearness) const {
+	x0 = std::max(x0, 0);
+	y0 = std::max(y0, 0);
+	x1 = std::min(x1, this->m_width - 1);
+	y1 = std::min(y1, this->m_height - 1);
+	if (x1 < x0 || y1 < y0) return true;
+	for (int tileY = y0 / TILE_H; tileY <= y1 / TILE_H; ++tileY) {
+		const int rowLo = std::max(y0 - tileY * TILE_H, 0), rowHi = std::min(y1 - tileY * TILE_H, TILE_H - 1);
+		for (int tileX = x0 / TILE_W; tileX <= x1 / TILE_W; ++tileX) {
+			const Tile& tile = this->m_tiles[(size_t)tileY * this->m_tilesX + tileX];
+			if (nearness < tile.zMin[0]) continue; // behind the whole tile
+			const uint32_t columns = spanMask(std::max(x0 - tileX * TILE_W, 0), std::min(x1 - tileX * TILE_W, TILE_W - 1) + 1);
+			for (int row = rowLo; row <= rowHi; ++row) {
+				if ((columns & ~tile.mask[row]) != 0u) return true;
+			}
+			if (!(nearness < tile.zMin[1])) return true;
+		}
+	}
+	return false;
+}
+
+bool SoftwareOcclusionBuffer::isSphereVisible(const glm::vec3& center, const float radius) const {
+	glm::vec2 ndcMin(FLT_MAX), ndcMax(-FLT_MAX);
+	float nearest = -FLT_MAX;
+	for (int i = 0; i < 8; ++i) {
+		const glm::vec3 corner = center + radius * glm::vec3((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f);
+		const glm::vec4 c = this->m_viewProj * glm::vec4(corner, 1.0f);
+		if (!(c.w > 0.0f) || this->clipPlaneDistance(c, 0) < 0.0f) return true; // reaches the near plane
+		ndcMin = glm::min(ndcMin, glm::vec2(c.x, c.y) / c.w);
+		ndcMax = glm::max(ndcMax, glm::vec2(c.x, c.y) / c.w);
+		nearest = std::max(nearest, this->nearness(c));
+	}
+	// pixels the box overlaps
+	const float sx0 = (ndcMin.x * 0.5f + 0.5f) * (float)this->m_width, sx1 = (ndcMax.x * 0.5f + 0.5f) * (float)this->m_width;
+	const float sy0 = (ndcMin.y * 0.5f + 0.5f) * (float)this->m_height, sy1 = (ndcMax.y * 0.5f + 0.5f) * (float)this->m_height;
+	if (sx1 < 0.0f || sy1 < 0.0f || sx0 > (float)this->m_width || sy0 > (float)this->m_height) return true; // off-screen
+	const int x0 = (int)std::floor(std::max(sx0, 0.0f)), y0 = (int)std::floor(std::max(sy0, 0.0f));
+	const int x1 = std::max((int)std::ceil(std::min(sx1, (float)this->m_width)) - 1, x0);
+	const int y1 = std::max((int)std::ceil(std::min(sy1, (float)this->m_height)) - 1, y0);
+	return this->isRectVisible(x0, y0, x1, y1, nearest);
+}
+
+void SoftwareOcclusionBuffer::resolveDepthPyramid(std::vector<std::vector<float>>& levels) const {
+	int numLevel = 1;
+	while ((std::max(this->m_width, this->m_height) >> numLevel) > 0) numLevel++;
+	levels.resize(numLevel);
+
+	// nearness first (farthest = min), window depth at the end
+	std::vector<float>& level0 = levels[0];
+	level0.resize((size_t)this->m_width * this->m_height);
+	for (int tileY = 0; tileY < this->m_tilesY; ++tileY) {
+		for (int tileX = 0; tileX < this->m_tilesX; ++tileX) {
+			const Tile& tile = this->m_tiles[(size_t)tileY * this->m_tilesX + tileX];
+			const float masked = std::max(tile.zMin[0], tile.zMin[1]);
+			for (int row = 0; row < TILE_H; ++row) {
+				float* dst = &level0[(size_t)(tileY * TILE_H + row) * this->m_width + tileX * TILE_W];
+				for (int col = 0; col < TILE_W; ++col) {
+					dst[col] = ((tile.mask[row] >> col) & 1u) ? masked : tile.zMin[0];
+				}
+			}
+		}
+	}
+	for (int l = 1; l < numLevel; ++l) {
+		const int srcW = std::max(this->m_width >> (l - 1), 1), srcH = std::max(this->m_height >> (l - 1), 1);
+		const int dstW = std::max(this->m_width >> l, 1), dstH = std::max(this->m_height >> l, 1);
+		const std::vector<float>& src = levels[l - 1];
+		std::vector<float>& dst = levels[l];
+		dst.resize((size_t)dstW * dstH);
+		for (int y = 0; y < dstH; ++y) {
+			const int sy1 = std::min((y == dstH - 1) ? srcH : 2 * y + 2, srcH);
+			for (int x = 0; x < dstW; ++x) {
+				const int sx1 = std::min((x == dstW - 1) ? srcW : 2 * x + 2, srcW);
+				float farthest = FLT_MAX;
+				for (int sy = 2 * y; sy < sy1; ++sy) {
+					for (int sx = 2 * x; sx < sx1; ++sx) {
+						farthest = std::min(farthest, src[(size_t)sy * srcW + sx]);
+					}
+				}
+				dst[(size_t)y * dstW + x] = farthest;
+			}
+		}
+	}
+	for (std::vector<float>& level : levels) {
+		for (float& v : level) v = this->windowDepth(v);
+	}
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+// CPU occlusion buffer in the style of masked software occlusion culling (Andersson, Hasselgren and
+// Akenine-Moller): occluders are rasterized at low resolution into tiles of 32x8 pixels. A tile keeps
+// no per-pixel depth, only a coverage mask and two conservative farthest depths, zMin[0] for the
+// whole tile and zMin[1] for the pixels in the mask. Triangles merge into the mask layer, which
+// replaces the tile layer once the mask is full.
+//
+// Depth is stored as "nearness": 1 at the near plane, 0 at the far plane (1 - window depth, or the
+// window depth with reversed-Z), which is linear in screen space like the depth buffer. Coverage is
+// sampled at pixel centers, so triangles sharing an edge leave no cracks.
+//
+// addTriangles() only queues a mesh. rasterize() transforms, clips and sets up the triangles of every
+// queued mesh in parallel, then rasterizes every row of tiles on one thread, all meshes in submission
+// order (front to back gives the tightest masks).
+class SoftwareOcclusionBuffer
+{
+public:
+	static const int TILE_W = 32;
+	static const int TILE_H = 8;
+
+	SoftwareOcclusionBuffer();
+	virtual ~SoftwareOcclusionBuffer();
+
+public:
+	// rounded up to whole tiles
+	void resize(const int width, const int height);
+	// worker threads besides the caller; < 0: hardware concurrency - 1
+	void setNumWorkers(int numWorker);
+	// clears the buffer; viewProj: GL clip space, reversedZ: [0,1] clip depth with near = 1
+	void begin(const glm::mat4& viewProj, const bool reversedZ);
+	// positions: xyz of numVertex vertices, strideFloats apart; indices: counter-clockwise triangles
+	// (back faces are skipped, as with GL_CULL_FACE). The arrays must stay alive until rasterize().
+	void addTriangles(const float* positions, const int numVertex, const int strideFloats, const uint32_t* indices, const int numIndex, const glm::mat4& model);
+	void rasterize();
+
+public:
+	// false when every pixel of [x0, x1] x [y0, y1] has occluders nearer than `nearness`
+	bool isRectVisible(int x0, int y0, int x1, int y1, const float nearness) const;
+	// the projected bounding box of the sphere, as cullInstances.comp does it
+	bool isSphereVisible(const glm::vec3& center, const float radius) const;
+	// farthest occluder of every pixel as window depth: level 0, then the farthest of each 2x2 block
+	// (the last texel of an odd-sized level also covers the extra row / column)
+	void resolveDepthPyramid(std::vector<std::vector<float>>& levels) const;
+
+	int width() const { return m_width; }
+	int height() const { return m_height; }
+	// of the last rasterize(): after clipping and back face culling
+	int numRasterizedTriangles() const { return m_numRasterized; }
+
+private:
+	struct Tile {
+		uint32_t mask[TILE_H];
+		float zMin[2];
+	};
+	// edges as x bounds per row: x >= k * y + m (lower), x <= k * y + m (upper), or a horizontal
+	// edge whose rows are inside when k * y + m >= 0
+	struct Triangle {
+		float edgeK[3];
+		float edgeM[3];
+		int edgeType[3]; // EDGE_*
+		float zA, zB, zC; // nearness plane in pixels
+		float zMinTri;
+		float bboxMin[2], bboxMax[2];
+		int tileMin[2], tileMax[2];
+	};
+	struct Mesh {
+		const float* positions = nullptr;
+		int numVertex = 0;
+		int strideFloats = 3;
+		const uint32_t* indices = nullptr;
+		int numIndex = 0;
+		glm::mat4 model = glm::mat4(1.0f);
+	};
+	struct MeshSetup {
+		std::vector<glm::vec4> clip;
+		std::vector<uint8_t> outcodes; // bit per clip plane the vertex is outside of
+		std::vector<Triangle> triangles;
+	};
+
+	void startWorkers(const int numWorker);
+	void stopWorkers();
+	void setUpMesh(const Mesh& mesh, MeshSetup& setup) const;
+	void setUpTriangle(const glm::vec4* polygon, const int numVertex, std::vector<Triangle>& out) const;
+	void rasterizeTileRow(const int tileY);
+	void coverage(const Triangle& tri, const int tileX, const int tileY, uint32_t mask[TILE_H]) const;
+	float clipPlaneDistance(const glm::vec4& clip, const int plane) const;
+	float nearness(const glm::vec4& clip) const;
+	float windowDepth(const float nearness) const;
+	// runs job(0 .. numJob - 1) on the workers and the calling thread
+	void parallelFor(const int numJob, const std::function<void(int)>& job);
+	void workerLoop();
+
+	int m_width = 0;
+	int m_height = 0;
+	int m_tilesX = 0;
+	int m_tilesY = 0;
+	std::vector<Tile> m_tiles;
+	glm::mat4 m_viewProj = glm::mat4(1.0f);
+	bool m_reversedZ = false;
+	std::vector<Mesh> m_meshes;
+	std::vector<MeshSetup> m_setups;
+	int m_numRasterized = 0;
+
+	// persistent workers; a job batch is identified by m_generation
+	bool m_workersStarted = false;
+	std::vector<std::thread> m_workers;
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_done;
+	const std::function<void(int)>* m_job = nullptr;
+	int m_numJob = 0;
+	std::atomic<int> m_nextJob{ 0 };
+	int m_busyWorkers = 0;
+	unsigned int m_generation = 0;
+	bool m_quit = false;
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+// C++ mirrors of the std140 blocks in shaders/uniformBlocks.glsl.
+// Every member is a vec4 / mat4 (or array of them), so std140 and C++ layouts match.
+
+enum UniformBlockBinding {
+	UBO_FRAME_BINDING = 0,
+	UBO_VIEW_BINDING = 1,
+	UBO_MATERIAL_BINDING = 2,
+	UBO_CULL_BINDING = 3,
+	UBO_SHADOW_BINDING = 4
+};
+
+const int MAX_NUM_MATERIAL = 32;
+const int MAX_SHADOW_CASCADES = 4;
+
+struct FrameBlockGPU {
+	glm::mat4 cullVP;
+	glm::mat4 cullViewMat;
+	glm::vec4 lightDirWorld;
+	glm::ivec4 shadowFlags; // shadows enabled, cascade visualization, number of cascades
+	glm::ivec4 depthFlags; // x: reversed-Z
+	glm::vec4 shadowFit; // cascade fit: min distance, max distance, split lambda, caster distance
+	glm::ivec4 shadowMapInfo; // x: shadow map size
+};
+
+struct ViewBlockGPU {
+	glm::mat4 viewMat;
+	glm::mat4 projMat;
+	glm::mat4 invProjMat;
+	glm::vec4 cameraPosWorld;
+};
+
+struct MaterialDataGPU {
+	glm::vec4 ambient = glm::vec4(1.0f);
+	glm::vec4 specularShininess = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	glm::ivec4 flags = glm::ivec4(0); // pixel process id, vertex process id, use normal map
+};
+
+struct MaterialBlockGPU {
+	MaterialDataGPU materials[MAX_NUM_MATERIAL];
+};
+
+// also the std430 output of shadowCascadeFit.comp (same layout)
+struct ShadowBlockGPU {
+	glm::mat4 lightVP[MAX_SHADOW_CASCADES];
+	glm::vec4 cascadeFar; // view depth where each cascade ends
+	glm::vec4 depthRange; // xy: view depth range covered by the cascades
+};
+
+struct CullBlockGPU {
+	glm::vec4 frustumPlanes[6];
+	glm::vec4 cullParams; // max view depth, occlusion bias, screen size
+	glm::uvec4 cullFlags; // instances to cull, use occlusion, fixed mip level, depth bins (front-to-back)
+	glm::uvec4 cullInfo;  // x: batch index (CullStats record), y: write per-instance reasons, z: software occlusion buffer, w: PVS ranges (0: all)
+	glm::vec4 impostorParams = glm::vec4(0.0f); // x: impostor distance (0: none)
+};
+
+static_assert(sizeof(FrameBlockGPU) == 2 * 64 + 5 * 16, "FrameBlock must match std140 layout");
+static_assert(sizeof(ViewBlockGPU) == 3 * 64 + 16, "ViewBlock must match std140 layout");
+static_assert(sizeof(MaterialDataGPU) == 48, "MaterialData must match std140 layout");
+static_assert(sizeof(ShadowBlockGPU) == MAX_SHADOW_CASCADES * 64 + 2 * 16, "ShadowBlock must match std140 layout");
+static_assert(sizeof(CullBlockGPU) == 10 * 16, "CullBlock must match std140 layout");
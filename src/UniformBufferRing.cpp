@@ -0,0 +1,120 @@
+#include "UniformBufferRing.h"
+#include "GLStateCache.h"
+#include "CpuProfiler.h"
+#include <cassert>
+#include <cstring>
+#include <iostream>
+
+UniformBufferRing::UniformBufferRing()
+{
+}
+
+UniformBufferRing::~UniformBufferRing()
+{
+	this->release();
+}
+
+bool UniformBufferRing::init(const GLsizeiptr regionSize, const int numRegion) {
+	this->release();
+	if (regionSize <= 0 || numRegion <= 0 || numRegion > 4) {
+		return false;
+	}
+
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &this->m_offsetAlignment);
+	if (this->m_offsetAlignment <= 0) { this->m_offsetAlignment = 256; }
+
+	// keep every region start aligned so bindRange offsets stay valid
+	const GLsizeiptr align = this->m_offsetAlignment;
+	this->m_regionSize = ((regionSize + align - 1) / align) * align;
+	this->m_numRegion = numRegion;
+
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glCreateBuffers(1, &this->m_bufferHandle);
+	glNamedBufferStorage(this->m_bufferHandle, this->m_regionSize * numRegion, nullptr, flags);
+	this->m_mappedPtr = (unsigned char*)glMapNamedBufferRange(this->m_bufferHandle, 0, this->m_regionSize * numRegion, flags);
+	if (this->m_mappedPtr == nullptr) {
+		this->release();
+		return false;
+	}
+
+	this->m_currRegion = -1;
+	this->m_writeOffset = 0;
+	return true;
+}
+
+void UniformBufferRing::release() {
+	for (int i = 0; i < 4; ++i) {
+		if (this->m_fences[i] != nullptr) {
+			glDeleteSync(this->m_fences[i]);
+			this->m_fences[i] = nullptr;
+		}
+	}
+	if (this->m_bufferHandle != 0) {
+		if (this->m_mappedPtr != nullptr) {
+			glUnmapNamedBuffer(this->m_bufferHandle);
+		}
+		glDeleteBuffers(1, &this->m_bufferHandle);
+		this->m_bufferHandle = 0;
+	}
+	this->m_mappedPtr = nullptr;
+	this->m_numRegion = 0;
+	this->m_currRegion = -1;
+	this->m_writeOffset = 0;
+}
+
+void UniformBufferRing::beginFrame() {
+	if (this->m_mappedPtr == nullptr) { return; }
+
+	// previous frame's commands are all submitted: fence its region
+	if (this->m_currRegion >= 0) {
+		if (this->m_fences[this->m_currRegion] != nullptr) {
+			glDeleteSync(this->m_fences[this->m_currRegion]);
+		}
+		this->m_fences[this->m_currRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	this->m_currRegion = (this->m_currRegion + 1) % this->m_numRegion;
+	this->m_writeOffset = 0;
+	this->m_numOverflow = 0;
+
+	// wait until the GPU is done with the region we are about to overwrite (normally already signaled)
+	GLsync fence = this->m_fences[this->m_currRegion];
+	if (fence != nullptr) {
+		CPU_PROFILE_SCOPE("Uniform ring fence wait");
+		GLbitfield waitFlags = 0;
+		for (;;) {
+			const GLenum result = glClientWaitSync(fence, waitFlags, 1000000);
+			if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED) {
+				break;
+			}
+			waitFlags = GL_SYNC_FLUSH_COMMANDS_BIT;
+		}
+		glDeleteSync(fence);
+		this->m_fences[this->m_currRegion] = nullptr;
+	}
+}
+
+GLintptr UniformBufferRing::write(const void* data, const GLsizeiptr dataByte) {
+	if (this->m_mappedPtr == nullptr || this->m_currRegion < 0) { return -1; }
+	if (this->m_writeOffset + dataByte > this->m_regionSize) {
+		if (this->m_numOverflow++ == 0) {
+			std::cerr << "UniformBufferRing: frame region of " << this->m_regionSize << " bytes is full, dropping blocks of this frame\n";
+		}
+		assert(!"UniformBufferRing region overflow");
+		return -1;
+	}
+
+	const GLintptr offset = this->m_currRegion * this->m_regionSize + this->m_writeOffset;
+	std::memcpy(this->m_mappedPtr + offset, data, (size_t)dataByte);
+	GLStateCache::Instance()->countUpload(dataByte);
+
+	const GLsizeiptr align = this->m_offsetAlignment;
+	this->m_writeOffset += ((dataByte + align - 1) / align) * align;
+	return offset;
+}
+
+void UniformBufferRing::bindRange(const GLuint binding, const GLintptr offset, const GLsizeiptr dataByte) const {
+	assert(offset >= 0 && "bindRange of a failed write()");
+	if (offset < 0 || this->m_bufferHandle == 0) { return; }
+	GLStateCache::Instance()->bindUniformBufferRange(binding, this->m_bufferHandle, offset, dataByte);
+}
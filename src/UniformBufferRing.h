@@ -0,0 +1,43 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// Persistently mapped uniform buffer split into N frame regions.
+// Each frame writes its constants into the current region and binds them by offset;
+// a fence per region keeps the CPU from overwriting data the GPU is still reading.
+class UniformBufferRing
+{
+public:
+	UniformBufferRing();
+	virtual ~UniformBufferRing();
+
+public:
+	bool init(const GLsizeiptr regionSize, const int numRegion = 3);
+	void release();
+
+	// Fence the region used by the previous frame, advance, and wait until the next region is free.
+	void beginFrame();
+	// Copy data into the current region. Returns the byte offset inside the buffer, or -1 if the region is full
+	// (asserts, and logs once per frame: the region must be sized for the frame's blocks).
+	GLintptr write(const void* data, const GLsizeiptr dataByte);
+	// offset must come from a successful write()
+	void bindRange(const GLuint binding, const GLintptr offset, const GLsizeiptr dataByte) const;
+
+public:
+	GLuint bufferId() const { return m_bufferHandle; }
+	GLsizeiptr regionSize() const { return m_regionSize; }
+	GLsizeiptr usedBytes() const { return m_writeOffset; }
+	// writes dropped because the region was full, this frame
+	int numOverflow() const { return m_numOverflow; }
+
+private:
+	GLuint m_bufferHandle = 0;
+	unsigned char* m_mappedPtr = nullptr;
+	GLsync m_fences[4] = { nullptr, nullptr, nullptr, nullptr };
+	int m_numRegion = 0;
+	int m_currRegion = -1;
+	GLsizeiptr m_regionSize = 0;
+	GLsizeiptr m_writeOffset = 0;
+	GLint m_offsetAlignment = 256;
+	int m_numOverflow = 0;
+};
@@ -1,9 +1,9 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include "ViewFrustumSceneObject.h"
 
-#include <glm\mat4x4.hpp>
-#include <glm\gtx\transform.hpp>
-#include <glm\gtc\type_ptr.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/gtx/transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
 
 
 
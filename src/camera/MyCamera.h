@@ -1,7 +1,7 @@
 #pragma once
 
-#include <glm\gtx\transform.hpp>
-#include <glm\mat4x4.hpp>
+#include <glm/gtx/transform.hpp>
+#include <glm/mat4x4.hpp>
 
 namespace INANOA {
 
@@ -7,6 +7,9 @@
 #include <cstring>
 #include <vector>
 #include <string>
+#include <chrono>
+#include <sstream>
+#include <cstdlib>
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 #include <assimp/Importer.hpp>
@@ -15,15 +18,25 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/transform.hpp>
 #include <GLFW/glfw3.h>
+#if defined(CG_HAS_EGL)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
 
 #include "Shader.h"
 #include "SceneRenderer.h"
 #include "MyImGuiPanel.h"
 #include "FrustumUtils.h"
+#include "MeshImport.h"
+#include "GpuProfiler.h"
+#include "CpuProfiler.h"
+#include "Benchmark.h"
+#include "JsonEscape.h"
+#include "SceneGenerator.h"
 
 #include "ViewFrustumSceneObject.h"
 #include "DynamicSceneObject.h"
-#include "terrain\MyTerrain.h"
+#include "terrain/MyTerrain.h"
 #include "MyCameraManager.h"
 
 const int INIT_WIDTH = 1920;
@@ -46,19 +59,40 @@ MyTerrain* m_terrain = nullptr;
 INANOA::MyCameraManager* m_myCameraManager = nullptr;
 DynamicSceneObject* m_airplaneSO = nullptr;
 DynamicSceneObject* m_magicStoneSO = nullptr;
+// terrain and instance batches to load (--scene / --generate-scene)
+SceneDescription m_sceneDescription = SceneDescription::defaultScene();
+std::string m_scenePath = "default";
 
 bool g_useNormalMap = false;
-int g_gbufferViewMode = 5; // 0:pos,1:normal,2:ambient,3:diffuse,4:specular,5:default
+int g_gbufferViewMode = 5; // 0:pos,1:normal,2:ambient,3:diffuse,4:specular,5:default,6:depth mip,7:overdraw
 bool g_depthVizSplit = false;
 int g_depthMipLevel = 0;
 float g_depthVisGamma = 1.0f;
+bool g_reversedZ = false;
 bool g_occlusionEnabled = true;
-float g_occlusionBias = 0.0005f;
+bool g_softwareOcclusion = false;
+bool g_pvsEnabled = true; // when the scene has a PVS
+bool g_impostorsEnabled = true; // batches with an impostor distance
+bool g_clusterCullingEnabled = true; // occluder batches with clusters
+float g_occlusionBias = 0.0005f; // depth units, or a fraction of the view distance with reversed-Z
 bool g_occlusionFixedMipOverride = false;
 int g_occlusionFixedMipLevel = 0;
 float g_maxCullDepth = 400.0f;
+bool g_depthSortEnabled = false;
+bool g_foliagePrepassEnabled = false;
+bool g_fragmentStatsEnabled = false;
+bool g_cullOverlayEnabled = false;
+int g_cullOverlayBatch = -1; // -1: all batches
+unsigned int g_cullOverlayReasonMask = (1u << CULL_REASON_COUNT) - 1u;
+bool g_cullOverlayBoxes = false;
 bool g_shadowEnabled = false;
 bool g_shadowCascadeViz = false;
+bool g_shadowFitToDepth = false;
+bool g_shadowPracticalSplits = false;
+int g_numShadowCascades = 3;
+int g_shadowMapSize = 2048;
+bool g_shadowCacheEnabled = false;
+bool g_shadowMomentsEnabled = false;
 // ==============================================
 
 void resize_impl(int w, int h);
@@ -90,8 +124,8 @@ GLuint createTextureFromFile(const std::string& fileFullPath) {
 
 DynamicSceneObject* createAirplaneSceneObject()
 {
-	const std::string modelPath = "assets\\outdoor\\airplane.obj";
-	const std::string texturePath = "assets\\outdoor\\Airplane_smooth_DefaultMaterial_BaseMap.jpg";
+	const std::string modelPath = "assets/outdoor/airplane.obj";
+	const std::string texturePath = "assets/outdoor/Airplane_smooth_DefaultMaterial_BaseMap.jpg";
 
 	Assimp::Importer importer;
 	const aiScene* scene = importer.ReadFile(modelPath,
@@ -105,38 +139,13 @@ DynamicSceneObject* createAirplaneSceneObject()
 	}
 
 	const aiMesh* mesh = scene->mMeshes[0];
-	const bool hasUV = mesh->HasTextureCoords(0);
 
 	const int numVertices = static_cast<int>(mesh->mNumVertices);
 	const int numIndices = static_cast<int>(mesh->mNumFaces * 3);
 
 	DynamicSceneObject* airplane = new DynamicSceneObject(numVertices, numIndices, true, true);
 
-	float* dataBuffer = airplane->dataBuffer();
-	for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-		const aiVector3D& v = mesh->mVertices[i];
-		const aiVector3D uv = hasUV ? mesh->mTextureCoords[0][i] : aiVector3D(0.0f, 0.0f, 0.0f);
-
-		dataBuffer[i * 11 + 0] = v.x;
-		dataBuffer[i * 11 + 1] = v.y;
-		dataBuffer[i * 11 + 2] = v.z;
-		dataBuffer[i * 11 + 3] = mesh->mNormals[i].x;
-		dataBuffer[i * 11 + 4] = mesh->mNormals[i].y;
-		dataBuffer[i * 11 + 5] = mesh->mNormals[i].z;
-		dataBuffer[i * 11 + 6] = mesh->mTangents ? mesh->mTangents[i].x : 0.0f;
-		dataBuffer[i * 11 + 7] = mesh->mTangents ? mesh->mTangents[i].y : 0.0f;
-		dataBuffer[i * 11 + 8] = mesh->mTangents ? mesh->mTangents[i].z : 0.0f;
-		dataBuffer[i * 11 + 9] = uv.x;
-		dataBuffer[i * 11 + 10] = uv.y;
-	}
-
-	unsigned int* indexBuffer = airplane->indexBuffer();
-	for (unsigned int f = 0; f < mesh->mNumFaces; f++) {
-		const aiFace& face = mesh->mFaces[f];
-		indexBuffer[f * 3 + 0] = face.mIndices[0];
-		indexBuffer[f * 3 + 1] = face.mIndices[1];
-		indexBuffer[f * 3 + 2] = face.mIndices[2];
-	}
+	interleaveAiMesh(mesh, airplane->dataBuffer(), airplane->indexBuffer());
 
 	airplane->updateDataBuffer(0, numVertices * 11 * sizeof(float));
 	airplane->updateIndexBuffer(0, numIndices * sizeof(unsigned int));
@@ -154,8 +163,8 @@ DynamicSceneObject* createAirplaneSceneObject()
 
 DynamicSceneObject* createMagicStoneSceneObject()
 {
-	const std::string modelPath = "assets\\outdoor\\MagicRock\\magicRock.obj";
-	const std::string texturePath = "assets\\outdoor\\MagicRock\\StylMagicRocks_AlbedoTransparency.png";
+	const std::string modelPath = "assets/outdoor/MagicRock/magicRock.obj";
+	const std::string texturePath = "assets/outdoor/MagicRock/StylMagicRocks_AlbedoTransparency.png";
 
 	Assimp::Importer importer;
 	const aiScene* scene = importer.ReadFile(modelPath,
@@ -169,38 +178,13 @@ DynamicSceneObject* createMagicStoneSceneObject()
 	}
 
 	const aiMesh* mesh = scene->mMeshes[0];
-	const bool hasUV = mesh->HasTextureCoords(0);
 
 	const int numVertices = static_cast<int>(mesh->mNumVertices);
 	const int numIndices = static_cast<int>(mesh->mNumFaces * 3);
 
 	DynamicSceneObject* stone = new DynamicSceneObject(numVertices, numIndices, true, true);
 
-	float* dataBuffer = stone->dataBuffer();
-	for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-		const aiVector3D& v = mesh->mVertices[i];
-		const aiVector3D uv = hasUV ? mesh->mTextureCoords[0][i] : aiVector3D(0.0f, 0.0f, 0.0f);
-
-		dataBuffer[i * 11 + 0] = v.x;
-		dataBuffer[i * 11 + 1] = v.y;
-		dataBuffer[i * 11 + 2] = v.z;
-		dataBuffer[i * 11 + 3] = mesh->mNormals[i].x;
-		dataBuffer[i * 11 + 4] = mesh->mNormals[i].y;
-		dataBuffer[i * 11 + 5] = mesh->mNormals[i].z;
-		dataBuffer[i * 11 + 6] = mesh->mTangents ? mesh->mTangents[i].x : 0.0f;
-		dataBuffer[i * 11 + 7] = mesh->mTangents ? mesh->mTangents[i].y : 0.0f;
-		dataBuffer[i * 11 + 8] = mesh->mTangents ? mesh->mTangents[i].z : 0.0f;
-		dataBuffer[i * 11 + 9] = uv.x;
-		dataBuffer[i * 11 + 10] = uv.y;
-	}
-
-	unsigned int* indexBuffer = stone->indexBuffer();
-	for (unsigned int f = 0; f < mesh->mNumFaces; f++) {
-		const aiFace& face = mesh->mFaces[f];
-		indexBuffer[f * 3 + 0] = face.mIndices[0];
-		indexBuffer[f * 3 + 1] = face.mIndices[1];
-		indexBuffer[f * 3 + 2] = face.mIndices[2];
-	}
+	interleaveAiMesh(mesh, stone->dataBuffer(), stone->indexBuffer());
 
 	stone->updateDataBuffer(0, numVertices * 11 * sizeof(float));
 	stone->updateIndexBuffer(0, numIndices * sizeof(unsigned int));
@@ -212,7 +196,7 @@ DynamicSceneObject* createMagicStoneSceneObject()
 	if (albedoTex != 0) {
 		stone->setAlbedoTexture(albedoTex);
 	}
-	const GLuint normalTex = createTextureFromFile("assets\\outdoor\\MagicRock\\StylMagicRocks_NormalOpenGL.png");
+	const GLuint normalTex = createTextureFromFile("assets/outdoor/MagicRock/StylMagicRocks_NormalOpenGL.png");
 	if (normalTex != 0) {
 		stone->setNormalTexture(normalTex);
 	}
@@ -226,12 +210,12 @@ bool on_init(int displayWidth, int displayHeight)
 	// initialize shader program
 	// vertex shader
 	Shader* vsShader = new Shader(GL_VERTEX_SHADER);
-	vsShader->createShaderFromFile("shaders\\oglVertexShader.glsl");
+	vsShader->createShaderFromFile("shaders/oglVertexShader.glsl");
 	std::cout << vsShader->shaderInfoLog() << "\n";
 
 	// fragment shader
 	Shader* fsShader = new Shader(GL_FRAGMENT_SHADER);
-	fsShader->createShaderFromFile("shaders\\oglFragmentShader.glsl");
+	fsShader->createShaderFromFile("shaders/oglFragmentShader.glsl");
 	std::cout << fsShader->shaderInfoLog() << "\n";
 
 	// shader program
@@ -253,7 +237,7 @@ bool on_init(int displayWidth, int displayHeight)
 	// =================================================================
 	// init renderer
 	defaultRenderer = new SceneRenderer();
-	if (!defaultRenderer->initialize(displayWidth, displayHeight, shaderProgram)) { return false; }
+	if (!defaultRenderer->initialize(displayWidth, displayHeight, shaderProgram, m_sceneDescription)) { return false; }
 
 	// =================================================================
 	// initialize camera
@@ -261,25 +245,25 @@ bool on_init(int displayWidth, int displayHeight)
 	m_myCameraManager->init(displayWidth, displayHeight);
 
 	// initialize view frustum
-	m_viewFrustumSO = new ViewFrustumSceneObject(2, SceneManager::Instance()->m_fs_pixelProcessIdHandle, SceneManager::Instance()->m_fs_pureColor);
-	defaultRenderer->appendDynamicSceneObject(m_viewFrustumSO->sceneObject());
+	m_viewFrustumSO = new ViewFrustumSceneObject(2, SceneManager::Instance()->m_materialIndexHandle, SceneManager::Instance()->m_fs_pureColor);
+	if (!defaultRenderer->appendDynamicSceneObject(m_viewFrustumSO->sceneObject())) { return false; }
 
 	// initialize airplane
 	m_airplaneSO = createAirplaneSceneObject();
-	if (m_airplaneSO != nullptr) {
-		defaultRenderer->appendDynamicSceneObject(m_airplaneSO);
-	}
+	if (m_airplaneSO != nullptr && !defaultRenderer->appendDynamicSceneObject(m_airplaneSO)) { return false; }
 
 	// initialize magic stone
 	m_magicStoneSO = createMagicStoneSceneObject();
-	if (m_magicStoneSO != nullptr) {
-		defaultRenderer->appendDynamicSceneObject(m_magicStoneSO);
-	}
+	if (m_magicStoneSO != nullptr && !defaultRenderer->appendDynamicSceneObject(m_magicStoneSO)) { return false; }
 
 	// initialize terrain
 	m_terrain = new MyTerrain();
-	m_terrain->init(-1);
-	defaultRenderer->appendTerrainSceneObject(m_terrain->sceneObject());
+	if (!m_terrain->init(m_sceneDescription.elevationPath, m_sceneDescription.chunkDataPath, m_sceneDescription.chunkSize)) {
+		std::cerr << "cannot load terrain " << m_sceneDescription.elevationPath << " / " << m_sceneDescription.chunkDataPath << "\n";
+		return false;
+	}
+	if (!defaultRenderer->appendTerrainSceneObject(m_terrain->sceneObject())) { return false; }
+	defaultRenderer->setOcclusionTerrain(m_terrain->terrainData());
 	// =================================================================	
 
 	resize_impl(displayWidth, displayHeight);
@@ -302,47 +286,6 @@ void on_destroy()
 	delete m_imguiPanel;
 }
 
-void viewFrustumMultiClipCorner(const std::vector<float>& depths, const glm::mat4& viewMat, const glm::mat4& projMat, float* clipCorner)
-{
-	const int NUM_CLIP = depths.size();
-
-	// Calculate Inverse
-	glm::mat4 viewProjInv = glm::inverse(projMat * viewMat);
-
-	// Calculate Clip Plane Corners
-	int clipOffset = 0;
-	for (const float depth : depths)
-	{
-		// Get Depth in NDC, the depth in viewSpace is negative
-		glm::vec4 v = glm::vec4(0, 0, -1 * depth, 1);
-		glm::vec4 vInNDC = projMat * v;
-		if (fabs(vInNDC.w) > 0.00001)
-		{
-			vInNDC.z = vInNDC.z / vInNDC.w;
-		}
-		// Get 4 corner of clip plane
-		float cornerXY[] = {
-			-1, 1,
-			-1, -1,
-			1, -1,
-			1, 1
-		};
-		for (int j = 0; j < 4; j++)
-		{
-			glm::vec4 wcc = {
-				cornerXY[j * 2 + 0], cornerXY[j * 2 + 1], vInNDC.z, 1
-			};
-			wcc = viewProjInv * wcc;
-			wcc = wcc / wcc.w;
-
-			clipCorner[clipOffset * 12 + j * 3 + 0] = wcc[0];
-			clipCorner[clipOffset * 12 + j * 3 + 1] = wcc[1];
-			clipCorner[clipOffset * 12 + j * 3 + 2] = wcc[2];
-		}
-		clipOffset = clipOffset + 1;
-	}
-}
-
 void updateWhenPlayerProjectionChanged(const float nearDepth, const float farDepth)
 {
 	// get view frustum corner
@@ -390,20 +333,43 @@ void on_resize(GLFWwindow* window, int w, int h)
 	resize_impl(w, h);
 }
 
-inline void on_display()
+inline void on_display(const double frameSeconds)
 {
-	// update cameras and airplane
-
-	// god camera
-	m_myCameraManager->updateGodCamera();
-	// player camera
-	m_myCameraManager->updatePlayerCamera();
-	const glm::vec3 PLAYER_CAMERA_POSITION = m_myCameraManager->playerViewOrig();
-	m_myCameraManager->adjustPlayerCameraHeight(m_terrain->terrainData()->height(PLAYER_CAMERA_POSITION.x, PLAYER_CAMERA_POSITION.z));
-	// airplane
-	m_myCameraManager->updateAirplane();
-	const glm::vec3 AIRPLANE_POSTION = m_myCameraManager->airplanePosition();
-	m_myCameraManager->adjustAirplaneHeight(m_terrain->terrainData()->height(AIRPLANE_POSTION.x, AIRPLANE_POSTION.z));
+	CPU_PROFILE_SCOPE("on_display");
+	// update cameras and airplane at the fixed simulation timestep
+	const int numSimulationStep = m_myCameraManager->advanceSimulation(frameSeconds);
+	// god camera (trackball, per frame)
+	if (!m_myCameraManager->playingBack()) {
+		m_myCameraManager->updateGodCamera();
+	}
+	for (int step = 0; step < numSimulationStep; ++step) {
+		CPU_PROFILE_SCOPE("Camera update");
+		if (m_myCameraManager->applyPlaybackStep()) { continue; }
+		// player camera
+		m_myCameraManager->updatePlayerCamera();
+		const glm::vec3 PLAYER_CAMERA_POSITION = m_myCameraManager->playerViewOrig();
+		float playerGroundHeight = 0.0f;
+		{
+			CPU_PROFILE_SCOPE("Terrain height");
+			playerGroundHeight = m_terrain->terrainData()->height(PLAYER_CAMERA_POSITION.x, PLAYER_CAMERA_POSITION.z);
+		}
+		m_myCameraManager->adjustPlayerCameraHeight(playerGroundHeight);
+		// airplane
+		m_myCameraManager->updateAirplane();
+		const glm::vec3 AIRPLANE_POSTION = m_myCameraManager->airplanePosition();
+		float airplaneGroundHeight = 0.0f;
+		{
+			CPU_PROFILE_SCOPE("Terrain height");
+			airplaneGroundHeight = m_terrain->terrainData()->height(AIRPLANE_POSTION.x, AIRPLANE_POSTION.z);
+		}
+		m_myCameraManager->adjustAirplaneHeight(airplaneGroundHeight);
+		m_myCameraManager->recordStep();
+	}
+
+	if (m_myCameraManager->reversedZ() != g_reversedZ) {
+		m_myCameraManager->setReversedZ(g_reversedZ);
+		updateWhenPlayerProjectionChanged(0.1, m_myCameraManager->playerCameraFar());
+	}
 
 	// prepare parameters
 	const glm::mat4 playerVM = m_myCameraManager->playerViewMatrix();
@@ -443,7 +409,10 @@ inline void on_display()
 		glm::vec3(0.0, 1.0, 0.0));
 	float clipCorners[2 * 12]; // near + far, 4 corners each
 	std::vector<float> depths = { nearDepth, farDepth };
-	viewFrustumMultiClipCorner(depths, tView, playerProjMat, clipCorners);
+	{
+		CPU_PROFILE_SCOPE("viewFrustumMultiClipCorner");
+		viewFrustumMultiClipCorner(depths, tView, playerProjMat, clipCorners);
+	}
 
 	// camera model matrix (same basis as ViewFrustumSceneObject::updateState)
 	glm::mat4 viewT = glm::transpose(playerVM);
@@ -472,11 +441,17 @@ inline void on_display()
 	}
 
 	glm::vec4 planes[6];
-	extractFrustumPlanesFromCorners(nearCornersWS, farCornersWS, planes);
+	{
+		CPU_PROFILE_SCOPE("Frustum planes");
+		extractFrustumPlanesFromCorners(nearCornersWS, farCornersWS, planes);
+	}
 	defaultRenderer->setCullingPlanes(planes);
 
 	// update geography with the same planes
-	m_terrain->updateState(playerVM, playerViewOrg, playerProjMat, planes);
+	{
+		CPU_PROFILE_SCOPE("Terrain updateState");
+		m_terrain->updateState(playerVM, playerViewOrg, playerProjMat, planes);
+	}
 	// =============================================
 
 	// =============================================
@@ -489,12 +464,30 @@ inline void on_display()
 	defaultRenderer->setDepthVizEnabled(g_depthVizSplit || g_gbufferViewMode == 6);
 	defaultRenderer->setDepthVisFar(playerFar);
 	defaultRenderer->setDepthVisGamma(g_depthVisGamma);
+	defaultRenderer->setReversedZEnabled(g_reversedZ);
 	defaultRenderer->setOcclusionEnabled(g_occlusionEnabled);
+	defaultRenderer->setSoftwareOcclusionEnabled(g_softwareOcclusion);
+	defaultRenderer->setPvsEnabled(g_pvsEnabled);
+	defaultRenderer->setImpostorsEnabled(g_impostorsEnabled);
+	defaultRenderer->setClusterCullingEnabled(g_clusterCullingEnabled);
 	defaultRenderer->setOcclusionBias(g_occlusionBias);
 	defaultRenderer->setOcclusionFixedLevelOverride(g_occlusionFixedMipOverride ? g_occlusionFixedMipLevel : -1);
 	defaultRenderer->setOcclusionMaxViewDepth(g_maxCullDepth);
+	defaultRenderer->setDepthSortEnabled(g_depthSortEnabled);
+	defaultRenderer->setFoliagePrepassEnabled(g_foliagePrepassEnabled);
+	defaultRenderer->setOverdrawEnabled(!g_depthVizSplit && g_gbufferViewMode == 7);
+	defaultRenderer->setFragmentStatsEnabled(g_fragmentStatsEnabled);
+	defaultRenderer->setCullOverlayEnabled(g_cullOverlayEnabled && !g_depthVizSplit);
+	defaultRenderer->setCullOverlayFilter(g_cullOverlayBatch, g_cullOverlayReasonMask);
+	defaultRenderer->setCullOverlayBoxes(g_cullOverlayBoxes);
 	defaultRenderer->setShadowEnabled(g_shadowEnabled);
 	defaultRenderer->setShadowCascadeVizEnabled(g_shadowCascadeViz);
+	defaultRenderer->setShadowFitToDepthEnabled(g_shadowFitToDepth);
+	defaultRenderer->setShadowPracticalSplitsEnabled(g_shadowPracticalSplits);
+	defaultRenderer->setNumShadowCascades(g_numShadowCascades);
+	defaultRenderer->setShadowMapSize(g_shadowMapSize);
+	defaultRenderer->setShadowCacheEnabled(g_shadowCacheEnabled);
+	defaultRenderer->setShadowMomentsEnabled(g_shadowMomentsEnabled);
 	defaultRenderer->startNewFrame();
 
 	// rendering with player view		
@@ -502,28 +495,38 @@ inline void on_display()
 	defaultRenderer->setView(playerVM);
 	defaultRenderer->setProjection(playerProjMat);
 	const int playerMode = g_depthVizSplit ? 5 : g_gbufferViewMode;
-	defaultRenderer->renderPass(playerMode);
+	{
+		CPU_PROFILE_SCOPE("Player view");
+		GpuScope scope("Player view");
+		defaultRenderer->renderPass(playerMode);
+	}
 
 	// left viewport
 	defaultRenderer->setViewport(godViewport[0], godViewport[1], godViewport[2], godViewport[3]);
 	if (g_depthVizSplit) {
+		CPU_PROFILE_SCOPE("Depth split view");
+		GpuScope scope("Depth split view");
 		// visualize player-view depth mipmap on the left
 		defaultRenderer->setDisplaySampleViewport(playerViewport[0], playerViewport[1], playerViewport[2], playerViewport[3]);
 		defaultRenderer->setView(playerVM);
 		defaultRenderer->setProjection(playerProjMat);
 		defaultRenderer->renderDisplayOnly(6);
 	} else {
+		CPU_PROFILE_SCOPE("God view");
+		GpuScope scope("God view");
 		// rendering with god view
 		defaultRenderer->setView(godVM);
 		defaultRenderer->setProjection(godProjMat);
 		// God view should visualize the SAME culling result from player view (no recompute tied to god camera).
 		defaultRenderer->renderPassReuseVisibility(g_gbufferViewMode);
+		defaultRenderer->renderCullOverlay();
 	}
 	// ===============================
 }
 
 inline void on_gui()
 {
+	CPU_PROFILE_SCOPE("on_gui");
 	// Show statistics window
 
 	ImGui::Begin("Information");
@@ -542,12 +545,38 @@ inline void on_gui()
 		m_myCameraManager->teleport(2);
 	}
 
+	// camera path recording / deterministic playback
+	static const char* CAMERA_RECORDING_PATH = "camera_path.camrec";
+	if (m_myCameraManager->recording()) {
+		if (ImGui::Button("Stop Recording")) {
+			m_myCameraManager->stopRecording(CAMERA_RECORDING_PATH);
+		}
+		ImGui::SameLine();
+		ImGui::Text("%d steps", m_myCameraManager->numRecordedStep());
+	}
+	else if (m_myCameraManager->playingBack()) {
+		if (ImGui::Button("Stop Playback")) {
+			m_myCameraManager->stopPlayback();
+		}
+		ImGui::SameLine();
+		ImGui::Text("%d / %d", m_myCameraManager->playbackStep(), m_myCameraManager->numRecordedStep());
+	}
+	else {
+		if (ImGui::Button("Record Path")) {
+			m_myCameraManager->startRecording();
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Play Path")) {
+			m_myCameraManager->startPlayback(CAMERA_RECORDING_PATH);
+		}
+	}
+
 	if (ImGui::Checkbox("Enable Magic Normal Map", &g_useNormalMap)) {
     	DynamicSceneObject::setGlobalNormalMapToggle(g_useNormalMap);
 	}
 
 	static const char* gbufferLabels[] = {
-		"World space vertex", "World space normal", "Ambient", "Diffuse", "Specular", "Default", "Depth Mip"
+		"World space vertex", "World space normal", "Ambient", "Diffuse", "Specular", "Default", "Depth Mip", "Overdraw"
 	};
 	ImGui::Text("G-Buffer View");
 	ImGui::Checkbox("Depth Mipmap Viz Split", &g_depthVizSplit);
@@ -565,20 +594,120 @@ inline void on_gui()
 		defaultRenderer->setDepthDisplayLevel(g_depthMipLevel);
 	}
 
+	if (!g_depthVizSplit && g_gbufferViewMode == 7) {
+		// fragment shader invocations per pixel of the player view (depth prepass not counted)
+		std::vector<OverdrawSlotStats> overdraw;
+		defaultRenderer->readOverdrawStats(overdraw);
+		if (ImGui::BeginTable("overdraw", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+			ImGui::TableSetupColumn("Batch");
+			ImGui::TableSetupColumn("Mean");
+			ImGui::TableSetupColumn("Max");
+			ImGui::TableHeadersRow();
+			for (const OverdrawSlotStats& slot : overdraw) {
+				if (slot.invocations == 0) continue;
+				ImGui::TableNextRow();
+				ImGui::TableSetColumnIndex(0);
+				ImGui::TextUnformatted(slot.name.c_str());
+				ImGui::TableSetColumnIndex(1);
+				ImGui::Text("%.2f", slot.meanOverdraw());
+				ImGui::TableSetColumnIndex(2);
+				ImGui::Text("%u", slot.maxOverdraw);
+			}
+			ImGui::EndTable();
+		}
+	}
+
 	ImGui::Separator();
 	ImGui::Text("Occlusion Culling");
+	ImGui::Checkbox("Reversed-Z Depth", &g_reversedZ);
 	ImGui::Checkbox("Enable Occlusion", &g_occlusionEnabled);
+	ImGui::Checkbox("CPU Occlusion Buffer", &g_softwareOcclusion);
+	if (g_softwareOcclusion) {
+		ImGui::Text("%d occluders, %d triangles", defaultRenderer->numSoftwareOccluders(), defaultRenderer->numSoftwareOcclusionTriangles());
+	}
+	if (defaultRenderer->hasPvs()) {
+		ImGui::Checkbox("Potentially Visible Set", &g_pvsEnabled);
+		if (g_pvsEnabled && defaultRenderer->pvsCell() >= 0) {
+			ImGui::Text("cell %d: %d / %d clusters", defaultRenderer->pvsCell(), defaultRenderer->numPvsVisibleClusters(), defaultRenderer->numPvsClusters());
+		}
+		else if (g_pvsEnabled) {
+			ImGui::Text("inactive (outside the bake)");
+		}
+	}
+	if (defaultRenderer->numImpostorAtlases() > 0) {
+		ImGui::Checkbox("Distant Impostors", &g_impostorsEnabled);
+	}
+	if (defaultRenderer->numClusteredBatches() > 0) {
+		ImGui::Checkbox("Cluster Culling", &g_clusterCullingEnabled);
+	}
 	ImGui::SliderFloat("Occlusion Bias", &g_occlusionBias, 0.0f, 0.01f, "%.6f");
 	ImGui::SliderFloat("Max View Depth", &g_maxCullDepth, 50.0f, 800.0f, "%.1f");
 	ImGui::Checkbox("Fixed Mip Override", &g_occlusionFixedMipOverride);
 	if (g_occlusionFixedMipOverride) {
 		ImGui::SliderInt("Occlusion Mip", &g_occlusionFixedMipLevel, 0, 12);
 	}
+	ImGui::Checkbox("Front-to-back Depth Bins", &g_depthSortEnabled);
+	ImGui::Checkbox("Foliage Depth Prepass", &g_foliagePrepassEnabled);
+	ImGui::Checkbox("Measure Fragments", &g_fragmentStatsEnabled);
+	if (g_fragmentStatsEnabled) {
+		const InstanceFragmentStats& fragments = defaultRenderer->instanceFragmentStats();
+		if (fragments.valid) {
+			ImGui::Text("Occluders: %llu samples, %llu FS", (unsigned long long)fragments.samplesPassed[0], (unsigned long long)fragments.fragmentInvocations[0]);
+			ImGui::Text("Foliage:   %llu samples, %llu FS", (unsigned long long)fragments.samplesPassed[1], (unsigned long long)fragments.fragmentInvocations[1]);
+		}
+	}
+
+	ImGui::Separator();
+	ImGui::Text("God View Cull Overlay");
+	ImGui::Checkbox("Show Instance Bounds", &g_cullOverlayEnabled);
+	if (g_cullOverlayEnabled) {
+		const CullStatsReadback& cullStats = defaultRenderer->cullStats();
+		const char* preview = (g_cullOverlayBatch >= 0 && g_cullOverlayBatch < cullStats.numBatch()) ? cullStats.batchName(g_cullOverlayBatch).c_str() : "All";
+		if (ImGui::BeginCombo("Overlay Batch", preview)) {
+			if (ImGui::Selectable("All", g_cullOverlayBatch < 0)) { g_cullOverlayBatch = -1; }
+			for (int b = 0; b < cullStats.numBatch(); ++b) {
+				ImGui::PushID(b);
+				if (ImGui::Selectable(cullStats.batchName(b).c_str(), g_cullOverlayBatch == b)) { g_cullOverlayBatch = b; }
+				ImGui::PopID();
+			}
+			ImGui::EndCombo();
+		}
+		// same colors as shaders/cullOverlayVertex.glsl
+		const ImVec4 REASON_COLORS[CULL_REASON_COUNT] = {
+			ImVec4(0.1f, 1.0f, 0.1f, 1.0f), ImVec4(0.45f, 0.45f, 1.0f, 1.0f), ImVec4(1.0f, 0.9f, 0.1f, 1.0f),
+			ImVec4(1.0f, 0.2f, 1.0f, 1.0f), ImVec4(1.0f, 0.15f, 0.1f, 1.0f), ImVec4(0.1f, 0.9f, 1.0f, 1.0f)
+		};
+		for (int r = 0; r < CULL_REASON_COUNT; ++r) {
+			ImGui::PushStyleColor(ImGuiCol_Text, REASON_COLORS[r]);
+			ImGui::CheckboxFlags(cullReasonName(r), &g_cullOverlayReasonMask, 1u << r);
+			ImGui::PopStyleColor();
+			if (r + 1 < CULL_REASON_COUNT) { ImGui::SameLine(); }
+		}
+		ImGui::Checkbox("Boxes instead of Spheres", &g_cullOverlayBoxes);
+	}
 
 	ImGui::Separator();
 	ImGui::Text("Cascaded Shadow Mapping");
 	ImGui::Checkbox("Enable Shadows", &g_shadowEnabled);
 	ImGui::Checkbox("Visualize Cascades (RGB)", &g_shadowCascadeViz);
+	ImGui::Checkbox("Fit Cascades to Depth (SDSM)", &g_shadowFitToDepth);
+	if (g_shadowFitToDepth) { ImGui::BeginDisabled(); }
+	ImGui::Checkbox("Practical Splits", &g_shadowPracticalSplits);
+	ImGui::Checkbox("Cache Static Casters", &g_shadowCacheEnabled);
+	if (g_shadowFitToDepth) { ImGui::EndDisabled(); }
+	ImGui::Checkbox("Prefiltered Shadows (EVSM)", &g_shadowMomentsEnabled);
+	ImGui::SliderInt("Cascades", &g_numShadowCascades, 1, MAX_SHADOW_CASCADES);
+	{
+		const int SIZES[] = { 512, 1024, 2048, 4096 };
+		const char* SIZE_NAMES[] = { "512", "1024", "2048", "4096" };
+		int sizeIndex = 2;
+		for (int i = 0; i < IM_ARRAYSIZE(SIZES); ++i) {
+			if (SIZES[i] == g_shadowMapSize) { sizeIndex = i; }
+		}
+		if (ImGui::Combo("Shadow Map Size", &sizeIndex, SIZE_NAMES, IM_ARRAYSIZE(SIZE_NAMES))) {
+			g_shadowMapSize = SIZES[sizeIndex];
+		}
+	}
 
 	ImGui::End();
 }
@@ -634,6 +763,9 @@ void on_key(GLFWwindow* window, int key, int scancode, int action, int mods)
 	else if (key == GLFW_KEY_T) { setKeyStatus(RenderWidgetKeyCode::KEY_T, action); }
 	else if (key == GLFW_KEY_Z) { setKeyStatus(RenderWidgetKeyCode::KEY_Z, action); }
 	else if (key == GLFW_KEY_X) { setKeyStatus(RenderWidgetKeyCode::KEY_X, action); }
+#if defined(CG_CPU_PROFILER)
+	else if (key == GLFW_KEY_F9 && action == GLFW_PRESS) { CpuProfiler::Instance()->requestCapture(120, "frame_trace.json"); }
+#endif
 }
 
 void on_scroll(GLFWwindow* window, double xoffset, double yoffset) {}
@@ -643,8 +775,309 @@ static void glfw_error_callback(int error, const char* description)
 	fprintf(stderr, "GLFW Error %d: %s\n", error, description);
 }
 
-int main(int, char**)
+// ==============================================
+// --scene <file>: load a .scene instead of the default outdoor scene
+// --generate-scene <dir> [generator options]: write a synthetic stress scene and load it (see SceneGenerator.h)
+// --occluder-triangles N: occluder proxy budget of every occluder batch (0: the full mesh)
+// --pvs <file>: potentially visible set baked by CG2025_pvsbake for this scene
+// --impostor-distance D: impostor distance of the batches that have impostors (0: meshes only)
+// --cluster-triangles N: triangles per cluster of every occluder batch (0: drawn whole)
+
+static bool parseSceneArgs(int argc, char** argv) {
+	std::string scenePath, generateDir;
+	SceneGeneratorOptions generatorOptions;
+	int occluderTriangles = -1;
+	std::string pvsPath;
+	float impostorDistance = -1.0f;
+	int clusterTriangles = -1;
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+		const bool hasValue = (i + 1 < argc);
+		std::string error;
+		if (arg == "--scene" && hasValue) { scenePath = argv[++i]; }
+		else if (arg == "--generate-scene" && hasValue) { generateDir = argv[++i]; }
+		else if (arg == "--occluder-triangles" && hasValue) { occluderTriangles = std::max(0, std::atoi(argv[++i])); }
+		else if (arg == "--pvs" && hasValue) { pvsPath = argv[++i]; }
+		else if (arg == "--impostor-distance" && hasValue) { impostorDistance = std::max(0.0f, (float)std::atof(argv[++i])); }
+		else if (arg == "--cluster-triangles" && hasValue) { clusterTriangles = std::max(0, std::atoi(argv[++i])); }
+		else if (parseSceneGeneratorArg(argc, argv, i, generatorOptions, error) && !error.empty()) {
+			std::cerr << error << "\n";
+			return false;
+		}
+	}
+
+	std::string error;
+	if (!generateDir.empty()) {
+		generatorOptions.outputDir = generateDir;
+		if (generatorOptions.batches.empty()) {
+			addDefaultGeneratedBatches(generatorOptions);
+		}
+		if (!generateScene(generatorOptions, m_sceneDescription, error, std::cout)) {
+			std::cerr << "generate scene: " << error << "\n";
+			return false;
+		}
+		m_scenePath = generateDir;
+	}
+	else if (!scenePath.empty()) {
+		if (!SceneDescription::fromFile(scenePath, m_sceneDescription, error)) {
+			std::cerr << error << "\n";
+			return false;
+		}
+		m_scenePath = scenePath;
+	}
+	if (occluderTriangles >= 0) {
+		for (InstanceBatchDesc& desc : m_sceneDescription.batches) {
+			desc.occluderTriangles = occluderTriangles;
+		}
+	}
+	if (!pvsPath.empty()) {
+		m_sceneDescription.pvsPath = pvsPath;
+	}
+	if (impostorDistance >= 0.0f) {
+		for (InstanceBatchDesc& desc : m_sceneDescription.batches) {
+			if (desc.impostorDistance > 0.0f) desc.impostorDistance = impostorDistance;
+		}
+	}
+	if (clusterTriangles >= 0) {
+		for (InstanceBatchDesc& desc : m_sceneDescription.batches) {
+			if (desc.isOccluder) desc.clusterTriangles = clusterTriangles;
+		}
+	}
+	return true;
+}
+
+// ==============================================
+// --benchmark: offscreen, fixed resolution, scripted camera path, JSON results
+
+struct BenchmarkOptions {
+	std::string cameraPath = "assets/benchmark/teleport_tour.campath";
+	std::string output = "benchmark_results.json";
+	int frames = 600;
+	int warmupFrames = 30;
+	int width = 1920;
+	int height = 960;
+	bool useEGL = false;
+};
+
+static bool parseBenchmarkArgs(int argc, char** argv, BenchmarkOptions& opt) {
+	bool benchmark = false;
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+		const bool hasValue = (i + 1 < argc);
+		if (arg == "--benchmark") { benchmark = true; }
+		else if (arg == "--path" && hasValue) { opt.cameraPath = argv[++i]; }
+		else if (arg == "--out" && hasValue) { opt.output = argv[++i]; }
+		else if (arg == "--frames" && hasValue) { opt.frames = std::max(1, std::atoi(argv[++i])); }
+		else if (arg == "--warmup" && hasValue) { opt.warmupFrames = std::max(0, std::atoi(argv[++i])); }
+		else if (arg == "--size" && i + 2 < argc) { opt.width = std::atoi(argv[++i]); opt.height = std::atoi(argv[++i]); }
+		else if (arg == "--egl") { opt.useEGL = true; }
+		else if (arg == "--no-occlusion") { g_occlusionEnabled = false; }
+		else if (arg == "--software-occlusion") { g_softwareOcclusion = true; }
+		else if (arg == "--no-pvs") { g_pvsEnabled = false; }
+		else if (arg == "--no-impostors") { g_impostorsEnabled = false; }
+		else if (arg == "--no-clusters") { g_clusterCullingEnabled = false; }
+		else if (arg == "--reversed-z") { g_reversedZ = true; }
+		else if (arg == "--depth-sort") { g_depthSortEnabled = true; }
+		else if (arg == "--foliage-prepass") { g_foliagePrepassEnabled = true; }
+		else if (arg == "--shadows") { g_shadowEnabled = true; }
+		else if (arg == "--sdsm") { g_shadowFitToDepth = true; }
+		else if (arg == "--shadow-practical-splits") { g_shadowPracticalSplits = true; }
+		else if (arg == "--shadow-cache") { g_shadowCacheEnabled = true; }
+		else if (arg == "--shadow-evsm") { g_shadowMomentsEnabled = true; }
+		else if (arg == "--shadow-cascades" && hasValue) { g_numShadowCascades = std::max(1, std::min(std::atoi(argv[++i]), MAX_SHADOW_CASCADES)); }
+		else if (arg == "--shadow-size" && hasValue) { g_shadowMapSize = std::max(16, std::atoi(argv[++i])); }
+	}
+	return benchmark;
+}
+
+static int run_benchmark(const BenchmarkOptions& opt)
+{
+	// context: EGL surfaceless (no display server needed, e.g. Mesa llvmpipe) or an invisible GLFW window
+	GLFWwindow* window = nullptr;
+	bool contextReady = false;
+#if defined(CG_HAS_EGL)
+	EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+	EGLContext eglContext = EGL_NO_CONTEXT;
+	const bool noDisplayServer = (std::getenv("DISPLAY") == nullptr && std::getenv("WAYLAND_DISPLAY") == nullptr);
+	if (opt.useEGL || noDisplayServer) {
+		auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		eglDisplay = (getPlatformDisplay != nullptr) ? getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr) : EGL_NO_DISPLAY;
+		EGLint major = 0, minor = 0;
+		if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, &major, &minor) || !eglBindAPI(EGL_OPENGL_API)) {
+			std::cerr << "benchmark: EGL surfaceless display unavailable\n";
+			return 1;
+		}
+		const EGLint contextAttribs[] = {
+			EGL_CONTEXT_MAJOR_VERSION, 4, EGL_CONTEXT_MINOR_VERSION, 6,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE
+		};
+		eglContext = eglCreateContext(eglDisplay, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttribs);
+		if (eglContext == EGL_NO_CONTEXT || !eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, eglContext)) {
+			std::cerr << "benchmark: cannot create a GL 4.6 core context with EGL\n";
+			return 1;
+		}
+		if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+			std::cerr << "Failed to initialize GLAD\n";
+			return 1;
+		}
+		contextReady = true;
+	}
+#else
+	if (opt.useEGL) {
+		std::cerr << "benchmark: built without EGL, using an invisible window\n";
+	}
+#endif
+	if (!contextReady) {
+		glfwSetErrorCallback(glfw_error_callback);
+		if (!glfwInit()) { return 1; }
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		window = glfwCreateWindow(64, 64, "Final_Outdoor_Benchmark", nullptr, nullptr);
+		if (window == nullptr) { glfwTerminate(); return 1; }
+		glfwMakeContextCurrent(window);
+		if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+			std::cerr << "Failed to initialize GLAD\n";
+			return 1;
+		}
+	}
+
+	displayWidth = opt.width;
+	displayHeight = opt.height;
+	if (on_init(displayWidth, displayHeight) == false) {
+		std::cerr << "benchmark: initialization failed\n";
+		return 1;
+	}
+
+	// .camrec: recorded session played back one simulation step per frame; otherwise a text camera path
+	CameraPath* cameraPath = nullptr;
+	const bool recordedPath = (opt.cameraPath.size() > 7 && opt.cameraPath.compare(opt.cameraPath.size() - 7, 7, ".camrec") == 0);
+	if (recordedPath) {
+		if (!m_myCameraManager->startPlayback(opt.cameraPath)) {
+			std::cerr << "benchmark: cannot play back " << opt.cameraPath << "\n";
+			return 1;
+		}
+	}
+	else {
+		std::string pathError;
+		cameraPath = CameraPath::fromFile(opt.cameraPath, pathError);
+		if (cameraPath == nullptr) {
+			std::cerr << "benchmark: " << pathError << "\n";
+			return 1;
+		}
+	}
+
+	// fixed-resolution offscreen target instead of the window's framebuffer
+	GLuint outputFBO = 0, outputRBO[2] = { 0, 0 };
+	glCreateFramebuffers(1, &outputFBO);
+	glCreateRenderbuffers(2, outputRBO);
+	glNamedRenderbufferStorage(outputRBO[0], GL_RGBA8, opt.width, opt.height);
+	glNamedRenderbufferStorage(outputRBO[1], GL_DEPTH_COMPONENT24, opt.width, opt.height);
+	glNamedFramebufferRenderbuffer(outputFBO, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, outputRBO[0]);
+	glNamedFramebufferRenderbuffer(outputFBO, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, outputRBO[1]);
+	defaultRenderer->setOutputFramebuffer(outputFBO);
+
+	// samples passed / FS invocations of the instance draws, to compare --depth-sort runs
+	g_fragmentStatsEnabled = true;
+
+	// frame time = submit + GPU completion (glFinish), so queued frames don't hide GPU cost
+	BenchmarkRecorder recorder;
+	std::vector<std::string> batchNames;
+	std::vector<unsigned int> batchInstances, batchVisible;
+	std::vector<unsigned long long> batchTriangles;
+	const int totalFrames = opt.warmupFrames + opt.frames;
+	for (int i = 0; i < totalFrames; ++i) {
+		const int measured = i - opt.warmupFrames;
+		if (cameraPath != nullptr) {
+			const float t = (measured <= 0 || opt.frames <= 1) ? 0.0f : cameraPath->duration() * (float)measured / (float)(opt.frames - 1);
+			const CameraPathKey key = cameraPath->sample(t);
+			m_myCameraManager->setCameraStates(key.playerViewOrg, key.playerLookCenter, key.godViewOrg, key.godLookCenter);
+		}
+		else if (measured == 0) {
+			// warmup frames advanced the playback: restart so the measured frames cover the whole recording
+			m_myCameraManager->startPlayback(opt.cameraPath);
+		}
+
+		CPU_PROFILE_FRAME();
+		const auto start = std::chrono::steady_clock::now();
+		on_display(INANOA::MyCameraManager::SIMULATION_TIMESTEP);
+		glFinish();
+		const auto end = std::chrono::steady_clock::now();
+
+		if (measured < 0) { continue; }
+		if (measured == 0) {
+			recorder.collectGpuFrames(GpuProfiler::Instance()->currentFrameIndex());
+		}
+		recorder.addFrameTime(std::chrono::duration<double, std::milli>(end - start).count());
+		defaultRenderer->readBatchVisibility(batchNames, batchInstances, batchVisible);
+		recorder.addVisibleCounts(batchNames, batchInstances, batchVisible);
+		defaultRenderer->readBatchTriangles(batchTriangles);
+		recorder.addTriangleCounts(batchTriangles);
+		const InstanceFragmentStats& fragments = defaultRenderer->instanceFragmentStats();
+		if (fragments.valid) {
+			recorder.addFragmentStats(fragments.samplesPassed, fragments.fragmentInvocations);
+		}
+		recorder.collectGpuFrames(0);
+	}
+	// resolve the timers of the last frames
+	GpuProfiler::Instance()->beginFrame();
+	recorder.collectGpuFrames(0);
+
+	const GLubyte* renderer = glGetString(GL_RENDERER);
+	std::ostringstream settings;
+	settings << "{\"renderer\":\"" << jsonEscape(renderer ? (const char*)renderer : "unknown") << "\""
+		<< ",\"camera_path\":\"" << jsonEscape(opt.cameraPath) << "\""
+		<< ",\"scene\":\"" << jsonEscape(m_scenePath) << "\""
+		<< ",\"width\":" << opt.width << ",\"height\":" << opt.height
+		<< ",\"warmup_frames\":" << opt.warmupFrames
+		<< ",\"occlusion\":" << (g_occlusionEnabled ? "true" : "false")
+		<< ",\"software_occlusion\":" << (g_softwareOcclusion ? "true" : "false")
+		<< ",\"pvs\":" << ((g_pvsEnabled && !m_sceneDescription.pvsPath.empty()) ? "true" : "false")
+		<< ",\"impostors\":" << ((g_impostorsEnabled && defaultRenderer->numImpostorAtlases() > 0) ? "true" : "false")
+		<< ",\"clusters\":" << ((g_clusterCullingEnabled && defaultRenderer->numClusteredBatches() > 0) ? "true" : "false")
+		<< ",\"reversed_z\":" << (g_reversedZ ? "true" : "false")
+		<< ",\"depth_sort\":" << (g_depthSortEnabled ? "true" : "false")
+		<< ",\"foliage_prepass\":" << (g_foliagePrepassEnabled ? "true" : "false")
+		<< ",\"shadows\":" << (g_shadowEnabled ? "true" : "false")
+		<< ",\"sdsm\":" << (g_shadowFitToDepth ? "true" : "false")
+		<< ",\"shadow_practical_splits\":" << (g_shadowPracticalSplits ? "true" : "false")
+		<< ",\"shadow_cache\":" << (g_shadowCacheEnabled ? "true" : "false")
+		<< ",\"shadow_evsm\":" << (g_shadowMomentsEnabled ? "true" : "false")
+		<< ",\"shadow_cascades\":" << g_numShadowCascades
+		<< ",\"shadow_map_size\":" << g_shadowMapSize << "}";
+	const bool written = recorder.writeJSON(opt.output, settings.str());
+	std::cout << "benchmark: " << recorder.numFrame() << " frames -> " << (written ? opt.output : "(write failed)") << "\n";
+
+	glDeleteFramebuffers(1, &outputFBO);
+	glDeleteRenderbuffers(2, outputRBO);
+	delete cameraPath;
+	on_destroy();
+#if defined(CG_HAS_EGL)
+	if (eglContext != EGL_NO_CONTEXT) {
+		eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		eglDestroyContext(eglDisplay, eglContext);
+		eglTerminate(eglDisplay);
+	}
+#endif
+	if (window != nullptr) {
+		glfwDestroyWindow(window);
+		glfwTerminate();
+	}
+	return written ? 0 : 1;
+}
+
+int main(int argc, char** argv)
 {
+	if (!parseSceneArgs(argc, argv)) {
+		return 1;
+	}
+	BenchmarkOptions benchmarkOptions;
+	if (parseBenchmarkArgs(argc, argv, benchmarkOptions)) {
+		return run_benchmark(benchmarkOptions);
+	}
+
 	glfwSetErrorCallback(glfw_error_callback);
 	if (!glfwInit())
 		return 1;
@@ -708,13 +1141,17 @@ int main(int, char**)
 
 	// FPS calculation
 	double previousTimeForFPS = glfwGetTime();
+	double previousFrameTime = previousTimeForFPS;
 	int frameCount = 0;
 
 	// Main loop
 	while (!glfwWindowShouldClose(window))
 	{
+		CPU_PROFILE_FRAME();
 		// FPS calculation
 		const double currentTime = glfwGetTime();
+		const double frameSeconds = currentTime - previousFrameTime;
+		previousFrameTime = currentTime;
 		frameCount = frameCount + 1;
 		const double deltaTime = currentTime - previousTimeForFPS;
 
@@ -734,7 +1171,10 @@ int main(int, char**)
 		// - When io.WantCaptureMouse is true, do not dispatch mouse input data to your main application, or clear/overwrite your copy of the mouse data.
 		// - When io.WantCaptureKeyboard is true, do not dispatch keyboard input data to your main application, or clear/overwrite your copy of the keyboard data.
 		// Generally you may always pass all inputs to dear imgui, and hide them from your application based on those two flags.
-		glfwPollEvents();
+		{
+			CPU_PROFILE_SCOPE("glfwPollEvents");
+			glfwPollEvents();
+		}
 		if (glfwGetWindowAttrib(window, GLFW_ICONIFIED) != 0)
 		{
 			ImGui_ImplGlfw_Sleep(10);
@@ -745,12 +1185,22 @@ int main(int, char**)
 		ImGui_ImplOpenGL3_NewFrame();
 		ImGui_ImplGlfw_NewFrame();
 		ImGui::NewFrame();
+		m_imguiPanel->setGLCounters(GLStateCache::Instance()->lastFrameCounters());
+		m_imguiPanel->setCullStats(&defaultRenderer->cullStats());
 		on_gui();
 		// Rendering
-		on_display();
-		ImGui::Render();
-		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-		glfwSwapBuffers(window);
+		on_display(frameSeconds);
+		{
+			CPU_PROFILE_SCOPE("ImGui render");
+			ImGui::Render();
+			GpuScope scope("ImGui");
+			ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+		}
+		{
+			// blocks here when the driver throttles the CPU (vsync, too many frames queued)
+			CPU_PROFILE_SCOPE("glfwSwapBuffers");
+			glfwSwapBuffers(window);
+		}
 	}
 
 	// Cleanup
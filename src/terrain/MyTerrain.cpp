@@ -1,8 +1,8 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include "MyTerrain.h"
-#include <glm\gtx\quaternion.hpp>
-#include <glm\mat4x4.hpp>
-#include <glm\gtx\transform.hpp>
+#include <glm/gtx/quaternion.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/gtx/transform.hpp>
 
 
 MyTerrain::MyTerrain() : m_numChunk(4)
@@ -23,13 +23,20 @@ TerrainSceneObject* MyTerrain::sceneObject() {
 	return this->m_terrainSO;
 }
 
-void MyTerrain::init(const float chunkSize) {
-	MyTerrainData* mtd = MyTerrainData::fromMYTD("assets\\outdoor\\elevationMap_2.mytd");
-	mtd->loadChunkDataFromFile("assets\\outdoor\\terrain.chunkdata");
-	this->setupTerrainSceneObject(this->m_numChunk, 512, mtd->m_chunkVertices, mtd->m_numChunkVertex, mtd->m_chunkIndices, mtd->m_numChunkIndex, mtd);
+bool MyTerrain::init(const std::string& elevationMapPath, const std::string& chunkDataPath, const float chunkSize) {
+	MyTerrainData* mtd = MyTerrainData::fromMYTD(elevationMapPath);
+	if (mtd == nullptr) {
+		return false;
+	}
+	if (!mtd->loadChunkDataFromFile(chunkDataPath)) {
+		delete mtd;
+		return false;
+	}
+	this->setupTerrainSceneObject(this->m_numChunk, (int)chunkSize, mtd->m_chunkVertices, mtd->m_numChunkVertex, mtd->m_chunkIndices, mtd->m_numChunkIndex, mtd);
 
 	this->m_terrainData = mtd;
 	this->m_terrainData->m_worldVtoElevationUVMat = this->m_worldVtoElevationUVMat;
+	return true;
 }
 void MyTerrain::setupTerrainSceneObject(const int numChunk, const int chunkSize, const float* chunkVertices, const int numChunkVertex, const unsigned int* chunkIndices, const int numChunkIndex, const MyTerrainData* td) {
 	this->m_terrainSO = new TerrainSceneObject(numChunk, chunkVertices, numChunkVertex, chunkIndices, numChunkIndex);
@@ -67,8 +74,7 @@ void MyTerrain::setupTerrainSceneObject(const int numChunk, const int chunkSize,
 	GLuint albedoTexHandle = createTexture(td->m_albedoMap, 4, td->m_albedoMapWidth, td->m_albedoMapHeight, GL_RGBA32F, GL_RGBA, GL_FLOAT, GL_CLAMP_TO_EDGE, GL_LINEAR);
 	this->m_terrainSO->setAlbedoTextureHandle(albedoTexHandle);
 
-	glm::mat4 worldVtoElevationUVMat = glm::scale(glm::vec3(0.5 / chunkSize, 1.0, 0.5 / chunkSize));
-	worldVtoElevationUVMat[3] = glm::vec4(0.5, 0.0, 0.5, 1.0);
+	glm::mat4 worldVtoElevationUVMat = MyTerrainData::worldVtoElevationUV((float)chunkSize);
 
 	this->m_terrainSO->setWorldVertexToElevationMapUVMatrix(worldVtoElevationUVMat);
 
@@ -1,6 +1,7 @@
 #pragma once
 
 
+#include <string>
 #include "TerrainSceneObject.h"
 #include "MyTerrainData.h"
 
@@ -11,7 +12,8 @@ public:
 	virtual ~MyTerrain();
 
 public:
-	void init(const float chunkSize);
+	// false if the .mytd or .chunkdata file cannot be loaded
+	bool init(const std::string& elevationMapPath, const std::string& chunkDataPath, const float chunkSize);
 	void setupTerrainSceneObject(const int numChunk, const int chunkSize, const float* chunkVertices, const int numChunkVertex, const unsigned int* chunkIndices, const int numChunkIndex, const MyTerrainData* td);
 
 public:
@@ -1,7 +1,7 @@
 #pragma once
 
 #include <fstream>
-#include <glm\mat4x4.hpp>
+#include <glm/mat4x4.hpp>
 
 class MyTerrainData
 {
@@ -97,7 +97,16 @@ public:
 	}
 
 public:
-	glm::vec3 MyTerrainData::worldVToHeightMapUV(float x, float z) const {
+	// world xz -> map uv as set up by MyTerrain: the maps cover [-chunkSize, chunkSize] on x and z
+	static glm::mat4 worldVtoElevationUV(const float chunkSize) {
+		glm::mat4 m(1.0f);
+		m[0][0] = 0.5f / chunkSize;
+		m[2][2] = 0.5f / chunkSize;
+		m[3] = glm::vec4(0.5f, 0.0f, 0.5f, 1.0f);
+		return m;
+	}
+
+	glm::vec3 worldVToHeightMapUV(float x, float z) const {
 		glm::vec4 uv = this->m_worldVtoElevationUVMat * glm::vec4(x, 0, z, 1.0);
 		for (int i = 0; i < 3; i += 2) {
 			float n = uv[i];
@@ -0,0 +1,149 @@
+#include "TerrainOccluderProxy.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+TerrainOccluderProxy::TerrainOccluderProxy()
+{
+}
+
+TerrainOccluderProxy::~TerrainOccluderProxy()
+{
+}
+
+void TerrainOccluderProxy::init(const MyTerrainData* td, const float cellSize) {
+	this->m_cellMin.clear();
+	this->m_cellMax.clear();
+	this->m_vertices.clear();
+	this->m_indices.clear();
+	if (td == nullptr || td->m_elevationMap == nullptr || td->m_elevationMapWidth <= 0 || td->m_elevationMapHeight <= 0) {
+		return;
+	}
+	this->m_cellSize = cellSize;
+
+	// world rectangle of uv [0, 1]
+	const glm::mat4& uvMat = td->m_worldVtoElevationUVMat;
+	const glm::vec2 uvScale(uvMat[0][0], uvMat[2][2]);
+	const glm::vec2 uvOffset(uvMat[3][0], uvMat[3][2]);
+	this->m_mapOrigin = -uvOffset / uvScale;
+	this->m_mapCellsX = std::max(1, (int)std::ceil(1.0f / uvScale.x / cellSize));
+	this->m_mapCellsZ = std::max(1, (int)std::ceil(1.0f / uvScale.y / cellSize));
+
+	const int w = td->m_elevationMapWidth, h = td->m_elevationMapHeight;
+	auto texelOf = [](const float uv, const int size) {
+		return std::min(std::max((int)std::floor(uv * (float)size), 0), size - 1);
+	};
+	this->m_cellMin.resize((size_t)this->m_mapCellsX * this->m_mapCellsZ);
+	this->m_cellMax.resize(this->m_cellMin.size());
+	for (int cz = 0; cz < this->m_mapCellsZ; ++cz) {
+		const float z0 = this->m_mapOrigin.y + cz * cellSize;
+		const int tz0 = texelOf(uvOffset.y + uvScale.y * z0, h), tz1 = texelOf(uvOffset.y + uvScale.y * (z0 + cellSize), h);
+		for (int cx = 0; cx < this->m_mapCellsX; ++cx) {
+			const float x0 = this->m_mapOrigin.x + cx * cellSize;
+			const int tx0 = texelOf(uvOffset.x + uvScale.x * x0, w), tx1 = texelOf(uvOffset.x + uvScale.x * (x0 + cellSize), w);
+			float lo = FLT_MAX, hi = -FLT_MAX;
+			for (int tz = tz0; tz <= tz1; ++tz) {
+				for (int tx = tx0; tx <= tx1; ++tx) {
+					const float e = td->m_elevationMap[((size_t)tz * w + tx) * 4];
+					lo = std::min(lo, e);
+					hi = std::max(hi, e);
+				}
+			}
+			this->m_cellMin[(size_t)cz * this->m_mapCellsX + cx] = lo;
+			this->m_cellMax[(size_t)cz * this->m_mapCellsX + cx] = hi;
+		}
+	}
+
+	// the chunk mesh is centered on the viewer; only its edges under the proxy matter
+	const float proxyRadius = 1.5f * (NUM_CELL / 2 + 1) * cellSize;
+	this->m_chunkEdgeLength = 0.0f;
+	if (td->m_chunkVertices != nullptr && td->m_chunkIndices != nullptr) {
+		const float* v = td->m_chunkVertices;
+		for (int i = 0; i + 2 < td->m_numChunkIndex; i += 3) {
+			const unsigned int* tri = td->m_chunkIndices + i;
+			float nearest = FLT_MAX, longest = 0.0f;
+			for (int e = 0; e < 3; ++e) {
+				const float* a = v + (size_t)tri[e] * 3;
+				const float* b = v + (size_t)tri[(e + 1) % 3] * 3;
+				nearest = std::min(nearest, std::sqrt(a[0] * a[0] + a[2] * a[2]));
+				longest = std::max(longest, std::max(std::fabs(b[0] - a[0]), std::fabs(b[2] - a[2])));
+			}
+			if (nearest <= proxyRadius) {
+				this->m_chunkEdgeLength = std::max(this->m_chunkEdgeLength, longest);
+			}
+		}
+	}
+
+	// two counter-clockwise (seen from above) triangles per cell
+	const int row = NUM_CELL + 1;
+	this->m_vertices.assign((size_t)row * row * 3, 0.0f);
+	this->m_indices.reserve((size_t)NUM_CELL * NUM_CELL * 6);
+	for (int j = 0; j < NUM_CELL; ++j) {
+		for (int i = 0; i < NUM_CELL; ++i) {
+			const uint32_t p00 = j * row + i, p10 = p00 + 1, p01 = p00 + row, p11 = p01 + 1;
+			const uint32_t quad[6] = { p00, p01, p10, p10, p01, p11 };
+			this->m_indices.insert(this->m_indices.end(), quad, quad + 6);
+		}
+	}
+}
+
+void TerrainOccluderProxy::cellRange(const float x0, const float z0, const float x1, const float z1, int range[4]) const {
+	// outside the map the edge texels repeat (clamp to edge), so the edge cells stand in
+	auto cellOf = [this](const float v, const float origin, const int numCell) {
+		return std::min(std::max((int)std::floor((v - origin) / this->m_cellSize), 0), numCell - 1);
+	};
+	range[0] = cellOf(x0, this->m_mapOrigin.x, this->m_mapCellsX);
+	range[1] = cellOf(z0, this->m_mapOrigin.y, this->m_mapCellsZ);
+	range[2] = cellOf(x1, this->m_mapOrigin.x, this->m_mapCellsX);
+	range[3] = cellOf(z1, this->m_mapOrigin.y, this->m_mapCellsZ);
+}
+
+float TerrainOccluderProxy::minHeight(const float x0, const float z0, const float x1, const float z1) const {
+	int range[4];
+	this->cellRange(x0, z0, x1, z1, range);
+	float lo = FLT_MAX;
+	for (int cz = range[1]; cz <= range[3]; ++cz) {
+		for (int cx = range[0]; cx <= range[2]; ++cx) {
+			lo = std::min(lo, this->m_cellMin[(size_t)cz * this->m_mapCellsX + cx]);
+		}
+	}
+	return lo;
+}
+
+float TerrainOccluderProxy::maxHeight(const float x0, const float z0, const float x1, const float z1) const {
+	int range[4];
+	this->cellRange(x0, z0, x1, z1, range);
+	float hi = -FLT_MAX;
+	for (int cz = range[1]; cz <= range[3]; ++cz) {
+		for (int cx = range[0]; cx <= range[2]; ++cx) {
+			hi = std::max(hi, this->m_cellMax[(size_t)cz * this->m_mapCellsX + cx]);
+		}
+	}
+	return hi;
+}
+
+bool TerrainOccluderProxy::update(const glm::vec3& viewOrg) {
+	if (this->m_cellMin.empty()) {
+		return false;
+	}
+	// the proxy only occludes for a viewer above the terrain
+	const float d = this->m_chunkEdgeLength;
+	if (!(viewOrg.y > this->maxHeight(viewOrg.x - d, viewOrg.z - d, viewOrg.x + d, viewOrg.z + d))) {
+		return false;
+	}
+
+	const int row = NUM_CELL + 1;
+	const float x0 = (std::floor(viewOrg.x / this->m_cellSize) - NUM_CELL / 2) * this->m_cellSize;
+	const float z0 = (std::floor(viewOrg.z / this->m_cellSize) - NUM_CELL / 2) * this->m_cellSize;
+	const float reach = this->m_cellSize + d;
+	for (int j = 0; j < row; ++j) {
+		for (int i = 0; i < row; ++i) {
+			const float x = x0 + i * this->m_cellSize, z = z0 + j * this->m_cellSize;
+			float* p = &this->m_vertices[((size_t)j * row + i) * 3];
+			p[0] = x;
+			p[1] = this->minHeight(x - reach, z - reach, x + reach, z + reach);
+			p[2] = z;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include "MyTerrainData.h"
+
+// Occluder mesh for the terrain: a regular grid around the viewer whose vertices never lie above the
+// rendered terrain. The terrain samples the elevation map (GL_NEAREST, clamp to edge) at the chunk
+// mesh vertices, so a point of its surface is a blend of texels within one chunk-mesh edge of it. A
+// proxy vertex takes the lowest texel within one proxy cell plus that edge length, which keeps the
+// proxy under the real surface everywhere: a view ray that hits the proxy from above has crossed the
+// terrain first.
+class TerrainOccluderProxy
+{
+public:
+	static const int NUM_CELL = 48;
+
+	TerrainOccluderProxy();
+	virtual ~TerrainOccluderProxy();
+
+public:
+	// cellSize: proxy grid spacing in world units
+	void init(const MyTerrainData* td, const float cellSize);
+	// re-centers the grid on the viewer (snapped to whole cells). False when the proxy can not
+	// occlude conservatively: no terrain, or the viewer is not above it.
+	bool update(const glm::vec3& viewOrg);
+
+	const float* vertices() const { return m_vertices.data(); }
+	int numVertex() const { return (int)m_vertices.size() / 3; }
+	const uint32_t* indices() const { return m_indices.data(); }
+	int numIndex() const { return (int)m_indices.size(); }
+
+private:
+	// lowest / highest texel of the cells overlapping [x0, x1] x [z0, z1]
+	float minHeight(const float x0, const float z0, const float x1, const float z1) const;
+	float maxHeight(const float x0, const float z0, const float x1, const float z1) const;
+	void cellRange(const float x0, const float z0, const float x1, const float z1, int range[4]) const;
+
+	float m_cellSize = 8.0f;
+	// chunk-mesh edge length near the viewer
+	float m_chunkEdgeLength = 0.0f;
+	// texel min/max per world cell over the elevation map
+	glm::vec2 m_mapOrigin = glm::vec2(0.0f);
+	int m_mapCellsX = 0;
+	int m_mapCellsZ = 0;
+	std::vector<float> m_cellMin;
+	std::vector<float> m_cellMax;
+
+	std::vector<float> m_vertices;
+	std::vector<uint32_t> m_indices;
+};
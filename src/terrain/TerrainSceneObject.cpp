@@ -1,4 +1,5 @@
 #include "TerrainSceneObject.h"
+#include "../GLStateCache.h"
 #include <glm/vec3.hpp>
 
 TerrainSceneObject::TerrainSceneObject(const int numChunk, const float* chunkVertices, const int numChunkVertex, const unsigned int* chunkIndices, const int numChunkIndex) :
@@ -38,30 +39,23 @@ void TerrainSceneObject::setAlbedoTextureHandle(const GLuint texHandle){
 	this->m_albedoMapHandle = texHandle;
 }
 
+void TerrainSceneObject::setMaterialIndex(const int idx) {
+	this->m_materialIndex = idx;
+}
+
 void TerrainSceneObject::update() {
+	GLStateCache* glState = GLStateCache::Instance();
 	// bind Buffer
-	glBindVertexArray(this->m_vao);
-
-	glActiveTexture(SceneManager::Instance()->m_elevationTexUnit);
-	glBindTexture(GL_TEXTURE_2D, this->m_evelationMapHandle);
-
-	glActiveTexture(SceneManager::Instance()->m_normalTexUnit);
-	glBindTexture(GL_TEXTURE_2D, this->m_normalMapHandle);
+	glState->bindVertexArray(this->m_vao);
 
-	glActiveTexture(SceneManager::Instance()->m_albedoTexUnit);
-	glBindTexture(GL_TEXTURE_2D, this->m_albedoMapHandle);
+	glState->bindTexture(SceneManager::Instance()->m_elevationTexUnit - GL_TEXTURE0, this->m_evelationMapHandle);
+	glState->bindTexture(SceneManager::Instance()->m_normalTexUnit - GL_TEXTURE0, this->m_normalMapHandle);
+	glState->bindTexture(SceneManager::Instance()->m_albedoTexUnit - GL_TEXTURE0, this->m_albedoMapHandle);
 
 	glUniformMatrix4fv(SceneManager::Instance()->m_terrainVToUVMatHandle, 1, false, glm::value_ptr(this->m_worldVertexToElevationMapUvMat));
 
-	glUniform1i(SceneManager::Instance()->m_fs_pixelProcessIdHandle, SceneManager::Instance()->m_fs_terrainPass);
-	// terrain 不用切換 normal map 開關，固定 0
-	glUniform1i(SceneManager::Instance()->m_useNormalMapHandle, 0);
-	// material: ambient = diffuse, specular 0, shininess 1
-	const glm::vec3 ambient(1.0f);
-	const glm::vec3 specular(0.0f);
-	glUniform3fv(SceneManager::Instance()->m_materialAmbientHandle, 1, glm::value_ptr(ambient));
-	glUniform3fv(SceneManager::Instance()->m_materialSpecularHandle, 1, glm::value_ptr(specular));
-	glUniform1f(SceneManager::Instance()->m_materialShininessHandle, 1.0f);
+	// terrain material (ambient = diffuse, specular 0, no normal map) lives in the material table
+	glUniform1i(SceneManager::Instance()->m_materialIndexHandle, this->m_materialIndex);
 
 	// render several chunks
 	for (int i = 0; i < this->m_numChunk; i++) {
@@ -72,7 +66,7 @@ void TerrainSceneObject::update() {
 		glUniformMatrix4fv(SceneManager::Instance()->m_modelMatHandle, 1, false, glm::value_ptr(this->m_chunkModelMats[i]));
 
 		int indicesPointer = 0;
-		glDrawElements(GL_TRIANGLES, this->m_numIndex, GL_UNSIGNED_INT, (GLvoid*)(indicesPointer));
+		glState->drawElements(GL_TRIANGLES, this->m_numIndex, GL_UNSIGNED_INT, (GLvoid*)(indicesPointer));
 	}
 }
 
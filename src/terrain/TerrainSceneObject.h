@@ -23,6 +23,7 @@ public:
 	void setElevationTextureHandle(const GLuint texHandle);
 	void setNormalTextureHandle(const GLuint texHandle);
 	void setAlbedoTextureHandle(const GLuint texHandle);
+	void setMaterialIndex(const int idx);
 
 private:
 	const int m_numChunk;
@@ -32,6 +33,7 @@ private:
 	glm::mat4 m_worldVertexToElevationMapUvMat;
 
 	int m_numIndex;
+	int m_materialIndex = 0;
 
 	GLuint m_evelationMapHandle;
 	GLuint m_normalMapHandle;
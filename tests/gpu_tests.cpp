@@ -0,0 +1,2602 @@
+// CG2025_gpu_tests: runs hzbBuild.comp, cullInstances.comp (+ depth bins), shadowCascadeFit.comp, the
+// cached shadow caster path, shadowMomentBlur.comp, the software occlusion buffer, occluder proxies, PVS clusters, impostors, mesh cluster culling and the foliage depth prepass on an EGL surfaceless context (Mesa llvmpipe is fine) and compares the results
+// with C++ references.
+// Run from the project root (shaders/ is loaded relative to it). Exit code 77 = no context (skip).
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "Shader.h"
+#include "FrustumUtils.h"
+#include "InstanceData.h"
+#include "UniformBlocks.h"
+#include "CullStats.h"
+#include "SoftwareOcclusion.h"
+#include "OccluderProxy.h"
+#include "PotentiallyVisibleSet.h"
+#include "ImpostorBaker.h"
+#include "MeshImport.h"
+#include "MeshClusters.h"
+
+static int g_numCheck = 0;
+static int g_numFailure = 0;
+
+static bool check(const bool condition, const char* format, ...) {
+	g_numCheck++;
+	if (condition) { return true; }
+	g_numFailure++;
+	std::printf("  FAIL: ");
+	va_list args;
+	va_start(args, format);
+	std::vprintf(format, args);
+	va_end(args);
+	std::printf("\n");
+	return false;
+}
+
+// ==============================================
+// context / programs
+
+static bool createSurfacelessContext() {
+	auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (getPlatformDisplay == nullptr) { return false; }
+	EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	EGLint major = 0, minor = 0;
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor) || !eglBindAPI(EGL_OPENGL_API)) { return false; }
+	const EGLint contextAttribs[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 4, EGL_CONTEXT_MINOR_VERSION, 5,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE
+	};
+	EGLContext context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttribs);
+	if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) { return false; }
+	return gladLoadGLLoader((GLADloadproc)eglGetProcAddress) != 0;
+}
+
+static ShaderProgram* loadComputeProgram(const std::string& path) {
+	Shader* cs = new Shader(GL_COMPUTE_SHADER);
+	const bool compiled = cs->createShaderFromFile(path);
+	if (!compiled) {
+		std::printf("  %s: %s\n", path.c_str(), cs->shaderInfoLog().c_str());
+		delete cs;
+		return nullptr;
+	}
+	ShaderProgram* program = new ShaderProgram();
+	program->init();
+	program->attachShader(cs);
+	program->checkStatus();
+	program->linkProgram();
+	cs->releaseShader();
+	delete cs;
+
+	GLint linked = 0;
+	glGetProgramiv(program->programId(), GL_LINK_STATUS, &linked);
+	if (!linked) {
+		delete program;
+		return nullptr;
+	}
+	return program;
+}
+
+static ShaderProgram* loadRenderProgram(const std::string& vsPath, const std::string& fsPath, const std::string& fsDefines = std::string()) {
+	Shader* vs = new Shader(GL_VERTEX_SHADER);
+	Shader* fs = new Shader(GL_FRAGMENT_SHADER);
+	const bool compiled = vs->createShaderFromFile(vsPath) && fs->createShaderFromFile(fsPath, fsDefines);
+	if (!compiled) {
+		std::printf("  %s / %s: %s%s\n", vsPath.c_str(), fsPath.c_str(), vs->shaderInfoLog().c_str(), fs->shaderInfoLog().c_str());
+		delete vs;
+		delete fs;
+		return nullptr;
+	}
+	ShaderProgram* program = new ShaderProgram();
+	program->init();
+	program->attachShader(vs);
+	program->attachShader(fs);
+	program->checkStatus();
+	program->linkProgram();
+	vs->releaseShader();
+	fs->releaseShader();
+	delete vs;
+	delete fs;
+
+	GLint linked = 0;
+	glGetProgramiv(program->programId(), GL_LINK_STATUS, &linked);
+	if (!linked) {
+		delete program;
+		return nullptr;
+	}
+	return program;
+}
+
+static int numMipLevel(const int w, const int h) {
+	return (int)std::floor(std::log2((float)std::max(w, h))) + 1;
+}
+
+static GLuint createPyramidTexture(const int w, const int h, const int levels, const GLenum format = GL_R32F) {
+	GLuint tex = 0;
+	glCreateTextures(GL_TEXTURE_2D, 1, &tex);
+	glTextureStorage2D(tex, levels, format, w, h);
+	glTextureParameteri(tex, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTextureParameteri(tex, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTextureParameteri(tex, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(tex, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	return tex;
+}
+
+static GLuint createDepthTexture(const int w, const int h, const std::vector<float>& depth) {
+	GLuint tex = 0;
+	glCreateTextures(GL_TEXTURE_2D, 1, &tex);
+	glTextureStorage2D(tex, 1, GL_DEPTH_COMPONENT32F, w, h);
+	glTextureParameteri(tex, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTextureParameteri(tex, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTextureSubImage2D(tex, 0, 0, 0, w, h, GL_DEPTH_COMPONENT, GL_FLOAT, depth.data());
+	return tex;
+}
+
+// channel: GL_RED / GL_GREEN
+static std::vector<float> readLevel(const GLuint tex, const int level, const int w, const int h, const GLenum channel = GL_RED) {
+	std::vector<float> texels((size_t)w * h);
+	glGetTextureImage(tex, level, channel, GL_FLOAT, (GLsizei)(texels.size() * sizeof(float)), texels.data());
+	return texels;
+}
+
+// ==============================================
+// C++ reference pyramid: level 0 = depth, level L texel covers its 2x2 block of level L-1, and
+// the last texel of a row/column also covers the extra texel of an odd-sized source
+
+struct PyramidLevel {
+	int w, h;
+	std::vector<float> texels;
+};
+
+static std::vector<PyramidLevel> referencePyramid(const int w, const int h, const std::vector<float>& depth, const bool useMax) {
+	std::vector<PyramidLevel> levels;
+	levels.push_back({ w, h, depth });
+	const int numLevel = numMipLevel(w, h);
+	for (int l = 1; l < numLevel; ++l) {
+		const PyramidLevel& src = levels.back();
+		PyramidLevel dst = { std::max(1, src.w >> 1), std::max(1, src.h >> 1), {} };
+		dst.texels.resize((size_t)dst.w * dst.h);
+		for (int y = 0; y < dst.h; ++y) {
+			for (int x = 0; x < dst.w; ++x) {
+				const int x1 = (x == dst.w - 1) ? src.w : std::min(src.w, 2 * x + 2);
+				const int y1 = (y == dst.h - 1) ? src.h : std::min(src.h, 2 * y + 2);
+				float m = useMax ? 0.0f : 1.0f;
+				for (int sy = 2 * y; sy < y1; ++sy) {
+					for (int sx = 2 * x; sx < x1; ++sx) {
+						const float d = src.texels[(size_t)sy * src.w + sx];
+						m = useMax ? std::max(m, d) : std::min(m, d);
+					}
+				}
+				dst.texels[(size_t)y * dst.w + x] = m;
+			}
+		}
+		levels.push_back(dst);
+	}
+	return levels;
+}
+
+static std::vector<float> syntheticDepth(const int w, const int h, const unsigned int seed) {
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<float> dist(0.2f, 0.9f);
+	std::vector<float> depth((size_t)w * h);
+	for (float& d : depth) { d = dist(rng); }
+	// extremes in the last row / column: an odd-size reduction that drops them is not conservative
+	depth[(size_t)(h - 1) * w + (w - 1)] = 0.05f;
+	depth[(size_t)(h / 2) * w + (w - 1)] = 0.99f;
+	depth[(size_t)(h - 1) * w + (w / 2)] = 0.01f;
+	return depth;
+}
+
+// every texel of level L-1 must be bounded by the level-L texel that covers it
+static void checkConservative(const std::vector<PyramidLevel>& gpu, const bool useMax, const char* label) {
+	for (size_t l = 1; l < gpu.size(); ++l) {
+		const PyramidLevel& src = gpu[l - 1];
+		const PyramidLevel& dst = gpu[l];
+		int numBad = 0;
+		for (int sy = 0; sy < src.h; ++sy) {
+			for (int sx = 0; sx < src.w; ++sx) {
+				const int dx = std::min(sx / 2, dst.w - 1);
+				const int dy = std::min(sy / 2, dst.h - 1);
+				const float s = src.texels[(size_t)sy * src.w + sx];
+				const float d = dst.texels[(size_t)dy * dst.w + dx];
+				if (useMax ? (d < s) : (d > s)) { numBad++; }
+			}
+		}
+		check(numBad == 0, "%s level %d: %d source texels not covered conservatively", label, (int)l, numBad);
+	}
+}
+
+static void comparePyramids(const std::vector<PyramidLevel>& gpu, const std::vector<PyramidLevel>& ref, const char* label) {
+	for (size_t l = 0; l < ref.size(); ++l) {
+		int numBad = 0, firstBad = -1;
+		for (size_t i = 0; i < ref[l].texels.size(); ++i) {
+			if (gpu[l].texels[i] != ref[l].texels[i]) {
+				if (firstBad < 0) { firstBad = (int)i; }
+				numBad++;
+			}
+		}
+		check(numBad == 0, "%s level %d (%dx%d): %d texels differ, first at (%d, %d)", label, (int)l, ref[l].w, ref[l].h,
+			numBad, (firstBad < 0) ? 0 : firstBad % ref[l].w, (firstBad < 0) ? 0 : firstBad / ref[l].w);
+	}
+}
+
+// ==============================================
+// hzbBuild.comp: same dispatch sequence as SceneRenderer::buildDepthPyramid. The viewport sits at
+// an offset inside a larger depth texture (the G-buffer) whose outside texels must not leak in;
+// r (nearest) must match the min reference, g (farthest) the max reference; swapped with reversed-Z.
+
+static void testHzbBuild(ShaderProgram* program, const GLuint counterBuffer, const int w, const int h, const int offsetX, const int offsetY, const bool reversedZ = false) {
+	char label[64];
+	std::snprintf(label, sizeof(label), "hzbBuild %dx%d at (%d, %d)%s", w, h, offsetX, offsetY, reversedZ ? " reversed-z" : "");
+	std::printf("%s\n", label);
+
+	const std::vector<float> depth = syntheticDepth(w, h, (unsigned int)(w * 131 + h));
+	const int frameW = w + offsetX + 5, frameH = h + offsetY + 3;
+	std::vector<float> frameDepth((size_t)frameW * frameH);
+	for (int y = 0; y < frameH; ++y) {
+		for (int x = 0; x < frameW; ++x) {
+			const bool inside = x >= offsetX && y >= offsetY && x < offsetX + w && y < offsetY + h;
+			frameDepth[(size_t)y * frameW + x] = inside ? depth[(size_t)(y - offsetY) * w + (x - offsetX)] : (((x + y) & 1) ? 0.0f : 1.0f);
+		}
+	}
+	const int levels = numMipLevel(w, h);
+	const GLuint depthTex = createDepthTexture(frameW, frameH, frameDepth);
+	const GLuint pyramidTex = createPyramidTexture(w, h, levels, GL_RG32F);
+
+	program->useProgram();
+	glBindTextureUnit(1, depthTex);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, counterBuffer);
+	const int LEVELS_PER_PASS = 8;
+	int numDispatch = 0;
+	for (int baseLevel = 0; baseLevel == 0 || baseLevel < levels - 1; baseLevel += LEVELS_PER_PASS - 1) {
+		const int numLevels = std::min(LEVELS_PER_PASS, levels - baseLevel);
+		for (int i = 0; i < numLevels; ++i) {
+			glBindImageTexture(i, pyramidTex, baseLevel + i, GL_FALSE, 0, GL_READ_WRITE, GL_RG32F);
+		}
+		glUniform2i(0, offsetX, offsetY);
+		glUniform1i(1, baseLevel);
+		glUniform1i(2, numLevels);
+		glUniform1i(3, reversedZ ? 1 : 0);
+		if (baseLevel == 0) {
+			glDispatchCompute((w + 63) / 64, (h + 63) / 64, 1);
+		}
+		else {
+			glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+			glDispatchCompute(1, 1, 1);
+		}
+		numDispatch++;
+	}
+	glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+	std::printf("  %d levels, %d dispatches\n", levels, numDispatch);
+
+	for (int channel = 0; channel < 2; ++channel) {
+		const bool useMax = (channel == 1) != reversedZ;
+		char channelLabel[80];
+		std::snprintf(channelLabel, sizeof(channelLabel), "%s %s", label, useMax ? "max" : "min");
+		const std::vector<PyramidLevel> ref = referencePyramid(w, h, depth, useMax);
+		std::vector<PyramidLevel> gpu;
+		for (const PyramidLevel& r : ref) {
+			gpu.push_back({ r.w, r.h, readLevel(pyramidTex, (int)gpu.size(), r.w, r.h, (channel == 1) ? GL_GREEN : GL_RED) });
+		}
+		comparePyramids(gpu, ref, channelLabel);
+		checkConservative(gpu, useMax, channelLabel);
+	}
+	// the next build starts from a zero counter
+	uint32_t finishedGroups = ~0u;
+	glGetNamedBufferSubData(counterBuffer, 0, sizeof(uint32_t), &finishedGroups);
+	check(finishedGroups == 0u, "%s: group counter left at %u", label, finishedGroups);
+
+	glDeleteTextures(1, &depthTex);
+	glDeleteTextures(1, &pyramidTex);
+}
+
+// ==============================================
+// cullInstances.comp against a C++ port of the same tests. Instances within a small margin of
+// a decision boundary (plane, distance, texel edge, depth compare) may go either way on the
+// GPU and are not compared.
+
+enum class CullRef { CULLED, VISIBLE, AMBIGUOUS };
+
+// reason: CullReason of the (unambiguous) outcome
+static CullRef referenceCull(const InstanceDataGPU& inst, const FrameBlockGPU& frame, const CullBlockGPU& cull, const std::vector<PyramidLevel>& pyramid, int& reason) {
+	const float EPS = 1.0e-3f;
+	bool ambiguous = false;
+	reason = CULL_VISIBLE;
+	const glm::vec3 center = glm::vec3(inst.sphere);
+	const float radius = inst.sphere.w;
+
+	const glm::vec3 viewCenter = glm::vec3(frame.cullViewMat * glm::vec4(center, 1.0f));
+	const float distMargin = cull.cullParams.x - (-viewCenter.z);
+	if (std::abs(distMargin) < EPS) { ambiguous = true; }
+	if (distMargin < 0.0f) { reason = CULL_DISTANCE; return ambiguous ? CullRef::AMBIGUOUS : CullRef::CULLED; }
+
+	for (int i = 0; i < 6; ++i) {
+		const float d = glm::dot(cull.frustumPlanes[i], glm::vec4(center, 1.0f)) + radius;
+		if (std::abs(d) < EPS * (1.0f + std::abs(radius))) { ambiguous = true; }
+		if (d < 0.0f) { reason = CULL_FRUSTUM; return ambiguous ? CullRef::AMBIGUOUS : CullRef::CULLED; }
+	}
+
+	if (cull.cullFlags.y == 1u) {
+		const glm::vec4 clip = frame.cullVP * glm::vec4(center, 1.0f);
+		if (std::abs(clip.w - 0.0001f) < EPS) { ambiguous = true; }
+		if (clip.w <= 0.0001f) { reason = CULL_OFFSCREEN; return ambiguous ? CullRef::AMBIGUOUS : CullRef::CULLED; }
+		const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		const glm::vec2 uv = glm::vec2(ndc) * 0.5f + 0.5f;
+		for (int k = 0; k < 2; ++k) {
+			if (std::abs(uv[k]) < EPS || std::abs(uv[k] - 1.0f) < EPS) { ambiguous = true; }
+		}
+		if (uv.x < 0.0f || uv.x > 1.0f || uv.y < 0.0f || uv.y > 1.0f) { reason = CULL_OFFSCREEN; return ambiguous ? CullRef::AMBIGUOUS : CullRef::CULLED; }
+
+		// textureLod with GL_NEAREST_MIPMAP_NEAREST at an integer lod
+		const PyramidLevel& level = pyramid[std::min((size_t)cull.cullFlags.z, pyramid.size() - 1)];
+		const float fx = uv.x * level.w, fy = uv.y * level.h;
+		if (std::abs(fx - std::round(fx)) < 0.01f || std::abs(fy - std::round(fy)) < 0.01f) { ambiguous = true; }
+		const int tx = std::clamp((int)std::floor(fx), 0, level.w - 1);
+		const int ty = std::clamp((int)std::floor(fy), 0, level.h - 1);
+		const float occDepth = level.texels[(size_t)ty * level.w + tx];
+		// reversed-Z: nearest is the largest depth, the bias is relative
+		const float depthMargin = (frame.depthFlags.x != 0)
+			? ndc.z - occDepth * (1.0f - cull.cullParams.y)
+			: (occDepth + cull.cullParams.y) - (ndc.z * 0.5f + 0.5f);
+		if (std::abs(depthMargin) < ((frame.depthFlags.x != 0) ? 1.0e-7f : 1.0e-5f)) { ambiguous = true; }
+		if (depthMargin < 0.0f) { reason = CULL_OCCLUSION; return ambiguous ? CullRef::AMBIGUOUS : CullRef::CULLED; }
+	}
+	return ambiguous ? CullRef::AMBIGUOUS : CullRef::VISIBLE;
+}
+
+// depthBins.glsl: sqrt-spaced bins over [0, maxViewDepth]
+static uint32_t referenceDepthBin(const float viewDepth, const float maxViewDepth) {
+	const float t = std::sqrt(std::clamp(viewDepth / maxViewDepth, 0.0f, 1.0f));
+	return std::min((uint32_t)(t * (float)DEPTH_BIN_COUNT), (uint32_t)(DEPTH_BIN_COUNT - 1));
+}
+
+struct DepthSortPrograms {
+	ShaderProgram* scan;
+	ShaderProgram* scatter;
+};
+
+struct CullTestOptions {
+	CullTestOptions(const int numInstance, const int w, const int h) : numInstance(numInstance), w(w), h(h) {}
+
+	int numInstance;
+	int w;
+	int h;
+	bool useOcclusion = false;
+	int fixedLevel = 0;
+	// groups per dispatch row (SceneRenderer::dispatchCulling uses 65535; smaller values
+	// exercise the 2D dispatch of very large batches with few instances)
+	uint32_t maxGroupX = 65535u;
+	// cull into depth bins, then scan + scatter like SceneRenderer::sortVisibleByDepth
+	const DepthSortPrograms* depthSort = nullptr;
+	// [0,1] projection with near = 1, pyramid of max depths (nearest)
+	bool reversedZ = false;
+	bool pvsRanges = false;
+	float impostorDistance = 0.0f;
+};
+
+static void testCullInstances(ShaderProgram* program, const CullTestOptions& options) {
+	const int numInstance = options.numInstance;
+	const int w = options.w;
+	const int h = options.h;
+	const bool useOcclusion = options.useOcclusion;
+	const int fixedLevel = options.fixedLevel;
+	const uint32_t maxGroupX = options.maxGroupX;
+	const DepthSortPrograms* depthSort = options.depthSort;
+	const bool reversedZ = options.reversedZ;
+	const bool pvsRanges = options.pvsRanges;
+	const float impostorDistance = options.impostorDistance;
+	char label[160];
+	std::snprintf(label, sizeof(label), "cullInstances n=%d %dx%d occlusion=%d level=%d groupsX<=%u%s%s%s%s", numInstance, w, h, useOcclusion ? 1 : 0, fixedLevel, maxGroupX, depthSort ? " depth-sorted" : "", reversedZ ? " reversed-z" : "", pvsRanges ? " pvs" : "", impostorDistance > 0.0f ? " impostors" : "");
+	std::printf("%s\n", label);
+
+	// camera at (0, 10, 0) looking down -Z
+	const float nearD = 0.1f, farD = 500.0f;
+	const glm::mat4 viewMat = glm::lookAt(glm::vec3(0.0f, 10.0f, 0.0f), glm::vec3(0.0f, 10.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	const glm::mat4 projMat = reversedZ
+		? glm::perspectiveRH_ZO(glm::radians(60.0f), (float)w / (float)h, farD, nearD)
+		: glm::perspective(glm::radians(60.0f), (float)w / (float)h, nearD, farD);
+
+	FrameBlockGPU frame = {};
+	frame.cullVP = projMat * viewMat;
+	frame.cullViewMat = viewMat;
+	frame.depthFlags = glm::ivec4(reversedZ ? 1 : 0, 0, 0, 0);
+	CullBlockGPU cull = {};
+	glm::vec4 planes[6];
+	extractFrustumPlanes(frame.cullVP, planes, reversedZ);
+	for (int i = 0; i < 6; ++i) { cull.frustumPlanes[i] = planes[i]; }
+	cull.cullParams = glm::vec4(300.0f, 0.001f, (float)w, (float)h);
+	cull.cullFlags = glm::uvec4((unsigned int)numInstance, useOcclusion ? 1u : 0u, (unsigned int)fixedLevel, depthSort ? 1u : 0u);
+	cull.cullInfo = glm::uvec4(0u, 1u, 0u, 0u); // per-instance reasons on (cull overlay)
+	cull.impostorParams = glm::vec4(impostorDistance, 0.0f, 0.0f, 0.0f);
+
+	// occluder: a wall 40 units away covering the left 60% of the screen, sky elsewhere
+	const glm::vec4 wallClip = projMat * glm::vec4(0.0f, 0.0f, -40.0f, 1.0f);
+	const float wallDepth = reversedZ ? wallClip.z / wallClip.w : (wallClip.z / wallClip.w) * 0.5f + 0.5f;
+	std::vector<float> depth((size_t)w * h, reversedZ ? 0.0f : 1.0f);
+	for (int y = 0; y < h; ++y) {
+		for (int x = 0; x < (w * 3) / 5; ++x) { depth[(size_t)y * w + x] = wallDepth; }
+	}
+	const std::vector<PyramidLevel> pyramid = referencePyramid(w, h, depth, reversedZ);
+	const GLuint pyramidTex = createPyramidTexture(w, h, (int)pyramid.size());
+	for (size_t l = 0; l < pyramid.size(); ++l) {
+		glTextureSubImage2D(pyramidTex, (GLint)l, 0, 0, pyramid[l].w, pyramid[l].h, GL_RED, GL_FLOAT, pyramid[l].texels.data());
+	}
+
+	// instances in and around the view volume: some behind, past the distance limit, behind the wall
+	std::mt19937 rng(numInstance + w);
+	std::uniform_real_distribution<float> xDist(-250.0f, 250.0f), yDist(-20.0f, 60.0f), zDist(-450.0f, 50.0f), rDist(0.2f, 6.0f);
+	std::vector<InstanceDataGPU> instances(numInstance);
+	for (InstanceDataGPU& inst : instances) {
+		const glm::vec3 c(xDist(rng), yDist(rng), zDist(rng));
+		inst.model = glm::translate(glm::mat4(1.0f), c);
+		inst.sphere = glm::vec4(c, rDist(rng));
+	}
+	// PVS: alternating runs of dispatched and pruned instances, as SceneRenderer::updatePvsRanges uploads them
+	std::vector<int> inPvs(numInstance, 1);
+	std::vector<glm::uvec2> ranges;
+	uint32_t numThread = (uint32_t)numInstance;
+	if (pvsRanges) {
+		std::uniform_int_distribution<int> runDist(1, 300);
+		numThread = 0;
+		bool dispatched = false;
+		for (int first = 0; first < numInstance; dispatched = !dispatched) {
+			const int count = std::min(runDist(rng), numInstance - first);
+			if (dispatched) {
+				ranges.push_back(glm::uvec2((uint32_t)first, numThread));
+				numThread += (uint32_t)count;
+			}
+			std::fill(inPvs.begin() + first, inPvs.begin() + first + count, dispatched ? 1 : 0);
+			first += count;
+		}
+		cull.cullFlags.x = numThread;
+		cull.cullInfo.w = (uint32_t)ranges.size();
+	}
+
+	GLuint buffers[5];
+	glCreateBuffers(5, buffers);
+	const GLuint instanceBuffer = buffers[0], visibleBuffer = buffers[1], drawBuffer = buffers[2], frameUBO = buffers[3], cullUBO = buffers[4];
+	glNamedBufferData(instanceBuffer, instances.size() * sizeof(InstanceDataGPU), instances.data(), GL_STATIC_DRAW);
+	std::vector<uint32_t> visibleInit(numInstance + 1, 0xFFFFFFFFu);
+	visibleInit[0] = 0;
+	glNamedBufferData(visibleBuffer, visibleInit.size() * sizeof(uint32_t), visibleInit.data(), GL_DYNAMIC_READ);
+	const uint32_t drawCmd[5] = { 36u, 0u, 0u, 0u, 0u };
+	glNamedBufferData(drawBuffer, sizeof(drawCmd), drawCmd, GL_DYNAMIC_READ);
+	glNamedBufferData(frameUBO, sizeof(FrameBlockGPU), &frame, GL_STATIC_DRAW);
+	glNamedBufferData(cullUBO, sizeof(CullBlockGPU), &cull, GL_STATIC_DRAW);
+	// cull.cullInfo.x = 0: counters of batch 0
+	GLuint statsBuffer = 0, reasonBuffer = 0;
+	glCreateBuffers(1, &statsBuffer);
+	const std::vector<uint32_t> statsInit(CULL_STATS_STRIDE, 0u);
+	glNamedBufferData(statsBuffer, statsInit.size() * sizeof(uint32_t), statsInit.data(), GL_DYNAMIC_READ);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, statsBuffer);
+	glCreateBuffers(1, &reasonBuffer);
+	const std::vector<uint32_t> reasonInit(numInstance, pvsRanges ? (uint32_t)CULL_PVS : 0xFFFFFFFFu);
+	glNamedBufferData(reasonBuffer, reasonInit.size() * sizeof(uint32_t), reasonInit.data(), GL_DYNAMIC_READ);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, reasonBuffer);
+	GLuint rangeBuffer = 0;
+	if (pvsRanges) {
+		glCreateBuffers(1, &rangeBuffer);
+		glNamedBufferData(rangeBuffer, (GLsizeiptr)std::max<size_t>(ranges.size(), 1) * sizeof(glm::uvec2), ranges.data(), GL_STATIC_DRAW);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, rangeBuffer);
+	}
+	// impostor list: DrawArraysIndirectCommand + indices
+	GLuint impostorBuffer = 0;
+	if (impostorDistance > 0.0f) {
+		std::vector<uint32_t> impostorInit(4 + numInstance, 0xFFFFFFFFu);
+		impostorInit[0] = 6u;
+		impostorInit[1] = impostorInit[2] = impostorInit[3] = 0u;
+		glCreateBuffers(1, &impostorBuffer);
+		glNamedBufferData(impostorBuffer, impostorInit.size() * sizeof(uint32_t), impostorInit.data(), GL_DYNAMIC_READ);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, impostorBuffer);
+	}
+	GLuint binBuffers[2] = { 0, 0 };
+	if (depthSort) {
+		glCreateBuffers(2, binBuffers);
+		glNamedBufferData(binBuffers[0], (GLsizeiptr)numInstance * 2 * sizeof(uint32_t), nullptr, GL_DYNAMIC_READ);
+		const std::vector<uint32_t> binsInit((DEPTH_BIN_DISPATCH_OFFSET / sizeof(uint32_t)) + 4, 0u);
+		glNamedBufferData(binBuffers[1], binsInit.size() * sizeof(uint32_t), binsInit.data(), GL_DYNAMIC_READ);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, binBuffers[0]);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, binBuffers[1]);
+	}
+
+	program->useProgram();
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, instanceBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, visibleBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, drawBuffer);
+	glBindBufferBase(GL_UNIFORM_BUFFER, UBO_FRAME_BINDING, frameUBO);
+	glBindBufferBase(GL_UNIFORM_BUFFER, UBO_CULL_BINDING, cullUBO);
+	glBindTextureUnit(5, pyramidTex);
+	const uint32_t numGroup = (numThread + 255u) / 256u;
+	const uint32_t numGroupX = std::min(numGroup, maxGroupX);
+	glDispatchCompute(numGroupX, (numGroup + numGroupX - 1) / numGroupX, 1);
+	if (depthSort) {
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+		depthSort->scan->useProgram();
+		glDispatchCompute(1, 1, 1);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+		depthSort->scatter->useProgram();
+		glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, binBuffers[1]);
+		glDispatchComputeIndirect(DEPTH_BIN_DISPATCH_OFFSET);
+		glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+	}
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+	std::vector<uint32_t> visible(numInstance + 1);
+	glGetNamedBufferSubData(visibleBuffer, 0, visible.size() * sizeof(uint32_t), visible.data());
+	uint32_t drawResult[5];
+	glGetNamedBufferSubData(drawBuffer, 0, sizeof(drawResult), drawResult);
+
+	const uint32_t count = visible[0];
+	check(count <= (uint32_t)numInstance, "%s: visible count %u exceeds instance count", label, count);
+	check(drawResult[1] == count, "%s: instanceCount %u != visible count %u", label, drawResult[1], count);
+	check(drawResult[0] == 36u, "%s: index count was modified", label);
+
+	std::vector<int> gpuState(numInstance, 0);
+	int numDuplicate = 0, numOutOfRange = 0;
+	for (uint32_t i = 0; i < std::min(count, (uint32_t)numInstance); ++i) {
+		const uint32_t idx = visible[i + 1];
+		if (idx >= (uint32_t)numInstance) { numOutOfRange++; continue; }
+		if (gpuState[idx] != 0) { numDuplicate++; }
+		gpuState[idx] = 1;
+	}
+	// visible instances past the impostor distance are in the impostor list instead, each in one list only
+	uint32_t numImpostor = 0;
+	if (impostorBuffer != 0) {
+		std::vector<uint32_t> impostors(4 + numInstance);
+		glGetNamedBufferSubData(impostorBuffer, 0, impostors.size() * sizeof(uint32_t), impostors.data());
+		numImpostor = impostors[1];
+		check(impostors[0] == 6u && impostors[2] == 0u && impostors[3] == 0u, "%s: impostor draw command was modified", label);
+		check(count + numImpostor <= (uint32_t)numInstance, "%s: %u impostors and %u visible", label, numImpostor, count);
+		int numWrongSide = 0;
+		for (uint32_t i = 0; i < std::min(numImpostor, (uint32_t)numInstance); ++i) {
+			const uint32_t idx = impostors[4 + i];
+			if (idx >= (uint32_t)numInstance) { numOutOfRange++; continue; }
+			if (gpuState[idx] != 0) { numDuplicate++; }
+			gpuState[idx] = 2;
+		}
+		for (int i = 0; i < numInstance; ++i) {
+			if (gpuState[i] == 0) continue;
+			const float distance = glm::length(glm::vec3(frame.cullViewMat * glm::vec4(glm::vec3(instances[i].sphere), 1.0f)));
+			if (std::abs(distance - impostorDistance) > 1.0e-3f && (gpuState[i] == 2) != (distance > impostorDistance)) { numWrongSide++; }
+		}
+		std::printf("  impostors %u\n", numImpostor);
+		check(numImpostor > 0 && count > 0, "%s: degenerate impostor split (%u meshes, %u impostors)", label, count, numImpostor);
+		check(numWrongSide == 0, "%s: %d instances on the wrong side of the impostor distance", label, numWrongSide);
+	}
+	check(numOutOfRange == 0 && numDuplicate == 0, "%s: %d out-of-range and %d duplicate indices", label, numOutOfRange, numDuplicate);
+
+	if (depthSort) {
+		std::vector<uint32_t> bins((DEPTH_BIN_DISPATCH_OFFSET / sizeof(uint32_t)) + 4);
+		glGetNamedBufferSubData(binBuffers[1], 0, bins.size() * sizeof(uint32_t), bins.data());
+		std::vector<uint32_t> entries((size_t)count * 2);
+		glGetNamedBufferSubData(binBuffers[0], 0, entries.size() * sizeof(uint32_t), entries.data());
+
+		uint32_t binTotal = 0;
+		for (int b = 0; b < DEPTH_BIN_COUNT; ++b) { binTotal += bins[b]; }
+		check(binTotal == count, "%s: bin counts sum to %u, visible count %u", label, binTotal, count);
+		// after the scatter every offset has advanced to the end of its bin
+		uint32_t end = 0, numBadOffset = 0;
+		for (int b = 0; b < DEPTH_BIN_COUNT; ++b) {
+			end += bins[b];
+			if (bins[DEPTH_BIN_COUNT + b] != end) { numBadOffset++; }
+		}
+		check(numBadOffset == 0, "%s: %u bin offsets don't end at their bin", label, numBadOffset);
+		const uint32_t numGroupScatter = (count + 255u) / 256u;
+		const uint32_t* dispatch = &bins[DEPTH_BIN_DISPATCH_OFFSET / sizeof(uint32_t)];
+		check(count == 0 || (dispatch[0] * dispatch[1] >= numGroupScatter && dispatch[0] <= 65535u && dispatch[2] == 1u),
+			"%s: scatter dispatch %ux%ux%u for %u groups", label, dispatch[0], dispatch[1], dispatch[2], numGroupScatter);
+
+		// indices[] must run through the bins near to far; each instance's bin matches the reference
+		// unless it sits on a bin edge
+		std::vector<uint32_t> binOf(numInstance, 0u);
+		int numBinMismatch = 0;
+		for (uint32_t i = 0; i < count; ++i) {
+			const uint32_t idx = entries[(size_t)i * 2], bin = entries[(size_t)i * 2 + 1];
+			if (idx >= (uint32_t)numInstance) { continue; }
+			binOf[idx] = bin;
+			const float viewDepth = -(frame.cullViewMat * glm::vec4(glm::vec3(instances[idx].sphere), 1.0f)).z;
+			const float t = std::sqrt(std::clamp(viewDepth / cull.cullParams.x, 0.0f, 1.0f)) * (float)DEPTH_BIN_COUNT;
+			if (std::abs(t - std::round(t)) > 1.0e-3f && bin != referenceDepthBin(viewDepth, cull.cullParams.x)) { numBinMismatch++; }
+		}
+		check(numBinMismatch == 0, "%s: %d instances in the wrong depth bin", label, numBinMismatch);
+		int numOutOfOrder = 0;
+		for (uint32_t i = 1; i < std::min(count, (uint32_t)numInstance); ++i) {
+			const uint32_t a = visible[i], b = visible[i + 1];
+			if (a < (uint32_t)numInstance && b < (uint32_t)numInstance && binOf[b] < binOf[a]) { numOutOfOrder++; }
+		}
+		check(numOutOfOrder == 0, "%s: %d visible indices out of near-to-far order", label, numOutOfOrder);
+		glDeleteBuffers(2, binBuffers);
+	}
+
+	std::vector<uint32_t> gpuReason(numInstance);
+	glGetNamedBufferSubData(reasonBuffer, 0, gpuReason.size() * sizeof(uint32_t), gpuReason.data());
+	int numVisibleRef = 0, numAmbiguous = 0, numFalseCull = 0, numFalseVisible = 0, numWrongReason = 0, numOutsidePvs = 0;
+	int reasonRef[CULL_REASON_COUNT] = {};
+	for (int i = 0; i < numInstance; ++i) {
+		if (!inPvs[i]) {
+			// never dispatched: not visible, reason untouched
+			if (gpuState[i] != 0 || gpuReason[i] != CULL_PVS) { numOutsidePvs++; }
+			continue;
+		}
+		int reason = CULL_VISIBLE;
+		const CullRef ref = referenceCull(instances[i], frame, cull, pyramid, reason);
+		// the overlay reason must agree with the visible list, and with the reference when unambiguous
+		if (gpuReason[i] >= CULL_REASON_COUNT || (gpuReason[i] == CULL_VISIBLE) != (gpuState[i] != 0)) { numWrongReason++; }
+		if (ref == CullRef::AMBIGUOUS) { numAmbiguous++; continue; }
+		reasonRef[reason]++;
+		if (gpuReason[i] != (uint32_t)reason) { numWrongReason++; }
+		if (ref == CullRef::VISIBLE) {
+			numVisibleRef++;
+			if (gpuState[i] == 0) { numFalseCull++; }
+		}
+		else if (gpuState[i] != 0) {
+			numFalseVisible++;
+		}
+	}
+	std::printf("  visible %u (reference %d, %d ambiguous)\n", count, numVisibleRef, numAmbiguous);
+	check(numFalseCull == 0, "%s: %d instances culled that the reference keeps", label, numFalseCull);
+	check(numFalseVisible == 0, "%s: %d instances kept that the reference culls", label, numFalseVisible);
+	// rejection counters: every instance counted once, each reason within the ambiguous margin
+	uint32_t stats[CULL_STATS_STRIDE];
+	glGetNamedBufferSubData(statsBuffer, 0, sizeof(stats), stats);
+	uint32_t statsTotal = 0;
+	int numBadReason = 0;
+	for (int r = 0; r < CULL_REASON_COUNT; ++r) {
+		statsTotal += stats[r];
+		if (std::abs((int)stats[r] - reasonRef[r]) > numAmbiguous) { numBadReason++; }
+	}
+	std::printf("  distance %u, frustum %u, off-screen %u, occluded %u\n", stats[CULL_DISTANCE], stats[CULL_FRUSTUM], stats[CULL_OFFSCREEN], stats[CULL_OCCLUSION]);
+	check(statsTotal == numThread && stats[CULL_VISIBLE] == count + numImpostor, "%s: cull stats count %u instances, %u visible", label, statsTotal, stats[CULL_VISIBLE]);
+	check(numBadReason == 0, "%s: %d rejection counters off the reference", label, numBadReason);
+	check(numWrongReason == 0, "%s: %d per-instance cull reasons wrong", label, numWrongReason);
+	check(numOutsidePvs == 0, "%s: %d instances outside the PVS ranges were culled", label, numOutsidePvs);
+	// make sure the scene exercises the tests at all
+	check(numVisibleRef > 0 && numVisibleRef < (int)numThread - numAmbiguous, "%s: degenerate scene (%d visible)", label, numVisibleRef);
+
+	if (rangeBuffer != 0) {
+		glDeleteBuffers(1, &rangeBuffer);
+	}
+	if (impostorBuffer != 0) {
+		glDeleteBuffers(1, &impostorBuffer);
+	}
+	glDeleteBuffers(5, buffers);
+	glDeleteBuffers(1, &statsBuffer);
+	glDeleteBuffers(1, &reasonBuffer);
+	glDeleteTextures(1, &pyramidTex);
+}
+
+// ==============================================
+// PVS clusters (PotentiallyVisibleSet.h): sortSamplesByCluster must turn every cluster into one
+// contiguous run of its own samples without losing any, and the run-length encoded bitsets must
+// decode to what was encoded.
+
+static void testPvsClusters() {
+	std::printf("pvs clusters\n");
+	std::mt19937 rng(2025);
+	std::uniform_real_distribution<float> posDist(-300.0f, 300.0f), angleDist(0.0f, 6.28f);
+	MyPoissonSample sample;
+	sample.m_numSample = 20000;
+	sample.m_positions = new float[sample.m_numSample * 3];
+	sample.m_radians = new float[sample.m_numSample * 3];
+	double sumBefore = 0.0;
+	for (int i = 0; i < sample.m_numSample; ++i) {
+		sample.m_positions[i * 3 + 0] = posDist(rng);
+		sample.m_positions[i * 3 + 1] = (float)i; // identifies the sample
+		sample.m_positions[i * 3 + 2] = posDist(rng) * 0.3f;
+		sample.m_radians[i * 3 + 1] = (float)i;
+		sumBefore += (double)i;
+	}
+	const float clusterSize = 32.0f;
+	std::vector<InstanceCluster> clusters;
+	sortSamplesByCluster(sample, clusterSize, clusters);
+
+	int numWrongCell = 0, numMismatch = 0, numUnordered = 0, end = 0;
+	double sumAfter = 0.0;
+	for (size_t c = 0; c < clusters.size(); ++c) {
+		const InstanceCluster& cluster = clusters[c];
+		if (cluster.first != end || cluster.count <= 0) { numUnordered++; }
+		end = cluster.first + cluster.count;
+		if (c > 0 && (cluster.cell.y < clusters[c - 1].cell.y || (cluster.cell.y == clusters[c - 1].cell.y && cluster.cell.x <= clusters[c - 1].cell.x))) { numUnordered++; }
+		for (int i = cluster.first; i < end && i < sample.m_numSample; ++i) {
+			if (clusterCellOf(sample.m_positions[i * 3 + 0], sample.m_positions[i * 3 + 2], clusterSize) != cluster.cell) { numWrongCell++; }
+			if (sample.m_radians[i * 3 + 1] != sample.m_positions[i * 3 + 1]) { numMismatch++; }
+			sumAfter += (double)sample.m_positions[i * 3 + 1];
+		}
+	}
+	std::printf("  %zu clusters\n", clusters.size());
+	check(end == sample.m_numSample && numUnordered == 0, "pvs clusters: clusters not contiguous / ordered (%d)", numUnordered);
+	check(numWrongCell == 0, "pvs clusters: %d samples in the wrong cluster", numWrongCell);
+	check(numMismatch == 0 && sumAfter == sumBefore, "pvs clusters: samples lost or rotations mixed up (%d)", numMismatch);
+
+	// bitsets: empty, all set, all clear, random runs and long runs (multi-byte varints)
+	std::vector<std::vector<uint8_t>> bitsets = { {}, std::vector<uint8_t>(1000, 1), std::vector<uint8_t>(777, 0) };
+	std::uniform_int_distribution<int> runDist(1, 40);
+	for (int longRuns = 0; longRuns < 2; ++longRuns) {
+		std::vector<uint8_t> bits;
+		for (uint8_t value = 1; bits.size() < 5000; value ^= 1) {
+			bits.insert(bits.end(), (size_t)(longRuns ? runDist(rng) * 200 : runDist(rng)), value);
+		}
+		bitsets.push_back(bits);
+	}
+	int numBad = 0;
+	for (const std::vector<uint8_t>& bits : bitsets) {
+		std::vector<uint8_t> encoded, decoded;
+		PotentiallyVisibleSet::encodeBits(bits, encoded);
+		if (!PotentiallyVisibleSet::decodeBits(encoded, (int)bits.size(), decoded) || decoded != bits) { numBad++; }
+		// wrong length or a truncated stream must be rejected
+		if (PotentiallyVisibleSet::decodeBits(encoded, (int)bits.size() + 1, decoded)) { numBad++; }
+		if (encoded.size() > 1 && PotentiallyVisibleSet::decodeBits(std::vector<uint8_t>(encoded.begin(), encoded.end() - 1), (int)bits.size(), decoded)) { numBad++; }
+	}
+	check(numBad == 0, "pvs clusters: %d bitset round trips failed", numBad);
+}
+
+// ==============================================
+// Foliage depth prepass: overlapping alpha-cutout cards drawn like SceneRenderer's foliage pass,
+// once with the G-buffer shader alone and once as prepass + GL_EQUAL G-buffer pass. gDiffuse.a is
+// additively blended, so it counts the fragments shaded per pixel. With the prepass every covered
+// pixel must be shaded exactly once (a depth mismatch between the two vertex shaders would leave
+// holes) and the result must match the single pass. The overdraw counters (overdraw.glsl) run in
+// both passes and must agree with their own heat image.
+
+struct FoliagePrograms {
+	ShaderProgram* gbuffer; // oglVertexShader + oglFragmentShader, OVERDRAW_COUNT
+	ShaderProgram* depth;   // foliageDepthVertex + foliageDepthFragment
+	ShaderProgram* equal;   // oglVertexShader + foliageGBufferFragment, OVERDRAW_COUNT
+};
+
+static void testFoliagePrepass(const FoliagePrograms& programs, const int numCard, const int w, const int h) {
+	char label[64];
+	std::snprintf(label, sizeof(label), "foliage prepass cards=%d %dx%d", numCard, w, h);
+	std::printf("%s\n", label);
+
+	// G-buffer: 5 RGBA32F targets + depth
+	GLuint fbo = 0, targets[5], depthTex = 0;
+	glCreateFramebuffers(1, &fbo);
+	glCreateTextures(GL_TEXTURE_2D, 5, targets);
+	const GLenum attachments[5] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3, GL_COLOR_ATTACHMENT4 };
+	for (int i = 0; i < 5; ++i) {
+		glTextureStorage2D(targets[i], 1, GL_RGBA32F, w, h);
+		glNamedFramebufferTexture(fbo, attachments[i], targets[i], 0);
+	}
+	glCreateTextures(GL_TEXTURE_2D, 1, &depthTex);
+	glTextureStorage2D(depthTex, 1, GL_DEPTH_COMPONENT32F, w, h);
+	glNamedFramebufferTexture(fbo, GL_DEPTH_ATTACHMENT, depthTex, 0);
+	glNamedFramebufferDrawBuffers(fbo, 5, attachments);
+	check(glCheckNamedFramebufferStatus(fbo, GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE, "%s: incomplete framebuffer", label);
+
+	// albedo: stripes of alpha 0 / 1 so the cutout matters
+	const int TEX = 16;
+	std::vector<uint8_t> texels((size_t)TEX * TEX * 4);
+	for (int y = 0; y < TEX; ++y) {
+		for (int x = 0; x < TEX; ++x) {
+			uint8_t* t = &texels[((size_t)y * TEX + x) * 4];
+			t[0] = 200; t[1] = (uint8_t)(x * 16); t[2] = (uint8_t)(y * 16); t[3] = ((x / 3 + y / 5) % 2 == 0) ? 255 : 0;
+		}
+	}
+	GLuint albedoTex = 0;
+	glCreateTextures(GL_TEXTURE_2D, 1, &albedoTex);
+	glTextureStorage2D(albedoTex, 1, GL_RGBA8, TEX, TEX);
+	glTextureSubImage2D(albedoTex, 0, 0, 0, TEX, TEX, GL_RGBA, GL_UNSIGNED_BYTE, texels.data());
+	glTextureParameteri(albedoTex, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTextureParameteri(albedoTex, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	// unit card in the XY plane, interleaved like the instance batches (position, normal, tangent, uv)
+	const float vertices[4 * 11] = {
+		-1.0f, -1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f,
+		 1.0f, -1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+		 1.0f,  1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f,
+		-1.0f,  1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+	};
+	const uint32_t indices[6] = { 0, 1, 2, 0, 2, 3 };
+	GLuint buffers[8];
+	glCreateBuffers(8, buffers);
+	const GLuint vbo = buffers[0], ebo = buffers[1], instanceBuffer = buffers[2], visibleBuffer = buffers[3];
+	const GLuint frameUBO = buffers[4], viewUBO = buffers[5], materialUBO = buffers[6], drawBuffer = buffers[7];
+	glNamedBufferData(vbo, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	glNamedBufferData(ebo, sizeof(indices), indices, GL_STATIC_DRAW);
+	GLuint vao = 0;
+	glCreateVertexArrays(1, &vao);
+	glVertexArrayVertexBuffer(vao, 0, vbo, 0, 11 * sizeof(float));
+	glVertexArrayElementBuffer(vao, ebo);
+	const GLuint ATTRIB_OFFSET[4] = { 0, 3, 6, 9 }, ATTRIB_SIZE[4] = { 3, 3, 3, 2 };
+	for (GLuint a = 0; a < 4; ++a) {
+		glEnableVertexArrayAttrib(vao, a);
+		glVertexArrayAttribFormat(vao, a, ATTRIB_SIZE[a], GL_FLOAT, GL_FALSE, ATTRIB_OFFSET[a] * sizeof(float));
+		glVertexArrayAttribBinding(vao, a, 0);
+	}
+
+	// overlapping cards at different depths and yaw angles
+	std::mt19937 rng(numCard * 31 + w);
+	std::uniform_real_distribution<float> xyDist(-1.5f, 1.5f), zDist(-4.0f, 1.0f), yawDist(-1.2f, 1.2f);
+	std::vector<InstanceDataGPU> instances(numCard);
+	std::vector<uint32_t> visible(numCard + 1);
+	visible[0] = (uint32_t)numCard;
+	for (int i = 0; i < numCard; ++i) {
+		const glm::vec3 c(xyDist(rng), xyDist(rng), zDist(rng));
+		instances[i].model = glm::rotate(glm::translate(glm::mat4(1.0f), c), yawDist(rng), glm::vec3(0.0f, 1.0f, 0.0f));
+		instances[i].sphere = glm::vec4(c, 1.5f);
+		visible[i + 1] = (uint32_t)i;
+	}
+	glNamedBufferData(instanceBuffer, instances.size() * sizeof(InstanceDataGPU), instances.data(), GL_STATIC_DRAW);
+	glNamedBufferData(visibleBuffer, visible.size() * sizeof(uint32_t), visible.data(), GL_STATIC_DRAW);
+	const uint32_t drawCmd[5] = { 6u, (uint32_t)numCard, 0u, 0u, 0u };
+	glNamedBufferData(drawBuffer, sizeof(drawCmd), drawCmd, GL_STATIC_DRAW);
+
+	FrameBlockGPU frame = {};
+	frame.lightDirWorld = glm::vec4(0.3f, 1.0f, 0.2f, 0.0f);
+	ViewBlockGPU view = {};
+	view.viewMat = glm::lookAt(glm::vec3(0.0f, 0.0f, 5.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	view.projMat = glm::perspective(glm::radians(60.0f), (float)w / (float)h, 0.1f, 100.0f);
+	view.invProjMat = glm::inverse(view.projMat);
+	view.cameraPosWorld = glm::vec4(0.0f, 0.0f, 5.0f, 1.0f);
+	MaterialBlockGPU materials = {};
+	materials.materials[0].flags = glm::ivec4(6, 4, 0, 0); // texture pass, instance process
+	glNamedBufferData(frameUBO, sizeof(frame), &frame, GL_STATIC_DRAW);
+	glNamedBufferData(viewUBO, sizeof(view), &view, GL_STATIC_DRAW);
+	glNamedBufferData(materialUBO, sizeof(materials), &materials, GL_STATIC_DRAW);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glViewport(0, 0, w, h);
+	glBindVertexArray(vao);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, instanceBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, visibleBuffer);
+	glBindBufferBase(GL_UNIFORM_BUFFER, UBO_FRAME_BINDING, frameUBO);
+	glBindBufferBase(GL_UNIFORM_BUFFER, UBO_VIEW_BINDING, viewUBO);
+	glBindBufferBase(GL_UNIFORM_BUFFER, UBO_MATERIAL_BINDING, materialUBO);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, drawBuffer);
+	glBindTextureUnit(0, albedoTex);
+	glEnable(GL_DEPTH_TEST);
+	glEnablei(GL_BLEND, 3);
+	glBlendFunci(3, GL_ONE, GL_ONE);
+
+	// overdraw counters: slot 0 only, so stats [0] and [1] must be equal
+	GLuint overdrawTex[2], overdrawStats = 0;
+	glCreateTextures(GL_TEXTURE_2D, 2, overdrawTex);
+	glTextureStorage2D(overdrawTex[0], 1, GL_R32UI, w, h);
+	glTextureStorage2D(overdrawTex[1], 1, GL_R32UI, w, h);
+	glCreateBuffers(1, &overdrawStats);
+	glNamedBufferData(overdrawStats, 2 * 4 * sizeof(uint32_t), nullptr, GL_DYNAMIC_READ);
+	glBindImageTexture(2, overdrawTex[0], 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+	glBindImageTexture(3, overdrawTex[1], 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, overdrawStats);
+
+	auto clearTargets = [&]() {
+		const float ZERO[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		for (int i = 0; i < 5; ++i) { glClearBufferfv(GL_COLOR, i, ZERO); }
+		const float ONE = 1.0f;
+		glClearBufferfv(GL_DEPTH, 0, &ONE);
+		const uint32_t zero = 0;
+		glClearTexImage(overdrawTex[0], 0, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+		glClearTexImage(overdrawTex[1], 0, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+		glClearNamedBufferData(overdrawStats, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+	};
+	auto drawCards = [&](ShaderProgram* program) {
+		program->useProgram();
+		glUniform1i(10, 0); // materialIndex
+		glUniform1i(glGetUniformLocation(program->programId(), "overdrawSlot"), 0); // -1 in the depth prepass
+		glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr);
+	};
+	// heat image vs. its stats; returns the per-pixel counts
+	auto checkOverdraw = [&](const char* pass) {
+		glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+		std::vector<uint32_t> counts((size_t)w * h);
+		glGetTextureImage(overdrawTex[0], 0, GL_RED_INTEGER, GL_UNSIGNED_INT, (GLsizei)(counts.size() * sizeof(uint32_t)), counts.data());
+		uint32_t stats[8];
+		glGetNamedBufferSubData(overdrawStats, 0, sizeof(stats), stats);
+		uint32_t sum = 0, pixels = 0, maxCount = 0;
+		for (const uint32_t n : counts) {
+			sum += n;
+			pixels += (n > 0) ? 1u : 0u;
+			maxCount = std::max(maxCount, n);
+		}
+		check(stats[0] == sum && stats[1] == pixels && stats[2] == maxCount, "%s %s: overdraw stats %u/%u/%u, heat image %u/%u/%u",
+			label, pass, stats[0], stats[1], stats[2], sum, pixels, maxCount);
+		check(stats[4] == stats[0] && stats[5] == stats[1] && stats[6] == stats[2], "%s %s: slot 0 stats differ from the totals", label, pass);
+		return counts;
+	};
+	auto readTarget = [&](const GLuint tex) {
+		std::vector<glm::vec4> pixels((size_t)w * h);
+		glGetTextureImage(tex, 0, GL_RGBA, GL_FLOAT, (GLsizei)(pixels.size() * sizeof(glm::vec4)), pixels.data());
+		return pixels;
+	};
+	auto readDepth = [&]() {
+		std::vector<float> depth((size_t)w * h);
+		glGetTextureImage(depthTex, 0, GL_DEPTH_COMPONENT, GL_FLOAT, (GLsizei)(depth.size() * sizeof(float)), depth.data());
+		return depth;
+	};
+
+	// single pass: the G-buffer shader with discard
+	clearTargets();
+	drawCards(programs.gbuffer);
+	const std::vector<glm::vec4> refDiffuse = readTarget(targets[3]);
+	const std::vector<glm::vec4> refPosition = readTarget(targets[0]);
+	const std::vector<glm::vec4> refAmbient = readTarget(targets[2]);
+	const std::vector<float> refDepth = readDepth();
+	const std::vector<uint32_t> refCounts = checkOverdraw("single pass");
+
+	// prepass + GL_EQUAL
+	clearTargets();
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	drawCards(programs.depth);
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	glDepthFunc(GL_EQUAL);
+	glDepthMask(GL_FALSE);
+	drawCards(programs.equal);
+	glDepthFunc(GL_LESS);
+	glDepthMask(GL_TRUE);
+	const std::vector<glm::vec4> diffuse = readTarget(targets[3]);
+	const std::vector<glm::vec4> position = readTarget(targets[0]);
+	const std::vector<glm::vec4> ambient = readTarget(targets[2]);
+	const std::vector<float> depth = readDepth();
+	const std::vector<uint32_t> counts = checkOverdraw("prepass");
+
+	glDisablei(GL_BLEND, 3);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glBindVertexArray(0);
+
+	int numCovered = 0, numOverdrawn = 0, numHole = 0, numShadedTwice = 0, numDepthDiff = 0, numColorDiff = 0, numBadCount = 0;
+	for (size_t p = 0; p < depth.size(); ++p) {
+		// every blended fragment was an invocation; after the prepass exactly one per covered pixel
+		if (refCounts[p] < (uint32_t)refDiffuse[p].a || counts[p] != ((depth[p] < 1.0f) ? 1u : 0u)) { numBadCount++; }
+		const bool covered = refDepth[p] < 1.0f;
+		if (covered) { numCovered++; }
+		if (refDiffuse[p].a > 1.5f) { numOverdrawn++; }
+		if (refDepth[p] != depth[p]) { numDepthDiff++; }
+		if (depth[p] < 1.0f && diffuse[p].a < 0.5f) { numHole++; }
+		if (diffuse[p].a > 1.5f) { numShadedTwice++; }
+		// gDiffuse is blended: compare the surface through gAmbient (albedo * ambient) and gPosition
+		if (covered && (glm::any(glm::greaterThan(glm::abs(glm::vec3(refAmbient[p]) - glm::vec3(ambient[p])), glm::vec3(1.0e-5f))) ||
+			glm::any(glm::greaterThan(glm::abs(glm::vec3(refPosition[p]) - glm::vec3(position[p])), glm::vec3(1.0e-4f))))) {
+			numColorDiff++;
+		}
+	}
+	std::printf("  covered %d, overdrawn without prepass %d\n", numCovered, numOverdrawn);
+	check(numCovered > 0 && numCovered < w * h && numOverdrawn > 0, "%s: degenerate scene (%d covered, %d overdrawn)", label, numCovered, numOverdrawn);
+	check(numDepthDiff == 0, "%s: %d pixels with a different depth than the single pass", label, numDepthDiff);
+	check(numHole == 0, "%s: %d pixels with prepass depth but no G-buffer fragment (GL_EQUAL failed)", label, numHole);
+	check(numShadedTwice == 0, "%s: %d pixels shaded more than once after the prepass", label, numShadedTwice);
+	check(numColorDiff == 0, "%s: %d pixels differ from the single pass", label, numColorDiff);
+	check(numBadCount == 0, "%s: %d pixels with a wrong overdraw count", label, numBadCount);
+
+	glDeleteVertexArrays(1, &vao);
+	glDeleteBuffers(8, buffers);
+	glDeleteTextures(5, targets);
+	glDeleteTextures(1, &depthTex);
+	glDeleteTextures(1, &albedoTex);
+	glDeleteTextures(2, overdrawTex);
+	glDeleteBuffers(1, &overdrawStats);
+	glDeleteFramebuffers(1, &fbo);
+}
+
+// ==============================================
+
+// ==============================================
+// Cull overlay: a grid of spheres with cycling CullReasons drawn as lines over a scene depth whose
+// left half is in front of everything. Every reason in the mask must show up in its color (faded
+// on the left), reasons outside the mask must not appear at all.
+
+static void testCullOverlay(ShaderProgram* program, const uint32_t reasonMask, const bool boxes) {
+	char label[64];
+	std::snprintf(label, sizeof(label), "cull overlay mask=0x%x %s", reasonMask, boxes ? "boxes" : "spheres");
+	std::printf("%s\n", label);
+	const int w = 320, h = 200;
+
+	GLuint fbo = 0, colorTex = 0, depthTex = 0;
+	glCreateFramebuffers(1, &fbo);
+	glCreateTextures(GL_TEXTURE_2D, 1, &colorTex);
+	glTextureStorage2D(colorTex, 1, GL_RGBA8, w, h);
+	glNamedFramebufferTexture(fbo, GL_COLOR_ATTACHMENT0, colorTex, 0);
+	check(glCheckNamedFramebufferStatus(fbo, GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE, "%s: incomplete framebuffer", label);
+	std::vector<float> sceneDepth((size_t)w * h, 1.0f);
+	for (int y = 0; y < h; ++y) {
+		for (int x = 0; x < w / 2; ++x) { sceneDepth[(size_t)y * w + x] = 0.0f; }
+	}
+	glCreateTextures(GL_TEXTURE_2D, 1, &depthTex);
+	glTextureStorage2D(depthTex, 1, GL_R32F, w, h);
+	glTextureSubImage2D(depthTex, 0, 0, 0, w, h, GL_RED, GL_FLOAT, sceneDepth.data());
+
+	// 6 x 4 spheres in front of the camera, reason = (row + column) % CULL_REASON_COUNT: every reason on both halves
+	std::vector<InstanceDataGPU> instances;
+	std::vector<uint32_t> reasons;
+	for (int row = 0; row < 4; ++row) {
+		for (int col = 0; col < 6; ++col) {
+			InstanceDataGPU inst;
+			const glm::vec3 c(-12.5f + 5.0f * (float)col, -6.0f + 4.0f * (float)row, -25.0f);
+			inst.model = glm::translate(glm::mat4(1.0f), c);
+			inst.sphere = glm::vec4(c, 1.5f);
+			instances.push_back(inst);
+			reasons.push_back((uint32_t)((row + col) % CULL_REASON_COUNT));
+		}
+	}
+	ViewBlockGPU view;
+	view.viewMat = glm::mat4(1.0f);
+	view.projMat = glm::perspective(glm::radians(60.0f), (float)w / (float)h, 0.1f, 100.0f);
+	view.invProjMat = glm::inverse(view.projMat);
+	view.cameraPosWorld = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+	GLuint buffers[3];
+	glCreateBuffers(3, buffers);
+	glNamedBufferData(buffers[0], instances.size() * sizeof(InstanceDataGPU), instances.data(), GL_STATIC_DRAW);
+	glNamedBufferData(buffers[1], reasons.size() * sizeof(uint32_t), reasons.data(), GL_STATIC_DRAW);
+	glNamedBufferData(buffers[2], sizeof(view), &view, GL_STATIC_DRAW);
+	GLuint vao = 0;
+	glCreateVertexArrays(1, &vao);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glViewport(0, 0, w, h);
+	const float BLACK[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	glClearBufferfv(GL_COLOR, 0, BLACK);
+	// same state as SceneRenderer::renderCullOverlay
+	program->useProgram();
+	glUniform1ui(0, reasonMask);
+	glUniform1i(1, boxes ? 1 : 0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, buffers[0]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, buffers[1]);
+	glBindBufferBase(GL_UNIFORM_BUFFER, UBO_VIEW_BINDING, buffers[2]);
+	glBindTextureUnit(5, depthTex);
+	glBindVertexArray(vao);
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDrawArraysInstanced(GL_LINES, 0, boxes ? 24 : 96, (GLsizei)instances.size());
+	glDisable(GL_BLEND);
+	glBindVertexArray(0);
+
+	std::vector<uint8_t> pixels((size_t)w * h * 4);
+	glGetTextureImage(colorTex, 0, GL_RGBA, GL_UNSIGNED_BYTE, (GLsizei)pixels.size(), pixels.data());
+
+	// colors of cullOverlayVertex.glsl; faded = 0.3 alpha over black
+	const glm::vec3 REASON_COLORS[CULL_REASON_COUNT] = {
+		glm::vec3(0.1f, 1.0f, 0.1f), glm::vec3(0.45f, 0.45f, 1.0f), glm::vec3(1.0f, 0.9f, 0.1f),
+		glm::vec3(1.0f, 0.2f, 1.0f), glm::vec3(1.0f, 0.15f, 0.1f), glm::vec3(0.1f, 0.9f, 1.0f)
+	};
+	int numPixel[CULL_REASON_COUNT][2] = {}; // reason, left (faded) / right
+	int numFullLeft = 0;
+	for (int y = 0; y < h; ++y) {
+		for (int x = 0; x < w; ++x) {
+			const uint8_t* p = &pixels[((size_t)y * w + x) * 4];
+			const glm::vec3 rgb = glm::vec3(p[0], p[1], p[2]) / 255.0f;
+			const bool left = x < w / 2;
+			for (int r = 0; r < CULL_REASON_COUNT; ++r) {
+				if (glm::all(glm::lessThan(glm::abs(rgb - REASON_COLORS[r] * (left ? 0.3f : 1.0f)), glm::vec3(0.02f)))) { numPixel[r][left ? 0 : 1]++; }
+				if (left && glm::all(glm::lessThan(glm::abs(rgb - REASON_COLORS[r]), glm::vec3(0.02f)))) { numFullLeft++; }
+			}
+		}
+	}
+	int numBadReason = 0;
+	for (int r = 0; r < CULL_REASON_COUNT; ++r) {
+		const bool shown = (reasonMask & (1u << r)) != 0;
+		if (shown != (numPixel[r][0] > 0) || shown != (numPixel[r][1] > 0)) { numBadReason++; }
+	}
+	check(numBadReason == 0, "%s: %d reasons drawn against the mask", label, numBadReason);
+	check(numFullLeft == 0, "%s: %d lines behind the scene not faded", label, numFullLeft);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteVertexArrays(1, &vao);
+	glDeleteBuffers(3, buffers);
+	glDeleteTextures(1, &colorTex);
+	glDeleteTextures(1, &depthTex);
+	glDeleteFramebuffers(1, &fbo);
+}
+
+// ==============================================
+// shadowCascadeFit.comp: a ground plane seen from above, ending 300 units away (sky past it and
+// above the horizon). The depth range must match the visible depth, the splits must be increasing,
+// and every visible point must land inside the light box of the cascade whose slice contains it,
+// together with casters above it. Fitted boxes must be tighter than the fixed-split boxes.
+
+static void testShadowCascadeFit(ShaderProgram* program, const int numCascades, const bool reversedZ) {
+	char label[64];
+	std::snprintf(label, sizeof(label), "shadowCascadeFit cascades=%d%s", numCascades, reversedZ ? " reversed-z" : "");
+	std::printf("%s\n", label);
+	const int w = 320, h = 180, mapSize = 2048;
+	const float nearD = 0.1f, farD = 500.0f, minDistance = 1.0f, maxDistance = 400.0f, lambda = 0.75f, casterDistance = 50.0f;
+
+	const glm::vec3 eye(3.0f, 10.0f, 5.0f);
+	const glm::mat4 viewMat = glm::lookAt(eye, eye + glm::vec3(0.3f, -0.3f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	const glm::mat4 projMat = reversedZ
+		? glm::perspectiveRH_ZO(glm::radians(60.0f), (float)w / (float)h, farD, nearD)
+		: glm::perspective(glm::radians(60.0f), (float)w / (float)h, nearD, farD);
+	const glm::mat4 VP = projMat * viewMat;
+	const glm::mat4 invVP = glm::inverse(VP);
+	const float background = reversedZ ? 0.0f : 1.0f;
+	auto toNDC = [&](const float d) { return reversedZ ? d : d * 2.0f - 1.0f; };
+	auto unproject = [&](const glm::vec2& ndc, const float ndcZ) {
+		const glm::vec4 p = invVP * glm::vec4(ndc, ndcZ, 1.0f);
+		return glm::vec3(p) / p.w;
+	};
+	auto viewDepthOf = [&](const glm::vec3& p) { return -(viewMat * glm::vec4(p, 1.0f)).z; };
+
+	std::vector<float> depth((size_t)w * h, background);
+	float refNear = FLT_MAX, refFar = 0.0f;
+	for (int y = 0; y < h; ++y) {
+		for (int x = 0; x < w; ++x) {
+			const glm::vec2 ndc(((float)x + 0.5f) / (float)w * 2.0f - 1.0f, ((float)y + 0.5f) / (float)h * 2.0f - 1.0f);
+			const glm::vec3 a = unproject(ndc, reversedZ ? 1.0f : -1.0f);
+			const glm::vec3 b = unproject(ndc, reversedZ ? 0.0f : 1.0f);
+			if (b.y >= a.y) { continue; }
+			const glm::vec3 p = a + (b - a) * (a.y / (a.y - b.y));
+			if (glm::length(p - eye) > 300.0f) { continue; }
+			const glm::vec4 clip = VP * glm::vec4(p, 1.0f);
+			const float d = reversedZ ? clip.z / clip.w : (clip.z / clip.w) * 0.5f + 0.5f;
+			depth[(size_t)y * w + x] = d;
+			const float viewDepth = viewDepthOf(unproject(ndc, toNDC(d)));
+			refNear = std::min(refNear, viewDepth);
+			refFar = std::max(refFar, viewDepth);
+		}
+	}
+
+	// r = nearest, g = farthest (hzbBuild.comp)
+	const std::vector<PyramidLevel> nearest = referencePyramid(w, h, depth, reversedZ);
+	const std::vector<PyramidLevel> farthest = referencePyramid(w, h, depth, !reversedZ);
+	const GLuint pyramidTex = createPyramidTexture(w, h, (int)nearest.size(), GL_RG32F);
+	for (size_t l = 0; l < nearest.size(); ++l) {
+		std::vector<float> rg(nearest[l].texels.size() * 2);
+		for (size_t i = 0; i < nearest[l].texels.size(); ++i) {
+			rg[2 * i + 0] = nearest[l].texels[i];
+			rg[2 * i + 1] = farthest[l].texels[i];
+		}
+		glTextureSubImage2D(pyramidTex, (GLint)l, 0, 0, nearest[l].w, nearest[l].h, GL_RG, GL_FLOAT, rg.data());
+	}
+
+	FrameBlockGPU frame = {};
+	frame.cullVP = VP;
+	frame.cullViewMat = viewMat;
+	frame.lightDirWorld = glm::vec4(glm::normalize(glm::vec3(0.4f, 0.5f, 0.8f)), 0.0f);
+	frame.shadowFlags = glm::ivec4(1, 0, numCascades, 0);
+	frame.depthFlags = glm::ivec4(reversedZ ? 1 : 0, 0, 0, 0);
+	frame.shadowFit = glm::vec4(minDistance, maxDistance, lambda, casterDistance);
+	frame.shadowMapInfo = glm::ivec4(mapSize, 0, 0, 0);
+	GLuint buffers[2];
+	glCreateBuffers(2, buffers);
+	glNamedBufferData(buffers[0], sizeof(FrameBlockGPU), &frame, GL_STATIC_DRAW);
+	glNamedBufferData(buffers[1], sizeof(ShadowBlockGPU), nullptr, GL_DYNAMIC_READ);
+
+	program->useProgram();
+	glBindBufferBase(GL_UNIFORM_BUFFER, UBO_FRAME_BINDING, buffers[0]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, buffers[1]);
+	glBindTextureUnit(5, pyramidTex);
+	glDispatchCompute(1, 1, 1);
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	ShadowBlockGPU fit;
+	glGetNamedBufferSubData(buffers[1], 0, sizeof(ShadowBlockGPU), &fit);
+
+	check(std::abs(fit.depthRange.x - refNear) < 1e-3f * refNear && std::abs(fit.depthRange.y - refFar) < 1e-3f * refFar,
+		"%s: depth range [%f, %f], visible [%f, %f]", label, fit.depthRange.x, fit.depthRange.y, refNear, refFar);
+	int numBadSplit = 0;
+	for (int c = 0; c < numCascades; ++c) {
+		const float sliceNear = (c == 0) ? fit.depthRange.x : fit.cascadeFar[c - 1];
+		if (!(fit.cascadeFar[c] > sliceNear)) { numBadSplit++; }
+	}
+	check(numBadSplit == 0 && fit.cascadeFar[numCascades - 1] == fit.depthRange.y, "%s: splits not increasing up to the far depth", label);
+
+	auto insideBox = [&](const int c, const glm::vec3& p) {
+		const glm::vec4 clip = fit.lightVP[c] * glm::vec4(p, 1.0f);
+		const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		const float EPS = 1e-4f;
+		return std::abs(ndc.x) <= 1.0f + EPS && std::abs(ndc.y) <= 1.0f + EPS &&
+			ndc.z >= (reversedZ ? 0.0f : -1.0f) - EPS && ndc.z <= 1.0f + EPS;
+	};
+	const glm::vec3 toLight = glm::vec3(frame.lightDirWorld);
+	int numReceiver[MAX_SHADOW_CASCADES] = {}, numOutside = 0, numCasterOutside = 0;
+	for (int y = 0; y < h; ++y) {
+		for (int x = 0; x < w; ++x) {
+			const float d = depth[(size_t)y * w + x];
+			if (d == background) { continue; }
+			const glm::vec2 ndc(((float)x + 0.5f) / (float)w * 2.0f - 1.0f, ((float)y + 0.5f) / (float)h * 2.0f - 1.0f);
+			const glm::vec3 p = unproject(ndc, toNDC(d));
+			const float viewDepth = viewDepthOf(p);
+			for (int c = 0; c < numCascades; ++c) {
+				const float sliceNear = (c == 0) ? fit.depthRange.x : fit.cascadeFar[c - 1];
+				const float sliceFar = fit.cascadeFar[c];
+				// boundaries may go either way
+				if (viewDepth < sliceNear * 1.001f || viewDepth > sliceFar * 0.999f) { continue; }
+				numReceiver[c]++;
+				if (!insideBox(c, p)) { numOutside++; }
+				if (!insideBox(c, p + toLight * (casterDistance - 1.0f))) { numCasterOutside++; }
+			}
+		}
+	}
+	check(numOutside == 0, "%s: %d visible points outside their cascade", label, numOutside);
+	check(numCasterOutside == 0, "%s: %d casters above visible points clipped", label, numCasterOutside);
+
+	// the fixed splits fit the whole frustum slice (sky included)
+	float fixedSplits[MAX_SHADOW_CASCADES + 1];
+	shadowCascadeSplits(fit.depthRange.x, fit.depthRange.y, numCascades, lambda, fixedSplits);
+	int numLooser = 0, numEmpty = 0;
+	for (int c = 0; c < numCascades; ++c) {
+		const glm::mat4 fixedVP = computeCascadeLightVP(viewMat, projMat, fixedSplits[c], fixedSplits[c + 1], toLight, mapSize, reversedZ);
+		const float fitArea = 1.0f / (fit.lightVP[c][0][0] * fit.lightVP[c][1][1]);
+		const float fixedArea = 1.0f / std::abs(fixedVP[0][0] * fixedVP[1][1] - fixedVP[1][0] * fixedVP[0][1]);
+		if (!(std::abs(fitArea) < fixedArea)) { numLooser++; }
+		if (numReceiver[c] == 0) { numEmpty++; }
+	}
+	check(numLooser == 0, "%s: %d fitted cascades larger than the fixed ones", label, numLooser);
+	check(numEmpty == 0, "%s: degenerate scene (%d empty cascades)", label, numEmpty);
+	// unused cascades put everything off the map
+	if (numCascades < MAX_SHADOW_CASCADES) {
+		check(!insideBox(numCascades, eye), "%s: unused cascade covers the scene", label);
+	}
+
+	glDeleteBuffers(2, buffers);
+	glDeleteTextures(1, &pyramidTex);
+}
+
+// ==============================================
+// Cached shadow casters (SceneRenderer::buildShadowMaps): static instances rendered once with
+// useInstancing = 2 (every instance, culled against the cascade in the vertex shader), copied, then
+// the dynamic object drawn on top must give exactly the map of drawing everything at once.
+
+static void testShadowCasterCache(ShaderProgram* program, const bool reversedZ) {
+	char label[64];
+	std::snprintf(label, sizeof(label), "shadow caster cache%s", reversedZ ? " reversed-z" : "");
+	std::printf("%s\n", label);
+	const int size = 256, numLayer = 2, layer = 1;
+
+	// unit cube, position only
+	const float vertices[8 * 3] = {
+		-1.0f, -1.0f, -1.0f,  1.0f, -1.0f, -1.0f,  1.0f, 1.0f, -1.0f,  -1.0f, 1.0f, -1.0f,
+		-1.0f, -1.0f,  1.0f,  1.0f, -1.0f,  1.0f,  1.0f, 1.0f,  1.0f,  -1.0f, 1.0f,  1.0f
+	};
+	const uint32_t indices[36] = {
+		0, 2, 1, 0, 3, 2,  4, 5, 6, 4, 6, 7,  0, 1, 5, 0, 5, 4,
+		3, 6, 2, 3, 7, 6,  0, 4, 7, 0, 7, 3,  1, 2, 6, 1, 6, 5
+	};
+	// a field of boxes, many of them outside the cascade
+	std::vector<InstanceDataGPU> instances;
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> xzDist(-150.0f, 150.0f), sDist(0.5f, 4.0f);
+	for (int i = 0; i < 2000; ++i) {
+		const glm::vec3 c(xzDist(rng), 0.0f, xzDist(rng));
+		const float s = sDist(rng);
+		InstanceDataGPU inst;
+		inst.model = glm::scale(glm::translate(glm::mat4(1.0f), c), glm::vec3(s, 2.0f * s, s));
+		inst.sphere = glm::vec4(c, std::sqrt(6.0f) * s);
+		instances.push_back(inst);
+	}
+	std::vector<uint32_t> visible(instances.size() + 1);
+	visible[0] = (uint32_t)instances.size();
+	for (size_t i = 0; i < instances.size(); ++i) { visible[i + 1] = (uint32_t)i; }
+	const glm::mat4 dynamicModel = glm::translate(glm::mat4(1.0f), glm::vec3(3.0f, 12.0f, -4.0f));
+
+	ShadowBlockGPU shadowBlock = {};
+	const glm::mat4 lightView = lightRotationView(glm::normalize(glm::vec3(0.4f, 0.5f, 0.8f)));
+	const glm::vec3 center = glm::vec3(lightView * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+	shadowBlock.lightVP[layer] = lightBoxVP(lightView, center - glm::vec3(40.0f, 30.0f, 100.0f), center + glm::vec3(40.0f, 30.0f, 100.0f), reversedZ);
+
+	GLuint buffers[5];
+	glCreateBuffers(5, buffers);
+	glNamedBufferData(buffers[0], sizeof(vertices), vertices, GL_STATIC_DRAW);
+	glNamedBufferData(buffers[1], sizeof(indices), indices, GL_STATIC_DRAW);
+	glNamedBufferData(buffers[2], instances.size() * sizeof(InstanceDataGPU), instances.data(), GL_STATIC_DRAW);
+	glNamedBufferData(buffers[3], visible.size() * sizeof(uint32_t), visible.data(), GL_STATIC_DRAW);
+	glNamedBufferData(buffers[4], sizeof(ShadowBlockGPU), &shadowBlock, GL_STATIC_DRAW);
+	GLuint vao = 0;
+	glCreateVertexArrays(1, &vao);
+	glVertexArrayVertexBuffer(vao, 0, buffers[0], 0, 3 * sizeof(float));
+	glVertexArrayElementBuffer(vao, buffers[1]);
+	glEnableVertexArrayAttrib(vao, 0);
+	glVertexArrayAttribFormat(vao, 0, 3, GL_FLOAT, GL_FALSE, 0);
+	glVertexArrayAttribBinding(vao, 0, 0);
+
+	// full: the map built every frame; cached: output of the copy + dynamic draw; static: the cache
+	GLuint textures[3], fbo = 0;
+	glCreateTextures(GL_TEXTURE_2D_ARRAY, 3, textures);
+	for (const GLuint tex : textures) { glTextureStorage3D(tex, 1, GL_DEPTH_COMPONENT32F, size, size, numLayer); }
+	const GLuint fullTex = textures[0], cachedTex = textures[1], staticTex = textures[2];
+	glCreateFramebuffers(1, &fbo);
+
+	glClipControl(GL_LOWER_LEFT, reversedZ ? GL_ZERO_TO_ONE : GL_NEGATIVE_ONE_TO_ONE);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glDrawBuffer(GL_NONE);
+	glViewport(0, 0, size, size);
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(reversedZ ? GL_GREATER : GL_LESS);
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(reversedZ ? -2.0f : 2.0f, reversedZ ? -4.0f : 4.0f);
+	glClearDepth(reversedZ ? 0.0 : 1.0);
+	program->useProgram();
+	glBindVertexArray(vao);
+	glBindBufferBase(GL_UNIFORM_BUFFER, UBO_SHADOW_BINDING, buffers[4]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, buffers[2]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, buffers[3]);
+	glUniform1i(22, layer);
+	auto drawDynamic = [&]() {
+		glUniform1i(21, 0);
+		glUniformMatrix4fv(0, 1, GL_FALSE, &dynamicModel[0][0]);
+		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, nullptr);
+	};
+	auto drawStatic = [&](const int useInstancing) {
+		glUniform1i(21, useInstancing);
+		glDrawElementsInstanced(GL_TRIANGLES, 36, GL_UNSIGNED_INT, nullptr, (GLsizei)instances.size());
+	};
+
+	glNamedFramebufferTextureLayer(fbo, GL_DEPTH_ATTACHMENT, fullTex, 0, layer);
+	glClear(GL_DEPTH_BUFFER_BIT);
+	drawDynamic();
+	drawStatic(1);
+
+	glNamedFramebufferTextureLayer(fbo, GL_DEPTH_ATTACHMENT, staticTex, 0, layer);
+	glClear(GL_DEPTH_BUFFER_BIT);
+	drawStatic(2);
+	glCopyImageSubData(staticTex, GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, cachedTex, GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, size, size, 1);
+	glNamedFramebufferTextureLayer(fbo, GL_DEPTH_ATTACHMENT, cachedTex, 0, layer);
+	drawDynamic();
+
+	glDisable(GL_POLYGON_OFFSET_FILL);
+	glDepthFunc(GL_LESS);
+	glClipControl(GL_LOWER_LEFT, GL_NEGATIVE_ONE_TO_ONE);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	std::vector<float> full((size_t)size * size * numLayer), cached(full.size()), staticOnly(full.size());
+	glGetTextureImage(fullTex, 0, GL_DEPTH_COMPONENT, GL_FLOAT, (GLsizei)(full.size() * sizeof(float)), full.data());
+	glGetTextureImage(cachedTex, 0, GL_DEPTH_COMPONENT, GL_FLOAT, (GLsizei)(cached.size() * sizeof(float)), cached.data());
+	glGetTextureImage(staticTex, 0, GL_DEPTH_COMPONENT, GL_FLOAT, (GLsizei)(staticOnly.size() * sizeof(float)), staticOnly.data());
+	const size_t first = (size_t)layer * size * size, last = first + (size_t)size * size;
+	const float empty = reversedZ ? 0.0f : 1.0f;
+	int numDiff = 0, numCovered = 0, numDynamic = 0;
+	for (size_t i = first; i < last; ++i) {
+		if (full[i] != cached[i]) { numDiff++; }
+		if (staticOnly[i] != empty) { numCovered++; }
+		if (cached[i] != staticOnly[i]) { numDynamic++; }
+	}
+	check(numDiff == 0, "%s: %d texels differ from the uncached map", label, numDiff);
+	check(numCovered > 0 && numCovered < size * size && numDynamic > 0, "%s: degenerate scene (%d static, %d dynamic texels)", label, numCovered, numDynamic);
+
+	glDeleteFramebuffers(1, &fbo);
+	glDeleteTextures(3, textures);
+	glDeleteVertexArrays(1, &vao);
+	glDeleteBuffers(5, buffers);
+}
+
+// ==============================================
+// software occlusion buffer (SoftwareOcclusion.cpp): the same occluders drawn by GL at the buffer's
+// resolution are never farther than the buffer says, and cullInstances.comp only culls instances
+// the buffer and the GL depth both hide.
+
+static void testSoftwareOcclusion(ShaderProgram* depthProgram, ShaderProgram* cullProgram, const bool reversedZ) {
+	char label[64];
+	std::snprintf(label, sizeof(label), "software occlusion%s", reversedZ ? " reversed-z" : "");
+	std::printf("%s\n", label);
+	const int w = 160, h = 88;
+
+	const float nearD = 0.1f, farD = 500.0f;
+	const glm::mat4 viewMat = glm::lookAt(glm::vec3(0.0f, 12.0f, 5.0f), glm::vec3(0.0f, 8.0f, -30.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	const glm::mat4 projMat = reversedZ
+		? glm::perspectiveRH_ZO(glm::radians(60.0f), (float)w / (float)h, farD, nearD)
+		: glm::perspective(glm::radians(60.0f), (float)w / (float)h, nearD, farD);
+	const glm::mat4 viewProj = projMat * viewMat;
+
+	// bumpy ground (counter-clockwise seen from above) and boxes standing on it
+	const int GRID = 32;
+	std::vector<float> groundVertices;
+	std::vector<uint32_t> groundIndices;
+	for (int j = 0; j <= GRID; ++j) {
+		for (int i = 0; i <= GRID; ++i) {
+			const float x = -150.0f + 300.0f * i / GRID, z = -300.0f + 310.0f * j / GRID;
+			groundVertices.insert(groundVertices.end(), { x, 6.0f * std::sin(x * 0.05f) * std::cos(z * 0.03f), z });
+		}
+	}
+	for (int j = 0; j < GRID; ++j) {
+		for (int i = 0; i < GRID; ++i) {
+			const uint32_t p00 = j * (GRID + 1) + i, p10 = p00 + 1, p01 = p00 + GRID + 1, p11 = p01 + 1;
+			groundIndices.insert(groundIndices.end(), { p00, p01, p10, p10, p01, p11 });
+		}
+	}
+	const float cubeVertices[8 * 3] = {
+		-1.0f, -1.0f, -1.0f,  1.0f, -1.0f, -1.0f,  1.0f, 1.0f, -1.0f,  -1.0f, 1.0f, -1.0f,
+		-1.0f, -1.0f,  1.0f,  1.0f, -1.0f,  1.0f,  1.0f, 1.0f,  1.0f,  -1.0f, 1.0f,  1.0f
+	};
+	const uint32_t cubeIndices[36] = {
+		0, 2, 1, 0, 3, 2,  4, 5, 6, 4, 6, 7,  0, 1, 5, 0, 5, 4,
+		3, 6, 2, 3, 7, 6,  0, 4, 7, 0, 7, 3,  1, 2, 6, 1, 6, 5
+	};
+	std::vector<glm::mat4> boxes;
+	for (int i = 0; i < 10; ++i) {
+		const glm::vec3 c(-36.0f + 8.0f * i, 6.0f, -25.0f - 6.0f * (i % 3));
+		boxes.push_back(glm::scale(glm::translate(glm::mat4(1.0f), c), glm::vec3(3.5f, 8.0f, 2.0f)));
+	}
+
+	SoftwareOcclusionBuffer buffer;
+	buffer.resize(w, h);
+	buffer.setNumWorkers(2);
+	buffer.begin(viewProj, reversedZ);
+	buffer.addTriangles(groundVertices.data(), (int)groundVertices.size() / 3, 3, groundIndices.data(), (int)groundIndices.size(), glm::mat4(1.0f));
+	for (const glm::mat4& model : boxes) {
+		buffer.addTriangles(cubeVertices, 8, 3, cubeIndices, 36, model);
+	}
+	buffer.rasterize();
+	std::vector<std::vector<float>> levels;
+	buffer.resolveDepthPyramid(levels);
+	check(buffer.width() == w && buffer.height() == h && (int)levels.size() == numMipLevel(w, h), "%s: buffer %dx%d with %d levels", label, buffer.width(), buffer.height(), (int)levels.size());
+
+	// the same meshes through GL, back faces culled
+	GLuint buffers[5];
+	glCreateBuffers(5, buffers);
+	glNamedBufferData(buffers[0], groundVertices.size() * sizeof(float), groundVertices.data(), GL_STATIC_DRAW);
+	glNamedBufferData(buffers[1], groundIndices.size() * sizeof(uint32_t), groundIndices.data(), GL_STATIC_DRAW);
+	glNamedBufferData(buffers[2], sizeof(cubeVertices), cubeVertices, GL_STATIC_DRAW);
+	glNamedBufferData(buffers[3], sizeof(cubeIndices), cubeIndices, GL_STATIC_DRAW);
+	ShadowBlockGPU shadowBlock = {};
+	shadowBlock.lightVP[0] = viewProj;
+	glNamedBufferData(buffers[4], sizeof(ShadowBlockGPU), &shadowBlock, GL_STATIC_DRAW);
+	GLuint vaos[2];
+	glCreateVertexArrays(2, vaos);
+	for (int m = 0; m < 2; ++m) {
+		glVertexArrayVertexBuffer(vaos[m], 0, buffers[2 * m], 0, 3 * sizeof(float));
+		glVertexArrayElementBuffer(vaos[m], buffers[2 * m + 1]);
+		glEnableVertexArrayAttrib(vaos[m], 0);
+		glVertexArrayAttribFormat(vaos[m], 0, 3, GL_FLOAT, GL_FALSE, 0);
+		glVertexArrayAttribBinding(vaos[m], 0, 0);
+	}
+	GLuint depthTex = 0, fbo = 0;
+	glCreateTextures(GL_TEXTURE_2D, 1, &depthTex);
+	glTextureStorage2D(depthTex, 1, GL_DEPTH_COMPONENT32F, w, h);
+	glCreateFramebuffers(1, &fbo);
+	glNamedFramebufferTexture(fbo, GL_DEPTH_ATTACHMENT, depthTex, 0);
+
+	glClipControl(GL_LOWER_LEFT, reversedZ ? GL_ZERO_TO_ONE : GL_NEGATIVE_ONE_TO_ONE);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glDrawBuffer(GL_NONE);
+	glViewport(0, 0, w, h);
+	glEnable(GL_DEPTH_TEST);
+	glEnable(GL_CULL_FACE);
+	glDepthFunc(reversedZ ? GL_GREATER : GL_LESS);
+	glClearDepth(reversedZ ? 0.0 : 1.0);
+	glClear(GL_DEPTH_BUFFER_BIT);
+	depthProgram->useProgram();
+	glBindBufferBase(GL_UNIFORM_BUFFER, UBO_SHADOW_BINDING, buffers[4]);
+	glUniform1i(21, 0);
+	glUniform1i(22, 0);
+	const glm::mat4 identity(1.0f);
+	glUniformMatrix4fv(0, 1, GL_FALSE, &identity[0][0]);
+	glBindVertexArray(vaos[0]);
+	glDrawElements(GL_TRIANGLES, (GLsizei)groundIndices.size(), GL_UNSIGNED_INT, nullptr);
+	glBindVertexArray(vaos[1]);
+	for (const glm::mat4& model : boxes) {
+		glUniformMatrix4fv(0, 1, GL_FALSE, &model[0][0]);
+		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, nullptr);
+	}
+	glBindVertexArray(0);
+	glDisable(GL_CULL_FACE);
+	glDepthFunc(GL_LESS);
+	glClearDepth(1.0);
+	glClipControl(GL_LOWER_LEFT, GL_NEGATIVE_ONE_TO_ONE);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	std::vector<float> glDepth((size_t)w * h);
+	glGetTextureImage(depthTex, 0, GL_DEPTH_COMPONENT, GL_FLOAT, (GLsizei)(glDepth.size() * sizeof(float)), glDepth.data());
+
+	// farther or equal everywhere
+	auto nearer = [reversedZ](const float a, const float b) { return reversedZ ? a > b : a < b; };
+	const float EPSILON = 1e-5f;
+	int numNearer = 0, numCovered = 0;
+	for (size_t i = 0; i < glDepth.size(); ++i) {
+		const float cpu = levels[0][i];
+		if (cpu != (reversedZ ? 0.0f : 1.0f)) numCovered++;
+		if (nearer(cpu, glDepth[i] + (reversedZ ? EPSILON : -EPSILON))) numNearer++;
+	}
+	check(numNearer == 0, "%s: %d pixels where the buffer is nearer than GL", label, numNearer);
+	check(numCovered > w * h / 3, "%s: degenerate buffer (%d pixels covered)", label, numCovered);
+	int numBadLevel = 0;
+	for (size_t l = 1; l < levels.size(); ++l) {
+		const int srcW = std::max(w >> (l - 1), 1), srcH = std::max(h >> (l - 1), 1), dstW = std::max(w >> l, 1), dstH = std::max(h >> l, 1);
+		for (int y = 0; y < srcH; ++y) {
+			for (int x = 0; x < srcW; ++x) {
+				const float coarse = levels[l][(size_t)std::min(y / 2, dstH - 1) * dstW + std::min(x / 2, dstW - 1)];
+				if (nearer(coarse, levels[l - 1][(size_t)y * srcW + x])) numBadLevel++;
+			}
+		}
+	}
+	check(numBadLevel == 0, "%s: %d texels nearer than a texel they cover", label, numBadLevel);
+
+	// instances behind and among the occluders, tested by cullInstances.comp against the buffer only
+	FrameBlockGPU frame = {};
+	frame.cullVP = viewProj;
+	frame.cullViewMat = viewMat;
+	frame.depthFlags = glm::ivec4(reversedZ ? 1 : 0, 0, 0, 0);
+	CullBlockGPU cull = {};
+	glm::vec4 planes[6];
+	extractFrustumPlanes(viewProj, planes, reversedZ);
+	for (int i = 0; i < 6; ++i) { cull.frustumPlanes[i] = planes[i]; }
+	const int numInstance = 3000;
+	cull.cullParams = glm::vec4(400.0f, 0.0f, (float)w, (float)h);
+	cull.cullFlags = glm::uvec4((unsigned int)numInstance, 0u, 0u, 0u);
+	cull.cullInfo = glm::uvec4(0u, 1u, 1u, 0u);
+	std::mt19937 rng(reversedZ ? 11 : 5);
+	std::uniform_real_distribution<float> xDist(-120.0f, 120.0f), yDist(-15.0f, 12.0f), zDist(-280.0f, 0.0f), rDist(0.2f, 3.0f);
+	std::vector<InstanceDataGPU> instances(numInstance);
+	for (InstanceDataGPU& inst : instances) {
+		const glm::vec3 c(xDist(rng), yDist(rng), zDist(rng));
+		inst.model = glm::translate(glm::mat4(1.0f), c);
+		inst.sphere = glm::vec4(c, rDist(rng));
+	}
+	const GLuint occlusionTex = createPyramidTexture(w, h, (int)levels.size());
+	for (size_t l = 0; l < levels.size(); ++l) {
+		glTextureSubImage2D(occlusionTex, (GLint)l, 0, 0, std::max(w >> l, 1), std::max(h >> l, 1), GL_RED, GL_FLOAT, levels[l].data());
+	}
+	GLuint cullBuffers[6];
+	glCreateBuffers(6, cullBuffers);
+	glNamedBufferData(cullBuffers[0], instances.size() * sizeof(InstanceDataGPU), instances.data(), GL_STATIC_DRAW);
+	const std::vector<uint32_t> visibleInit(numInstance + 1, 0u);
+	glNamedBufferData(cullBuffers[1], visibleInit.size() * sizeof(uint32_t), visibleInit.data(), GL_DYNAMIC_READ);
+	const uint32_t drawCmd[5] = { 36u, 0u, 0u, 0u, 0u };
+	glNamedBufferData(cullBuffers[2], sizeof(drawCmd), drawCmd, GL_DYNAMIC_READ);
+	glNamedBufferData(cullBuffers[3], sizeof(FrameBlockGPU), &frame, GL_STATIC_DRAW);
+	glNamedBufferData(cullBuffers[4], sizeof(CullBlockGPU), &cull, GL_STATIC_DRAW);
+	const std::vector<uint32_t> statsInit(CULL_STATS_STRIDE, 0u);
+	glNamedBufferData(cullBuffers[5], statsInit.size() * sizeof(uint32_t), statsInit.data(), GL_DYNAMIC_READ);
+	GLuint reasonBuffer = 0;
+	glCreateBuffers(1, &reasonBuffer);
+	const std::vector<uint32_t> reasonInit(numInstance, 0xFFFFFFFFu);
+	glNamedBufferData(reasonBuffer, reasonInit.size() * sizeof(uint32_t), reasonInit.data(), GL_DYNAMIC_READ);
+	cullProgram->useProgram();
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, cullBuffers[0]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, cullBuffers[1]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, cullBuffers[2]);
+	glBindBufferBase(GL_UNIFORM_BUFFER, UBO_FRAME_BINDING, cullBuffers[3]);
+	glBindBufferBase(GL_UNIFORM_BUFFER, UBO_CULL_BINDING, cullBuffers[4]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, cullBuffers[5]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, reasonBuffer);
+	glBindTextureUnit(9, occlusionTex);
+	glDispatchCompute((numInstance + 255) / 256, 1, 1);
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	std::vector<uint32_t> reasons(numInstance);
+	glGetNamedBufferSubData(reasonBuffer, 0, reasons.size() * sizeof(uint32_t), reasons.data());
+	glBindTextureUnit(9, 0);
+
+	// an occluded instance: hidden for the CPU test, and every GL pixel of its box nearer than the box
+	int numOccluded = 0, numCpuVisible = 0, numGLVisible = 0, numCulledOnlyOnCpu = 0;
+	for (int i = 0; i < numInstance; ++i) {
+		const glm::vec3 center(instances[i].sphere);
+		const float radius = instances[i].sphere.w;
+		const bool cpuVisible = buffer.isSphereVisible(center, radius);
+		if (reasons[i] == CULL_VISIBLE && !cpuVisible) numCulledOnlyOnCpu++; // coarser mip on the GPU
+		if (reasons[i] != CULL_OCCLUSION) continue;
+		numOccluded++;
+		if (cpuVisible) { numCpuVisible++; continue; }
+		glm::vec2 lo(1e30f), hi(-1e30f);
+		float nearest = reversedZ ? 0.0f : 1.0f;
+		for (int c = 0; c < 8; ++c) {
+			const glm::vec3 corner = center + radius * glm::vec3((c & 1) ? 1.0f : -1.0f, (c & 2) ? 1.0f : -1.0f, (c & 4) ? 1.0f : -1.0f);
+			const glm::vec4 clip = viewProj * glm::vec4(corner, 1.0f);
+			const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+			lo = glm::min(lo, glm::vec2(ndc));
+			hi = glm::max(hi, glm::vec2(ndc));
+			const float d = reversedZ ? ndc.z : ndc.z * 0.5f + 0.5f;
+			if (nearer(d, nearest)) nearest = d;
+		}
+		const int x0 = std::max((int)std::floor((lo.x * 0.5f + 0.5f) * w), 0), x1 = std::min((int)std::ceil((hi.x * 0.5f + 0.5f) * w), w) - 1;
+		const int y0 = std::max((int)std::floor((lo.y * 0.5f + 0.5f) * h), 0), y1 = std::min((int)std::ceil((hi.y * 0.5f + 0.5f) * h), h) - 1;
+		bool hidden = true;
+		for (int y = y0; y <= y1 && hidden; ++y) {
+			for (int x = x0; x <= x1 && hidden; ++x) {
+				hidden = nearer(glDepth[(size_t)y * w + x], nearest);
+			}
+		}
+		if (!hidden) numGLVisible++;
+	}
+	check(numCpuVisible == 0, "%s: %d of %d culled instances visible to SoftwareOcclusionBuffer::isSphereVisible", label, numCpuVisible, numOccluded);
+	check(numGLVisible == 0, "%s: %d of %d culled instances not hidden by the GL depth", label, numGLVisible, numOccluded);
+	check(numOccluded > numInstance / 20, "%s: degenerate scene (%d occluded)", label, numOccluded);
+	std::printf("  %d culled, %d more culled by the full-resolution CPU test\n", numOccluded, numCulledOnlyOnCpu);
+
+	glDeleteTextures(1, &occlusionTex);
+	glDeleteTextures(1, &depthTex);
+	glDeleteFramebuffers(1, &fbo);
+	glDeleteVertexArrays(2, vaos);
+	glDeleteBuffers(5, buffers);
+	glDeleteBuffers(6, cullBuffers);
+	glDeleteBuffers(1, &reasonBuffer);
+}
+
+// ==============================================
+// occluder proxy (OccluderProxy.cpp) of a house with a gable roof and eaves, no floor: seen from
+// around and above, the proxy in the software occlusion buffer is never nearer than the house drawn
+// by GL (back faces culled, as in the G-buffer pass), and it covers most of it.
+
+static void testOccluderProxy(ShaderProgram* depthProgram, const bool reversedZ) {
+	char label[64];
+	std::snprintf(label, sizeof(label), "occluder proxy%s", reversedZ ? " reversed-z" : "");
+	std::printf("%s\n", label);
+	const int w = 128, h = 96;
+
+	// quads counter-clockwise seen from outside
+	std::vector<float> houseVertices;
+	std::vector<uint32_t> houseIndices;
+	auto addPolygon = [&](std::initializer_list<glm::vec3> corners) {
+		const uint32_t base = (uint32_t)(houseVertices.size() / 3);
+		for (const glm::vec3& c : corners) houseVertices.insert(houseVertices.end(), { c.x, c.y, c.z });
+		for (uint32_t i = 1; i + 1 < (uint32_t)corners.size(); ++i) houseIndices.insert(houseIndices.end(), { base, base + i, base + i + 1 });
+	};
+	addPolygon({ { -5, 0, 3 }, { 5, 0, 3 }, { 5, 6, 3 }, { -5, 6, 3 } });
+	addPolygon({ { 5, 0, -3 }, { -5, 0, -3 }, { -5, 6, -3 }, { 5, 6, -3 } });
+	addPolygon({ { 5, 0, 3 }, { 5, 0, -3 }, { 5, 6, -3 }, { 5, 6, 3 } });
+	addPolygon({ { -5, 0, -3 }, { -5, 0, 3 }, { -5, 6, 3 }, { -5, 6, -3 } });
+	addPolygon({ { 5, 6, 3 }, { 5, 6, -3 }, { 5, 9, 0 } });
+	addPolygon({ { -5, 6, -3 }, { -5, 6, 3 }, { -5, 9, 0 } });
+	addPolygon({ { -5.5f, 5, 4 }, { 5.5f, 5, 4 }, { 5.5f, 9, 0 }, { -5.5f, 9, 0 } });
+	addPolygon({ { 5.5f, 5, -4 }, { -5.5f, 5, -4 }, { -5.5f, 9, 0 }, { 5.5f, 9, 0 } });
+
+	const int MAX_TRIANGLES = 60;
+	std::vector<float> proxyVertices;
+	std::vector<uint32_t> proxyIndices;
+	buildOccluderProxy(houseVertices.data(), (int)houseVertices.size() / 3, 3, houseIndices.data(), (int)houseIndices.size(), 32, MAX_TRIANGLES, proxyVertices, proxyIndices);
+	const int numTriangle = (int)proxyIndices.size() / 3;
+	check(numTriangle >= 12 && numTriangle <= MAX_TRIANGLES, "%s: %d triangles, budget %d", label, numTriangle, MAX_TRIANGLES);
+	int numOutside = 0;
+	for (size_t i = 0; i < proxyVertices.size(); i += 3) {
+		const glm::vec3 p(proxyVertices[i], proxyVertices[i + 1], proxyVertices[i + 2]);
+		const float roof = 5.0f + 4.0f - std::fabs(p.z);
+		if (std::fabs(p.x) > 5.0f || std::fabs(p.z) > 3.0f || p.y < 0.0f || p.y > std::min(roof, 9.0f)) numOutside++;
+	}
+	check(numOutside == 0, "%s: %d proxy vertices outside the house", label, numOutside);
+
+	GLuint buffers[3];
+	glCreateBuffers(3, buffers);
+	glNamedBufferData(buffers[0], houseVertices.size() * sizeof(float), houseVertices.data(), GL_STATIC_DRAW);
+	glNamedBufferData(buffers[1], houseIndices.size() * sizeof(uint32_t), houseIndices.data(), GL_STATIC_DRAW);
+	GLuint vao = 0;
+	glCreateVertexArrays(1, &vao);
+	glVertexArrayVertexBuffer(vao, 0, buffers[0], 0, 3 * sizeof(float));
+	glVertexArrayElementBuffer(vao, buffers[1]);
+	glEnableVertexArrayAttrib(vao, 0);
+	glVertexArrayAttribFormat(vao, 0, 3, GL_FLOAT, GL_FALSE, 0);
+	glVertexArrayAttribBinding(vao, 0, 0);
+	GLuint depthTex = 0, fbo = 0;
+	glCreateTextures(GL_TEXTURE_2D, 1, &depthTex);
+	glTextureStorage2D(depthTex, 1, GL_DEPTH_COMPONENT32F, w, h);
+	glCreateFramebuffers(1, &fbo);
+	glNamedFramebufferTexture(fbo, GL_DEPTH_ATTACHMENT, depthTex, 0);
+
+	auto nearer = [reversedZ](const float a, const float b) { return reversedZ ? a > b : a < b; };
+	const float farDepth = reversedZ ? 0.0f : 1.0f;
+	const float EPSILON = 1e-5f;
+	SoftwareOcclusionBuffer buffer;
+	buffer.resize(w, h);
+	buffer.setNumWorkers(0);
+	int numNearer = 0, numHouse = 0, numProxy = 0;
+	for (int view = 0; view < 12; ++view) {
+		const float azimuth = glm::radians(30.0f * view + 10.0f);
+		const float distance = 18.0f + 3.0f * (view % 4), height = 8.0f + 4.0f * (view % 3);
+		const glm::vec3 eye(distance * std::cos(azimuth), height, distance * std::sin(azimuth));
+		const glm::mat4 viewMat = glm::lookAt(eye, glm::vec3(0.0f, 4.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		const glm::mat4 projMat = reversedZ
+			? glm::perspectiveRH_ZO(glm::radians(50.0f), (float)w / (float)h, 200.0f, 0.1f)
+			: glm::perspective(glm::radians(50.0f), (float)w / (float)h, 0.1f, 200.0f);
+		const glm::mat4 viewProj = projMat * viewMat;
+
+		ShadowBlockGPU shadowBlock = {};
+		shadowBlock.lightVP[0] = viewProj;
+		glNamedBufferData(buffers[2], sizeof(ShadowBlockGPU), &shadowBlock, GL_STATIC_DRAW);
+		glClipControl(GL_LOWER_LEFT, reversedZ ? GL_ZERO_TO_ONE : GL_NEGATIVE_ONE_TO_ONE);
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		glDrawBuffer(GL_NONE);
+		glViewport(0, 0, w, h);
+		glEnable(GL_DEPTH_TEST);
+		glEnable(GL_CULL_FACE);
+		glDepthFunc(reversedZ ? GL_GREATER : GL_LESS);
+		glClearDepth(farDepth);
+		glClear(GL_DEPTH_BUFFER_BIT);
+		depthProgram->useProgram();
+		glBindBufferBase(GL_UNIFORM_BUFFER, UBO_SHADOW_BINDING, buffers[2]);
+		glUniform1i(21, 0);
+		glUniform1i(22, 0);
+		const glm::mat4 identity(1.0f);
+		glUniformMatrix4fv(0, 1, GL_FALSE, &identity[0][0]);
+		glBindVertexArray(vao);
+		glDrawElements(GL_TRIANGLES, (GLsizei)houseIndices.size(), GL_UNSIGNED_INT, nullptr);
+		glBindVertexArray(0);
+		glDisable(GL_CULL_FACE);
+		glDepthFunc(GL_LESS);
+		glClearDepth(1.0);
+		glClipControl(GL_LOWER_LEFT, GL_NEGATIVE_ONE_TO_ONE);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		std::vector<float> glDepth((size_t)w * h);
+		glGetTextureImage(depthTex, 0, GL_DEPTH_COMPONENT, GL_FLOAT, (GLsizei)(glDepth.size() * sizeof(float)), glDepth.data());
+
+		buffer.begin(viewProj, reversedZ);
+		buffer.addTriangles(proxyVertices.data(), (int)proxyVertices.size() / 3, 3, proxyIndices.data(), (int)proxyIndices.size(), glm::mat4(1.0f));
+		buffer.rasterize();
+		std::vector<std::vector<float>> levels;
+		buffer.resolveDepthPyramid(levels);
+		for (size_t i = 0; i < glDepth.size(); ++i) {
+			if (glDepth[i] != farDepth) numHouse++;
+			if (levels[0][i] != farDepth) numProxy++;
+			if (nearer(levels[0][i], glDepth[i] + (reversedZ ? EPSILON : -EPSILON))) numNearer++;
+		}
+	}
+	check(numNearer == 0, "%s: %d pixels where the proxy is nearer than the house", label, numNearer);
+	check(numProxy * 2 > numHouse, "%s: the proxy covers %d of %d house pixels", label, numProxy, numHouse);
+	std::printf("  %d triangles, %d of %d house pixels covered\n", numTriangle, numProxy, numHouse);
+
+	glDeleteTextures(1, &depthTex);
+	glDeleteFramebuffers(1, &fbo);
+	glDeleteVertexArrays(1, &vao);
+	glDeleteBuffers(3, buffers);
+}
+
+// ==============================================
+// EVSM prefilter (shadowMomentBlur.comp): moments averaged over downsample x downsample depth texels,
+// then a separable Gaussian with clamped edges, against a double precision reference.
+
+static glm::dvec4 referenceEvsmMoments(double depth) {
+	const double x = depth * 2.0 - 1.0;
+	const double p = std::exp(40.0 * x), n = -std::exp(-5.0 * x);
+	return glm::dvec4(p, p * p, n, n * n);
+}
+
+static void testShadowMomentBlur(ShaderProgram* program, const int size, const int downsample, const int radius, const bool reversedZ) {
+	char label[64];
+	std::snprintf(label, sizeof(label), "shadow moment blur %d/%d r%d%s", size, downsample, radius, reversedZ ? " reversed-z" : "");
+	std::printf("%s\n", label);
+	const int numLayer = 2, momentSize = size / downsample;
+
+	// blocky casters over a sloped receiver, different per layer
+	std::vector<float> depth((size_t)size * size * numLayer);
+	std::mt19937 rng(11);
+	std::uniform_real_distribution<float> noise(0.0f, 0.02f);
+	for (int l = 0; l < numLayer; ++l) {
+		for (int y = 0; y < size; ++y) {
+			for (int x = 0; x < size; ++x) {
+				float d = 0.6f + 0.3f * (float)y / (float)size + noise(rng);
+				if (((x / (7 + l)) + (y / 5)) % 3 == 0) { d = 0.2f + 0.1f * (float)l; }
+				depth[((size_t)l * size + y) * size + x] = reversedZ ? 1.0f - d : d;
+			}
+		}
+	}
+
+	GLuint depthTex = 0, tempTex = 0, momentTex = 0;
+	glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &depthTex);
+	glTextureStorage3D(depthTex, 1, GL_DEPTH_COMPONENT32F, size, size, numLayer);
+	glTextureSubImage3D(depthTex, 0, 0, 0, 0, size, size, numLayer, GL_DEPTH_COMPONENT, GL_FLOAT, depth.data());
+	glTextureParameteri(depthTex, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTextureParameteri(depthTex, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &tempTex);
+	glTextureStorage3D(tempTex, 1, GL_RGBA32F, momentSize, momentSize, 1);
+	glTextureParameteri(tempTex, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTextureParameteri(tempTex, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &momentTex);
+	glTextureStorage3D(momentTex, 1, GL_RGBA32F, momentSize, momentSize, numLayer);
+
+	FrameBlockGPU frame = {};
+	frame.depthFlags = glm::ivec4(reversedZ ? 1 : 0, 0, 0, 0);
+	GLuint frameUBO = 0;
+	glCreateBuffers(1, &frameUBO);
+	glNamedBufferData(frameUBO, sizeof(FrameBlockGPU), &frame, GL_STATIC_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, UBO_FRAME_BINDING, frameUBO);
+
+	// same sequence as SceneRenderer::blurShadowMoments
+	program->useProgram();
+	glBindTextureUnit(1, depthTex);
+	glBindTextureUnit(2, tempTex);
+	const GLuint blurId = program->programId();
+	const GLint blurPassLoc = glGetUniformLocation(blurId, "blurPass");
+	glUniform1i(glGetUniformLocation(blurId, "downsample"), downsample);
+	glUniform1i(glGetUniformLocation(blurId, "radius"), radius);
+	const GLuint groups = (GLuint)((momentSize + 7) / 8);
+	for (int l = 0; l < numLayer; ++l) {
+		glUniform1i(glGetUniformLocation(blurId, "layer"), l);
+		glUniform1i(blurPassLoc, 0);
+		glBindImageTexture(0, tempTex, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+		glDispatchCompute(groups, groups, 1);
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+		glUniform1i(blurPassLoc, 1);
+		glBindImageTexture(0, momentTex, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+		glDispatchCompute(groups, groups, 1);
+		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+	}
+	glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+	std::vector<glm::vec4> gpu((size_t)momentSize * momentSize * numLayer);
+	glGetTextureImage(momentTex, 0, GL_RGBA, GL_FLOAT, (GLsizei)(gpu.size() * sizeof(glm::vec4)), gpu.data());
+
+	const double sigma = std::max(radius * 0.5, 0.5);
+	std::vector<double> weights;
+	double weightSum = 0.0;
+	for (int k = -radius; k <= radius; ++k) {
+		weights.push_back(std::exp(-0.5 * k * k / (sigma * sigma)));
+		weightSum += weights.back();
+	}
+	int numWrong = 0;
+	double worst = 0.0;
+	for (int l = 0; l < numLayer; ++l) {
+		std::vector<glm::dvec4> box((size_t)momentSize * momentSize), horizontal(box.size());
+		for (int y = 0; y < momentSize; ++y) {
+			for (int x = 0; x < momentSize; ++x) {
+				glm::dvec4 sum(0.0);
+				for (int dy = 0; dy < downsample; ++dy) {
+					for (int dx = 0; dx < downsample; ++dx) {
+						const double d = depth[((size_t)l * size + y * downsample + dy) * size + x * downsample + dx];
+						sum += referenceEvsmMoments(reversedZ ? 1.0 - d : d);
+					}
+				}
+				box[(size_t)y * momentSize + x] = sum / (double)(downsample * downsample);
+			}
+		}
+		for (int pass = 0; pass < 2; ++pass) {
+			const std::vector<glm::dvec4>& src = (pass == 0) ? box : horizontal;
+			std::vector<glm::dvec4>& dst = (pass == 0) ? horizontal : box;
+			std::vector<glm::dvec4> out(src.size());
+			for (int y = 0; y < momentSize; ++y) {
+				for (int x = 0; x < momentSize; ++x) {
+					glm::dvec4 sum(0.0);
+					for (int k = -radius; k <= radius; ++k) {
+						const int sx = std::max(0, std::min(x + (pass == 0 ? k : 0), momentSize - 1));
+						const int sy = std::max(0, std::min(y + (pass == 1 ? k : 0), momentSize - 1));
+						sum += weights[k + radius] * src[(size_t)sy * momentSize + sx];
+					}
+					out[(size_t)y * momentSize + x] = sum / weightSum;
+				}
+			}
+			dst = out;
+		}
+		for (size_t i = 0; i < box.size(); ++i) {
+			const glm::vec4& g = gpu[(size_t)l * momentSize * momentSize + i];
+			for (int c = 0; c < 4; ++c) {
+				const double error = std::abs((double)g[c] - box[i][c]) / std::max(std::abs(box[i][c]), 1e-6);
+				worst = std::max(worst, error);
+				if (!(error < 1e-4)) { numWrong++; }
+			}
+		}
+	}
+	check(numWrong == 0, "%s: %d moments off the reference (worst relative error %g)", label, numWrong, worst);
+
+	glDeleteBuffers(1, &frameUBO);
+	const GLuint textures[3] = { depthTex, tempTex, momentTex };
+	glDeleteTextures(3, textures);
+}
+
+// ==============================================
+// octahedral impostors (ImpostorBaker.cpp, impostorVertex/Fragment.glsl) of an untextured box: every
+// covered atlas texel holds the depth a ray along its frame direction hits the box at; the runtime
+// quad of an instance seen along a frame direction covers and depth-tests like the box drawn by GL
+// (quad front-facing with face culling on), and its G-buffer position and normal are the box's.
+
+static void testImpostors(ShaderProgram* impostorProgram, ShaderProgram* depthProgram, const bool reversedZ) {
+	char label[64];
+	std::snprintf(label, sizeof(label), "impostors%s", reversedZ ? " reversed-z" : "");
+	std::printf("%s\n", label);
+	const int frames = 8, frameSize = 64, w = 128, h = 128;
+
+	// box, interleaved like MeshImport.h, faces counter-clockwise seen from outside
+	const glm::vec3 boxMin(-1.5f, 0.0f, -1.0f), boxMax(1.5f, 2.0f, 1.0f);
+	std::vector<float> vertices;
+	std::vector<uint32_t> indices;
+	for (int axis = 0; axis < 3; ++axis) {
+		for (int side = 0; side < 2; ++side) {
+			glm::vec3 n(0.0f);
+			n[axis] = side ? 1.0f : -1.0f;
+			const glm::vec3 u = glm::vec3(n.y != 0.0f ? 1.0f : 0.0f, n.y != 0.0f ? 0.0f : 1.0f, 0.0f);
+			const glm::vec3 v = glm::cross(n, u);
+			const uint32_t base = (uint32_t)(vertices.size() / INTERLEAVED_VERTEX_FLOATS);
+			const glm::vec2 corners[4] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+			for (const glm::vec2& c : corners) {
+				const glm::vec3 p = (boxMin + boxMax) * 0.5f + (n + c.x * u + c.y * v) * (boxMax - boxMin) * 0.5f;
+				vertices.insert(vertices.end(), { p.x, p.y, p.z, n.x, n.y, n.z, u.x, u.y, u.z, c.x * 0.5f + 0.5f, c.y * 0.5f + 0.5f });
+			}
+			indices.insert(indices.end(), { base, base + 1, base + 2, base, base + 2, base + 3 });
+		}
+	}
+	const int numVertex = (int)(vertices.size() / INTERLEAVED_VERTEX_FLOATS);
+
+	ImpostorAtlas atlas;
+	if (!check(bakeImpostorAtlas(vertices.data(), numVertex, indices.data(), (int)indices.size(), 0, frames, frameSize, atlas), "%s: bake failed", label)) return;
+	const int size = atlas.size();
+	check(atlas.frames == frames && atlas.frameSize == frameSize && atlas.albedo.size() == (size_t)size * size * 4 && atlas.normalDepth.size() == atlas.albedo.size(),
+		"%s: atlas %dx%d frames of %d px", label, atlas.frames, atlas.frames, atlas.frameSize);
+	check(glm::length(atlas.center - glm::vec3(0.0f, 1.0f, 0.0f)) < 1e-5f && std::abs(atlas.radius - glm::length(boxMax - boxMin) * 0.5f) < 1e-5f,
+		"%s: bounds (%f %f %f) r %f", label, atlas.center.x, atlas.center.y, atlas.center.z, atlas.radius);
+
+	// 1. atlas against rays through the texel centers, from the viewer's side of every frame
+	int numCovered = 0, numCoverageMismatch = 0, numDepthMismatch = 0, numNotWhite = 0;
+	for (int j = 0; j < frames; ++j) {
+		for (int i = 0; i < frames; ++i) {
+			const glm::vec3 dir = impostorFrameDirection(i, j, frames);
+			glm::vec3 right, up;
+			impostorFrameBasis(dir, right, up);
+			for (int py = 0; py < frameSize; ++py) {
+				for (int px = 0; px < frameSize; ++px) {
+					const glm::vec2 xy = (glm::vec2((float)px, (float)py) + 0.5f) / (float)frameSize * 2.0f - 1.0f;
+					const glm::vec3 origin = atlas.center + (xy.x * right + xy.y * up + dir * 1.01f) * atlas.radius;
+					float tEnter = -FLT_MAX, tExit = FLT_MAX;
+					for (int k = 0; k < 3; ++k) {
+						if (std::abs(dir[k]) < 1e-7f) {
+							if (origin[k] < boxMin[k] || origin[k] > boxMax[k]) tExit = -1.0f;
+							continue;
+						}
+						const float t0 = (origin[k] - boxMin[k]) / dir[k], t1 = (origin[k] - boxMax[k]) / dir[k];
+						tEnter = std::max(tEnter, std::min(t0, t1));
+						tExit = std::min(tExit, std::max(t0, t1));
+					}
+					const bool hit = tEnter <= tExit && tExit >= 0.0f;
+					const size_t texel = ((size_t)(j * frameSize + py) * size + (size_t)(i * frameSize + px)) * 4;
+					const bool covered = atlas.albedo[texel + 3] >= 128;
+					if (covered != hit) { numCoverageMismatch++; continue; }
+					if (!hit) continue;
+					numCovered++;
+					if (atlas.albedo[texel] != 255) { numNotWhite++; }
+					const float expected = glm::dot(origin - dir * tEnter - atlas.center, dir) / atlas.radius;
+					const float baked = atlas.normalDepth[texel + 3] / 255.0f * 2.0f - 1.0f;
+					if (std::abs(baked - expected) > 3.0f / 255.0f) { numDepthMismatch++; }
+				}
+			}
+		}
+	}
+	std::printf("  atlas: %d covered texels, %d coverage and %d depth mismatches\n", numCovered, numCoverageMismatch, numDepthMismatch);
+	check(numCovered > frames * frames * frameSize * frameSize / 8, "%s: only %d covered texels", label, numCovered);
+	// texel centers exactly on an edge may go either way
+	check(numCoverageMismatch * 200 < numCovered, "%s: %d texels covered differently from the ray cast", label, numCoverageMismatch);
+	check(numDepthMismatch * 200 < numCovered, "%s: %d texels with a depth off the ray cast", label, numDepthMismatch);
+	check(numNotWhite == 0, "%s: %d covered texels not white (untextured)", label, numNotWhite);
+
+	// 2. one rotated instance seen along frame (2, 5): mesh depth (shadowDepth program) vs impostor
+	const glm::mat4 model = glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(20.0f, 3.0f, -5.0f)), 0.7f, glm::vec3(0.0f, 1.0f, 0.0f));
+	const glm::vec3 dirOS = impostorFrameDirection(2, 5, frames);
+	const glm::vec3 centerWS = glm::vec3(model * glm::vec4(atlas.center, 1.0f));
+	const glm::vec3 eye = glm::vec3(model * glm::vec4(atlas.center + dirOS * 6.0f * atlas.radius, 1.0f));
+	const glm::mat4 viewMat = glm::lookAt(eye, centerWS, glm::vec3(0.0f, 1.0f, 0.0f));
+	const float nearD = 0.5f, farD = 100.0f;
+	const glm::mat4 projMat = reversedZ
+		? glm::perspectiveRH_ZO(glm::radians(40.0f), (float)w / (float)h, farD, nearD)
+		: glm::perspective(glm::radians(40.0f), (float)w / (float)h, nearD, farD);
+
+	FrameBlockGPU frame = {};
+	frame.cullVP = projMat * viewMat;
+	frame.cullViewMat = viewMat;
+	frame.lightDirWorld = glm::vec4(0.0f, 1.0f, 0.0f, 0.0f);
+	frame.depthFlags = glm::ivec4(reversedZ ? 1 : 0, 0, 0, 0);
+	ViewBlockGPU view = {};
+	view.viewMat = viewMat;
+	view.projMat = projMat;
+	view.invProjMat = glm::inverse(projMat);
+	view.cameraPosWorld = glm::vec4(eye, 1.0f);
+	MaterialBlockGPU materials = {};
+	materials.materials[0] = MaterialDataGPU();
+	ShadowBlockGPU shadowBlock = {};
+	shadowBlock.lightVP[0] = projMat * viewMat;
+	InstanceDataGPU instance;
+	instance.model = model;
+	instance.sphere = glm::vec4(centerWS, atlas.radius);
+	const uint32_t impostorList[5] = { 6u, 1u, 0u, 0u, 0u };
+
+	GLuint buffers[9];
+	glCreateBuffers(9, buffers);
+	glNamedBufferData(buffers[0], vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+	glNamedBufferData(buffers[1], indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+	glNamedBufferData(buffers[2], sizeof(InstanceDataGPU), &instance, GL_STATIC_DRAW);
+	glNamedBufferData(buffers[3], sizeof(impostorList), impostorList, GL_STATIC_DRAW);
+	glNamedBufferData(buffers[4], sizeof(FrameBlockGPU), &frame, GL_STATIC_DRAW);
+	glNamedBufferData(buffers[5], sizeof(ViewBlockGPU), &view, GL_STATIC_DRAW);
+	glNamedBufferData(buffers[6], sizeof(MaterialBlockGPU), &materials, GL_STATIC_DRAW);
+	glNamedBufferData(buffers[7], sizeof(ShadowBlockGPU), &shadowBlock, GL_STATIC_DRAW);
+	glNamedBufferData(buffers[8], sizeof(uint32_t), impostorList, GL_STATIC_DRAW);
+	GLuint vaos[2];
+	glCreateVertexArrays(2, vaos);
+	glVertexArrayVertexBuffer(vaos[0], 0, buffers[0], 0, INTERLEAVED_VERTEX_FLOATS * sizeof(float));
+	glVertexArrayElementBuffer(vaos[0], buffers[1]);
+	glEnableVertexArrayAttrib(vaos[0], 0);
+	glVertexArrayAttribFormat(vaos[0], 0, 3, GL_FLOAT, GL_FALSE, 0);
+	glVertexArrayAttribBinding(vaos[0], 0, 0);
+
+	// atlas textures as SceneRenderer::loadImpostorAtlas creates them
+	GLuint atlasTex[2];
+	glCreateTextures(GL_TEXTURE_2D, 2, atlasTex);
+	const std::vector<uint8_t>* pixels[2] = { &atlas.albedo, &atlas.normalDepth };
+	for (int k = 0; k < 2; ++k) {
+		glTextureStorage2D(atlasTex[k], 5, GL_RGBA8, size, size);
+		glTextureSubImage2D(atlasTex[k], 0, 0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, pixels[k]->data());
+		glGenerateTextureMipmap(atlasTex[k]);
+		glTextureParameteri(atlasTex[k], GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTextureParameteri(atlasTex[k], GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(atlasTex[k], GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+
+	// mesh depth, impostor depth + gPosition + gNormal
+	GLuint targets[4], fbos[2];
+	glCreateTextures(GL_TEXTURE_2D, 4, targets);
+	glTextureStorage2D(targets[0], 1, GL_DEPTH_COMPONENT32F, w, h);
+	glTextureStorage2D(targets[1], 1, GL_DEPTH_COMPONENT32F, w, h);
+	glTextureStorage2D(targets[2], 1, GL_RGBA32F, w, h);
+	glTextureStorage2D(targets[3], 1, GL_RGBA32F, w, h);
+	glCreateFramebuffers(2, fbos);
+	glNamedFramebufferTexture(fbos[0], GL_DEPTH_ATTACHMENT, targets[0], 0);
+	glNamedFramebufferDrawBuffer(fbos[0], GL_NONE);
+	glNamedFramebufferTexture(fbos[1], GL_DEPTH_ATTACHMENT, targets[1], 0);
+	glNamedFramebufferTexture(fbos[1], GL_COLOR_ATTACHMENT0, targets[2], 0);
+	glNamedFramebufferTexture(fbos[1], GL_COLOR_ATTACHMENT1, targets[3], 0);
+	const GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glNamedFramebufferDrawBuffers(fbos[1], 2, drawBuffers);
+
+	const float empty = reversedZ ? 0.0f : 1.0f;
+	const float clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	glClipControl(GL_LOWER_LEFT, reversedZ ? GL_ZERO_TO_ONE : GL_NEGATIVE_ONE_TO_ONE);
+	glViewport(0, 0, w, h);
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(reversedZ ? GL_GREATER : GL_LESS);
+	glBindBufferBase(GL_UNIFORM_BUFFER, UBO_FRAME_BINDING, buffers[4]);
+	glBindBufferBase(GL_UNIFORM_BUFFER, UBO_VIEW_BINDING, buffers[5]);
+	glBindBufferBase(GL_UNIFORM_BUFFER, UBO_MATERIAL_BINDING, buffers[6]);
+	glBindBufferBase(GL_UNIFORM_BUFFER, UBO_SHADOW_BINDING, buffers[7]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, buffers[2]);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, fbos[0]);
+	glClearNamedFramebufferfv(fbos[0], GL_DEPTH, 0, &empty);
+	depthProgram->useProgram();
+	glBindVertexArray(vaos[0]);
+	glUniform1i(21, 0);
+	glUniform1i(22, 0);
+	glUniformMatrix4fv(0, 1, GL_FALSE, &model[0][0]);
+	glDrawElements(GL_TRIANGLES, (GLsizei)indices.size(), GL_UNSIGNED_INT, nullptr);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, fbos[1]);
+	glClearNamedFramebufferfv(fbos[1], GL_DEPTH, 0, &empty);
+	glClearNamedFramebufferfv(fbos[1], GL_COLOR, 0, clearColor);
+	glClearNamedFramebufferfv(fbos[1], GL_COLOR, 1, clearColor);
+	glEnable(GL_CULL_FACE);
+	impostorProgram->useProgram();
+	glBindVertexArray(vaos[1]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, buffers[3]);
+	glBindTextureUnit(0, atlasTex[0]);
+	glBindTextureUnit(1, atlasTex[1]);
+	const GLuint impostorId = impostorProgram->programId();
+	glUniform1i(glGetUniformLocation(impostorId, "materialIndex"), 0);
+	glUniform4f(glGetUniformLocation(impostorId, "impostorBounds"), atlas.center.x, atlas.center.y, atlas.center.z, atlas.radius);
+	glUniform1i(glGetUniformLocation(impostorId, "impostorFrames"), frames);
+	glUniform1i(glGetUniformLocation(impostorId, "shadowCascade"), -1);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffers[3]);
+	glDrawArraysIndirect(GL_TRIANGLES, nullptr);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glDisable(GL_CULL_FACE);
+	glDepthFunc(GL_LESS);
+	glClipControl(GL_LOWER_LEFT, GL_NEGATIVE_ONE_TO_ONE);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glBindTextureUnit(0, 0);
+	glBindTextureUnit(1, 0);
+
+	std::vector<float> meshDepth((size_t)w * h), impostorDepth(meshDepth.size()), positions(meshDepth.size() * 4), normals(positions.size());
+	glGetTextureImage(targets[0], 0, GL_DEPTH_COMPONENT, GL_FLOAT, (GLsizei)(meshDepth.size() * sizeof(float)), meshDepth.data());
+	glGetTextureImage(targets[1], 0, GL_DEPTH_COMPONENT, GL_FLOAT, (GLsizei)(impostorDepth.size() * sizeof(float)), impostorDepth.data());
+	glGetTextureImage(targets[2], 0, GL_RGBA, GL_FLOAT, (GLsizei)(positions.size() * sizeof(float)), positions.data());
+	glGetTextureImage(targets[3], 0, GL_RGBA, GL_FLOAT, (GLsizei)(normals.size() * sizeof(float)), normals.data());
+
+	const glm::mat4 invVP = glm::inverse(projMat * viewMat);
+	auto viewDistance = [&](const int x, const int y, const float depth) {
+		const glm::vec3 ndc((x + 0.5f) / w * 2.0f - 1.0f, (y + 0.5f) / h * 2.0f - 1.0f, reversedZ ? depth : depth * 2.0f - 1.0f);
+		const glm::vec4 p = invVP * glm::vec4(ndc, 1.0f);
+		return glm::length(glm::vec3(p) / p.w - eye);
+	};
+	int numMesh = 0, numImpostor = 0, numBoth = 0, numDepthOff = 0, numPositionOff = 0, numNormalOff = 0;
+	for (int y = 0; y < h; ++y) {
+		for (int x = 0; x < w; ++x) {
+			const size_t i = (size_t)y * w + x;
+			const bool mesh = meshDepth[i] != empty, impostor = impostorDepth[i] != empty;
+			numMesh += mesh ? 1 : 0;
+			numImpostor += impostor ? 1 : 0;
+			if (!impostor) continue;
+			// gPosition is the point whose depth was written (moved along the frame direction, so not
+			// on the pixel's view ray)
+			const glm::vec4 clip = projMat * viewMat * glm::vec4(positions[i * 4], positions[i * 4 + 1], positions[i * 4 + 2], 1.0f);
+			const float positionDepth = reversedZ ? clip.z / clip.w : clip.z / clip.w * 0.5f + 0.5f;
+			if (std::abs(viewDistance(x, y, positionDepth) - viewDistance(x, y, impostorDepth[i])) > 1e-2f) { numPositionOff++; }
+			// one of the box's faces
+			const glm::vec3 n = glm::inverse(glm::mat3(model)) * glm::vec3(normals[i * 4], normals[i * 4 + 1], normals[i * 4 + 2]);
+			if (std::max(std::abs(n.x), std::max(std::abs(n.y), std::abs(n.z))) < 0.95f) { numNormalOff++; }
+			if (!mesh) continue;
+			numBoth++;
+			if (std::abs(viewDistance(x, y, impostorDepth[i]) - viewDistance(x, y, meshDepth[i])) > 0.05f * atlas.radius) { numDepthOff++; }
+		}
+	}
+	std::printf("  %d mesh, %d impostor pixels, %d both; %d off in depth, %d in position, %d in normal\n", numMesh, numImpostor, numBoth, numDepthOff, numPositionOff, numNormalOff);
+	check(numMesh > w * h / 10, "%s: box covers only %d pixels", label, numMesh);
+	// silhouettes differ by the bake's resolution and perspective
+	check((numMesh + numImpostor - 2 * numBoth) * 10 < numMesh, "%s: coverage %d mesh / %d impostor, %d both", label, numMesh, numImpostor, numBoth);
+	check(numDepthOff * 20 < numBoth, "%s: %d of %d pixels off the mesh depth", label, numDepthOff, numBoth);
+	check(numPositionOff == 0, "%s: %d G-buffer positions off the written depth", label, numPositionOff);
+	check(numNormalOff * 10 < numImpostor, "%s: %d normals off the box faces", label, numNormalOff);
+
+	glDeleteFramebuffers(2, fbos);
+	glDeleteTextures(4, targets);
+	glDeleteTextures(2, atlasTex);
+	glDeleteVertexArrays(2, vaos);
+	glDeleteBuffers(9, buffers);
+}
+
+// ==============================================
+// Mesh clusters: a subdivided house split by buildMeshClusters (ranges tile the reordered index
+// buffer, bounds hold every vertex, the normal cone only rejects clusters whose every triangle faces
+// away), then clusterCullArgs.comp + clusterCull.comp over a field of rotated houses, drawn through
+// clusterProcess(). With back-face culling on, the compacted draw must give the same depth and
+// G-buffer as the whole visible instances; with a software occlusion buffer hiding the left half
+// behind a wall, the same once the wall is composited over both.
+
+// n x n quads per face, counter-clockwise seen from outside, interleaved like the instance batches
+static void buildClusterTestHouse(const int n, std::vector<float>& vertices, std::vector<uint32_t>& indices) {
+	auto addGrid = [&](const glm::vec3& origin, const glm::vec3& u, const glm::vec3& v) {
+		const glm::vec3 normal = glm::normalize(glm::cross(u, v));
+		const glm::vec3 tangent = glm::normalize(u);
+		const uint32_t base = (uint32_t)(vertices.size() / INTERLEAVED_VERTEX_FLOATS);
+		for (int j = 0; j <= n; ++j) {
+			for (int i = 0; i <= n; ++i) {
+				const glm::vec3 p = origin + u * ((float)i / n) + v * ((float)j / n);
+				vertices.insert(vertices.end(), { p.x, p.y, p.z, normal.x, normal.y, normal.z, tangent.x, tangent.y, tangent.z, (float)i / n, (float)j / n });
+			}
+		}
+		for (int j = 0; j < n; ++j) {
+			for (int i = 0; i < n; ++i) {
+				const uint32_t a = base + (uint32_t)(j * (n + 1) + i);
+				indices.insert(indices.end(), { a, a + 1, a + (uint32_t)n + 2, a, a + (uint32_t)n + 2, a + (uint32_t)n + 1 });
+			}
+		}
+	};
+	addGrid({ -5, 0, 3 }, { 10, 0, 0 }, { 0, 6, 0 });
+	addGrid({ 5, 0, -3 }, { -10, 0, 0 }, { 0, 6, 0 });
+	addGrid({ 5, 0, 3 }, { 0, 0, -6 }, { 0, 6, 0 });
+	addGrid({ -5, 0, -3 }, { 0, 0, 6 }, { 0, 6, 0 });
+	addGrid({ -5, 0, -3 }, { 10, 0, 0 }, { 0, 0, 6 });
+	addGrid({ -5.5f, 5, 4 }, { 11, 0, 0 }, { 0, 4, -4 });
+	addGrid({ 5.5f, 5, -4 }, { -11, 0, 0 }, { 0, 4, 4 });
+}
+
+static void testMeshClusters() {
+	const char* label = "mesh clusters";
+	std::printf("%s\n", label);
+	std::vector<float> vertices;
+	std::vector<uint32_t> indices;
+	buildClusterTestHouse(8, vertices, indices);
+	const int numVertex = (int)(vertices.size() / INTERLEAVED_VERTEX_FLOATS);
+	const int numTriangle = (int)indices.size() / 3;
+	auto sortedTriangles = [&]() {
+		std::vector<glm::uvec3> triangles((size_t)numTriangle);
+		for (int t = 0; t < numTriangle; ++t) triangles[t] = glm::uvec3(indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2]);
+		std::sort(triangles.begin(), triangles.end(), [](const glm::uvec3& a, const glm::uvec3& b) {
+			return (a.x != b.x) ? a.x < b.x : (a.y != b.y) ? a.y < b.y : a.z < b.z;
+		});
+		return triangles;
+	};
+	const std::vector<glm::uvec3> before = sortedTriangles();
+
+	const int MAX_TRIANGLES = 48;
+	std::vector<MeshCluster> clusters;
+	buildMeshClusters(vertices.data(), numVertex, INTERLEAVED_VERTEX_FLOATS, indices.data(), (int)indices.size(), MAX_TRIANGLES, clusters);
+	check(sortedTriangles() == before, "%s: triangles lost or changed by the reorder", label);
+
+	auto position = [&](const uint32_t v) {
+		return glm::vec3(vertices[(size_t)v * INTERLEAVED_VERTEX_FLOATS], vertices[(size_t)v * INTERLEAVED_VERTEX_FLOATS + 1], vertices[(size_t)v * INTERLEAVED_VERTEX_FLOATS + 2]);
+	};
+	uint32_t next = 0;
+	int numBadSize = 0, numOutside = 0;
+	for (const MeshCluster& cluster : clusters) {
+		check(cluster.firstIndex == next, "%s: cluster at index %u, expected %u", label, cluster.firstIndex, next);
+		next = cluster.firstIndex + cluster.numTriangles * 3;
+		if (cluster.numTriangles == 0 || cluster.numTriangles > (uint32_t)MAX_TRIANGLES) numBadSize++;
+		for (uint32_t i = cluster.firstIndex; i < next; ++i) {
+			if (glm::length(position(indices[i]) - cluster.center) > cluster.radius * 1.0001f + 1e-4f) numOutside++;
+		}
+	}
+	check(next == (uint32_t)indices.size(), "%s: clusters cover %u of %d indices", label, next, (int)indices.size());
+	check(numBadSize == 0, "%s: %d clusters empty or over %d triangles", label, numBadSize, MAX_TRIANGLES);
+	check(numOutside == 0, "%s: %d vertices outside their cluster's sphere", label, numOutside);
+	// 7 planar faces of 128 triangles: every cluster is flat and can be rejected
+	check((int)clusters.size() <= 7 * ((128 + MAX_TRIANGLES - 1) / MAX_TRIANGLES), "%s: %d clusters", label, (int)clusters.size());
+
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> eyeDist(-40.0f, 40.0f);
+	int numRejected = 0, numFrontRejected = 0, numTest = 0;
+	for (int e = 0; e < 500; ++e) {
+		const glm::vec3 eye(eyeDist(rng), eyeDist(rng), eyeDist(rng));
+		for (const MeshCluster& cluster : clusters) {
+			numTest++;
+			if (!clusterBackfacing(cluster, eye)) continue;
+			numRejected++;
+			for (uint32_t i = cluster.firstIndex; i < cluster.firstIndex + cluster.numTriangles * 3; i += 3) {
+				const glm::vec3 a = position(indices[i]), b = position(indices[i + 1]), c = position(indices[i + 2]);
+				if (glm::dot(glm::cross(b - a, c - a), eye - a) > 0.0f) numFrontRejected++;
+			}
+		}
+	}
+	std::printf("  %d clusters, %d of %d rejected by their cone\n", (int)clusters.size(), numRejected, numTest);
+	check(numFrontRejected == 0, "%s: %d front-facing triangles in rejected clusters", label, numFrontRejected);
+	check(numRejected > numTest / 5, "%s: cones too wide (%d of %d rejected)", label, numRejected, numTest);
+
+	// degenerate triangles: never rejected
+	std::vector<uint32_t> flat = { 0, 0, 1, 0, 1, 2 };
+	buildMeshClusters(vertices.data(), numVertex, INTERLEAVED_VERTEX_FLOATS, flat.data(), (int)flat.size(), MAX_TRIANGLES, clusters);
+	check(clusters.size() == 1 && clusters[0].coneCutoff >= 1.0f, "%s: cluster with a degenerate triangle has a cone", label);
+	check(clusterVertexBits(1) == 0 && clusterVertexBits(numVertex) == 10 && clusterVertexBits(1025) == 11, "%s: vertex bits", label);
+}
+
+struct ClusterPrograms {
+	ShaderProgram* gbuffer; // oglVertexShader + oglFragmentShader
+	ShaderProgram* args;    // clusterCullArgs.comp
+	ShaderProgram* cull;    // clusterCull.comp
+};
+
+static void testClusterCulling(const ClusterPrograms& programs, const bool reversedZ, const bool softwareOcclusion) {
+	char label[64];
+	std::snprintf(label, sizeof(label), "cluster cull%s%s", reversedZ ? " reversed-z" : "", softwareOcclusion ? " software occlusion" : "");
+	std::printf("%s\n", label);
+	const int w = 256, h = 160;
+
+	std::vector<float> vertices;
+	std::vector<uint32_t> indices;
+	buildClusterTestHouse(6, vertices, indices);
+	const int numVertex = (int)(vertices.size() / INTERLEAVED_VERTEX_FLOATS);
+	const int numIndex = (int)indices.size();
+	std::vector<MeshCluster> clusters;
+	buildMeshClusters(vertices.data(), numVertex, INTERLEAVED_VERTEX_FLOATS, indices.data(), numIndex, 32, clusters);
+	std::vector<ClusterDataGPU> clusterData(clusters.size());
+	for (size_t c = 0; c < clusters.size(); ++c) {
+		clusterData[c].sphere = glm::vec4(clusters[c].center, clusters[c].radius);
+		clusterData[c].cone = glm::vec4(clusters[c].coneAxis, clusters[c].coneCutoff);
+		clusterData[c].range = glm::uvec4(clusters[c].firstIndex, clusters[c].numTriangles, 0u, 0u);
+	}
+	const int vertexBits = clusterVertexBits(numVertex);
+
+	// rotated houses on a grid, wider than the frustum; every fourth one left out of the visible list
+	std::mt19937 rng(reversedZ ? 11 : 5);
+	std::uniform_real_distribution<float> yawDist(0.0f, 6.2831853f);
+	std::vector<InstanceDataGPU> instances;
+	std::vector<uint32_t> visible(1, 0u);
+	for (int z = 0; z < 5; ++z) {
+		for (int x = 0; x < 7; ++x) {
+			InstanceDataGPU instance;
+			const glm::vec3 p(-90.0f + 30.0f * x, 0.0f, 10.0f - 30.0f * z);
+			instance.model = glm::rotate(glm::translate(glm::mat4(1.0f), p), yawDist(rng), glm::vec3(0.0f, 1.0f, 0.0f));
+			instance.sphere = glm::vec4(p + glm::vec3(0.0f, 4.5f, 0.0f), 8.0f);
+			if (instances.size() % 4 != 3) visible.push_back((uint32_t)instances.size());
+			instances.push_back(instance);
+		}
+	}
+	const uint32_t numVisible = (uint32_t)visible.size() - 1;
+	visible[0] = numVisible;
+
+	const glm::vec3 eye(0.0f, 18.0f, 45.0f);
+	const glm::mat4 viewMat = glm::lookAt(eye, glm::vec3(0.0f, 0.0f, -40.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	const float nearD = 0.5f, farD = 300.0f;
+	const glm::mat4 projMat = reversedZ
+		? glm::perspectiveRH_ZO(glm::radians(60.0f), (float)w / (float)h, farD, nearD)
+		: glm::perspective(glm::radians(60.0f), (float)w / (float)h, nearD, farD);
+	FrameBlockGPU frame = {};
+	frame.cullVP = projMat * viewMat;
+	frame.cullViewMat = viewMat;
+	frame.lightDirWorld = glm::vec4(0.3f, 1.0f, 0.2f, 0.0f);
+	frame.depthFlags = glm::ivec4(reversedZ ? 1 : 0, 0, 0, 0);
+	ViewBlockGPU view = {};
+	view.viewMat = viewMat;
+	view.projMat = projMat;
+	view.invProjMat = glm::inverse(projMat);
+	view.cameraPosWorld = glm::vec4(eye, 1.0f);
+	MaterialBlockGPU materials = {};
+	materials.materials[0].flags = glm::ivec4(5, 4, 0, 0); // pure color, instance process
+	materials.materials[1].flags = glm::ivec4(5, 8, 0, 0); // pure color, cluster process
+	CullBlockGPU cull = {};
+	extractFrustumPlanes(frame.cullVP, cull.frustumPlanes, reversedZ);
+	cull.cullInfo = glm::uvec4(0u, 0u, softwareOcclusion ? 1u : 0u, 0u);
+
+	// software occlusion buffer: a wall at view depth 45 over the left half, empty on the right
+	const glm::vec4 wallClip = projMat * glm::vec4(0.0f, 0.0f, -45.0f, 1.0f);
+	const float wallDepth = reversedZ ? wallClip.z / wallClip.w : wallClip.z / wallClip.w * 0.5f + 0.5f;
+	const float empty = reversedZ ? 0.0f : 1.0f;
+	auto nearer = [&](const float a, const float b) { return reversedZ ? std::max(a, b) : std::min(a, b); };
+	auto farther = [&](const float a, const float b) { return reversedZ ? std::min(a, b) : std::max(a, b); };
+	const int OCC_W = 64, OCC_H = 32;
+	const int occLevels = numMipLevel(OCC_W, OCC_H);
+	GLuint occlusionTex = 0;
+	glCreateTextures(GL_TEXTURE_2D, 1, &occlusionTex);
+	glTextureStorage2D(occlusionTex, occLevels, GL_R32F, OCC_W, OCC_H);
+	glTextureParameteri(occlusionTex, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTextureParameteri(occlusionTex, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	std::vector<float> occLevel((size_t)OCC_W * OCC_H);
+	for (int y = 0; y < OCC_H; ++y) {
+		for (int x = 0; x < OCC_W; ++x) occLevel[(size_t)y * OCC_W + x] = (x < OCC_W / 2) ? wallDepth : empty;
+	}
+	for (int level = 0, lw = OCC_W, lh = OCC_H; level < occLevels; ++level) {
+		glTextureSubImage2D(occlusionTex, level, 0, 0, lw, lh, GL_RED, GL_FLOAT, occLevel.data());
+		const int nw = std::max(lw / 2, 1), nh = std::max(lh / 2, 1);
+		std::vector<float> down((size_t)nw * nh);
+		for (int y = 0; y < nh; ++y) {
+			for (int x = 0; x < nw; ++x) {
+				const int x1 = std::min(x * 2 + 1, lw - 1), y1 = std::min(y * 2 + 1, lh - 1);
+				down[(size_t)y * nw + x] = farther(farther(occLevel[(size_t)y * 2 * lw + x * 2], occLevel[(size_t)y * 2 * lw + x1]),
+					farther(occLevel[(size_t)y1 * lw + x * 2], occLevel[(size_t)y1 * lw + x1]));
+			}
+		}
+		occLevel.swap(down);
+		lw = nw;
+		lh = nh;
+	}
+
+	ClusterDrawGPU clusterDraw = {};
+	clusterDraw.instanceCount = 1;
+	clusterDraw.dispatch = glm::uvec4(0u);
+	clusterDraw.stats = glm::uvec4(7u); // stale counters of an earlier frame
+	const size_t maxClusterIndices = instances.size() * (size_t)numIndex;
+	const uint32_t drawCmd[5] = { (uint32_t)numIndex, numVisible, 0u, 0u, 0u };
+
+	GLuint buffers[12];
+	glCreateBuffers(12, buffers);
+	const GLuint vbo = buffers[0], ebo = buffers[1], instanceBuffer = buffers[2], visibleBuffer = buffers[3];
+	const GLuint clusterBuffer = buffers[4], clusterDrawBuffer = buffers[5], clusterIndexBuffer = buffers[6], drawBuffer = buffers[7];
+	const GLuint frameUBO = buffers[8], viewUBO = buffers[9], materialUBO = buffers[10], cullUBO = buffers[11];
+	glNamedBufferData(vbo, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+	glNamedBufferData(ebo, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+	glNamedBufferData(instanceBuffer, instances.size() * sizeof(InstanceDataGPU), instances.data(), GL_STATIC_DRAW);
+	glNamedBufferData(visibleBuffer, visible.size() * sizeof(uint32_t), visible.data(), GL_STATIC_DRAW);
+	glNamedBufferData(clusterBuffer, clusterData.size() * sizeof(ClusterDataGPU), clusterData.data(), GL_STATIC_DRAW);
+	glNamedBufferData(clusterDrawBuffer, sizeof(ClusterDrawGPU), &clusterDraw, GL_DYNAMIC_DRAW);
+	glNamedBufferData(clusterIndexBuffer, maxClusterIndices * sizeof(uint32_t), nullptr, GL_DYNAMIC_DRAW);
+	glNamedBufferData(drawBuffer, sizeof(drawCmd), drawCmd, GL_STATIC_DRAW);
+	glNamedBufferData(frameUBO, sizeof(frame), &frame, GL_STATIC_DRAW);
+	glNamedBufferData(viewUBO, sizeof(view), &view, GL_STATIC_DRAW);
+	glNamedBufferData(materialUBO, sizeof(materials), &materials, GL_STATIC_DRAW);
+	glNamedBufferData(cullUBO, sizeof(cull), &cull, GL_STATIC_DRAW);
+
+	GLuint vaos[2];
+	glCreateVertexArrays(2, vaos);
+	glVertexArrayVertexBuffer(vaos[0], 0, vbo, 0, INTERLEAVED_VERTEX_FLOATS * sizeof(float));
+	glVertexArrayElementBuffer(vaos[0], ebo);
+	const GLuint ATTRIB_OFFSET[4] = { 0, 3, 6, 9 }, ATTRIB_SIZE[4] = { 3, 3, 3, 2 };
+	for (GLuint a = 0; a < 4; ++a) {
+		glEnableVertexArrayAttrib(vaos[0], a);
+		glVertexArrayAttribFormat(vaos[0], a, ATTRIB_SIZE[a], GL_FLOAT, GL_FALSE, ATTRIB_OFFSET[a] * sizeof(float));
+		glVertexArrayAttribBinding(vaos[0], a, 0);
+	}
+	// as SceneRenderer's clusterVAO: no attributes, the compacted indices as element buffer
+	glVertexArrayElementBuffer(vaos[1], clusterIndexBuffer);
+
+	glBindBufferBase(GL_UNIFORM_BUFFER, UBO_FRAME_BINDING, frameUBO);
+	glBindBufferBase(GL_UNIFORM_BUFFER, UBO_VIEW_BINDING, viewUBO);
+	glBindBufferBase(GL_UNIFORM_BUFFER, UBO_MATERIAL_BINDING, materialUBO);
+	glBindBufferBase(GL_UNIFORM_BUFFER, UBO_CULL_BINDING, cullUBO);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, instanceBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, visibleBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, clusterDrawBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 10, clusterBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 11, ebo);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 12, clusterIndexBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 13, vbo);
+	glBindTextureUnit(9, occlusionTex);
+
+	programs.args->useProgram();
+	glDispatchCompute(1, 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+	programs.cull->useProgram();
+	glUniform1ui(0, (GLuint)clusters.size());
+	glUniform1ui(1, (GLuint)vertexBits);
+	glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, clusterDrawBuffer);
+	glDispatchComputeIndirect((GLintptr)offsetof(ClusterDrawGPU, dispatch));
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+	glGetNamedBufferSubData(clusterDrawBuffer, 0, sizeof(ClusterDrawGPU), &clusterDraw);
+	check(clusterDraw.dispatch == glm::uvec4(numVisible, 1u, 1u, 0u), "%s: dispatch %u x %u x %u", label, clusterDraw.dispatch.x, clusterDraw.dispatch.y, clusterDraw.dispatch.z);
+	check(clusterDraw.instanceCount == 1u && clusterDraw.firstIndex == 0u && clusterDraw.baseVertex == 0u, "%s: draw command was modified", label);
+	const glm::uvec4 stats = clusterDraw.stats;
+	check(stats.x + stats.y + stats.z + stats.w == numVisible * (uint32_t)clusters.size(), "%s: stats count %u clusters, %u expected", label,
+		stats.x + stats.y + stats.z + stats.w, numVisible * (uint32_t)clusters.size());
+	check(stats.y > 0u && stats.z > 0u && (stats.w > 0u) == softwareOcclusion, "%s: degenerate scene (%u frustum, %u backface, %u occluded)", label, stats.y, stats.z, stats.w);
+	const uint32_t count = clusterDraw.count;
+	check(count % 3u == 0u && count > 0u && count < numVisible * (uint32_t)numIndex, "%s: %u indices of %u", label, count, numVisible * (uint32_t)numIndex);
+	std::printf("  %u of %u triangles, clusters %u visible / %u frustum / %u backface / %u occluded\n",
+		count / 3u, numVisible * (uint32_t)numIndex / 3u, stats.x, stats.y, stats.z, stats.w);
+	std::vector<uint32_t> compacted(count);
+	glGetNamedBufferSubData(clusterIndexBuffer, 0, (GLsizeiptr)(count * sizeof(uint32_t)), compacted.data());
+	std::vector<bool> isVisible(instances.size(), false);
+	for (uint32_t i = 1; i <= numVisible; ++i) isVisible[visible[i]] = true;
+	int numBadIndex = 0;
+	for (const uint32_t index : compacted) {
+		const uint32_t instance = index >> vertexBits, vertex = index & ((1u << vertexBits) - 1u);
+		if (instance >= instances.size() || !isVisible[instance] || vertex >= (uint32_t)numVertex) numBadIndex++;
+	}
+	check(numBadIndex == 0, "%s: %d compacted indices outside the visible instances", label, numBadIndex);
+
+	// whole instances vs. surviving clusters, both with back-face culling
+	GLuint targets[3], fbo = 0;
+	glCreateTextures(GL_TEXTURE_2D, 3, targets);
+	glTextureStorage2D(targets[0], 1, GL_RGBA32F, w, h);
+	glTextureStorage2D(targets[1], 1, GL_RGBA32F, w, h);
+	glTextureStorage2D(targets[2], 1, GL_DEPTH_COMPONENT32F, w, h);
+	glCreateFramebuffers(1, &fbo);
+	glNamedFramebufferTexture(fbo, GL_COLOR_ATTACHMENT0, targets[0], 0);
+	glNamedFramebufferTexture(fbo, GL_COLOR_ATTACHMENT1, targets[1], 0);
+	glNamedFramebufferTexture(fbo, GL_DEPTH_ATTACHMENT, targets[2], 0);
+	const GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glNamedFramebufferDrawBuffers(fbo, 2, drawBuffers);
+	check(glCheckNamedFramebufferStatus(fbo, GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE, "%s: incomplete framebuffer", label);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glClipControl(GL_LOWER_LEFT, reversedZ ? GL_ZERO_TO_ONE : GL_NEGATIVE_ONE_TO_ONE);
+	glViewport(0, 0, w, h);
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(reversedZ ? GL_GREATER : GL_LESS);
+	glEnable(GL_CULL_FACE);
+	programs.gbuffer->useProgram();
+	struct Image {
+		std::vector<glm::vec4> position, normal;
+		std::vector<float> depth;
+	};
+	auto render = [&](const bool clustered) {
+		const float clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		glClearNamedFramebufferfv(fbo, GL_COLOR, 0, clearColor);
+		glClearNamedFramebufferfv(fbo, GL_COLOR, 1, clearColor);
+		glClearNamedFramebufferfv(fbo, GL_DEPTH, 0, &empty);
+		glBindVertexArray(vaos[clustered ? 1 : 0]);
+		glUniform1i(10, clustered ? 1 : 0); // materialIndex
+		glUniform1i(12, vertexBits);        // clusterVertexBits
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, clustered ? clusterDrawBuffer : drawBuffer);
+		glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr);
+		Image image;
+		image.position.resize((size_t)w * h);
+		image.normal.resize((size_t)w * h);
+		image.depth.resize((size_t)w * h);
+		glGetTextureImage(targets[0], 0, GL_RGBA, GL_FLOAT, (GLsizei)(image.position.size() * sizeof(glm::vec4)), image.position.data());
+		glGetTextureImage(targets[1], 0, GL_RGBA, GL_FLOAT, (GLsizei)(image.normal.size() * sizeof(glm::vec4)), image.normal.data());
+		glGetTextureImage(targets[2], 0, GL_DEPTH_COMPONENT, GL_FLOAT, (GLsizei)(image.depth.size() * sizeof(float)), image.depth.data());
+		return image;
+	};
+	const Image ref = render(false);
+	const Image result = render(true);
+	glDisable(GL_CULL_FACE);
+	glBindVertexArray(0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	int numCovered = 0, numDepthDiff = 0, numSurfaceDiff = 0;
+	for (int y = 0; y < h; ++y) {
+		for (int x = 0; x < w; ++x) {
+			const size_t p = (size_t)y * w + x;
+			const bool walled = softwareOcclusion && x < w / 2;
+			const float refDepth = walled ? nearer(ref.depth[p], wallDepth) : ref.depth[p];
+			const float depth = walled ? nearer(result.depth[p], wallDepth) : result.depth[p];
+			if (ref.depth[p] != empty) numCovered++;
+			if (refDepth != depth) numDepthDiff++;
+			// same surface where it isn't behind the wall
+			if (refDepth == depth && depth != empty && !(walled && depth == wallDepth) &&
+				(glm::any(glm::greaterThan(glm::abs(glm::vec3(ref.position[p]) - glm::vec3(result.position[p])), glm::vec3(1.0e-3f))) ||
+				 glm::any(glm::greaterThan(glm::abs(glm::vec3(ref.normal[p]) - glm::vec3(result.normal[p])), glm::vec3(1.0e-4f))))) {
+				numSurfaceDiff++;
+			}
+		}
+	}
+	check(numCovered > w * h / 10 && numCovered < w * h, "%s: degenerate scene (%d pixels covered)", label, numCovered);
+	check(numDepthDiff == 0, "%s: %d pixels with a different depth than the whole instances", label, numDepthDiff);
+	check(numSurfaceDiff == 0, "%s: %d pixels with a different position / normal", label, numSurfaceDiff);
+
+	glDeleteFramebuffers(1, &fbo);
+	glDeleteTextures(3, targets);
+	glDeleteTextures(1, &occlusionTex);
+	glDeleteVertexArrays(2, vaos);
+	glDeleteBuffers(12, buffers);
+}
+
+int main(int, char**) {
+	if (!createSurfacelessContext()) {
+		std::printf("no EGL surfaceless OpenGL 4.5 context, skipping\n");
+		return 77;
+	}
+	std::printf("GL_RENDERER: %s\n", (const char*)glGetString(GL_RENDERER));
+
+	ShaderProgram* hzbProgram = loadComputeProgram("shaders/hzbBuild.comp");
+	ShaderProgram* cullProgram = loadComputeProgram("shaders/cullInstances.comp");
+	DepthSortPrograms depthSort = { loadComputeProgram("shaders/depthBinScan.comp"), loadComputeProgram("shaders/depthBinScatter.comp") };
+	if (!check(hzbProgram != nullptr && cullProgram != nullptr && depthSort.scan != nullptr && depthSort.scatter != nullptr, "shader programs failed to build")) {
+		return 1;
+	}
+
+	// power of two, odd, non-power-of-two and 1-texel-wide viewports
+	const int SIZES[][2] = { { 64, 64 }, { 63, 37 }, { 1, 7 }, { 100, 1 }, { 129, 65 }, { 13, 11 }, { 960, 540 }, { 961, 541 } };
+	GLuint hzbCounterBuffer = 0;
+	glCreateBuffers(1, &hzbCounterBuffer);
+	const uint32_t zero = 0u;
+	glNamedBufferStorage(hzbCounterBuffer, sizeof(uint32_t), &zero, GL_DYNAMIC_STORAGE_BIT);
+	for (const auto& size : SIZES) {
+		testHzbBuild(hzbProgram, hzbCounterBuffer, size[0], size[1], 0, 0);
+		testHzbBuild(hzbProgram, hzbCounterBuffer, size[0], size[1], 7, 3);
+	}
+	// more levels than image units (tail dispatch), with one of them a single group
+	testHzbBuild(hzbProgram, hzbCounterBuffer, 300, 2, 0, 0);
+	testHzbBuild(hzbProgram, hzbCounterBuffer, 5000, 3, 1, 0);
+	testHzbBuild(hzbProgram, hzbCounterBuffer, 129, 65, 0, 0, true);
+	testHzbBuild(hzbProgram, hzbCounterBuffer, 961, 541, 7, 3, true);
+	glDeleteBuffers(1, &hzbCounterBuffer);
+
+	{ CullTestOptions o(5000, 317, 181); testCullInstances(cullProgram, o); }
+	{ CullTestOptions o(5000, 317, 181); o.useOcclusion = true; testCullInstances(cullProgram, o); }
+	{ CullTestOptions o(4097, 317, 181); o.useOcclusion = true; o.fixedLevel = 3; testCullInstances(cullProgram, o); }
+	{ CullTestOptions o(777, 960, 541); o.useOcclusion = true; o.fixedLevel = 5; testCullInstances(cullProgram, o); }
+	{ CullTestOptions o(256, 64, 64); o.useOcclusion = true; o.fixedLevel = 6; testCullInstances(cullProgram, o); }
+	{ CullTestOptions o(5000, 317, 181); o.useOcclusion = true; o.maxGroupX = 3; testCullInstances(cullProgram, o); }
+	{ CullTestOptions o(5000, 317, 181); o.depthSort = &depthSort; testCullInstances(cullProgram, o); }
+	{ CullTestOptions o(5000, 317, 181); o.useOcclusion = true; o.maxGroupX = 3; o.depthSort = &depthSort; testCullInstances(cullProgram, o); }
+	{ CullTestOptions o(5000, 317, 181); o.reversedZ = true; testCullInstances(cullProgram, o); }
+	{ CullTestOptions o(5000, 317, 181); o.useOcclusion = true; o.reversedZ = true; testCullInstances(cullProgram, o); }
+	{ CullTestOptions o(777, 960, 541); o.useOcclusion = true; o.fixedLevel = 5; o.reversedZ = true; testCullInstances(cullProgram, o); }
+	{ CullTestOptions o(5000, 317, 181); o.useOcclusion = true; o.pvsRanges = true; testCullInstances(cullProgram, o); }
+	{ CullTestOptions o(5000, 317, 181); o.useOcclusion = true; o.maxGroupX = 3; o.depthSort = &depthSort; o.reversedZ = true; o.pvsRanges = true; testCullInstances(cullProgram, o); }
+	{ CullTestOptions o(5000, 317, 181); o.useOcclusion = true; o.impostorDistance = 150.0f; testCullInstances(cullProgram, o); }
+	{ CullTestOptions o(5000, 317, 181); o.useOcclusion = true; o.maxGroupX = 3; o.depthSort = &depthSort; o.reversedZ = true; o.pvsRanges = true; o.impostorDistance = 150.0f; testCullInstances(cullProgram, o); }
+	testPvsClusters();
+
+	FoliagePrograms foliage = {
+		loadRenderProgram("shaders/oglVertexShader.glsl", "shaders/oglFragmentShader.glsl", "#define OVERDRAW_COUNT\n"),
+		loadRenderProgram("shaders/foliageDepthVertex.glsl", "shaders/foliageDepthFragment.glsl"),
+		loadRenderProgram("shaders/oglVertexShader.glsl", "shaders/foliageGBufferFragment.glsl", "#define OVERDRAW_COUNT\n")
+	};
+	if (check(foliage.gbuffer != nullptr && foliage.depth != nullptr && foliage.equal != nullptr, "foliage programs failed to build")) {
+		testFoliagePrepass(foliage, 60, 320, 240);
+		testFoliagePrepass(foliage, 200, 257, 129);
+	}
+	ShaderProgram* overlayProgram = loadRenderProgram("shaders/cullOverlayVertex.glsl", "shaders/cullOverlayFragment.glsl");
+	if (check(overlayProgram != nullptr, "cull overlay program failed to build")) {
+		testCullOverlay(overlayProgram, (1u << CULL_REASON_COUNT) - 1u, false);
+		testCullOverlay(overlayProgram, ((1u << CULL_REASON_COUNT) - 1u) & ~(1u << CULL_OCCLUSION), true);
+		testCullOverlay(overlayProgram, 1u << CULL_FRUSTUM, false);
+	}
+	ShaderProgram* shadowFitProgram = loadComputeProgram("shaders/shadowCascadeFit.comp");
+	if (check(shadowFitProgram != nullptr, "shadow cascade fit program failed to build")) {
+		testShadowCascadeFit(shadowFitProgram, 3, false);
+		testShadowCascadeFit(shadowFitProgram, 4, false);
+		testShadowCascadeFit(shadowFitProgram, 1, true);
+		testShadowCascadeFit(shadowFitProgram, 3, true);
+	}
+	delete shadowFitProgram;
+	ShaderProgram* shadowDepthProgram = loadRenderProgram("shaders/shadowDepthVertex.glsl", "shaders/shadowDepthFragment.glsl");
+	if (check(shadowDepthProgram != nullptr, "shadow depth program failed to build")) {
+		testShadowCasterCache(shadowDepthProgram, false);
+		testShadowCasterCache(shadowDepthProgram, true);
+		testSoftwareOcclusion(shadowDepthProgram, cullProgram, false);
+		testSoftwareOcclusion(shadowDepthProgram, cullProgram, true);
+		testOccluderProxy(shadowDepthProgram, false);
+		testOccluderProxy(shadowDepthProgram, true);
+	}
+	ShaderProgram* impostorProgram = loadRenderProgram("shaders/impostorVertex.glsl", "shaders/impostorFragment.glsl");
+	if (check(shadowDepthProgram != nullptr && impostorProgram != nullptr, "impostor program failed to build")) {
+		testImpostors(impostorProgram, shadowDepthProgram, false);
+		testImpostors(impostorProgram, shadowDepthProgram, true);
+	}
+	testMeshClusters();
+	// the normal G-buffer program has no overdraw side effects (they would disable early depth tests)
+	ShaderProgram* gbufferProgram = loadRenderProgram("shaders/oglVertexShader.glsl", "shaders/oglFragmentShader.glsl");
+	if (check(gbufferProgram != nullptr, "G-buffer program failed to build")) {
+		const GLuint id = gbufferProgram->programId();
+		check(glGetUniformLocation(id, "overdrawSlot") == -1 && glGetProgramResourceIndex(id, GL_SHADER_STORAGE_BLOCK, "OverdrawStats") == GL_INVALID_INDEX,
+			"G-buffer program without OVERDRAW_COUNT still counts overdraw");
+	}
+	ClusterPrograms clusterPrograms = { gbufferProgram, loadComputeProgram("shaders/clusterCullArgs.comp"), loadComputeProgram("shaders/clusterCull.comp") };
+	if (check(clusterPrograms.gbuffer != nullptr && clusterPrograms.args != nullptr && clusterPrograms.cull != nullptr, "cluster cull programs failed to build")) {
+		testClusterCulling(clusterPrograms, false, false);
+		testClusterCulling(clusterPrograms, true, false);
+		testClusterCulling(clusterPrograms, false, true);
+		testClusterCulling(clusterPrograms, true, true);
+	}
+	delete clusterPrograms.args;
+	delete clusterPrograms.cull;
+	delete gbufferProgram;
+	delete impostorProgram;
+	delete shadowDepthProgram;
+	ShaderProgram* momentBlurProgram = loadComputeProgram("shaders/shadowMomentBlur.comp");
+	if (check(momentBlurProgram != nullptr, "shadow moment blur program failed to build")) {
+		testShadowMomentBlur(momentBlurProgram, 64, 2, 2, false);
+		testShadowMomentBlur(momentBlurProgram, 76, 2, 2, true);
+		testShadowMomentBlur(momentBlurProgram, 60, 1, 4, false);
+	}
+	delete momentBlurProgram;
+	delete overlayProgram;
+	delete foliage.gbuffer;
+	delete foliage.depth;
+	delete foliage.equal;
+
+	delete hzbProgram;
+	delete cullProgram;
+	delete depthSort.scan;
+	delete depthSort.scatter;
+
+	std::printf("%d checks, %d failures\n", g_numCheck, g_numFailure);
+	return (g_numFailure == 0) ? 0 : 1;
+}
@@ -0,0 +1,172 @@
+// CG2025_impostorbake: bakes the octahedral impostor atlas (ImpostorAtlas.h) of an instance batch's mesh
+// on a headless EGL surfaceless context (Mesa llvmpipe is fine). The renderer bakes the same atlas at
+// load when a batch has no file; a baked file skips that.
+// Usage: CG2025_impostorbake <out.imp> [options]
+//   --batch <name>         mesh and texture of this batch (default scene, or --scene)
+//   --scene <file>
+//   --obj <file>           mesh instead of a batch
+//   --texture <file>       albedo (alpha-tested at 0.5) for --obj
+//   --frames N             N x N views over the upper hemisphere (default 8)
+//   --frame-size S         pixels per view (default 128)
+// Run from the project root (shaders/ is loaded relative to it).
+// Load the result with a scene line: impostor <batch> <distance> <out.imp>
+#define STB_IMAGE_IMPLEMENTATION
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stb_image.h>
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+#include "ImpostorBaker.h"
+#include "MeshImport.h"
+#include "SceneDescription.h"
+
+struct BakeOptions {
+	std::string outputPath;
+	std::string scenePath;
+	std::string batchName;
+	std::string objPath;
+	std::string texPath;
+	int frames = 8;
+	int frameSize = 128;
+};
+
+static bool parseArgs(int argc, char** argv, BakeOptions& opt) {
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+		const bool hasValue = (i + 1 < argc);
+		if (arg == "--scene" && hasValue) { opt.scenePath = argv[++i]; }
+		else if (arg == "--batch" && hasValue) { opt.batchName = argv[++i]; }
+		else if (arg == "--obj" && hasValue) { opt.objPath = argv[++i]; }
+		else if (arg == "--texture" && hasValue) { opt.texPath = argv[++i]; }
+		else if (arg == "--frames" && hasValue) { opt.frames = std::atoi(argv[++i]); }
+		else if (arg == "--frame-size" && hasValue) { opt.frameSize = std::atoi(argv[++i]); }
+		else if (arg[0] != '-' && opt.outputPath.empty()) { opt.outputPath = arg; }
+		else { return false; }
+	}
+	return !opt.outputPath.empty() && (opt.batchName.empty() != opt.objPath.empty())
+		&& opt.frames >= 2 && opt.frames <= 64 && opt.frameSize >= 4 && opt.frameSize <= 1024;
+}
+
+static bool createSurfacelessContext() {
+	auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (getPlatformDisplay == nullptr) { return false; }
+	EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	EGLint major = 0, minor = 0;
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor) || !eglBindAPI(EGL_OPENGL_API)) { return false; }
+	const EGLint contextAttribs[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 4, EGL_CONTEXT_MINOR_VERSION, 5,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE
+	};
+	EGLContext context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttribs);
+	if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) { return false; }
+	return gladLoadGLLoader((GLADloadproc)eglGetProcAddress) != 0;
+}
+
+// same as SceneRenderer::loadTexture (flipped rows, mipmapped)
+static GLuint loadTexture(const std::string& path) {
+	int w = 0, h = 0, ch = 0;
+	stbi_set_flip_vertically_on_load(true);
+	unsigned char* data = stbi_load(path.c_str(), &w, &h, &ch, STBI_rgb_alpha);
+	if (!data || w <= 0 || h <= 0) {
+		return 0;
+	}
+	GLuint tex = 0;
+	glCreateTextures(GL_TEXTURE_2D, 1, &tex);
+	int levels = 1;
+	while ((std::max(w, h) >> levels) > 0) levels++;
+	glTextureStorage2D(tex, levels, GL_RGBA8, w, h);
+	glTextureSubImage2D(tex, 0, 0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, data);
+	glGenerateTextureMipmap(tex);
+	glTextureParameteri(tex, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTextureParameteri(tex, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(tex, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTextureParameteri(tex, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	stbi_image_free(data);
+	return tex;
+}
+
+int main(int argc, char** argv)
+{
+	BakeOptions opt;
+	if (!parseArgs(argc, argv, opt)) {
+		std::cerr << "usage: CG2025_impostorbake <out.imp> (--batch <name> [--scene <file>] | --obj <file> [--texture <file>])\n"
+			<< "         [--frames N] [--frame-size S]\n";
+		return 2;
+	}
+	if (!opt.batchName.empty()) {
+		SceneDescription scene = SceneDescription::defaultScene();
+		std::string error;
+		if (!opt.scenePath.empty() && !SceneDescription::fromFile(opt.scenePath, scene, error)) {
+			std::cerr << error << "\n";
+			return 1;
+		}
+		const InstanceBatchDesc* desc = nullptr;
+		for (const InstanceBatchDesc& other : scene.batches) {
+			if (other.name == opt.batchName) { desc = &other; }
+		}
+		if (desc == nullptr) {
+			std::cerr << "no batch " << opt.batchName << "\n";
+			return 1;
+		}
+		opt.objPath = desc->objPath;
+		opt.texPath = desc->texPath;
+	}
+	if (!createSurfacelessContext()) {
+		std::cerr << "no EGL surfaceless OpenGL 4.5 context\n";
+		return 1;
+	}
+
+	// same import as SceneRenderer::appendInstanceBatch
+	Assimp::Importer importer;
+	const aiScene* aiscene = importer.ReadFile(opt.objPath,
+		aiProcess_Triangulate |
+		aiProcess_JoinIdenticalVertices |
+		aiProcess_GenSmoothNormals |
+		aiProcess_CalcTangentSpace);
+	if (!aiscene || aiscene->mNumMeshes == 0) {
+		std::cerr << "cannot load " << opt.objPath << "\n";
+		return 1;
+	}
+	const aiMesh* mesh = aiscene->mMeshes[0];
+	const int numVertices = (int)mesh->mNumVertices;
+	const int numIndices = (int)mesh->mNumFaces * 3;
+	std::vector<float> vertices((size_t)numVertices * INTERLEAVED_VERTEX_FLOATS);
+	std::vector<unsigned int> indices((size_t)numIndices);
+	interleaveAiMesh(mesh, vertices.data(), indices.data());
+	GLuint texture = 0;
+	if (!opt.texPath.empty()) {
+		texture = loadTexture(opt.texPath);
+		if (texture == 0) {
+			std::cerr << "cannot load " << opt.texPath << "\n";
+			return 1;
+		}
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	ImpostorAtlas atlas;
+	if (!bakeImpostorAtlas(vertices.data(), numVertices, indices.data(), numIndices, texture, opt.frames, opt.frameSize, atlas)) {
+		std::cerr << "bake failed\n";
+		return 1;
+	}
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	size_t covered = 0;
+	for (size_t p = 3; p < atlas.albedo.size(); p += 4) {
+		if (atlas.albedo[p] >= 128) covered++;
+	}
+	if (!atlas.writeFile(opt.outputPath)) {
+		std::cerr << "cannot write " << opt.outputPath << "\n";
+		return 1;
+	}
+	std::cout << opt.outputPath << ": " << atlas.frames << "x" << atlas.frames << " frames of " << atlas.frameSize << " px, "
+		<< numIndices / 3 << " triangles, radius " << atlas.radius << ", "
+		<< (100.0 * (double)covered / (double)((size_t)atlas.size() * atlas.size())) << "% covered, " << seconds << " s\n";
+	return 0;
+}
@@ -0,0 +1,215 @@
+// CG2025_poisson: Poisson-disk placement of vegetation on a terrain height field, written as .ppd2.
+// Usage: CG2025_poisson <out.ppd2> --radius R [options]
+//   --terrain <mytd>      place points on this height field (y = MyTerrainData::height); flat y = 0 without it
+//   --chunk-size S        world size of the terrain maps, [-S, S] (default 512, as MyTerrain)
+//   --extent x0 z0 x1 z1  sampled area (default: the whole terrain tile)
+//   --density <image>     grayscale map over the terrain tile: keep probability per point (0..255)
+//   --max-slope DEG       drop points on steeper ground
+//   --min-height H / --max-height H
+//   --tilt DEG            random x/z tilt in [-DEG, DEG] on top of the random yaw
+//   --seed N  --threads N (0: all cores)  --serial (classic single-threaded Bridson)
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <glm/trigonometric.hpp>
+#include <glm/gtc/constants.hpp>
+#include "PoissonDiskSampler.h"
+#include "MyPoissonSample.h"
+#include "terrain/MyTerrainData.h"
+
+struct PlacementOptions {
+	std::string outputPath;
+	std::string terrainPath;
+	std::string densityPath;
+	float radius = 0.0f;
+	float chunkSize = 512.0f;
+	glm::vec2 minXZ = glm::vec2(0.0f);
+	glm::vec2 maxXZ = glm::vec2(0.0f);
+	bool hasExtent = false;
+	float maxSlopeDeg = 90.0f;
+	float minHeight = -FLT_MAX;
+	float maxHeight = FLT_MAX;
+	float tiltDeg = 0.0f;
+	unsigned int seed = 1;
+	int numThread = 0;
+	bool serial = false;
+};
+
+// per-point random numbers from (seed, index, stream): same result for any thread count
+static float hashUnit(const unsigned int seed, const uint64_t index, const unsigned int stream) {
+	uint64_t x = index * 0x9E3779B97F4A7C15ull + ((uint64_t)seed << 32) + stream;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+	x = x ^ (x >> 31);
+	return (float)(x >> 40) * (1.0f / 16777216.0f);
+}
+
+// runs fn(first, last) over [0, n) split across numThread threads
+template <typename Fn>
+static void parallelRange(const size_t n, const int numThread, const Fn& fn) {
+	const size_t numChunk = std::max<size_t>(1, std::min<size_t>((size_t)numThread, n / 4096 + 1));
+	std::vector<std::thread> threads;
+	for (size_t c = 1; c < numChunk; ++c) {
+		threads.emplace_back(fn, n * c / numChunk, n * (c + 1) / numChunk);
+	}
+	fn(0, n / numChunk);
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+}
+
+static bool parseArgs(int argc, char** argv, PlacementOptions& opt) {
+	if (argc < 2 || argv[1][0] == '-') { return false; }
+	opt.outputPath = argv[1];
+	for (int i = 2; i < argc; ++i) {
+		const std::string arg = argv[i];
+		const bool hasValue = (i + 1 < argc);
+		if (arg == "--radius" && hasValue) { opt.radius = (float)std::atof(argv[++i]); }
+		else if (arg == "--terrain" && hasValue) { opt.terrainPath = argv[++i]; }
+		else if (arg == "--chunk-size" && hasValue) { opt.chunkSize = (float)std::atof(argv[++i]); }
+		else if (arg == "--extent" && i + 4 < argc) {
+			opt.minXZ = glm::vec2((float)std::atof(argv[i + 1]), (float)std::atof(argv[i + 2]));
+			opt.maxXZ = glm::vec2((float)std::atof(argv[i + 3]), (float)std::atof(argv[i + 4]));
+			opt.hasExtent = true;
+			i += 4;
+		}
+		else if (arg == "--density" && hasValue) { opt.densityPath = argv[++i]; }
+		else if (arg == "--max-slope" && hasValue) { opt.maxSlopeDeg = (float)std::atof(argv[++i]); }
+		else if (arg == "--min-height" && hasValue) { opt.minHeight = (float)std::atof(argv[++i]); }
+		else if (arg == "--max-height" && hasValue) { opt.maxHeight = (float)std::atof(argv[++i]); }
+		else if (arg == "--tilt" && hasValue) { opt.tiltDeg = (float)std::atof(argv[++i]); }
+		else if (arg == "--seed" && hasValue) { opt.seed = (unsigned int)std::strtoul(argv[++i], nullptr, 10); }
+		else if (arg == "--threads" && hasValue) { opt.numThread = std::atoi(argv[++i]); }
+		else if (arg == "--serial") { opt.serial = true; }
+		else {
+			std::cerr << "unknown option: " << arg << "\n";
+			return false;
+		}
+	}
+	if (!opt.hasExtent) {
+		opt.minXZ = glm::vec2(-opt.chunkSize);
+		opt.maxXZ = glm::vec2(opt.chunkSize);
+	}
+	return opt.radius > 0.0f && opt.chunkSize > 0.0f && opt.maxXZ.x > opt.minXZ.x && opt.maxXZ.y > opt.minXZ.y;
+}
+
+int main(int argc, char** argv)
+{
+	PlacementOptions opt;
+	if (!parseArgs(argc, argv, opt)) {
+		std::cerr << "usage: CG2025_poisson <out.ppd2> --radius R [--terrain <mytd>] [--chunk-size S] [--extent x0 z0 x1 z1]\n"
+			<< "         [--density <image>] [--max-slope DEG] [--min-height H] [--max-height H] [--tilt DEG]\n"
+			<< "         [--seed N] [--threads N] [--serial]\n";
+		return 2;
+	}
+	if (opt.numThread <= 0) {
+		opt.numThread = std::max(1, (int)std::thread::hardware_concurrency());
+	}
+	using Clock = std::chrono::steady_clock;
+	auto seconds = [](const Clock::time_point& start) { return std::chrono::duration<double>(Clock::now() - start).count(); };
+
+	// terrain: only the elevation map is needed; without one the ground is flat
+	MyTerrainData* terrain = nullptr;
+	if (!opt.terrainPath.empty()) {
+		terrain = MyTerrainData::fromMYTD(opt.terrainPath);
+		if (terrain == nullptr) {
+			std::cerr << "cannot load terrain " << opt.terrainPath << "\n";
+			return 1;
+		}
+	}
+	else {
+		terrain = new MyTerrainData();
+	}
+	terrain->m_worldVtoElevationUVMat = MyTerrainData::worldVtoElevationUV(opt.chunkSize);
+	const bool hasHeight = (terrain->m_elevationMap != nullptr);
+	auto heightAt = [&](const float x, const float z) { return hasHeight ? terrain->height(x, z) : 0.0f; };
+
+	int densityW = 0, densityH = 0, densityChannel = 0;
+	unsigned char* density = nullptr;
+	if (!opt.densityPath.empty()) {
+		density = stbi_load(opt.densityPath.c_str(), &densityW, &densityH, &densityChannel, 1);
+		if (density == nullptr) {
+			std::cerr << "cannot load density map " << opt.densityPath << "\n";
+			return 1;
+		}
+	}
+
+	// 1. Poisson-disk points over the extent
+	auto start = Clock::now();
+	PoissonDiskSampler sampler(opt.radius, opt.minXZ, opt.maxXZ, opt.seed);
+	const std::vector<glm::vec2> points = opt.serial ? sampler.sampleSerial() : sampler.sampleTiled(opt.numThread);
+	std::cout << "poisson: " << points.size() << " points, radius " << opt.radius << ", " << sampler.gridWidth() << "x" << sampler.gridHeight()
+		<< " grid, " << (opt.serial ? 1 : opt.numThread) << " thread(s), " << seconds(start) << " s\n";
+
+	// 2. density, slope and height filters (thinning keeps the blue-noise spacing), random rotation
+	start = Clock::now();
+	const float tanMaxSlope = (opt.maxSlopeDeg >= 90.0f) ? FLT_MAX : std::tan(glm::radians(opt.maxSlopeDeg));
+	const float slopeStep = hasHeight ? 2.0f * opt.chunkSize / (float)(terrain->m_elevationMapWidth - 1) : 1.0f;
+	const float tilt = glm::radians(opt.tiltDeg);
+	std::vector<glm::vec3> positions(points.size());
+	std::vector<glm::vec3> rotations(points.size());
+	std::vector<unsigned char> keep(points.size(), 0);
+	parallelRange(points.size(), opt.numThread, [&](const size_t first, const size_t last) {
+		for (size_t i = first; i < last; ++i) {
+			const float x = points[i].x;
+			const float z = points[i].y;
+			if (density != nullptr) {
+				const glm::vec3 uv = terrain->worldVToHeightMapUV(x, z);
+				const int px = std::min(densityW - 1, (int)(uv.x * (float)densityW));
+				const int pz = std::min(densityH - 1, (int)(uv.z * (float)densityH));
+				if (hashUnit(opt.seed, i, 0) * 255.0f >= (float)density[pz * densityW + px]) { continue; }
+			}
+			const float y = heightAt(x, z);
+			if (y < opt.minHeight || y > opt.maxHeight) { continue; }
+			if (tanMaxSlope != FLT_MAX) {
+				const float dx = (heightAt(x + slopeStep, z) - heightAt(x - slopeStep, z)) / (2.0f * slopeStep);
+				const float dz = (heightAt(x, z + slopeStep) - heightAt(x, z - slopeStep)) / (2.0f * slopeStep);
+				if (dx * dx + dz * dz > tanMaxSlope * tanMaxSlope) { continue; }
+			}
+			positions[i] = glm::vec3(x, y, z);
+			rotations[i] = glm::vec3(
+				(hashUnit(opt.seed, i, 2) * 2.0f - 1.0f) * tilt,
+				hashUnit(opt.seed, i, 1) * glm::two_pi<float>(),
+				(hashUnit(opt.seed, i, 3) * 2.0f - 1.0f) * tilt);
+			keep[i] = 1;
+		}
+	});
+
+	MyPoissonSample sample;
+	sample.m_numSample = (int)std::count(keep.begin(), keep.end(), (unsigned char)1);
+	sample.m_positions = new float[(size_t)sample.m_numSample * 3];
+	sample.m_radians = new float[(size_t)sample.m_numSample * 3];
+	int idx = 0;
+	for (size_t i = 0; i < points.size(); ++i) {
+		if (keep[i] == 0) { continue; }
+		sample.setPosition(idx, positions[i].x, positions[i].y, positions[i].z);
+		sample.setRadians(idx, rotations[i].x, rotations[i].y, rotations[i].z);
+		idx++;
+	}
+	std::cout << "placement: " << sample.m_numSample << " kept, " << seconds(start) << " s\n";
+
+	std::ofstream output(opt.outputPath, std::ios::binary);
+	if (!output.is_open()) {
+		std::cerr << "cannot write " << opt.outputPath << "\n";
+		return 1;
+	}
+	sample.exportBinaryFile(output);
+	std::cout << "wrote " << opt.outputPath << "\n";
+
+	stbi_image_free(density);
+	delete[] terrain->m_elevationMap;
+	delete[] terrain->m_normalMap;
+	delete[] terrain->m_albedoMap;
+	delete terrain;
+	return output.good() ? 0 : 1;
+}
@@ -0,0 +1,283 @@
+// CG2025_pvsbake: bakes a potentially visible set (PotentiallyVisibleSet.h) of a scene's instance clusters
+// by ray casting the terrain height field from sample eyes in every view cell.
+// Usage: CG2025_pvsbake <out.pvs> [options]
+//   --scene <file>         scene to bake (default: the outdoor scene)
+//   --batch <name>         bake this batch (repeatable); default: every batch of at most --max-instances
+//   --max-instances N      default 100000 (skips the grass)
+//   --cell-size S          view cell size (default 32)
+//   --cluster-size S       instance cluster size (default 32)
+//   --max-distance D       clusters farther than D from the whole view cell are not visible (default 600: the
+//                          renderer needs the corner of its cull frustum inside it, 400 view depth at 45 deg fov)
+//   --eye-offset H         lowest eye above the ground (default 5, MyCameraManager's minimum)
+//   --eye-range H          eyes are baked from eye-offset to eye-offset + H above the ground (default 10)
+//   --samples N            N x N eye positions per view cell, at the lowest and highest eye (default 4)
+//   --margin M             the terrain only blocks a ray where it is M above it (default 0.5)
+//   --extent x0 z0 x1 z1   walkable area (default: the terrain tile)
+//   --threads N            (0: all cores)
+// Load the result with: CG2025 --pvs <out.pvs> (same scene)
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <glm/glm.hpp>
+#include "InstanceData.h"
+#include "MyPoissonSample.h"
+#include "PotentiallyVisibleSet.h"
+#include "SceneDescription.h"
+#include "terrain/MyTerrainData.h"
+
+struct BakeOptions {
+	std::string outputPath;
+	std::string scenePath;
+	std::vector<std::string> batchNames;
+	int maxInstances = 100000;
+	float cellSize = 32.0f;
+	float clusterSize = 32.0f;
+	float maxDistance = 600.0f;
+	float eyeOffset = 5.0f;
+	float eyeRange = 10.0f;
+	int numSample = 4;
+	float margin = 0.5f;
+	glm::vec2 minXZ = glm::vec2(0.0f);
+	glm::vec2 maxXZ = glm::vec2(0.0f);
+	bool hasExtent = false;
+	int numThread = 0;
+};
+
+// world bounds of a cluster's instance spheres and the points rays are cast to: a 3x3 grid on top of
+// the bounds and the top of up to 8 instance spheres
+struct ClusterTargets {
+	glm::vec3 boundsMin = glm::vec3(FLT_MAX);
+	glm::vec3 boundsMax = glm::vec3(-FLT_MAX);
+	std::vector<glm::vec3> points;
+};
+
+static bool parseArgs(int argc, char** argv, BakeOptions& opt) {
+	if (argc < 2 || argv[1][0] == '-') { return false; }
+	opt.outputPath = argv[1];
+	for (int i = 2; i < argc; ++i) {
+		const std::string arg = argv[i];
+		const bool hasValue = (i + 1 < argc);
+		if (arg == "--scene" && hasValue) { opt.scenePath = argv[++i]; }
+		else if (arg == "--batch" && hasValue) { opt.batchNames.push_back(argv[++i]); }
+		else if (arg == "--max-instances" && hasValue) { opt.maxInstances = std::atoi(argv[++i]); }
+		else if (arg == "--cell-size" && hasValue) { opt.cellSize = (float)std::atof(argv[++i]); }
+		else if (arg == "--cluster-size" && hasValue) { opt.clusterSize = (float)std::atof(argv[++i]); }
+		else if (arg == "--max-distance" && hasValue) { opt.maxDistance = (float)std::atof(argv[++i]); }
+		else if (arg == "--eye-offset" && hasValue) { opt.eyeOffset = (float)std::atof(argv[++i]); }
+		else if (arg == "--eye-range" && hasValue) { opt.eyeRange = std::max(0.0f, (float)std::atof(argv[++i])); }
+		else if (arg == "--samples" && hasValue) { opt.numSample = std::max(2, std::atoi(argv[++i])); }
+		else if (arg == "--margin" && hasValue) { opt.margin = (float)std::atof(argv[++i]); }
+		else if (arg == "--extent" && i + 4 < argc) {
+			opt.minXZ = glm::vec2((float)std::atof(argv[i + 1]), (float)std::atof(argv[i + 2]));
+			opt.maxXZ = glm::vec2((float)std::atof(argv[i + 3]), (float)std::atof(argv[i + 4]));
+			opt.hasExtent = true;
+			i += 4;
+		}
+		else if (arg == "--threads" && hasValue) { opt.numThread = std::atoi(argv[++i]); }
+		else {
+			std::cerr << "unknown option: " << arg << "\n";
+			return false;
+		}
+	}
+	return opt.cellSize > 0.0f && opt.clusterSize > 0.0f && opt.maxDistance > 0.0f;
+}
+
+// squared distance between two boxes
+static float boxDistance2(const glm::vec3& aMin, const glm::vec3& aMax, const glm::vec3& bMin, const glm::vec3& bMax) {
+	const glm::vec3 gap = glm::max(glm::max(aMin - bMax, bMin - aMax), glm::vec3(0.0f));
+	return glm::dot(gap, gap);
+}
+
+int main(int argc, char** argv)
+{
+	BakeOptions opt;
+	if (!parseArgs(argc, argv, opt)) {
+		std::cerr << "usage: CG2025_pvsbake <out.pvs> [--scene <file>] [--batch <name>]... [--max-instances N] [--cell-size S]\n"
+			<< "         [--cluster-size S] [--max-distance D] [--eye-offset H] [--eye-range H] [--samples N] [--margin M]\n"
+			<< "         [--extent x0 z0 x1 z1] [--threads N]\n";
+		return 2;
+	}
+	if (opt.numThread <= 0) {
+		opt.numThread = std::max(1, (int)std::thread::hardware_concurrency());
+	}
+	using Clock = std::chrono::steady_clock;
+	auto seconds = [](const Clock::time_point& start) { return std::chrono::duration<double>(Clock::now() - start).count(); };
+
+	SceneDescription scene = SceneDescription::defaultScene();
+	std::string error;
+	if (!opt.scenePath.empty() && !SceneDescription::fromFile(opt.scenePath, scene, error)) {
+		std::cerr << error << "\n";
+		return 1;
+	}
+	MyTerrainData* terrain = MyTerrainData::fromMYTD(scene.elevationPath);
+	if (terrain == nullptr) {
+		std::cerr << "cannot load terrain " << scene.elevationPath << "\n";
+		return 1;
+	}
+	terrain->m_worldVtoElevationUVMat = MyTerrainData::worldVtoElevationUV(scene.chunkSize);
+	if (!opt.hasExtent) {
+		opt.minXZ = glm::vec2(-scene.chunkSize);
+		opt.maxXZ = glm::vec2(scene.chunkSize);
+	}
+
+	// 1. clusters of the baked batches, in the order the renderer sorts them
+	auto start = Clock::now();
+	PotentiallyVisibleSet pvs;
+	pvs.clusterSize = opt.clusterSize;
+	pvs.viewCellSize = opt.cellSize;
+	pvs.maxDistance = opt.maxDistance;
+	pvs.eyeOffset = opt.eyeOffset;
+	pvs.eyeRange = opt.eyeRange;
+	pvs.origin = opt.minXZ;
+	pvs.cellsX = std::max(1, (int)std::ceil((opt.maxXZ.x - opt.minXZ.x) / opt.cellSize));
+	pvs.cellsZ = std::max(1, (int)std::ceil((opt.maxXZ.y - opt.minXZ.y) / opt.cellSize));
+	std::vector<ClusterTargets> targets;
+	for (const InstanceBatchDesc& desc : scene.batches) {
+		const bool named = std::find(opt.batchNames.begin(), opt.batchNames.end(), desc.name) != opt.batchNames.end();
+		if (!opt.batchNames.empty() && !named) { continue; }
+		MyPoissonSample* sample = MyPoissonSample::fromFile(desc.samplePath);
+		if (sample == nullptr) {
+			std::cerr << "cannot load " << desc.samplePath << "\n";
+			return 1;
+		}
+		if (opt.batchNames.empty() && sample->m_numSample > opt.maxInstances) {
+			std::cout << "skipping " << desc.name << " (" << sample->m_numSample << " instances)\n";
+			delete sample;
+			continue;
+		}
+		std::vector<InstanceCluster> clusters;
+		sortSamplesByCluster(*sample, opt.clusterSize, clusters);
+		std::vector<InstanceDataGPU> instances((size_t)sample->m_numSample);
+		buildInstanceData(*sample, desc.sphereCenterOS, desc.sphereRadiusOS, instances.data());
+
+		PotentiallyVisibleSet::Batch batch;
+		batch.name = desc.name;
+		batch.numInstances = sample->m_numSample;
+		batch.firstCluster = pvs.numCluster;
+		for (const InstanceCluster& cluster : clusters) {
+			batch.clusterCells.push_back(cluster.cell);
+			ClusterTargets t;
+			for (int i = cluster.first; i < cluster.first + cluster.count; ++i) {
+				const glm::vec3 center(instances[i].sphere);
+				const float radius = instances[i].sphere.w;
+				t.boundsMin = glm::min(t.boundsMin, center - glm::vec3(radius));
+				t.boundsMax = glm::max(t.boundsMax, center + glm::vec3(radius));
+			}
+			for (int j = 0; j < 3; ++j) {
+				for (int i = 0; i < 3; ++i) {
+					t.points.push_back(glm::vec3(glm::mix(t.boundsMin.x, t.boundsMax.x, i * 0.5f), t.boundsMax.y, glm::mix(t.boundsMin.z, t.boundsMax.z, j * 0.5f)));
+				}
+			}
+			const int step = std::max(1, cluster.count / 8);
+			for (int i = cluster.first; i < cluster.first + cluster.count; i += step) {
+				t.points.push_back(glm::vec3(instances[i].sphere) + glm::vec3(0.0f, instances[i].sphere.w, 0.0f));
+			}
+			targets.push_back(t);
+		}
+		pvs.numCluster += (int)clusters.size();
+		pvs.batches.push_back(batch);
+		std::cout << desc.name << ": " << sample->m_numSample << " instances in " << clusters.size() << " clusters\n";
+		delete sample;
+	}
+	if (pvs.batches.empty()) {
+		std::cerr << "no batch to bake\n";
+		return 1;
+	}
+	std::cout << "clusters: " << pvs.numCluster << ", " << seconds(start) << " s\n";
+
+	// 2. per view cell: eyes on a grid at the lowest and highest baked height; a cluster is potentially
+	// visible when a ray from one of them reaches one of its points over the terrain
+	start = Clock::now();
+	const float texel = 2.0f * scene.chunkSize / (float)std::max(terrain->m_elevationMapWidth - 1, 1);
+	auto rayClear = [&](const glm::vec3& from, const glm::vec3& to) {
+		const glm::vec3 d = to - from;
+		const float length = glm::length(d);
+		const int numStep = (int)(length / texel);
+		for (int s = 1; s < numStep; ++s) {
+			const glm::vec3 p = from + d * ((float)s / (float)numStep);
+			if (terrain->height(p.x, p.z) > p.y + opt.margin) return false;
+		}
+		return true;
+	};
+	const int numCell = pvs.cellsX * pvs.cellsZ;
+	pvs.maxEyeHeight.resize(numCell);
+	pvs.cellBits.resize(numCell);
+	std::atomic<int> nextCell(0);
+	std::atomic<long long> numVisible(0);
+	auto bakeCells = [&]() {
+		std::vector<uint8_t> bits;
+		std::vector<glm::vec3> eyes;
+		for (int cell = nextCell++; cell < numCell; cell = nextCell++) {
+			const glm::vec2 cellMin = pvs.origin + opt.cellSize * glm::vec2((float)(cell % pvs.cellsX), (float)(cell / pvs.cellsX));
+			// highest eye over the cell, at texel spacing
+			const int numStep = std::max(2, (int)std::ceil(opt.cellSize / texel) + 1);
+			float groundMin = FLT_MAX, groundMax = -FLT_MAX;
+			for (int j = 0; j < numStep; ++j) {
+				for (int i = 0; i < numStep; ++i) {
+					const float g = terrain->height(cellMin.x + opt.cellSize * i / (numStep - 1), cellMin.y + opt.cellSize * j / (numStep - 1));
+					groundMin = std::min(groundMin, g);
+					groundMax = std::max(groundMax, g);
+				}
+			}
+			pvs.maxEyeHeight[cell] = groundMax + opt.eyeOffset + opt.eyeRange;
+			const glm::vec3 eyeMin(cellMin.x, groundMin + opt.eyeOffset, cellMin.y);
+			const glm::vec3 eyeMax(cellMin.x + opt.cellSize, pvs.maxEyeHeight[cell], cellMin.y + opt.cellSize);
+			eyes.clear();
+			for (int j = 0; j < opt.numSample; ++j) {
+				for (int i = 0; i < opt.numSample; ++i) {
+					const float x = cellMin.x + opt.cellSize * i / (opt.numSample - 1), z = cellMin.y + opt.cellSize * j / (opt.numSample - 1);
+					const float g = terrain->height(x, z) + opt.eyeOffset;
+					eyes.push_back(glm::vec3(x, g + opt.eyeRange, z));
+					eyes.push_back(glm::vec3(x, g, z));
+				}
+			}
+
+			bits.assign((size_t)pvs.numCluster, 0);
+			for (int c = 0; c < pvs.numCluster; ++c) {
+				const ClusterTargets& t = targets[c];
+				const float distance2 = boxDistance2(eyeMin, eyeMax, t.boundsMin, t.boundsMax);
+				if (distance2 > opt.maxDistance * opt.maxDistance) continue;
+				// overlapping or next to the view cell
+				bool visible = distance2 <= opt.cellSize * opt.cellSize;
+				for (size_t e = 0; e < eyes.size() && !visible; ++e) {
+					for (size_t p = 0; p < t.points.size() && !visible; ++p) {
+						visible = rayClear(eyes[e], t.points[p]);
+					}
+				}
+				bits[c] = visible ? 1 : 0;
+			}
+			numVisible += (long long)std::count(bits.begin(), bits.end(), (uint8_t)1);
+			PotentiallyVisibleSet::encodeBits(bits, pvs.cellBits[cell]);
+		}
+	};
+	std::vector<std::thread> threads;
+	for (int t = 1; t < opt.numThread; ++t) {
+		threads.emplace_back(bakeCells);
+	}
+	bakeCells();
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	size_t numByte = 0;
+	for (const std::vector<uint8_t>& bits : pvs.cellBits) {
+		numByte += bits.size();
+	}
+	std::cout << "view cells: " << pvs.cellsX << "x" << pvs.cellsZ << ", " << 100.0 * (double)numVisible / ((double)numCell * pvs.numCluster)
+		<< "% of clusters potentially visible, " << numByte << " bytes of bitsets (" << ((size_t)numCell * ((pvs.numCluster + 7) / 8))
+		<< " uncompressed), " << opt.numThread << " thread(s), " << seconds(start) << " s\n";
+
+	const bool written = pvs.writeFile(opt.outputPath);
+	std::cout << (written ? "wrote " : "cannot write ") << opt.outputPath << "\n";
+	delete[] terrain->m_elevationMap;
+	delete[] terrain->m_normalMap;
+	delete[] terrain->m_albedoMap;
+	delete terrain;
+	return written ? 0 : 1;
+}
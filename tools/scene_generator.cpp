@@ -0,0 +1,45 @@
+// CG2025_scenegen: writes a synthetic stress scene (terrain + instance batches) for scaling tests.
+// Usage: CG2025_scenegen <outputDir> [options]   (options: see parseSceneGeneratorArg in SceneGenerator.h)
+// Run the renderer on it with: CG2025 --scene <outputDir>/generated.scene
+#include <chrono>
+#include <iostream>
+#include <string>
+#include "SceneGenerator.h"
+
+int main(int argc, char** argv)
+{
+	if (argc < 2 || argv[1][0] == '-') {
+		std::cerr << "usage: CG2025_scenegen <outputDir> [--terrain-size N] [--chunk-size S] [--chunk-res N] [--height H] [--seed N]\n"
+			<< "         [--clusters N] [--cluster-radius R] [--lot-spacing L] [--street-width W]\n"
+			<< "         [--batch <grassB|bush01|bush05|buildingV1|buildingV2> <count> <uniform|clustered|city>]...\n";
+		return 2;
+	}
+
+	SceneGeneratorOptions opt;
+	opt.outputDir = argv[1];
+	for (int i = 2; i < argc; ++i) {
+		std::string error;
+		if (!parseSceneGeneratorArg(argc, argv, i, opt, error)) {
+			std::cerr << "unknown option: " << argv[i] << "\n";
+			return 2;
+		}
+		if (!error.empty()) {
+			std::cerr << error << "\n";
+			return 2;
+		}
+	}
+	if (opt.batches.empty()) {
+		addDefaultGeneratedBatches(opt);
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	SceneDescription scene;
+	std::string error;
+	if (!generateScene(opt, scene, error, std::cout)) {
+		std::cerr << error << "\n";
+		return 1;
+	}
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "done in " << seconds << " s\n";
+	return 0;
+}